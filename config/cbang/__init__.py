@@ -26,6 +26,14 @@ def configure_deps(conf, local = True, with_openssl = True):
         env.CBConfigDef('HAVE_MARIADB')
         env.cb_enabled.add('mariadb')
 
+    # Precompressed static content
+    if conf.CBCheckCHeader('brotli/encode.h') and \
+            conf.CBCheckLib('brotlienc'):
+        env.CBConfigDef('HAVE_BROTLI')
+
+    if conf.CBCheckCHeader('zstd.h') and conf.CBCheckLib('zstd'):
+        env.CBConfigDef('HAVE_ZSTD')
+
     # Boost
     if env['PLATFORM'] == 'win32': env.CBDefine('BOOST_ALL_NO_LIB')
 
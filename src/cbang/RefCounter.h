@@ -37,6 +37,7 @@
 #include <cbang/os/Mutex.h>
 
 #include <typeinfo>
+#include <atomic>
 
 
 namespace cb {
@@ -119,16 +120,17 @@ namespace cb {
   };
 
 
+  /// Thread safe reference counter which serializes access with a Mutex
   template<typename T, class Dealloc_T = DeallocNew<T> >
-  class ProtectedRefCounterImpl :
+  class MutexRefCounterImpl :
     public RefCounterImpl<T, Dealloc_T>, public Mutex {
   protected:
     typedef RefCounterImpl<T, Dealloc_T> Super_T;
     using Super_T::count;
 
   public:
-    ProtectedRefCounterImpl(unsigned count = 0) : Super_T(count) {}
-    static RefCounter *create() {return new ProtectedRefCounterImpl;}
+    MutexRefCounterImpl(unsigned count = 0) : Super_T(count) {}
+    static RefCounter *create() {return new MutexRefCounterImpl;}
     static bool staticIsProtected() {return true;}
 
     // From RefCounterImpl
@@ -168,6 +170,59 @@ namespace cb {
   };
 
 
+
+  /// Lock-free thread safe reference counter
+  template<typename T, class Dealloc_T = DeallocNew<T> >
+  class AtomicRefCounterImpl : public RefCounter {
+  protected:
+    std::atomic<unsigned> count;
+
+  public:
+    AtomicRefCounterImpl(unsigned count = 0) : count(count) {}
+    static RefCounter *create() {return new AtomicRefCounterImpl;}
+    static bool staticIsProtected() {return true;}
+
+    void release(const void *ptr) {
+      delete this;
+      if (ptr) Dealloc_T::dealloc((T *)ptr);
+    }
+
+    // From RefCounter
+    bool isProtected() const {return true;}
+    unsigned getCount() const {return count.load(std::memory_order_acquire);}
+
+    void incCount() {
+      // New references are only made from existing ones, no ordering needed
+#ifdef DEBUG
+      log(typeid(T).name(), count.fetch_add(1, std::memory_order_relaxed) + 1);
+#else
+      count.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    void decCount(const void *ptr) {
+      // Last reference must see all other threads' writes before deallocating
+      unsigned x = count.fetch_sub(1, std::memory_order_acq_rel);
+
+      if (!x) {
+        count.fetch_add(1, std::memory_order_relaxed);
+        raise("Already zero!");
+      }
+
+#ifdef DEBUG
+      log(typeid(T).name(), x - 1);
+#endif
+
+      if (x == 1) release(ptr);
+    }
+  };
+
+
+  /// The default thread safe reference counter
+  template<typename T, class Dealloc_T = DeallocNew<T> >
+  using ProtectedRefCounterImpl = AtomicRefCounterImpl<T, Dealloc_T>;
+
+
   class RefCounterPhonyImpl : public RefCounter {
     static RefCounterPhonyImpl singleton;
     RefCounterPhonyImpl() {}
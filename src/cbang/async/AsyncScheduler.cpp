@@ -0,0 +1,89 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "AsyncScheduler.h"
+
+#include <cbang/log/Logger.h>
+
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  struct AsyncTask : public Event::ConcurrentPool::Task {
+    AsyncScheduler::callback_t work;
+    AsyncScheduler::callback_t cb;
+    AsyncScheduler::error_cb_t errorCB;
+    AsyncScheduler::callback_t completeCB;
+
+    AsyncTask(int priority, AsyncScheduler::callback_t work,
+              AsyncScheduler::callback_t cb,
+              AsyncScheduler::error_cb_t errorCB,
+              AsyncScheduler::callback_t completeCB) :
+      Task(priority), work(work), cb(cb), errorCB(errorCB),
+      completeCB(completeCB) {}
+
+    // From Task
+    void run() {work();}
+    void success() {if (cb) cb();}
+
+    void error(const Exception &e) {
+      if (errorCB) errorCB(e);
+      else LOG_ERROR("Async task failed: " << e);
+    }
+
+    void complete() {completeCB();}
+  };
+}
+
+
+AsyncScheduler::AsyncScheduler(Event::Base &base, unsigned threads) :
+  pool(base, threads),
+  keepAlive(base.newEvent([] (Event::Event &, int, unsigned) {}, 0)),
+  outstanding(0) {
+  pool.start();
+}
+
+
+AsyncScheduler::~AsyncScheduler() {pool.join();}
+
+
+void AsyncScheduler::add(callback_t work, callback_t cb, error_cb_t error,
+                         int priority) {
+  if (!outstanding++) keepAlive->add(365 * 24 * 60 * 60);
+
+  pool.submit(new AsyncTask(priority, work, cb, error ? error : errorCB,
+                            [this] () {completed();}));
+}
+
+
+void AsyncScheduler::completed() {if (!--outstanding) keepAlive->del();}
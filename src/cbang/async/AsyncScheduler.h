@@ -0,0 +1,76 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include <cbang/event/ConcurrentPool.h>
+
+#include <functional>
+#include <atomic>
+
+
+namespace cb {
+  /// Runs work on a pool of threads and calls back on the Event::Base thread
+  class AsyncScheduler {
+  public:
+    typedef std::function<void ()> callback_t;
+    typedef std::function<void (const Exception &)> error_cb_t;
+
+  protected:
+    Event::ConcurrentPool pool;
+    error_cb_t errorCB;
+
+    /// Keeps the event loop running while work is outstanding
+    SmartPointer<Event::Event> keepAlive;
+    std::atomic<unsigned> outstanding;
+
+  public:
+    AsyncScheduler(Event::Base &base, unsigned threads = 4);
+    ~AsyncScheduler();
+
+    /// Called when work throws and add() was not given an error callback
+    void setErrorHandler(error_cb_t cb) {errorCB = cb;}
+
+    unsigned getNumReady() const {return pool.getNumReady();}
+    unsigned getNumActive() const {return pool.getNumActive();}
+
+    /// Callbacks with higher @param priority are delivered first
+    void add(callback_t work, callback_t cb = 0, error_cb_t error = 0,
+             int priority = 0);
+
+    void stop() {pool.stop();}
+    void join() {pool.join();}
+
+  protected:
+    void completed();
+  };
+}
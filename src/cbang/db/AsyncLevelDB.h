@@ -32,19 +32,40 @@
 
 #pragma once
 
+#include <cbang/config.h>
+
+#ifdef HAVE_LEVELDB
+
 #include "LevelDB.h"
 
 #include <cbang/SmartPointer.h>
+#include <cbang/Exception.h>
 #include <cbang/async/AsyncScheduler.h>
+#include <cbang/log/Logger.h>
+
+#include <leveldb/iterator.h> // Foreach copies Iterators inline
 
 #include <functional>
+#include <vector>
 
 
 namespace cb {
+  /// LevelDB calls run on the scheduler's threads.  Callbacks are made from
+  /// the scheduler's Event::Base.  Reads and writes operate on a copy of the
+  /// DB handle, open() and close() on this object which must outlive them.
   class AsyncLevelDB : public LevelDB {
     SmartPointer<AsyncScheduler> scheduler;
 
   public:
+    typedef std::vector<std::string> keys_t;
+    typedef std::vector<std::string> values_t;
+    typedef std::vector<std::pair<std::string, std::string> > pairs_t;
+    typedef std::function<bool (const std::string &key,
+                                const std::string &value)> foreach_cb_t;
+    /// The error is null if the iteration ended normally
+    typedef std::function<void (const SmartPointer<Exception> &error)>
+    foreach_done_t;
+
     AsyncLevelDB(const LevelDB &db,
                  const SmartPointer<AsyncScheduler> &scheduler) :
       LevelDB(db), scheduler(scheduler) {}
@@ -59,6 +80,11 @@ namespace cb {
       LevelDB(name, comparator), scheduler(scheduler) {}
 
 
+    const SmartPointer<AsyncScheduler> &getScheduler() const {
+      return scheduler;
+    }
+
+
     AsyncLevelDB ns(const std::string &name) {
       return AsyncLevelDB(LevelDB::ns(name), scheduler);
     }
@@ -66,7 +92,8 @@ namespace cb {
 
     void open(const std::string &path, std::function<void ()> cb,
               int options = 0) {
-      scheduler->add([&] () {LevelDB::open(path, options);}, cb);
+      scheduler->add([this, path, options] () {LevelDB::open(path, options);},
+                     cb);
     }
 
 
@@ -77,80 +104,199 @@ namespace cb {
 
     void has(const std::string &key, std::function<void (bool)> cb,
              int options = 0) const {
-      bool result = false;
+      LevelDB db = *this;
+      SmartPointer<bool> result = new bool(false);
 
-      scheduler->add([&] () {result = LevelDB::has(key, options);},
-                     [&] () {if (cb) cb(result);});
+      scheduler->add([db, key, options, result] () {
+          *result = db.has(key, options);
+        }, [cb, result] () {if (cb) cb(*result);});
     }
 
 
     void get(const std::string &key,
              std::function<void (const std::string &)> cb,
              int options = 0) const {
-      std::string result;
+      LevelDB db = *this;
+      SmartPointer<std::string> result = new std::string;
 
-      scheduler->add([&] () {result = LevelDB::get(key, options);},
-                     [&] () {if (cb) cb(result);});
+      scheduler->add([db, key, options, result] () {
+          *result = db.get(key, options);
+        }, [cb, result] () {if (cb) cb(*result);});
     }
 
 
     void get(const std::string &key, const std::string &defaultValue,
              std::function<void (const std::string &)> cb,
              int options = 0) const {
-      std::string result;
+      LevelDB db = *this;
+      SmartPointer<std::string> result = new std::string;
+
+      scheduler->add([db, key, defaultValue, options, result] () {
+          *result = db.get(key, defaultValue, options);
+        }, [cb, result] () {if (cb) cb(*result);});
+    }
+
+
+    /// Values are returned in key order, @param defaultValue for missing keys
+    void get(const keys_t &keys, const std::string &defaultValue,
+             std::function<void (const values_t &)> cb,
+             int options = 0) const {
+      LevelDB db = *this;
+      SmartPointer<values_t> results = new values_t;
+
+      scheduler->add([db, keys, defaultValue, options, results] () {
+          results->reserve(keys.size());
+          for (unsigned i = 0; i < keys.size(); i++)
+            results->push_back(db.get(keys[i], defaultValue, options));
+        }, [cb, results] () {if (cb) cb(*results);});
+    }
+
+
+    void set(const std::string &key, const std::string &value,
+             std::function<void ()> cb, int options = 0) {
+      LevelDB db = *this;
+      scheduler->add([db, key, value, options] () mutable {
+          db.set(key, value, options);
+        }, cb);
+    }
+
+
+    /// Writes all @param pairs in a single batch
+    void set(const pairs_t &pairs, std::function<void ()> cb,
+             int options = 0) {
+      LevelDB db = *this;
+      scheduler->add([db, pairs, options] () mutable {
+          Batch batch = db.batch();
+          for (unsigned i = 0; i < pairs.size(); i++)
+            batch.set(pairs[i].first, pairs[i].second);
+          batch.commit(options);
+        }, cb);
+    }
+
 
-      scheduler->add([&] () {
-          result = LevelDB::get(key, defaultValue, options);
-        }, [&] () {if (cb) cb(result);});
+    void erase(const std::string &key, std::function<void ()> cb,
+               int options = 0) {
+      LevelDB db = *this;
+      scheduler->add([db, key, options] () mutable {db.erase(key, options);},
+                     cb);
     }
 
 
-    void foreach(std::function<bool (const std::string &key,
-                                     const std::string &value)> cb,
-                 const std::string &seek = std::string(),
+    /// Iterates in chunks of @param batchSize on the scheduler's threads.
+    /// @param cb is called from the event loop for each pair until it
+    /// returns false.  @param done is always called when the iteration
+    /// ends, with the error if reading or @param cb failed.
+    void foreach(foreach_cb_t cb, const std::string &seek = std::string(),
                  bool reverse = false, int options = 0,
-                 int batchSize = 1000) const {
-      LevelDB::Iterator it = iterator(options);
-      bool first = true;
+                 unsigned batchSize = 1000, foreach_done_t done = 0) const {
+      SmartPointer<Foreach> state =
+        new Foreach(*this, cb, done, seek, reverse, options, batchSize);
+      next(scheduler, state);
+    }
+
+
+    void commit(const Batch &batch, std::function<void ()> cb,
+                int options = 0) {
+      Batch b = batch;
+      scheduler->add([b, options] () mutable {b.commit(options);}, cb);
+    }
 
-      typedef std::vector<std::pair<std::string, std::string> > results_t;
-      results_t results(batchSize);
 
-      auto batch = [&] () {
-        if (first) {
+    void compact(std::function<void ()> cb,
+                 const std::string &begin = std::string(),
+                 const std::string &end = std::string()) {
+      LevelDB db = *this;
+      scheduler->add([db, begin, end] () mutable {db.compact(begin, end);},
+                     cb);
+    }
+
+  protected:
+    struct Foreach {
+      LevelDB db;
+      Iterator it;
+      foreach_cb_t cb;
+      foreach_done_t done;
+      std::string seek;
+      bool reverse;
+      int options;
+      unsigned batchSize;
+      bool started = false;
+      pairs_t results;
+
+      Foreach(const LevelDB &db, foreach_cb_t cb, foreach_done_t done,
+              const std::string &seek, bool reverse, int options,
+              unsigned batchSize) :
+        db(db), it(0, db.getNS()), cb(cb), done(done), seek(seek),
+        reverse(reverse), options(options),
+        batchSize(batchSize ? batchSize : 1) {}
+
+
+      // Called from the scheduler's threads
+      void read() {
+        if (!started) {
+          it = db.iterator(options);
+
           if (seek.empty()) {
             if (reverse) it.last();
             else it.first();
           } else it.seek(seek);
 
-          first = false;
+          started = true;
         }
 
-        for (int i = 0; i < batchSize && it.valid(); reverse ? it-- : it++)
-          results.push_back(results_t::value_type(it.key(), it.value()));
-      };
+        results.clear();
+        for (unsigned i = 0; i < batchSize && it.valid();
+             reverse ? it-- : it++, i++)
+          results.push_back(pairs_t::value_type(it.key(), it.value()));
+      }
+
 
-      std::function<void ()> process = [&] () {
+      // Called from the event loop, returns true if there is more to read
+      bool process() {
         for (unsigned i = 0; i < results.size(); i++)
-          if (!cb(results[i].first, results[i].second)) return;
+          if (!cb(results[i].first, results[i].second)) {
+            results.clear();
+            return false;
+          }
+
+        bool more = results.size() == batchSize;
         results.clear();
 
-        if (first || it.valid()) scheduler->add(batch, process);
-      };
+        return more;
+      }
 
-      process(); // Kick things off
-    }
 
+      void finish(const SmartPointer<Exception> &error) {
+        if (done) done(error);
+        else if (error.isSet()) LOG_ERROR("Async foreach failed: " << *error);
+      }
+    };
 
-    void commit(Batch &batch, std::function<void ()> cb, int options = 0) {
-      scheduler->add([&] () {batch.commit(options);}, cb);
-    }
 
+    static void next(const SmartPointer<AsyncScheduler> &scheduler,
+                     const SmartPointer<Foreach> &state) {
+      auto cb = [scheduler, state] () {
+        SmartPointer<Exception> error;
 
-    void compact(std::function<void ()> cb,
-                 const std::string &begin = std::string(),
-                 const std::string &end = std::string()) {
-      scheduler->add([&] () {LevelDB::compact(begin, end);}, cb);
+        try {
+          if (state->process()) return next(scheduler, state);
+
+        } catch (const Exception &e) {
+          error = new Exception(e);
+
+        } catch (const std::exception &e) {
+          error = new Exception(e.what());
+        }
+
+        state->finish(error);
+      };
+
+      scheduler->add([state] () {state->read();}, cb,
+                     [state] (const Exception &e) {
+                       state->finish(new Exception(e));
+                     });
     }
   };
 }
+
+#endif // HAVE_LEVELDB
@@ -50,7 +50,8 @@ using namespace cb;
 using namespace cb::DB;
 
 
-Database::Database(double timeout) : timeout(timeout), db(0), transaction(0) {}
+Database::Database(double timeout) :
+  timeout(timeout), db(0), transaction(0), statementCacheSize(64) {}
 
 
 Database::~Database() {
@@ -78,6 +79,9 @@ void Database::open(const string &filename, unsigned flags) {
 
 
 void Database::close() {
+  // Statements must be finalized before the connection is closed
+  clearStatementCache();
+
   if (isOpen()) {
     if (sqlite3_close(db) != SQLITE_OK)
       LOG_WARNING("Failed to close DB connection: " << lastErrorMsg());
@@ -86,6 +90,64 @@ void Database::close() {
 }
 
 
+void Database::setJournalMode(journal_mode_t mode) {
+  const char *name;
+
+  switch (mode) {
+  case JOURNAL_DELETE:   name = "delete";   break;
+  case JOURNAL_TRUNCATE: name = "truncate"; break;
+  case JOURNAL_PERSIST:  name = "persist";  break;
+  case JOURNAL_MEMORY:   name = "memory";   break;
+  case JOURNAL_WAL:      name = "wal";      break;
+  case JOURNAL_OFF:      name = "off";      break;
+  default: THROW("Invalid journal mode " << mode);
+  }
+
+  // SQLite returns the resulting mode which may differ, e.g. for in-memory DBs
+  string result;
+  execute(SSTR("PRAGMA journal_mode=" << name), result);
+  if (String::toLower(result) != name)
+    LOG_WARNING("Journal mode '" << name << "' not set, using '" << result
+                << "'");
+}
+
+
+void Database::setSynchronous(synchronous_t sync) {
+  const char *name;
+
+  switch (sync) {
+  case SYNC_OFF:    name = "OFF";    break;
+  case SYNC_NORMAL: name = "NORMAL"; break;
+  case SYNC_FULL:   name = "FULL";   break;
+  case SYNC_EXTRA:  name = "EXTRA";  break;
+  default: THROW("Invalid synchronous mode " << sync);
+  }
+
+  execute(SSTR("PRAGMA synchronous=" << name));
+}
+
+
+void Database::setMMapSize(uint64_t size) {
+  execute(SSTR("PRAGMA mmap_size=" << size));
+}
+
+
+void Database::setStatementCacheSize(unsigned size) {
+  statementCacheSize = size;
+
+  while (statementCacheSize < cache.size()) {
+    cacheIndex.erase(cache.back().first);
+    cache.pop_back();
+  }
+}
+
+
+void Database::clearStatementCache() {
+  cacheIndex.clear();
+  cache.clear();
+}
+
+
 void Database::executef(const char *sql, ...) {
   va_list ap;
 
@@ -119,17 +181,17 @@ void Database::execute(const string &sql) {
 
 
 bool Database::execute(const string &sql, int64_t &result) {
-  return compile(sql)->execute(result);
+  return prepare(sql)->execute(result);
 }
 
 
 bool Database::execute(const string &sql, double &result) {
-  return compile(sql)->execute(result);
+  return prepare(sql)->execute(result);
 }
 
 
 bool Database::execute(const string &sql, string &result) {
-  return compile(sql)->execute(result);
+  return prepare(sql)->execute(result);
 }
 
 
@@ -149,13 +211,41 @@ SmartPointer<Statement> Database::compile(const string &sql) {
 }
 
 
+SmartPointer<Statement> Database::prepare(const string &sql) {
+  auto it = cacheIndex.find(sql);
+
+  if (it != cacheIndex.end()) {
+    // Move to front
+    cache.splice(cache.begin(), cache, it->second);
+
+    SmartPointer<Statement> stmt = it->second->second;
+    stmt->reset();
+    stmt->clearBindings();
+    return stmt;
+  }
+
+  SmartPointer<Statement> stmt = compile(sql);
+  if (!statementCacheSize) return stmt;
+
+  cache.push_front(cache_t::value_type(sql, stmt));
+  cacheIndex[sql] = cache.begin();
+
+  if (statementCacheSize < cache.size()) {
+    cacheIndex.erase(cache.back().first);
+    cache.pop_back();
+  }
+
+  return stmt;
+}
+
+
 SmartPointer<Transaction> Database::begin(transaction_t type, double timeout) {
   if (transaction) THROW("Already in a transaction");
 
   switch (type) {
-  case DEFERRED: execute("BEGIN DEFERRED"); break;
-  case IMMEDIATE: execute("BEGIN IMMEDIATE"); break;
-  case EXCLUSIVE: execute("BEGIN EXCLUSIVE"); break;
+  case DEFERRED: prepare("BEGIN DEFERRED")->execute(); break;
+  case IMMEDIATE: prepare("BEGIN IMMEDIATE")->execute(); break;
+  case EXCLUSIVE: prepare("BEGIN EXCLUSIVE")->execute(); break;
   }
 
   return transaction = new Transaction(this, timeout);
@@ -165,7 +255,7 @@ SmartPointer<Transaction> Database::begin(transaction_t type, double timeout) {
 void Database::commit() {
   if (!transaction) THROW("Not in a transaction");
 
-  execute("COMMIT");
+  prepare("COMMIT")->execute();
 
   // NOTE Transaction is deleted by the SmartPointer returned from begin()
   transaction->release();
@@ -176,7 +266,7 @@ void Database::commit() {
 void Database::rollback() {
   if (!transaction) THROW("Not in a transaction");
 
-  execute("ROLLBACK");
+  prepare("ROLLBACK")->execute();
 
   // NOTE Transaction is deleted by the SmartPointer returned from begin()
   transaction->release();
@@ -38,6 +38,8 @@
 #include <cbang/SmartPointer.h>
 
 #include <string>
+#include <list>
+#include <map>
 
 struct sqlite3;
 
@@ -51,6 +53,13 @@ namespace cb {
       sqlite3 *db;
       Transaction *transaction;
 
+      // LRU prepared statement cache, most recently used first
+      unsigned statementCacheSize;
+      typedef std::list<std::pair<std::string, SmartPointer<Statement> > >
+      cache_t;
+      cache_t cache;
+      std::map<std::string, cache_t::iterator> cacheIndex;
+
     public:
       typedef enum {
         DEFERRED,
@@ -69,6 +78,22 @@ namespace cb {
         PRIVATE_CACHE = 0x00040000,
       } open_mode_t;
 
+      typedef enum {
+        JOURNAL_DELETE,
+        JOURNAL_TRUNCATE,
+        JOURNAL_PERSIST,
+        JOURNAL_MEMORY,
+        JOURNAL_WAL,
+        JOURNAL_OFF,
+      } journal_mode_t;
+
+      typedef enum {
+        SYNC_OFF,
+        SYNC_NORMAL,
+        SYNC_FULL,
+        SYNC_EXTRA,
+      } synchronous_t;
+
       Database(double timeout = 30);
       virtual ~Database();
 
@@ -79,6 +104,15 @@ namespace cb {
       void open(const std::string &con, unsigned flags = READ_WRITE | CREATE);
       void close();
 
+      void setJournalMode(journal_mode_t mode);
+      void setSynchronous(synchronous_t sync);
+      /// Maximum number of bytes of the database file to memory map
+      void setMMapSize(uint64_t size);
+
+      unsigned getStatementCacheSize() const {return statementCacheSize;}
+      void setStatementCacheSize(unsigned size);
+      void clearStatementCache();
+
       void executef(const char *sql, ...);
       void execute(const std::string &sql);
       bool execute(const std::string &sql, int64_t &result);
@@ -87,6 +121,12 @@ namespace cb {
 
       SmartPointer<Statement> compilef(const char *sql, ...);
       SmartPointer<Statement> compile(const std::string &sql);
+      /**
+       * Returns a reset statement from the cache, compiling it on a miss.
+       * Cached statements are shared so finish with one before preparing
+       * the same SQL again.
+       */
+      SmartPointer<Statement> prepare(const std::string &sql);
 
       SmartPointer<Transaction> begin(transaction_t type = DEFERRED,
                                       double timeout = 30);
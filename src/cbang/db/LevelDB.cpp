@@ -38,6 +38,9 @@
 
 #include <cbang/Exception.h>
 
+#include <cstring>
+#include <algorithm>
+
 #include <leveldb/db.h>
 #include <leveldb/slice.h>
 #include <leveldb/comparator.h>
@@ -61,6 +64,26 @@ namespace {
 }
 
 
+LevelDBNS::Slice LevelDBNS::Slice::substr(size_t offset) const {
+  if (length < offset) THROW("Slice offset " << offset << " out of range");
+  return Slice(ptr + offset, length - offset);
+}
+
+
+bool LevelDBNS::Slice::startsWith(const Slice &prefix) const {
+  return prefix.length <= length &&
+    (!prefix.length || !memcmp(ptr, prefix.ptr, prefix.length));
+}
+
+
+int LevelDBNS::Slice::compare(const Slice &o) const {
+  size_t len = min(length, o.length);
+  int ret = len ? memcmp(ptr, o.ptr, len) : 0;
+  if (ret) return ret;
+  return length < o.length ? -1 : (o.length < length ? 1 : 0);
+}
+
+
 string LevelDBNS::nsKey(const string &key) const {
   return name + key;
 }
@@ -73,11 +96,24 @@ string LevelDBNS::stripKey(const string &key) const {
 }
 
 
+LevelDBNS::Slice LevelDBNS::stripKey(const Slice &key) const {
+  if (key.size() < name.length())
+    THROW("Invalid key '" << key.toString() << "' for namespace '" << name
+          << "'");
+  return key.substr(name.length());
+}
+
+
 bool LevelDBNS::inNS(const string &key) const {
   return name.empty() || key.compare(0, name.length(), name) == 0;
 }
 
 
+bool LevelDBNS::inNS(const Slice &key) const {
+  return key.startsWith(name);
+}
+
+
 void LevelDBNS::check(const leveldb::Status &s, const std::string &key) const {
   if (s.ok()) return;
   if (s.IsNotFound()) THROW("DB ERROR: Not '" << nsKey(key) << "' found");
@@ -90,8 +126,15 @@ int LevelDB::Comparator::operator()(const string &, const string &) const {
 }
 
 
+namespace {
+  LevelDBNS::Slice toSlice(const leveldb::Slice &s) {
+    return LevelDBNS::Slice(s.data(), s.size());
+  }
+}
+
+
 bool LevelDB::Iterator::valid() const {
-  return it->Valid() && inNS(it->key().ToString());
+  return it->Valid() && inNS(toSlice(it->key()));
 }
 
 
@@ -127,22 +170,26 @@ void LevelDB::Iterator::prev() {
 }
 
 
-string LevelDB::Iterator::key() const {
+string LevelDB::Iterator::key() const {return keySlice().toString();}
+string LevelDB::Iterator::value() const {return valueSlice().toString();}
+
+
+LevelDB::Slice LevelDB::Iterator::keySlice() const {
   if (!valid()) THROW("Cannot call key() on invalid iterator");
-  return stripKey(it->key().ToString());
+  return stripKey(toSlice(it->key()));
 }
 
 
-string LevelDB::Iterator::value() const {
+LevelDB::Slice LevelDB::Iterator::valueSlice() const {
   if (!valid()) THROW("Cannot call value() on invalid iterator");
-  return it->value().ToString();
+  return toSlice(it->value());
 }
 
 
 bool LevelDB::Iterator::operator==(const Iterator &it) const {
   if (!valid() && !it.valid()) return true;
   if (!valid() || !it.valid()) return false;
-  return this->it->key().ToString() == it.it->key().ToString();
+  return this->it->key() == it.it->key();
 }
 
 
@@ -193,7 +240,7 @@ namespace {
       comparator(comparator) {}
 
     int Compare(const leveldb::Slice &a, const leveldb::Slice &b) const {
-      return (*comparator)(a.data(), a.size(), b.data(), b.size());
+      return comparator->compare(toSlice(a), toSlice(b));
     }
 
     const char *Name() const {return comparator->getName().c_str();}
@@ -267,6 +314,16 @@ string LevelDB::get(const string &key, const string &defaultValue,
 }
 
 
+bool LevelDB::lookup(const string &key, string &value, int options) const {
+  leveldb::Status s = hasNS() ?
+    db->Get(getReadOptions(options), nsKey(key), &value) :
+    db->Get(getReadOptions(options), key, &value);
+  if (s.IsNotFound()) return false;
+  check(s, key);
+  return true;
+}
+
+
 void LevelDB::set(const string &key, const string &value, int options) {
   check(db->Put(getWriteOptions(options), nsKey(key), value), key);
 }
@@ -319,7 +376,7 @@ void LevelDB::compact(const string &begin, const string &end) {
   SmartPointer<leveldb::Slice> beginSlice =
     begin.empty() ? 0 : new leveldb::Slice(begin);
   SmartPointer<leveldb::Slice> endSlice =
-    end.empty() ? 0 : new leveldb::Slice(begin);
+    end.empty() ? 0 : new leveldb::Slice(end);
 
   db->CompactRange(beginSlice.get(), endSlice.get());
 }
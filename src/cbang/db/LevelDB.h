@@ -39,6 +39,7 @@
 #include <cbang/SmartPointer.h>
 
 #include <string>
+#include <cstring>
 
 namespace leveldb {
   class DB;
@@ -59,6 +60,35 @@ namespace cb {
     std::string name;
 
   public:
+    /// A reference to bytes owned by someone else, e.g. LevelDB
+    class Slice {
+      const char *ptr;
+      size_t length;
+
+    public:
+      Slice() : ptr(0), length(0) {}
+      Slice(const char *ptr, size_t length) : ptr(ptr), length(length) {}
+      Slice(const char *s) : ptr(s), length(s ? strlen(s) : 0) {}
+      Slice(const std::string &s) : ptr(s.data()), length(s.length()) {}
+
+      const char *data() const {return ptr;}
+      size_t size() const {return length;}
+      bool empty() const {return !length;}
+      const char *begin() const {return ptr;}
+      const char *end() const {return ptr + length;}
+      char operator[](size_t i) const {return ptr[i];}
+
+      std::string toString() const {return std::string(ptr, length);}
+      Slice substr(size_t offset) const;
+      bool startsWith(const Slice &prefix) const;
+      int compare(const Slice &o) const;
+
+      bool operator==(const Slice &o) const {return !compare(o);}
+      bool operator!=(const Slice &o) const {return compare(o);}
+      bool operator<(const Slice &o) const {return compare(o) < 0;}
+    };
+
+
     LevelDBNS(const std::string &name = std::string()) : name(name) {}
 
     bool hasNS() const {return !name.empty();}
@@ -66,7 +96,9 @@ namespace cb {
 
     std::string nsKey(const std::string &key) const;
     std::string stripKey(const std::string &key) const;
+    Slice stripKey(const Slice &key) const;
     bool inNS(const std::string &key) const;
+    bool inNS(const Slice &key) const;
     void check(const leveldb::Status &s,
                const std::string &key = std::string()) const;
   };
@@ -97,6 +129,11 @@ namespace cb {
 
       const std::string &getName() const {return name;}
 
+      /// Override compare() to avoid allocating strings on each comparison
+      virtual int compare(const Slice &key1, const Slice &key2) const {
+        return (*this)(key1.data(), key1.size(), key2.data(), key2.size());
+      }
+
       virtual int operator()(const std::string &key1,
                              const std::string &key2) const;
       virtual int operator()(const char *key1, unsigned len1,
@@ -123,6 +160,10 @@ namespace cb {
       std::string key() const;
       std::string value() const;
 
+      /// Valid until the iterator moves
+      Slice keySlice() const;
+      Slice valueSlice() const;
+
       Iterator &operator++() {next(); return *this;}
       void operator++(int) {next();}
       Iterator &operator--() {prev(); return *this;}
@@ -173,6 +214,9 @@ namespace cb {
     std::string get(const std::string &key, int options = 0) const;
     std::string get(const std::string &key,
                     const std::string &defaultValue, int options = 0) const;
+    /// Reuses @param value's storage.  Returns false if @param key is missing.
+    bool lookup(const std::string &key, std::string &value,
+                int options = 0) const;
     void set(const std::string &key, const std::string &value, int options = 0);
     void erase(const std::string &key, int options = 0);
     void eraseAll(int options = 0);
@@ -0,0 +1,93 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "WriteBatch.h"
+
+#include "Statement.h"
+
+#include <cbang/Catch.h>
+#include <cbang/time/Timer.h>
+
+using namespace std;
+using namespace cb;
+using namespace cb::DB;
+
+
+WriteBatch::WriteBatch(Database &db, unsigned maxWrites, double maxDelay,
+                       Database::transaction_t type) :
+  db(db), maxWrites(maxWrites), maxDelay(maxDelay), type(type), writes(0),
+  started(0) {}
+
+
+WriteBatch::~WriteBatch() {TRY_CATCH_ERROR(flush());}
+
+
+void WriteBatch::write(function<void ()> cb) {
+  if (transaction.isNull()) {
+    transaction = db.begin(type);
+    started = Timer::now();
+  }
+
+  cb();
+  writes++;
+
+  if (maxWrites <= writes) flush();
+  else check();
+}
+
+
+void WriteBatch::execute(const string &sql) {
+  write([this, &sql] () {db.prepare(sql)->execute();});
+}
+
+
+void WriteBatch::check() {
+  if (transaction.isSet() && maxDelay <= Timer::now() - started) flush();
+}
+
+
+void WriteBatch::flush() {
+  if (transaction.isNull()) return;
+
+  SmartPointer<Transaction> transaction = this->transaction;
+  this->transaction.release();
+  writes = 0;
+
+  transaction->commit();
+}
+
+
+void WriteBatch::rollback() {
+  // Transaction rolls back if not committed
+  transaction.release();
+  writes = 0;
+}
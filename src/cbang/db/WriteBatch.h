@@ -0,0 +1,81 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include "Database.h"
+
+#include <functional>
+
+namespace cb {
+  namespace DB {
+    /**
+     * Groups many small writes into one transaction.  The transaction is
+     * committed after @param maxWrites writes or when a write finds it has
+     * been open for more than @param maxDelay seconds.  Call check() from a
+     * timer to bound the delay when writes stop.
+     *
+     * SQLite transactions do not nest.  While writes are pending the batch
+     * owns the Database's transaction so Database::begin() will throw.
+     * Call flush() before starting another transaction on the same Database.
+     */
+    class WriteBatch {
+      Database &db;
+      unsigned maxWrites;
+      double maxDelay;
+      Database::transaction_t type;
+
+      SmartPointer<Transaction> transaction;
+      unsigned writes;
+      double started;
+
+    public:
+      WriteBatch(Database &db, unsigned maxWrites = 1000, double maxDelay = 1,
+                 Database::transaction_t type = Database::IMMEDIATE);
+      ~WriteBatch();
+
+      unsigned getMaxWrites() const {return maxWrites;}
+      void setMaxWrites(unsigned maxWrites) {this->maxWrites = maxWrites;}
+      double getMaxDelay() const {return maxDelay;}
+      void setMaxDelay(double maxDelay) {this->maxDelay = maxDelay;}
+
+      bool isPending() const {return transaction.isSet();}
+      unsigned getPendingWrites() const {return writes;}
+
+      void write(std::function<void ()> cb);
+      void execute(const std::string &sql);
+      void check();
+      void flush();
+      void rollback();
+    };
+  }
+}
@@ -37,6 +37,7 @@
 
 #include <cbang/Catch.h>
 #include <cbang/log/Logger.h>
+#include <cbang/json/Sink.h>
 #include <cbang/json/Value.h>
 
 #include <mysql/mysqld_error.h>
@@ -58,29 +59,51 @@ namespace {
     return ready;
   }
 
-  class QueryCallback {
+
+  // Works for both DB and Statement
+  template <typename T>
+  unsigned get_event_flags(const T &db) {
+    return
+      (db.waitRead()    ? Event::Base::EVENT_READ    : 0) |
+      (db.waitWrite()   ? Event::Base::EVENT_WRITE   : 0) |
+      (db.waitExcept()  ? Event::Base::EVENT_CLOSED  : 0) |
+      (db.waitTimeout() ? Event::Base::EVENT_TIMEOUT : 0);
+  }
+
+
+  template <typename T>
+  void add_event(const T &db, Event::Event &e) {
+    if (db.waitTimeout()) e.add(db.getTimeout());
+    else e.add();
+  }
+
+
+  EventDB::callback_t sink_callback(const SmartPointer<JSON::Sink> &sink,
+                                    EventDB::callback_t cb,
+                                    function<void ()> writeRow) {
+    return [sink, cb, writeRow] (EventDB::state_t state) {
+      switch (state) {
+      case EventDB::EVENTDB_BEGIN_RESULT: sink->beginList(); break;
+      case EventDB::EVENTDB_ROW: sink->beginAppend(); writeRow(); break;
+      case EventDB::EVENTDB_END_RESULT: sink->endList(); break;
+      default: break;
+      }
+
+      if (cb) cb(state);
+    };
+  }
+
+
+  class OperationCallback {
+  protected:
     EventDB &db;
     EventDB::callback_t cb;
-    string query;
     unsigned retry;
 
-    typedef enum {
-      STATE_START,
-      STATE_QUERY,
-      STATE_STORE,
-      STATE_FETCH,
-      STATE_FREE,
-      STATE_NEXT,
-      STATE_DONE,
-    } state_t;
-
-    state_t state;
-
   public:
-    QueryCallback(EventDB &db, EventDB::callback_t cb, const string &query,
-                  unsigned retry = 5) :
-      db(db), cb(cb), query(query), retry(retry),
-      state(STATE_START) {}
+    OperationCallback(EventDB &db, EventDB::callback_t cb,
+                      unsigned retry = 5) : db(db), cb(cb), retry(retry) {}
+    virtual ~OperationCallback() {}
 
 
     void call(EventDB::state_t state) {
@@ -96,6 +119,88 @@ namespace {
     }
 
 
+    void done(EventDB::state_t state) {
+      call(state);
+      db.dequeue();
+    }
+
+
+    void start(const SmartPointer<OperationCallback> &self) {
+      try {
+        // By wrapping the event callback in a lambda the SmartPointer is kept
+        // alive
+        if (!next())
+          newEvent([self] (Event::Event &event, int fd, unsigned flags) {
+              (*self)(event, fd, flags);
+            });
+
+      } catch (const Exception &e) {
+        LOG_DEBUG(5, e);
+        done(EventDB::EVENTDB_ERROR);
+      }
+    }
+
+
+    void operator()(Event::Event &event, int fd, unsigned flags) {
+      try {
+        if (continueNB(event_flags_to_db_ready(flags))) {
+          if (!next()) renewEvent(event);
+        } else addEvent(event);
+
+        return;
+
+      } catch (const Exception &e) {
+        // Retry deadlocks
+        if (getErrorNumber() != ER_LOCK_DEADLOCK || !--retry) {
+          LOG_DEBUG(5, e);
+          return done(EventDB::EVENTDB_ERROR);
+        }
+      }
+
+      LOG_WARNING("DB deadlock detected, retrying");
+      call(EventDB::EVENTDB_RETRY);
+      restart();
+
+      try {
+        if (!next()) renewEvent(event);
+      } catch (const Exception &e) {
+        LOG_DEBUG(5, e);
+        done(EventDB::EVENTDB_ERROR);
+      }
+    }
+
+
+    virtual bool next() = 0;
+    virtual void restart() = 0;
+    virtual bool continueNB(unsigned ready) = 0;
+    virtual unsigned getErrorNumber() const = 0;
+    virtual void newEvent(Event::Base::callback_t cb) = 0;
+    virtual void renewEvent(Event::Event &e) = 0;
+    virtual void addEvent(Event::Event &e) = 0;
+  };
+
+
+  class QueryCallback : public OperationCallback {
+    string query;
+
+    typedef enum {
+      STATE_START,
+      STATE_QUERY,
+      STATE_STORE,
+      STATE_FETCH,
+      STATE_FREE,
+      STATE_NEXT,
+      STATE_DONE,
+    } state_t;
+
+    state_t state;
+
+  public:
+    QueryCallback(EventDB &db, EventDB::callback_t cb, const string &query) :
+      OperationCallback(db, cb), query(query), state(STATE_START) {}
+
+
+    // From OperationCallback
     bool next() {
       switch (state) {
       case STATE_START:
@@ -141,7 +246,7 @@ namespace {
 
       case STATE_DONE:
         LOG_DEBUG(6, "EVENTDB_DONE");
-        call(EventDB::EVENTDB_DONE);
+        done(EventDB::EVENTDB_DONE);
         return true;
 
       default: THROW("Invalid state");
@@ -149,43 +254,116 @@ namespace {
     }
 
 
-    void operator()(Event::Event &event, int fd, unsigned flags) {
-      try {
-        if (db.continueNB(event_flags_to_db_ready(flags))) {
-          if (!next()) db.renewEvent(event);
-        } else db.addEvent(event);
+    void restart() {state = STATE_START;}
+    bool continueNB(unsigned ready) {return db.continueNB(ready);}
+    unsigned getErrorNumber() const {return db.getErrorNumber();}
+    void newEvent(Event::Base::callback_t cb) {db.newEvent(cb);}
+    void renewEvent(Event::Event &e) {db.renewEvent(e);}
+    void addEvent(Event::Event &e) {db.addEvent(e);}
+  };
 
-      } catch (const Exception &e) {
-        // Retry deadlocks
-        if (db.getErrorNumber() == ER_LOCK_DEADLOCK && --retry) {
-          LOG_WARNING("DB deadlock detected, retrying");
-          call(EventDB::EVENTDB_RETRY);
-          state = STATE_START;
-          if (!next()) db.renewEvent(event);
 
-        } else {
-          LOG_DEBUG(5, e);
-          call(EventDB::EVENTDB_ERROR);
+  class ExecuteCallback : public OperationCallback {
+    SmartPointer<Statement> stmt;
+    SmartPointer<const JSON::Value> params;
+
+    typedef enum {
+      STATE_START,
+      STATE_PREPARE,
+      STATE_EXECUTE,
+      STATE_STORE,
+      STATE_FETCH,
+      STATE_FREE,
+      STATE_DONE,
+    } state_t;
+
+    state_t state;
+
+  public:
+    ExecuteCallback(EventDB &db, EventDB::callback_t cb,
+                    const SmartPointer<Statement> &stmt,
+                    const SmartPointer<const JSON::Value> &params) :
+      OperationCallback(db, cb), stmt(stmt), params(params),
+      state(STATE_START) {}
+
+
+    // From OperationCallback
+    bool next() {
+      switch (state) {
+      case STATE_START:
+        state = STATE_PREPARE;
+        if (!stmt->isPrepared() && !stmt->prepareNB()) return false;
+
+      case STATE_PREPARE:
+        if (params.isSet()) stmt->bind(*params);
+        state = STATE_EXECUTE;
+        if (!stmt->executeNB()) return false;
+
+      case STATE_EXECUTE:
+        if (!stmt->hasResultSet()) {
+          state = STATE_DONE;
+          return next();
         }
+
+        state = STATE_STORE;
+        if (!stmt->storeResultNB()) return false;
+
+      case STATE_STORE:
+        call(EventDB::EVENTDB_BEGIN_RESULT);
+        state = STATE_FETCH;
+        if (!stmt->fetchNB()) return false;
+
+      case STATE_FETCH:
+        while (stmt->haveRow()) {
+          call(EventDB::EVENTDB_ROW);
+          if (!stmt->fetchNB()) return false;
+        }
+        state = STATE_FREE;
+        if (!stmt->freeResultNB()) return false;
+
+      case STATE_FREE:
+        call(EventDB::EVENTDB_END_RESULT);
+        state = STATE_DONE;
+
+      case STATE_DONE:
+        done(EventDB::EVENTDB_DONE);
+        return true;
+
+      default: THROW("Invalid state");
       }
     }
+
+
+    void restart() {state = STATE_START;}
+    bool continueNB(unsigned ready) {return stmt->continueNB(ready);}
+    unsigned getErrorNumber() const {return stmt->getErrorNumber();}
+
+
+    void newEvent(Event::Base::callback_t cb) {
+      Event::Base &base = db.getBase();
+      addEvent(*base.newEvent(stmt->getSocket(), cb, get_event_flags(*stmt)));
+    }
+
+
+    void renewEvent(Event::Event &e) {
+      e.renew(stmt->getSocket(), get_event_flags(*stmt));
+      addEvent(e);
+    }
+
+
+    void addEvent(Event::Event &e) {add_event(*stmt, e);}
   };
 }
 
 
-EventDB::EventDB(Event::Base &base, st_mysql *db) : DB(db), base(base) {}
+EventDB::EventDB(Event::Base &base, st_mysql *db) :
+  DB(db), base(base), busy(false), dequeuing(false) {}
 
 
 // TODO Error when EventDB deallocated while events are still outstanding.
 
 
-unsigned EventDB::getEventFlags() const {
-  return
-    (waitRead()    ? Event::Base::EVENT_READ    : 0) |
-    (waitWrite()   ? Event::Base::EVENT_WRITE   : 0) |
-    (waitExcept()  ? Event::Base::EVENT_CLOSED  : 0) |
-    (waitTimeout() ? Event::Base::EVENT_TIMEOUT : 0);
-}
+unsigned EventDB::getEventFlags() const {return get_event_flags(*this);}
 
 
 void EventDB::newEvent(Event::Base::callback_t cb) const {
@@ -201,10 +379,7 @@ void EventDB::renewEvent(Event::Event &e) const {
 }
 
 
-void EventDB::addEvent(Event::Event &e) const {
-  if (waitTimeout()) e.add(getTimeout());
-  else e.add();
-}
+void EventDB::addEvent(Event::Event &e) const {add_event(*this, e);}
 
 
 void EventDB::callback(callback_t cb) {
@@ -227,49 +402,99 @@ void EventDB::callback(callback_t cb) {
 void EventDB::connect(callback_t cb, const string &host, const string &user,
                       const string &password, const string &dbName,
                       unsigned port, const string &socketName, flags_t flags) {
-  try {
-    if (connectNB(host, user, password, dbName, port, socketName, flags))
-      TRY_CATCH_ERROR(cb(EVENTDB_DONE));
-    else callback(cb);
+  run(cb, [=] () {
+      return connectNB(host, user, password, dbName, port, socketName, flags);
+    });
+}
 
-  } catch (const Exception &e) {
-    TRY_CATCH_ERROR(cb(EventDB::EVENTDB_ERROR));
-  }
+
+void EventDB::ping(callback_t cb) {run(cb, [this] () {return pingNB();});}
+
+
+void EventDB::close(callback_t cb) {
+  run(cb, [this] () {
+      statements.clear(); // Must close before the connection
+      return closeNB();
+    });
 }
 
 
-void EventDB::ping(callback_t cb) {
-  try {
-    if (pingNB()) TRY_CATCH_ERROR(cb(EVENTDB_DONE));
-    else callback(cb);
+void EventDB::query(callback_t cb, const string &s,
+                    const SmartPointer<const JSON::Value> &dict) {
+  string query = dict.isNull() ? s : format(s, dict->getDict());
+  SmartPointer<OperationCallback> queryCB = new QueryCallback(*this, cb, query);
+  enqueue([queryCB] () {queryCB->start(queryCB);});
+}
+
 
-  } catch (const Exception &e) {
-    TRY_CATCH_ERROR(cb(EventDB::EVENTDB_ERROR));
-  }
+void EventDB::query(const SmartPointer<JSON::Sink> &sink, callback_t cb,
+                    const string &s,
+                    const SmartPointer<const JSON::Value> &dict) {
+  query(sink_callback(sink, cb, [this, sink] () {writeRowDict(*sink);}), s,
+        dict);
 }
 
 
-void EventDB::close(callback_t cb) {
-  try {
-    if (closeNB()) TRY_CATCH_ERROR(cb(EVENTDB_DONE));
-    else callback(cb);
+SmartPointer<Statement> EventDB::prepare(const string &sql) {
+  auto it = statements.find(sql);
+  if (it != statements.end()) return it->second;
+  return statements[sql] = new Statement(getDB(), sql);
+}
+
+
+void EventDB::execute(callback_t cb, const SmartPointer<Statement> &stmt,
+                      const SmartPointer<const JSON::Value> &params) {
+  SmartPointer<OperationCallback> executeCB =
+    new ExecuteCallback(*this, cb, stmt, params);
+  enqueue([executeCB] () {executeCB->start(executeCB);});
+}
+
+
+void EventDB::execute(const SmartPointer<JSON::Sink> &sink, callback_t cb,
+                      const SmartPointer<Statement> &stmt,
+                      const SmartPointer<const JSON::Value> &params) {
+  execute(sink_callback(sink, cb, [stmt, sink] () {stmt->writeRowDict(*sink);}),
+          stmt, params);
+}
+
+
+void EventDB::enqueue(function<void ()> op) {
+  queue.push_back(op);
+  if (!busy) dequeue();
+}
+
 
-  } catch (const Exception &e) {
-    TRY_CATCH_ERROR(cb(EventDB::EVENTDB_ERROR));
+void EventDB::dequeue() {
+  busy = false;
+  if (dequeuing) return; // The loop below starts the next operation
+
+  dequeuing = true;
+
+  while (!busy && !queue.empty()) {
+    function<void ()> op = queue.front();
+    queue.pop_front();
+    busy = true;
+    TRY_CATCH_ERROR(op());
   }
+
+  dequeuing = false;
 }
 
 
-void EventDB::query(callback_t cb, const string &s,
-                    const SmartPointer<const JSON::Value> &dict) {
-  string query = dict.isNull() ? s : format(s, dict->getDict());
-  SmartPointer<QueryCallback> queryCB = new QueryCallback(*this, cb, query);
+void EventDB::run(callback_t cb, function<bool ()> start) {
+  enqueue([this, cb, start] () {
+      callback_t done = [this, cb] (state_t state) {
+        if (cb) TRY_CATCH_ERROR(cb(state));
+        dequeue();
+      };
 
-  // By wrapping the event callback in a lambda the SmartPointer is kept alive
-  auto reply =
-    [queryCB] (Event::Event &event, int fd, unsigned flags) {
-      (*queryCB)(event, fd, flags);
-    };
+      try {
+        if (start()) done(EVENTDB_DONE);
+        else callback(done);
 
-  if (isPending() || !queryCB->next()) newEvent(reply);
+      } catch (const Exception &e) {
+        LOG_DEBUG(5, e);
+        done(EVENTDB_ERROR);
+      }
+    });
 }
@@ -33,18 +33,33 @@
 #pragma once
 
 #include "DB.h"
+#include "Statement.h"
 
 #include <cbang/event/Base.h>
 
 #include <functional>
+#include <list>
+#include <map>
 
 namespace cb {
-  namespace JSON {class Value;}
+  namespace JSON {
+    class Sink;
+    class Value;
+  }
 
   namespace MariaDB {
     class EventDB : public DB {
       Event::Base &base;
 
+      // Operations run one at a time in order
+      typedef std::list<std::function<void ()> > queue_t;
+      queue_t queue;
+      bool busy;
+      bool dequeuing;
+
+      typedef std::map<std::string, SmartPointer<Statement> > statements_t;
+      statements_t statements;
+
     public:
       typedef enum {
         EVENTDB_ERROR,
@@ -63,6 +78,12 @@ namespace cb {
 
       EventDB(Event::Base &base, st_mysql *db = 0);
 
+      Event::Base &getBase() const {return base;}
+
+      /// Number of operations running or waiting to run
+      unsigned getQueueLength() const {return queue.size() + busy;}
+      bool isIdle() const {return !busy;}
+
       unsigned getEventFlags() const;
 
       void newEvent(Event::Base::callback_t cb) const;
@@ -118,6 +139,43 @@ namespace cb {
         query(std::bind(member, obj, _1), s, dict);
       }
 
+      /// Writes each result to @param sink as a list of row dicts.  The sink
+      /// is held until the query completes.
+      void query(const SmartPointer<JSON::Sink> &sink, callback_t cb,
+                 const std::string &s,
+                 const SmartPointer<const JSON::Value> &dict = 0);
+
+      /// Returns a cached statement for this connection.  It is prepared
+      /// on first execute().
+      SmartPointer<Statement> prepare(const std::string &sql);
+      void clearStatements() {statements.clear();}
+
+      /// Binds @param params, a JSON list, when the statement runs.  Read
+      /// rows from @param stmt on EVENTDB_ROW.
+      void execute(callback_t cb, const SmartPointer<Statement> &stmt,
+                   const SmartPointer<const JSON::Value> &params = 0);
+
+      template <class T>
+      void execute(T *obj, typename Callback<T>::member_t member,
+                   const SmartPointer<Statement> &stmt,
+                   const SmartPointer<const JSON::Value> &params = 0) {
+        using namespace std::placeholders;
+        execute(std::bind(member, obj, _1), stmt, params);
+      }
+
+      void execute(const SmartPointer<JSON::Sink> &sink, callback_t cb,
+                   const SmartPointer<Statement> &stmt,
+                   const SmartPointer<const JSON::Value> &params = 0);
+
+      /// @param op runs after earlier operations and must call dequeue() when
+      /// it completes
+      void enqueue(std::function<void ()> op);
+      void dequeue();
+
+    protected:
+      void run(callback_t cb, std::function<bool ()> start);
+
+    public:
       // From DB
       using DB::connect;
       using DB::close;
@@ -0,0 +1,194 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "EventDBPool.h"
+
+#include <cbang/event/Event.h>
+#include <cbang/log/Logger.h>
+
+using namespace std;
+using namespace cb;
+using namespace cb::MariaDB;
+
+
+EventDBPool::EventDBPool(Event::Base &base, unsigned size) :
+  base(base), port(3306), flags(DB::FLAG_NONE), pingInterval(60) {
+  if (!size) THROW("EventDBPool size must be at least 1");
+  for (unsigned i = 0; i < size; i++) dbs.push_back(create());
+}
+
+
+EventDBPool::~EventDBPool() {
+  if (open.isSet()) *open = false;
+}
+
+
+unsigned EventDBPool::getConnectedCount() const {
+  unsigned count = 0;
+  for (auto &db: dbs) if (db->isConnected()) count++;
+  return count;
+}
+
+
+void EventDBPool::setPingInterval(double interval) {
+  pingInterval = interval;
+
+  if (pingEvent.isSet()) {
+    pingEvent->del();
+    if (pingInterval) pingEvent->add(pingInterval);
+  }
+}
+
+
+void EventDBPool::connect(const string &host, const string &user,
+                          const string &password, const string &dbName,
+                          unsigned port, const string &socketName,
+                          DB::flags_t flags) {
+  this->host = host;
+  this->user = user;
+  this->password = password;
+  this->dbName = dbName;
+  this->port = port;
+  this->socketName = socketName;
+  this->flags = flags;
+
+  if (open.isSet()) *open = false;
+  open = new bool(true);
+
+  for (unsigned i = 0; i < dbs.size(); i++) connect(i);
+
+  if (pingEvent.isNull())
+    pingEvent = base.newEvent(this, &EventDBPool::pingCB, 0);
+  if (pingInterval) pingEvent->add(pingInterval);
+}
+
+
+void EventDBPool::close() {
+  if (open.isSet()) *open = false;
+  open.release();
+
+  if (pingEvent.isSet()) pingEvent->del();
+  for (auto &db: dbs) db->close([] (EventDB::state_t) {});
+}
+
+
+EventDB &EventDBPool::get() {
+  EventDB *best = 0;
+
+  for (auto &db: dbs) {
+    if (!best || (db->isConnected() && !best->isConnected()) ||
+        (db->isConnected() == best->isConnected() &&
+         db->getQueueLength() < best->getQueueLength()))
+      best = db.get();
+
+    if (best->isConnected() && best->isIdle()) break;
+  }
+
+  return *best;
+}
+
+
+void EventDBPool::query(EventDB::callback_t cb, const string &s,
+                        const SmartPointer<const JSON::Value> &dict) {
+  get().query(cb, s, dict);
+}
+
+
+void EventDBPool::query(const SmartPointer<JSON::Sink> &sink,
+                        EventDB::callback_t cb, const string &s,
+                        const SmartPointer<const JSON::Value> &dict) {
+  get().query(sink, cb, s, dict);
+}
+
+
+void EventDBPool::execute(EventDB::callback_t cb, const string &sql,
+                          const SmartPointer<const JSON::Value> &params) {
+  EventDB &db = get();
+  db.execute(cb, db.prepare(sql), params);
+}
+
+
+void EventDBPool::execute(const SmartPointer<JSON::Sink> &sink,
+                          EventDB::callback_t cb, const string &sql,
+                          const SmartPointer<const JSON::Value> &params) {
+  EventDB &db = get();
+  db.execute(sink, cb, db.prepare(sql), params);
+}
+
+
+SmartPointer<EventDB> EventDBPool::create() {
+  SmartPointer<EventDB> db = new EventDB(base);
+  db->enableNonBlocking();
+  return db;
+}
+
+
+void EventDBPool::connect(unsigned i) {
+  SmartPointer<EventDB> db = dbs[i];
+
+  auto cb = [db] (EventDB::state_t state) {
+    if (state == EventDB::EVENTDB_ERROR)
+      LOG_WARNING("DB connection failed: " << db->getError());
+  };
+
+  db->connect(cb, host, user, password, dbName, port, socketName, flags);
+}
+
+
+void EventDBPool::pingCB() {
+  for (unsigned i = 0; i < dbs.size(); i++) {
+    SmartPointer<EventDB> db = dbs[i];
+
+    // Never replace a connection with operations outstanding
+    if (!db->isIdle()) continue;
+
+    if (!db->isConnected()) {
+      dbs[i] = create();
+      connect(i);
+      continue;
+    }
+
+    SmartPointer<bool> open = this->open;
+    auto cb = [this, i, db, open] (EventDB::state_t state) {
+      if (!*open || dbs[i] != db) return;
+      if (state != EventDB::EVENTDB_ERROR && db->isConnected()) return;
+
+      LOG_INFO(3, "Lost DB connection, reconnecting");
+      dbs[i] = create();
+      connect(i);
+    };
+
+    db->ping(cb);
+  }
+
+  if (pingInterval) pingEvent->add(pingInterval);
+}
@@ -0,0 +1,104 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include "EventDB.h"
+
+#include <vector>
+
+namespace cb {
+  namespace MariaDB {
+    /// A fixed size pool of non-blocking connections.  Operations go to the
+    /// least loaded connection and are pipelined behind its earlier work.
+    class EventDBPool {
+      Event::Base &base;
+      std::vector<SmartPointer<EventDB> > dbs;
+
+      std::string host;
+      std::string user;
+      std::string password;
+      std::string dbName;
+      unsigned port;
+      std::string socketName;
+      DB::flags_t flags;
+
+      double pingInterval;
+      SmartPointer<Event::Event> pingEvent;
+
+      /// Cleared on close() or destruction so outstanding pings are ignored
+      SmartPointer<bool> open;
+
+    public:
+      EventDBPool(Event::Base &base, unsigned size = 4);
+      virtual ~EventDBPool();
+
+      unsigned getSize() const {return dbs.size();}
+      unsigned getConnectedCount() const;
+
+      double getPingInterval() const {return pingInterval;}
+      /// Idle connections are pinged and lost connections replaced
+      void setPingInterval(double interval);
+
+      void connect(const std::string &host = "localhost",
+                   const std::string &user = "root",
+                   const std::string &password = std::string(),
+                   const std::string &dbName = std::string(),
+                   unsigned port = 3306,
+                   const std::string &socketName = std::string(),
+                   DB::flags_t flags = DB::FLAG_NONE);
+      void close();
+
+      /// Returns the connection with the shortest queue, preferring those
+      /// which are connected
+      EventDB &get();
+
+      void query(EventDB::callback_t cb, const std::string &s,
+                 const SmartPointer<const JSON::Value> &dict = 0);
+      void query(const SmartPointer<JSON::Sink> &sink, EventDB::callback_t cb,
+                 const std::string &s,
+                 const SmartPointer<const JSON::Value> &dict = 0);
+
+      /// Runs @param sql as a prepared statement cached per connection
+      void execute(EventDB::callback_t cb, const std::string &sql,
+                   const SmartPointer<const JSON::Value> &params = 0);
+      void execute(const SmartPointer<JSON::Sink> &sink,
+                   EventDB::callback_t cb, const std::string &sql,
+                   const SmartPointer<const JSON::Value> &params = 0);
+
+    protected:
+      virtual SmartPointer<EventDB> create();
+      void connect(unsigned i);
+      void pingCB();
+    };
+  }
+}
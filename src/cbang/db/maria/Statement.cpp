@@ -0,0 +1,616 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "Statement.h"
+
+#include <cbang/String.h>
+#include <cbang/Exception.h>
+#include <cbang/json/Sink.h>
+#include <cbang/json/Value.h>
+#include <cbang/log/Logger.h>
+
+#include <mysql/mysql.h>
+
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+#define RAISE_ERROR(msg) raiseError(SSTR(msg), false)
+#define RAISE_DB_ERROR(msg) raiseError(SSTR(msg), true)
+
+using namespace std;
+using namespace cb;
+using namespace cb::MariaDB;
+
+
+struct Statement::Binds {
+  struct Value {
+    int64_t integer = 0;
+    double real = 0;
+    string str;
+    unsigned long length = 0;
+    my_bool null = 0;
+    my_bool error = 0;
+  };
+
+  vector<MYSQL_BIND> binds;
+  vector<Value> values;
+
+  Binds(unsigned size) : binds(size), values(size) {}
+
+  unsigned size() const {return binds.size();}
+
+
+  MYSQL_BIND &bind(unsigned i, enum_field_types type) {
+    if (size() <= i) THROW("Parameter " << i << " out of range");
+
+    MYSQL_BIND &b = binds[i];
+    Value &v = values[i];
+
+    b = MYSQL_BIND();
+    b.buffer_type = type;
+    b.is_null = &v.null;
+    b.length = &v.length;
+    b.error = &v.error;
+    v.null = false;
+
+    return b;
+  }
+};
+
+
+Statement::Statement(st_mysql *db, const string &sql) :
+  db(db), stmt(mysql_stmt_init(db)), sql(sql), meta(0), prepared(false),
+  stored(false), row(false), status(0), continueFunc(0) {
+  if (!stmt) THROW("MariaDB: Failed to create statement");
+}
+
+
+Statement::~Statement() {
+  if (meta) mysql_free_result(meta);
+  if (stmt) mysql_stmt_close(stmt);
+}
+
+
+unsigned Statement::getParamCount() const {
+  assertPrepared();
+  return params->size();
+}
+
+
+void Statement::clearParams() {
+  assertPrepared();
+  params = new Binds(params->size());
+}
+
+
+void Statement::bindNull(unsigned i) {
+  assertPrepared();
+  params->bind(i, MYSQL_TYPE_NULL);
+  params->values[i].null = true;
+}
+
+
+void Statement::bind(unsigned i, bool value) {
+  bind(i, (int64_t)value);
+}
+
+
+void Statement::bind(unsigned i, int64_t value) {
+  assertPrepared();
+  MYSQL_BIND &b = params->bind(i, MYSQL_TYPE_LONGLONG);
+  params->values[i].integer = value;
+  b.buffer = &params->values[i].integer;
+}
+
+
+void Statement::bind(unsigned i, uint64_t value) {
+  bind(i, (int64_t)value);
+  params->binds[i].is_unsigned = true;
+}
+
+
+void Statement::bind(unsigned i, double value) {
+  assertPrepared();
+  MYSQL_BIND &b = params->bind(i, MYSQL_TYPE_DOUBLE);
+  params->values[i].real = value;
+  b.buffer = &params->values[i].real;
+}
+
+
+void Statement::bind(unsigned i, const string &value, bool blob) {
+  assertPrepared();
+  MYSQL_BIND &b =
+    params->bind(i, blob ? MYSQL_TYPE_BLOB : MYSQL_TYPE_STRING);
+  Binds::Value &v = params->values[i];
+
+  v.str = value;
+  v.length = v.str.length();
+  b.buffer = (void *)v.str.data();
+  b.buffer_length = v.length;
+}
+
+
+void Statement::bind(const JSON::Value &params) {
+  for (unsigned i = 0; i < params.size(); i++) {
+    const JSON::Value &value = *params.get(i);
+
+    if (value.isNull() || value.isUndefined()) bindNull(i);
+    else if (value.isBoolean()) bind(i, value.getBoolean());
+    else if (value.isNumber()) {
+      double x = value.getNumber();
+
+      if (x == floor(x) && fabs(x) < 9007199254740992.0) // 2^53
+        bind(i, (int64_t)x);
+      else bind(i, x);
+
+    } else if (value.isString()) bind(i, value.getString());
+    else RAISE_ERROR("Cannot bind JSON " << value.getType()
+                     << " to parameter " << i);
+  }
+}
+
+
+void Statement::prepare() {
+  assertNotPending();
+  prepareComplete(mysql_stmt_prepare(stmt, CPP_TO_C_STR(sql), sql.length()));
+}
+
+
+void Statement::execute() {
+  assertPrepared();
+  assertNotPending();
+  bindParams();
+  executeComplete(mysql_stmt_execute(stmt));
+}
+
+
+void Statement::storeResult() {
+  assertNotPending();
+  storeResultComplete(mysql_stmt_store_result(stmt));
+}
+
+
+bool Statement::fetch() {
+  assertNotPending();
+  fetchComplete(mysql_stmt_fetch(stmt));
+  return row;
+}
+
+
+void Statement::freeResult() {
+  assertNotPending();
+  if (mysql_stmt_free_result(stmt)) RAISE_DB_ERROR("Failed to free result");
+  stored = row = false;
+}
+
+
+bool Statement::prepareNB() {
+  LOG_DEBUG(5, __func__ << "() " << sql);
+
+  assertNotPending();
+
+  int ret = 0;
+  status =
+    mysql_stmt_prepare_start(&ret, stmt, CPP_TO_C_STR(sql), sql.length());
+
+  if (status) {
+    continueFunc = &Statement::prepareContinue;
+    return false;
+  }
+
+  return prepareComplete(ret);
+}
+
+
+bool Statement::executeNB() {
+  LOG_DEBUG(5, __func__ << "()");
+
+  assertPrepared();
+  assertNotPending();
+  bindParams();
+
+  int ret = 0;
+  status = mysql_stmt_execute_start(&ret, stmt);
+
+  if (status) {
+    continueFunc = &Statement::executeContinue;
+    return false;
+  }
+
+  return executeComplete(ret);
+}
+
+
+bool Statement::storeResultNB() {
+  LOG_DEBUG(5, __func__ << "()");
+
+  assertNotPending();
+
+  int ret = 0;
+  status = mysql_stmt_store_result_start(&ret, stmt);
+
+  if (status) {
+    continueFunc = &Statement::storeResultContinue;
+    return false;
+  }
+
+  return storeResultComplete(ret);
+}
+
+
+bool Statement::fetchNB() {
+  assertNotPending();
+
+  int ret = 0;
+  status = mysql_stmt_fetch_start(&ret, stmt);
+
+  if (status) {
+    continueFunc = &Statement::fetchContinue;
+    return false;
+  }
+
+  return fetchComplete(ret);
+}
+
+
+bool Statement::freeResultNB() {
+  LOG_DEBUG(5, __func__ << "()");
+
+  assertNotPending();
+
+  my_bool ret = 0;
+  status = mysql_stmt_free_result_start(&ret, stmt);
+
+  if (status) {
+    continueFunc = &Statement::freeResultContinue;
+    return false;
+  }
+
+  if (ret) RAISE_DB_ERROR("Failed to free result");
+  stored = row = false;
+
+  return true;
+}
+
+
+bool Statement::continueNB(unsigned ready) {
+  if (!status) RAISE_ERROR("Non-blocking call not pending");
+  if (!continueFunc) RAISE_ERROR("Continue function not set");
+  bool ret = (this->*continueFunc)(ready);
+  if (ret) continueFunc = 0;
+  return ret;
+}
+
+
+bool Statement::waitRead() const {return status & MYSQL_WAIT_READ;}
+bool Statement::waitWrite() const {return status & MYSQL_WAIT_WRITE;}
+bool Statement::waitExcept() const {return status & MYSQL_WAIT_EXCEPT;}
+bool Statement::waitTimeout() const {return status & MYSQL_WAIT_TIMEOUT;}
+int Statement::getSocket() const {return mysql_get_socket(db);}
+
+
+double Statement::getTimeout() const {
+  return (double)mysql_get_timeout_value_ms(db) / 1000.0; // millisec -> sec
+}
+
+
+bool Statement::hasResultSet() const {return mysql_stmt_field_count(stmt);}
+uint64_t Statement::getRowCount() const {return mysql_stmt_num_rows(stmt);}
+
+
+uint64_t Statement::getAffectedRowCount() const {
+  return mysql_stmt_affected_rows(stmt);
+}
+
+
+uint64_t Statement::getInsertID() const {return mysql_stmt_insert_id(stmt);}
+
+
+unsigned Statement::getFieldCount() const {
+  return results.isNull() ? mysql_stmt_field_count(stmt) : results->size();
+}
+
+
+void Statement::appendRow(JSON::Sink &sink) const {
+  for (unsigned i = 0; i < getFieldCount(); i++) {
+    sink.beginAppend();
+    writeField(sink, i);
+  }
+}
+
+
+void Statement::insertRow(JSON::Sink &sink, bool withNulls) const {
+  for (unsigned i = 0; i < getFieldCount(); i++) {
+    if (!withNulls && getNull(i)) continue;
+    sink.beginInsert(getField(i).getName());
+    writeField(sink, i);
+  }
+}
+
+
+void Statement::writeRowList(JSON::Sink &sink) const {
+  sink.beginList();
+  appendRow(sink);
+  sink.endList();
+}
+
+
+void Statement::writeRowDict(JSON::Sink &sink, bool withNulls) const {
+  sink.beginDict();
+  insertRow(sink, withNulls);
+  sink.endDict();
+}
+
+
+Field Statement::getField(unsigned i) const {
+  assertInFieldRange(i);
+  return &mysql_fetch_fields(meta)[i];
+}
+
+
+void Statement::writeField(JSON::Sink &sink, unsigned i) const {
+  if (getNull(i)) return sink.writeNull();
+
+  const MYSQL_BIND &b = results->binds[i];
+  const Binds::Value &v = results->values[i];
+
+  switch (b.buffer_type) {
+  case MYSQL_TYPE_LONGLONG:
+    if (b.is_unsigned) sink.write((uint64_t)v.integer);
+    else sink.write(v.integer);
+    break;
+
+  case MYSQL_TYPE_DOUBLE: sink.write(v.real); break;
+
+  default:
+    if (getField(i).isNumber()) sink.write(getDouble(i));
+    else sink.write(getString(i));
+  }
+}
+
+
+bool Statement::getNull(unsigned i) const {
+  assertHaveRow();
+  assertInFieldRange(i);
+  return results->values[i].null;
+}
+
+
+string Statement::getString(unsigned i) const {
+  if (getNull(i)) return string();
+
+  const MYSQL_BIND &b = results->binds[i];
+  const Binds::Value &v = results->values[i];
+
+  switch (b.buffer_type) {
+  case MYSQL_TYPE_LONGLONG:
+    if (b.is_unsigned) return String((uint64_t)v.integer);
+    return String(v.integer);
+
+  case MYSQL_TYPE_DOUBLE: return String(v.real);
+  default: return v.str.substr(0, v.length);
+  }
+}
+
+
+bool Statement::getBoolean(unsigned i) const {
+  if (results->binds[i].buffer_type == MYSQL_TYPE_LONGLONG)
+    return getS64(i);
+  return String::parseBool(getString(i));
+}
+
+
+double Statement::getDouble(unsigned i) const {
+  if (getNull(i)) RAISE_ERROR("Field " << i << " is null");
+
+  const MYSQL_BIND &b = results->binds[i];
+  const Binds::Value &v = results->values[i];
+
+  switch (b.buffer_type) {
+  case MYSQL_TYPE_LONGLONG:
+    return b.is_unsigned ? (double)(uint64_t)v.integer : (double)v.integer;
+  case MYSQL_TYPE_DOUBLE: return v.real;
+  default: return String::parseDouble(getString(i));
+  }
+}
+
+
+int64_t Statement::getS64(unsigned i) const {
+  if (getNull(i)) RAISE_ERROR("Field " << i << " is null");
+
+  const MYSQL_BIND &b = results->binds[i];
+  if (b.buffer_type == MYSQL_TYPE_LONGLONG) return results->values[i].integer;
+  if (b.buffer_type == MYSQL_TYPE_DOUBLE) return results->values[i].real;
+  return String::parseS64(getString(i));
+}
+
+
+uint64_t Statement::getU64(unsigned i) const {
+  if (getNull(i)) RAISE_ERROR("Field " << i << " is null");
+
+  const MYSQL_BIND &b = results->binds[i];
+  if (b.buffer_type == MYSQL_TYPE_LONGLONG) return results->values[i].integer;
+  if (b.buffer_type == MYSQL_TYPE_DOUBLE) return results->values[i].real;
+  return String::parseU64(getString(i));
+}
+
+
+string Statement::getError() const {return mysql_stmt_error(stmt);}
+unsigned Statement::getErrorNumber() const {return mysql_stmt_errno(stmt);}
+
+
+void Statement::raiseError(const string &msg, bool withDBError) const {
+  if (withDBError) THROW("MariaDB: " << msg << ": " << getError());
+  else THROW("MariaDB: " << msg);
+}
+
+
+void Statement::assertNotPending() const {
+  if (status) RAISE_ERROR("Non-blocking call still pending");
+}
+
+
+void Statement::assertPrepared() const {
+  if (!prepared) RAISE_ERROR("Statement not prepared");
+}
+
+
+void Statement::assertHaveRow() const {
+  if (!row) RAISE_ERROR("Don't have row, must call fetch()");
+}
+
+
+void Statement::assertInFieldRange(unsigned i) const {
+  if (results.isNull() || results->size() <= i)
+    RAISE_ERROR("Out of field range " << i);
+}
+
+
+void Statement::bindParams() {
+  if (params->size() && mysql_stmt_bind_param(stmt, &params->binds[0]))
+    RAISE_DB_ERROR("Failed to bind parameters");
+}
+
+
+void Statement::bindResults() {
+  // Metadata is copied, get it after storeResult() updates max_length
+  if (meta) mysql_free_result(meta);
+  meta = mysql_stmt_result_metadata(stmt);
+  if (!meta) RAISE_DB_ERROR("Failed to get result metadata");
+
+  unsigned count = mysql_num_fields(meta);
+  MYSQL_FIELD *fields = mysql_fetch_fields(meta);
+  if (results.isNull() || results->size() != count)
+    results = new Binds(count);
+
+  for (unsigned i = 0; i < count; i++) {
+    Field field(&fields[i]);
+    Binds::Value &v = results->values[i];
+
+    if (field.isInteger()) {
+      MYSQL_BIND &b = results->bind(i, MYSQL_TYPE_LONGLONG);
+      b.buffer = &v.integer;
+      b.is_unsigned = fields[i].flags & UNSIGNED_FLAG;
+
+    } else if (field.getType() == Field::TYPE_FLOAT ||
+               field.getType() == Field::TYPE_DOUBLE) {
+      MYSQL_BIND &b = results->bind(i, MYSQL_TYPE_DOUBLE);
+      b.buffer = &v.real;
+
+    } else {
+      MYSQL_BIND &b = results->bind(i, MYSQL_TYPE_STRING);
+      v.str.resize(fields[i].max_length + 1);
+      b.buffer = &v.str[0];
+      b.buffer_length = v.str.size();
+    }
+  }
+
+  if (count && mysql_stmt_bind_result(stmt, &results->binds[0]))
+    RAISE_DB_ERROR("Failed to bind results");
+}
+
+
+bool Statement::prepareComplete(int ret) {
+  if (ret) RAISE_DB_ERROR("Prepare failed: " << sql);
+
+  prepared = true;
+  params = new Binds(mysql_stmt_param_count(stmt));
+
+  // So storeResult() reports the result buffer sizes needed
+  my_bool update = true;
+  mysql_stmt_attr_set(stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &update);
+
+  return true;
+}
+
+
+bool Statement::executeComplete(int ret) {
+  if (ret) RAISE_DB_ERROR("Execute failed");
+  return true;
+}
+
+
+bool Statement::storeResultComplete(int ret) {
+  if (ret) RAISE_DB_ERROR("Failed to store result");
+  stored = true;
+  bindResults();
+  return true;
+}
+
+
+bool Statement::fetchComplete(int ret) {
+  if (ret == 1) RAISE_DB_ERROR("Fetch failed");
+  if (ret == MYSQL_DATA_TRUNCATED) RAISE_ERROR("Result data truncated");
+  row = !ret;
+  return true;
+}
+
+
+bool Statement::prepareContinue(unsigned ready) {
+  int ret = 0;
+  status = mysql_stmt_prepare_cont(&ret, stmt, ready);
+  return !status && prepareComplete(ret);
+}
+
+
+bool Statement::executeContinue(unsigned ready) {
+  int ret = 0;
+  status = mysql_stmt_execute_cont(&ret, stmt, ready);
+  return !status && executeComplete(ret);
+}
+
+
+bool Statement::storeResultContinue(unsigned ready) {
+  int ret = 0;
+  status = mysql_stmt_store_result_cont(&ret, stmt, ready);
+  return !status && storeResultComplete(ret);
+}
+
+
+bool Statement::fetchContinue(unsigned ready) {
+  int ret = 0;
+  status = mysql_stmt_fetch_cont(&ret, stmt, ready);
+  return !status && fetchComplete(ret);
+}
+
+
+bool Statement::freeResultContinue(unsigned ready) {
+  my_bool ret = 0;
+  status = mysql_stmt_free_result_cont(&ret, stmt, ready);
+  if (status) return false;
+
+  if (ret) RAISE_DB_ERROR("Failed to free result");
+  stored = row = false;
+
+  return true;
+}
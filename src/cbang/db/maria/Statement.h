@@ -0,0 +1,168 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include "Field.h"
+
+#include <cbang/SmartPointer.h>
+#include <cbang/StdTypes.h>
+
+#include <string>
+
+struct st_mysql;
+struct st_mysql_stmt;
+struct st_mysql_res;
+
+
+namespace cb {
+  namespace JSON {
+    class Sink;
+    class Value;
+  }
+
+  namespace MariaDB {
+    /// A server-side prepared statement.  Parameters and results use the
+    /// binary protocol so numbers and blobs are not formatted or parsed.
+    class Statement {
+      st_mysql *db;
+      st_mysql_stmt *stmt;
+      std::string sql;
+
+      struct Binds;
+      SmartPointer<Binds> params;
+      SmartPointer<Binds> results;
+      st_mysql_res *meta;
+
+      bool prepared;
+      bool stored;
+      bool row;
+      int status;
+
+      typedef bool (Statement::*continue_func_t)(unsigned ready);
+      continue_func_t continueFunc;
+
+    public:
+      Statement(st_mysql *db, const std::string &sql);
+      ~Statement();
+
+      const std::string &getSQL() const {return sql;}
+      bool isPrepared() const {return prepared;}
+
+      // Parameters
+      unsigned getParamCount() const;
+      void clearParams();
+      void bindNull(unsigned i);
+      void bind(unsigned i, bool value);
+      void bind(unsigned i, int32_t value) {bind(i, (int64_t)value);}
+      void bind(unsigned i, uint32_t value) {bind(i, (uint64_t)value);}
+      void bind(unsigned i, int64_t value);
+      void bind(unsigned i, uint64_t value);
+      void bind(unsigned i, double value);
+      void bind(unsigned i, const char *value) {bind(i, std::string(value));}
+      void bind(unsigned i, const std::string &value, bool blob = false);
+      /// Bind parameters from a JSON list
+      void bind(const JSON::Value &params);
+
+      // Blocking API
+      void prepare();
+      void execute();
+      void storeResult();
+      bool fetch();
+      void freeResult();
+
+      // Non-blocking API
+      bool prepareNB();
+      bool executeNB();
+      bool storeResultNB();
+      bool fetchNB();
+      bool freeResultNB();
+      bool continueNB(unsigned ready);
+      bool isPending() const {return status;}
+      bool waitRead() const;
+      bool waitWrite() const;
+      bool waitExcept() const;
+      bool waitTimeout() const;
+      int getSocket() const;
+      double getTimeout() const;
+
+      // Result set
+      bool hasResultSet() const;
+      bool haveResult() const {return stored;}
+      bool haveRow() const {return row;}
+      uint64_t getRowCount() const;
+      uint64_t getAffectedRowCount() const;
+      uint64_t getInsertID() const;
+      unsigned getFieldCount() const;
+      void appendRow(JSON::Sink &sink) const;
+      void insertRow(JSON::Sink &sink, bool withNulls = true) const;
+      void writeRowList(JSON::Sink &sink) const;
+      void writeRowDict(JSON::Sink &sink, bool withNulls = true) const;
+
+      // Field
+      Field getField(unsigned i) const;
+      void writeField(JSON::Sink &sink, unsigned i) const;
+      bool getNull(unsigned i) const;
+      std::string getString(unsigned i) const;
+      bool getBoolean(unsigned i) const;
+      double getDouble(unsigned i) const;
+      int64_t getS64(unsigned i) const;
+      uint64_t getU64(unsigned i) const;
+
+      // Error handling
+      std::string getError() const;
+      unsigned getErrorNumber() const;
+      void raiseError(const std::string &msg, bool withDBError = true) const;
+
+    protected:
+      void assertNotPending() const;
+      void assertPrepared() const;
+      void assertHaveRow() const;
+      void assertInFieldRange(unsigned i) const;
+
+      void bindParams();
+      void bindResults();
+
+      bool prepareComplete(int ret);
+      bool executeComplete(int ret);
+      bool storeResultComplete(int ret);
+      bool fetchComplete(int ret);
+
+      // Continue non-blocking calls
+      bool prepareContinue(unsigned ready);
+      bool executeContinue(unsigned ready);
+      bool storeResultContinue(unsigned ready);
+      bool fetchContinue(unsigned ready);
+      bool freeResultContinue(unsigned ready);
+    };
+  }
+}
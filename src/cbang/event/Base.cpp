@@ -60,7 +60,8 @@ namespace {
 bool Base::_threadsEnabled = false;
 
 
-Base::Base(bool withThreads, int priorities) {
+Base::Base(bool withThreads, int priorities) :
+  outputBuffered(0), outputPeak(0), outputDropped(0), outputBlocked(0) {
   Socket::initialize(); // Windows needs this
 
   if (withThreads) enableThreads();
@@ -99,6 +100,12 @@ void Base::countActiveEventsByPriority(std::map<int, unsigned> &counts) const {
 }
 
 
+void Base::outputAdded(uint64_t bytes) {
+  uint64_t total = outputBuffered += bytes;
+  if (outputPeak < total) outputPeak = total;
+}
+
+
 SmartPointer<cb::Event::Event>
 Base::newEvent(callback_t cb, unsigned flags) {return newEvent(-1, cb, flags);}
 
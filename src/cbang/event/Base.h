@@ -39,6 +39,7 @@
 
 #include <functional>
 #include <map>
+#include <atomic>
 
 struct event_base;
 
@@ -52,6 +53,12 @@ namespace cb {
 
       event_base *base;
 
+      uint64_t outputBudget = 0;
+      std::atomic<uint64_t> outputBuffered;
+      std::atomic<uint64_t> outputPeak;
+      std::atomic<uint64_t> outputDropped;
+      std::atomic<unsigned> outputBlocked;
+
     public:
       template <class T> struct Callback {
         typedef void (T::*member_t)(Event &, int, unsigned);
@@ -72,6 +79,25 @@ namespace cb {
       int getNumActiveEvents() const;
       void countActiveEventsByPriority(std::map<int, unsigned> &counts) const;
 
+      /// Limit output buffered by all BufferEvents on this Base, zero for none
+      void setOutputBudget(uint64_t bytes) {outputBudget = bytes;}
+      uint64_t getOutputBudget() const {return outputBudget;}
+      bool isOverOutputBudget() const
+        {return outputBudget && outputBudget < outputBuffered;}
+
+      uint64_t getOutputBuffered() const {return outputBuffered;}
+      uint64_t getOutputPeak() const {return outputPeak;}
+      uint64_t getOutputDropped() const {return outputDropped;}
+      /// @return The number of BufferEvents which are currently not writable
+      unsigned getOutputBlocked() const {return outputBlocked;}
+
+      // Called by BufferEvent
+      void outputAdded(uint64_t bytes);
+      void outputRemoved(uint64_t bytes) {outputBuffered -= bytes;}
+      void outputDrop(uint64_t bytes) {outputDropped += bytes;}
+      void outputBlock(bool blocked)
+        {if (blocked) outputBlocked++; else outputBlocked--;}
+
       SmartPointer<Event> newEvent(callback_t cb,
                                    unsigned flags = EVENT_PERSIST);
       SmartPointer<Event> newEvent(socket_t fd, callback_t cb,
@@ -45,6 +45,12 @@
 
 #ifdef _WIN32
 #include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
 #endif
 
 using namespace std;
@@ -243,6 +249,12 @@ void Buffer::reserve(unsigned bytes, vector<iovec> &space) {
 }
 
 
+void Buffer::reserve(unsigned bytes, iovec &space) {
+  if (evbuffer_reserve_space(evb, bytes, &space, 1) != 1)
+    THROW("Failed to reserve space");
+}
+
+
 void Buffer::commit(vector<iovec> &space) {
   evbuffer_commit_space(evb, &space[0], space.size());
 }
@@ -261,6 +273,31 @@ string Buffer::readLine(unsigned maxLength, eol_t eol) {
 }
 
 
+const char *Buffer::findLF(const char *s, const char *end) {
+#ifdef __SSE2__
+  const __m128i lf = _mm_set1_epi8('\n');
+
+  for (; s + 16 <= end; s += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)s);
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, lf));
+    if (mask) return s + __builtin_ctz(mask);
+  }
+#endif
+
+  return (const char *)memchr(s, '\n', end - s);
+}
+
+
+const char *Buffer::peekLine(unsigned maxLength, unsigned &length) {
+  return peek(maxLength, length, false);
+}
+
+
+const char *Buffer::peekLines(unsigned maxLength, unsigned &length) {
+  return peek(maxLength, length, true);
+}
+
+
 void Buffer::add(const Buffer &buf) {
   if (evbuffer_add_buffer(evb, buf.getBuffer())) THROW("Add buffer failed");
 }
@@ -281,15 +318,60 @@ void Buffer::add(const char *s) {add(s, strlen(s));}
 void Buffer::add(const string &s) {add(CBANG_CPP_TO_C_STR(s), s.length());}
 
 
+void Buffer::addRef(const char *data, unsigned length) {
+  if (evbuffer_add_reference(evb, data, length, 0, 0))
+    THROW("Buffer add reference failed");
+}
+
+
+namespace {
+  void refCleanup(const void *data, size_t length, void *arg) {
+    auto cleanup = (function<void ()> *)arg;
+    TRY_CATCH_ERROR((*cleanup)());
+    delete cleanup;
+  }
+}
+
+
+void Buffer::addRef(const char *data, unsigned length,
+                    const function<void ()> &cleanup) {
+  auto arg = new function<void ()>(cleanup);
+
+  if (evbuffer_add_reference(evb, data, length, refCleanup, arg)) {
+    delete arg;
+    THROW("Buffer add reference failed");
+  }
+}
+
+
 void Buffer::addFile(const string &path) {
   int fd = open(path.c_str(), O_RDONLY);
   if (fd == -1) THROW("Failed to open file " << path);
 
   struct stat buf;
-  if (fstat(fd, &buf)) THROW("Failed to get file size " << path);
+  if (fstat(fd, &buf)) {
+    ::close(fd);
+    THROW("Failed to get file size " << path);
+  }
+
+  addFile(fd, 0, buf.st_size);
+}
+
+
+void Buffer::addFile(int fd, uint64_t offset, uint64_t length) {
+  evbuffer_file_segment *seg =
+    evbuffer_file_segment_new(fd, offset, length, EVBUF_FS_CLOSE_ON_FREE);
+
+  if (!seg) {
+    ::close(fd);
+    THROW("Failed to create file segment");
+  }
+
+  // The Buffer holds its own reference to the segment
+  int ret = evbuffer_add_file_segment(evb, seg, 0, -1);
+  evbuffer_file_segment_free(seg);
 
-  if (evbuffer_add_file(evb, fd, 0, buf.st_size))
-    THROW("Failed to add file to buffer: " << path);
+  if (ret) THROW("Failed to add file to buffer");
 }
 
 
@@ -315,3 +397,37 @@ void Buffer::prepend(const string &s) {
 void Buffer::callback(int added, int deleted, int orig) {
   if (cb) cb(added, deleted, orig);
 }
+
+
+const char *Buffer::peek(unsigned maxLength, unsigned &length, bool block) {
+  unsigned total = getLength();
+  if (maxLength && maxLength < total) total = maxLength;
+  if (!total) return 0;
+
+  // Start with the first chunk, which needs no copy, and only pull up more
+  // if the EOL has not been found there
+  unsigned size = evbuffer_get_contiguous_space(evb);
+  unsigned offset = 0;
+
+  while (true) {
+    if (total < size || !size) size = total;
+
+    const char *data = (const char *)evbuffer_pullup(evb, size);
+    if (!data) THROW("Buffer pullup failed");
+    const char *end = data + size;
+
+    for (const char *p = data + offset; (p = findLF(p, end)); p++) {
+      length = p + 1 - data;
+      if (!block) return data;
+
+      // An empty line ends the block
+      const char *eol = p;
+      if (data < eol && eol[-1] == '\r') eol--;
+      if (eol == data || eol[-1] == '\n') return data;
+    }
+
+    if (size == total) return 0;
+    offset = size;
+    size *= 2;
+  }
+}
@@ -113,17 +113,45 @@ namespace cb {
 
       void peek(unsigned bytes, std::vector<iovec> &space);
       void reserve(unsigned bytes, std::vector<iovec> &space);
+      void reserve(unsigned bytes, iovec &space);
       void commit(std::vector<iovec> &space);
       void commit(iovec &space);
 
       std::string readLine(unsigned maxLength, eol_t eol = EOL_CRLF);
 
+      /**
+       * Find the first '\n' in [@param s, @param end) or return 0.  Scans
+       * 16 bytes at a time where SSE2 is available.
+       */
+      static const char *findLF(const char *s, const char *end);
+
+      /**
+       * Make the first complete line contiguous without removing it.
+       * @param length is set to the line length including the EOL.
+       * @return a pointer to the line or 0 if there is no complete line
+       * within the first @param maxLength bytes.
+       */
+      const char *peekLine(unsigned maxLength, unsigned &length);
+
+      /// Like peekLine() but up to and including the first empty line.
+      const char *peekLines(unsigned maxLength, unsigned &length);
+
       void add(const Buffer &buf);
       void addRef(const Buffer &buf);
       void add(const char *data, unsigned length);
       void add(const char *s);
       void add(const std::string &s);
+      /// @param data must remain valid until the Buffer is freed
+      void addRef(const char *data, unsigned length);
+      /// @param cleanup is called once libevent no longer references @param data
+      void addRef(const char *data, unsigned length,
+                  const std::function<void ()> &cleanup);
       void addFile(const std::string &path);
+      /**
+       * Add part of an open file.  Takes ownership of @param fd.  The data
+       * is sent with sendfile() if this Buffer drains to a socket.
+       */
+      void addFile(int fd, uint64_t offset, uint64_t length);
 
       void prepend(const Buffer &buf);
       void prepend(const char *data, unsigned length);
@@ -131,6 +159,9 @@ namespace cb {
       void prepend(const std::string &s);
 
       void callback(int added, int deleted, int orig);
+
+    protected:
+      const char *peek(unsigned maxLength, unsigned &length, bool block);
     };
   }
 }
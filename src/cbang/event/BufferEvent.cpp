@@ -82,13 +82,13 @@ using namespace cb::Event;
 #define CBANG_LOG_PREFIX << "BEV" << getID() << ':'
 
 
-uint64_t BufferEvent::nextID = 0;
+atomic<uint64_t> BufferEvent::nextID(0);
 
 
 BufferEvent::BufferEvent(cb::Event::Base &base, bool incoming,
                          const SmartPointer<Socket> &socket,
                          const SmartPointer<SSLContext> &sslCtx) :
-  base(base) {
+  base(base), sslCtx(sslCtx) {
   LOG_DEBUG(4, __func__ << "()");
 
   if (sslCtx.isNull()) {
@@ -124,6 +124,8 @@ BufferEvent::BufferEvent(cb::Event::Base &base, bool incoming,
 BufferEvent::~BufferEvent() {
   LOG_DEBUG(4, __func__ << "()");
   close();
+  base.outputRemoved(outputBuffer.getLength());
+  if (!writable) base.outputBlock(false);
 #ifdef HAVE_OPENSSL
   if (ssl) SSL_free(ssl);
 #endif // HAVE_OPENSSL
@@ -188,6 +190,26 @@ string BufferEvent::getSSLErrors() {
 }
 
 
+void BufferEvent::setOutputWatermarks(unsigned high, unsigned low) {
+  if (high && high < low)
+    THROW("Output low watermark " << low << " above high watermark " << high);
+
+  outputHigh = high;
+  outputLow = low;
+}
+
+
+bool BufferEvent::dropOutput(unsigned bytes) {
+  if (writable || outputPolicy == OutputPolicy::OUTPUT_PAUSE) return false;
+
+  LOG_DEBUG(4, __func__ << '(' << bytes << ')');
+  outputDropped += bytes;
+  base.outputDrop(bytes);
+
+  return true;
+}
+
+
 void BufferEvent::setRead(bool enabled) {
   if (enableRead == enabled) return;
   enableRead = enabled;
@@ -213,8 +235,17 @@ string BufferEvent::getEventsString(short events) {
 void BufferEvent::close()  {
   if (getFD() < 0) return;
 
+#ifdef HAVE_OPENSSL
+  // Send close_notify, OpenSSL will not resume an uncleanly closed session
+  if (ssl && state == STATE_SSL_READY) {
+    SSL_shutdown(ssl);
+    SSL::flushErrors();
+  }
+#endif // HAVE_OPENSSL
+
   readEvent.release();
   writeEvent.release();
+  if (closeEvent.isSet()) closeEvent->del();
 
   if (dnsReq.isSet()) {
     dnsReq->cancel();
@@ -234,6 +265,16 @@ void BufferEvent::connect(DNSBase &dns, const IPAddress &peer) {
   // Save peer port
   peerPort = peer.getPort();
 
+#ifdef HAVE_OPENSSL
+  if (ssl) {
+    if (peer.hasHost())
+      SSL_set_tlsext_host_name(ssl, peer.getHost().c_str());
+
+    // Offer a cached session for this host
+    sslCtx->setClientSession(ssl, peer.getHost(), peerPort);
+  }
+#endif // HAVE_OPENSSL
+
   // Skip DNS lookup if we already have an IP
   if (peer.getIP()) {
     vector<IPAddress> ip;
@@ -302,10 +343,53 @@ void BufferEvent::doReadCB() {
 void BufferEvent::outputBufferCB(int added, int deleted, int orig) {
   LOG_DEBUG(4, __func__
             << "(" << added << ", " << deleted << ", " << orig << ")");
+
+  if (added) base.outputAdded(added);
+  if (deleted) base.outputRemoved(deleted);
+
+  unsigned length = outputBuffer.getLength();
+
+  if (writable) {
+    if (added && ((outputHigh && outputHigh < length) ||
+                  base.isOverOutputBudget())) setWritable(false);
+
+  } else if (length <= outputLow) setWritable(true);
+
   if (added) updateEvents();
 }
 
 
+void BufferEvent::setWritable(bool writable) {
+  LOG_DEBUG(4, __func__ << '(' << writable << ") buffered="
+            << outputBuffer.getLength() << " policy=" << outputPolicy);
+
+  this->writable = writable;
+  base.outputBlock(!writable);
+
+  if (outputPolicy == OutputPolicy::OUTPUT_CLOSE) {
+    // Not safe to close from inside the writer, defer to the event loop
+    if (!writable) {
+      if (closeEvent.isNull())
+        closeEvent = newEvent(&BufferEvent::outputClose);
+      closeEvent->activate();
+    }
+
+    return; // Producers are not told, the connection is closed instead
+  }
+
+  updateEvents(); // Pause or resume reading
+  TRY_CATCH_ERROR(writableCB(writable));
+}
+
+
+void BufferEvent::outputClose() {
+  if (getFD() < 0) return;
+  LOG_DEBUG(3, "Closing, output limit exceeded with "
+            << outputBuffer.getLength() << " bytes buffered");
+  doErrorCB(BUFFEREVENT_WRITING, ENOBUFS);
+}
+
+
 void BufferEvent::sockRead() {
   LOG_DEBUG(4, __func__ << "()");
 
@@ -582,6 +666,7 @@ void BufferEvent::sslHandshake() {
   if (ret == 1) {
     LOG_DEBUG(4, "SSL Handshake complete");
     state = STATE_SSL_READY;
+    sslCtx->handshakeComplete(ssl);
 
   } else sslError(BUFFEREVENT_READING, ret);
 #endif // HAVE_OPENSSL
@@ -667,7 +752,8 @@ void BufferEvent::updateEvents() {
     if (outputBuffer.getLength()) enableEvents(EVENT_WRITE);
     else disableEvents(EVENT_WRITE);
 
-    if (enableRead) enableEvents(EVENT_READ);
+    if (enableRead && (writable || outputPolicy != OutputPolicy::OUTPUT_PAUSE))
+      enableEvents(EVENT_READ);
     else disableEvents(EVENT_READ);
     break;
   }
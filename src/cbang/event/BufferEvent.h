@@ -33,12 +33,14 @@
 #pragma once
 
 #include "EventFlag.h"
+#include "OutputPolicy.h"
 #include "Buffer.h"
 
 #include <cbang/SmartPointer.h>
 #include <cbang/socket/SocketType.h>
 
 #include <string>
+#include <atomic>
 
 struct ssl_st;
 
@@ -58,7 +60,7 @@ namespace cb {
     class BufferEvent : virtual public RefCounted, public EventFlag {
       Base &base;
 
-      static uint64_t nextID;
+      static std::atomic<uint64_t> nextID;
       uint64_t id = ++nextID;
 
       SmartPointer<Socket> socket;
@@ -75,6 +77,13 @@ namespace cb {
 
       unsigned minRead = 0;
 
+      unsigned outputHigh = 0;
+      unsigned outputLow = 0;
+      OutputPolicy outputPolicy = OutputPolicy::OUTPUT_PAUSE;
+      bool writable = true;
+      uint64_t outputDropped = 0;
+      SmartPointer<Event> closeEvent;
+
       typedef enum {
         STATE_FAILED,
         STATE_IDLE,
@@ -90,6 +99,7 @@ namespace cb {
       int sslWant = 0;
       bool enableRead = false;
 
+      SmartPointer<SSLContext> sslCtx;
       ssl_st *ssl = 0;
       size_t sslLastWrite = 0;
       size_t sslLastRead = 0;
@@ -134,6 +144,26 @@ namespace cb {
       void setRead(bool enable);
       void setMinRead(unsigned bytes) {minRead = bytes;}
 
+      /**
+       * Output becomes unwritable when more than @param high bytes are
+       * buffered, or the Base is over its output budget, and writable again
+       * once drained to @param low bytes.  A zero @param high disables the
+       * per connection limit.
+       */
+      void setOutputWatermarks(unsigned high, unsigned low = 0);
+      unsigned getOutputHighWatermark() const {return outputHigh;}
+      unsigned getOutputLowWatermark() const {return outputLow;}
+
+      /// While unwritable: pause reading, drop messages or close
+      void setOutputPolicy(OutputPolicy policy) {outputPolicy = policy;}
+      OutputPolicy getOutputPolicy() const {return outputPolicy;}
+
+      bool isWritable() const {return writable;}
+      uint64_t getOutputDropped() const {return outputDropped;}
+
+      /// @return True if @param bytes should be discarded by the caller
+      bool dropOutput(unsigned bytes);
+
       static std::string getEventsString(short events);
 
       void close();
@@ -143,6 +173,7 @@ namespace cb {
       virtual void readCB() {}
       virtual void writeCB() {}
       virtual void errorCB(short what, int err) {}
+      virtual void writableCB(bool writable) {}
 
       void dnsCB(int err, const std::vector<IPAddress> &addrs);
 
@@ -154,6 +185,8 @@ namespace cb {
       void doErrorCB(int flags, int err = 0);
       void doReadCB();
       void outputBufferCB(int added, int deleted, int orig);
+      void setWritable(bool writable);
+      void outputClose();
 
       void sockRead();
       void sockConnect();
@@ -32,22 +32,88 @@
 
 #include "Client.h"
 #include "Buffer.h"
+#include "Base.h"
+#include "Connection.h"
+#include "Event.h"
 
 #include <cbang/config.h>
 #include <cbang/openssl/SSLContext.h>
+#include <cbang/socket/Socket.h>
+#include <cbang/time/Timer.h>
+#include <cbang/util/RateSet.h>
+
+#include <list>
 
 using namespace std;
 using namespace cb;
 using namespace cb::Event;
 
 
+namespace {
+  class PooledConnection : public Connection {
+    DNSBase &dns;
+
+  public:
+    double idleSince = 0;
+    bool reusable = true;
+
+    PooledConnection(Client &client, const URI &uri,
+                     const SmartPointer<SSLContext> &sslCtx) :
+      Connection(client.getBase(), false, uri.getIPAddress(), 0, sslCtx),
+      dns(client.getDNS()) {}
+
+    bool isIdle() const {return reusable && isConnected() && !hasRequest();}
+
+    // From Connection
+    DNSBase &getDNS() {return dns;}
+  };
+
+  typedef SmartPointer<PooledConnection> PooledConnectionPtr;
+
+
+  string getPoolKey(const URI &uri) {
+    return SSTR(uri.getScheme() << "://" << uri.getHost() << ':'
+                << uri.getPort());
+  }
+}
+
+
+struct Client::Pool {
+  list<PooledConnectionPtr> connections;
+  list<OutgoingRequestPtr> pending;
+
+  unsigned getBusy() const {
+    unsigned busy = 0;
+    for (auto &con: connections) if (con->hasRequest()) busy++;
+    return busy;
+  }
+
+
+  PooledConnectionPtr add(Client &client, const URI &uri) {
+    PooledConnectionPtr con = new PooledConnection
+      (client, uri, uri.getScheme() == "https" ? client.getSSLContext() : 0);
+
+    if (0 <= client.getPriority()) con->setPriority(client.getPriority());
+    con->setStats(client.getStats());
+    connections.push_back(con);
+
+    return con;
+  }
+};
+
+
 Client::Client(cb::Event::Base &base, DNSBase &dns) :
   base(base), dns(dns), priority(-1) {}
 
 
 Client::Client(cb::Event::Base &base, DNSBase &dns,
                const SmartPointer<SSLContext> &sslCtx) :
-  base(base), dns(dns), sslCtx(sslCtx), priority(-1) {}
+  base(base), dns(dns), sslCtx(sslCtx), priority(-1) {
+#ifdef HAVE_OPENSSL
+  // Resume TLS sessions on later connections to the same host
+  if (sslCtx.isSet()) sslCtx->setClientSessionCache(true);
+#endif
+}
 
 
 Client::~Client() {}
@@ -60,7 +126,6 @@ Client::call(const URI &uri, RequestMethod method, const char *data,
     new OutgoingRequest(*this, uri, method, cb);
 
   if (data) req->getOutputBuffer().add(data, length);
-  if (0 <= priority) req->setPriority(priority);
   // TODO bind outgoing IP
 
   return req;
@@ -77,3 +142,141 @@ SmartPointer<OutgoingRequest>
 Client::call(const URI &uri, RequestMethod method, callback_t cb) {
   return call(uri, method, 0, 0, cb);
 }
+
+
+void Client::send(OutgoingRequest &req) {
+  auto &pool = pools[getPoolKey(req.getURI())];
+  if (pool.isNull()) pool = new Pool;
+
+  // Without pooling each request gets a connection which is closed after it
+  if (!pooling) {
+    PooledConnectionPtr con = pool->add(*this, req.getURI());
+    con->reusable = false;
+    return con->makeRequest(req);
+  }
+
+  // Reuse an idle connection
+  for (auto &con: pool->connections)
+    if (con->isIdle()) {
+      if (stats.isSet()) stats->event("pool-hit");
+      return con->makeRequest(req);
+    }
+
+  if (!maxInFlight || pool->getBusy() < maxInFlight) {
+    if (stats.isSet()) stats->event("pool-miss");
+    return pool->add(*this, req.getURI())->makeRequest(req);
+  }
+
+  if (pipelining) {
+    // Queue on the busy connection with the fewest requests
+    PooledConnectionPtr best;
+    for (auto &con: pool->connections)
+      if (con->reusable && con->hasRequest() &&
+          (best.isNull() || con->getRequestCount() < best->getRequestCount()))
+        best = con;
+
+    if (best.isSet()) {
+      if (stats.isSet()) stats->event("pool-pipelined");
+      return best->makeRequest(req);
+    }
+  }
+
+  // Wait for a connection
+  if (stats.isSet()) stats->event("pool-queued");
+  pool->pending.push_back(&req);
+}
+
+
+void Client::release(OutgoingRequest &req) {
+  if (!req.hasConnection()) return;
+
+  PooledConnection *con =
+    dynamic_cast<PooledConnection *>(&req.getConnection());
+  if (!con) return;
+
+  // Connection::done() closes the connection after the callback if needed
+  if (req.getConnectionError() || req.needsClose()) con->reusable = false;
+  con->idleSince = Timer::now();
+
+  if (poolEvent.isNull()) poolEvent = base.newEvent(this, &Client::service, 0);
+
+  // Hand the connection to a waiting request
+  auto it = pools.find(getPoolKey(req.getURI()));
+  if (it == pools.end()) return;
+  Pool &pool = *it->second;
+
+  if (!pool.pending.empty()) {
+    if (con->reusable && !con->hasRequest()) {
+      OutgoingRequestPtr next = pool.pending.front();
+      pool.pending.pop_front();
+      con->makeRequest(*next); // Dispatched by Connection::done()
+
+    } else poolEvent->activate();
+
+    return;
+  }
+
+  // Drop the connection after the callback returns
+  if (!con->reusable) return poolEvent->activate();
+
+  // Enforce max idle after the callback returns
+  unsigned idle = 0;
+  for (auto &c: pool.connections)
+    if (c->isIdle() || c.get() == con) idle++;
+
+  if (maxIdle < idle) {
+    con->reusable = false;
+    poolEvent->activate();
+
+  } else if (!poolEvent->isPending()) poolEvent->add(idleTimeout);
+}
+
+
+void Client::service() {
+  double now = Timer::now();
+  double nextTimeout = 0;
+
+  for (auto it = pools.begin(); it != pools.end();) {
+    Pool &pool = *it->second;
+
+    // Drop closed, expired or excess idle connections
+    for (auto it2 = pool.connections.begin(); it2 != pool.connections.end();) {
+      auto &con = *it2;
+
+      if (!con->hasRequest() &&
+          (!con->isIdle() || con->idleSince + idleTimeout <= now))
+        it2 = pool.connections.erase(it2);
+
+      else {
+        if (con->isIdle()) {
+          double timeout = con->idleSince + idleTimeout - now;
+          if (!nextTimeout || timeout < nextTimeout) nextTimeout = timeout;
+        }
+
+        it2++;
+      }
+    }
+
+    // Start waiting requests
+    while (!pool.pending.empty()) {
+      PooledConnectionPtr con;
+
+      for (auto &c: pool.connections)
+        if (c->isIdle()) {con = c; break;}
+
+      if (con.isNull()) {
+        if (maxInFlight && maxInFlight <= pool.getBusy()) break;
+        con = pool.add(*this, pool.pending.front()->getURI());
+      }
+
+      OutgoingRequestPtr req = pool.pending.front();
+      pool.pending.pop_front();
+      con->makeRequest(*req);
+    }
+
+    if (pool.connections.empty() && pool.pending.empty()) pools.erase(it++);
+    else it++;
+  }
+
+  if (nextTimeout) poolEvent->add(nextTimeout);
+}
@@ -37,16 +37,19 @@
 #include <cbang/SmartPointer.h>
 
 #include <map>
+#include <string>
 #include <functional>
 
 
 namespace cb {
   class URI;
   class SSLContext;
+  class RateSet;
 
   namespace Event {
     class Base;
     class DNSBase;
+    class Event;
 
     class Client {
       Base &base;
@@ -54,6 +57,18 @@ namespace cb {
       SmartPointer<SSLContext> sslCtx;
       int priority;
 
+      bool pooling         = false;
+      unsigned maxIdle     = 8;
+      unsigned maxInFlight = 0;
+      double idleTimeout   = 4;
+      bool pipelining      = false;
+
+      struct Pool;
+      typedef std::map<std::string, SmartPointer<Pool> > pools_t;
+      pools_t pools;
+      SmartPointer<Event> poolEvent;
+      SmartPointer<RateSet> stats;
+
     public:
       template <class T> struct Callback {
         typedef void (T::*member_t)(Request &);
@@ -72,6 +87,29 @@ namespace cb {
       int getPriority() const {return priority;}
       void setPriority(int priority) {this->priority = priority;}
 
+      /// Reuse keep-alive connections per scheme, host and port
+      void setPooling(bool pooling) {this->pooling = pooling;}
+      bool isPooling() const {return pooling;}
+
+      /// Maximum idle connections kept per host
+      void setMaxIdle(unsigned max) {maxIdle = max;}
+      unsigned getMaxIdle() const {return maxIdle;}
+
+      /// Maximum concurrent requests per host, 0 for no limit
+      void setMaxInFlight(unsigned max) {maxInFlight = max;}
+      unsigned getMaxInFlight() const {return maxInFlight;}
+
+      /// Should be shorter than the servers' keep-alive timeout
+      void setIdleTimeout(double timeout) {idleTimeout = timeout;}
+      double getIdleTimeout() const {return idleTimeout;}
+
+      /// Queue requests on busy connections once max in-flight is reached
+      void setPipelining(bool pipelining) {this->pipelining = pipelining;}
+      bool getPipelining() const {return pipelining;}
+
+      void setStats(const SmartPointer<RateSet> &stats) {this->stats = stats;}
+      const SmartPointer<RateSet> &getStats() const {return stats;}
+
       SmartPointer<OutgoingRequest>
       call(const URI &uri, RequestMethod method, const char *data,
            unsigned length, callback_t cb);
@@ -83,6 +121,10 @@ namespace cb {
       SmartPointer<OutgoingRequest>
       call(const URI &uri, RequestMethod method, callback_t cb);
 
+      // Called by OutgoingRequest
+      void send(OutgoingRequest &req);
+      void release(OutgoingRequest &req);
+
 
       // Member callbacks
       template <class T>
@@ -104,6 +146,9 @@ namespace cb {
       call(const URI &uri, RequestMethod method,
            T *obj, typename Callback<T>::member_t member)
       {return call(uri, method, bind(obj, member));}
+
+    protected:
+      void service();
     };
   }
 }
@@ -46,43 +46,59 @@ bool ConcurrentPool::Task::shouldShutdown() {
 
 ConcurrentPool::ConcurrentPool(cb::Event::Base &base, unsigned size) :
   ThreadPool(size), base(base),
-  event(base.newEvent(this, &ConcurrentPool::complete, EF::EVENT_NO_SELF_REF)) {
+  event(base.newEvent(this, &ConcurrentPool::complete, EF::EVENT_NO_SELF_REF)),
+  nextWorker(0), nextSubmit(0), ready(0), active(0), sleeping(0),
+  completePending(false) {
   if (!Base::threadsEnabled())
     THROW("Cannot use Event::ConcurrentPool without threads enabled.  "
           "Call Event::Base::enableThreads() before creating Event::Base.");
+
+  for (unsigned i = 0; i < (size ? size : 1); i++)
+    workers.push_back(new Worker);
 }
 
 
 ConcurrentPool::~ConcurrentPool() {}
 
 
-unsigned ConcurrentPool::getNumReady() const {
-  SmartLock lock(this);
-  return ready.size();
-}
+unsigned ConcurrentPool::getNumReady() const {return ready;}
+unsigned ConcurrentPool::getNumActive() const {return active;}
 
 
-unsigned ConcurrentPool::getNumActive() const {
-  SmartLock lock(this);
-  return active;
-}
+unsigned ConcurrentPool::getNumCompleted() const {
+  unsigned count = 0;
 
+  for (unsigned i = 0; i < workers.size(); i++) {
+    SmartLock lock(workers[i].get());
+    count += workers[i]->completed.size();
+  }
 
-unsigned ConcurrentPool::getNumCompleted() const {
-  SmartLock lock(this);
-  return completed.size();
+  return count;
 }
 
 
 void ConcurrentPool::submit(const SmartPointer<Task> &task) {
-  SmartLock lock(this);
-  ready.push(task);
-  Condition::signal();
+  Worker &worker = *workers[nextSubmit++ % workers.size()];
+
+  // Counted before a thief can pop it and before checking for sleeping
+  // threads, see sleep()
+  {
+    SmartLock lock(&worker);
+    worker.ready.push(task);
+    ready++;
+  }
+
+  if (sleeping) {
+    SmartLock lock(this);
+    Condition::signal();
+  }
 }
 
 
 void ConcurrentPool::stop() {
   ThreadPool::stop();
+
+  SmartLock lock(this);
   Condition::broadcast();
 }
 
@@ -93,55 +109,120 @@ void ConcurrentPool::join() {
 }
 
 
-void ConcurrentPool::run() {
+SmartPointer<ConcurrentPool::Task> ConcurrentPool::pop(Worker &worker) {
+  if (worker.ready.empty()) return 0;
+
+  SmartPointer<Task> task = worker.ready.top();
+  worker.ready.pop();
+  ready--;
+
+  return task;
+}
+
+
+SmartPointer<ConcurrentPool::Task>
+ConcurrentPool::steal(unsigned id, bool block) {
+  for (unsigned i = 1; i < workers.size() && ready; i++) {
+    Worker &victim = *workers[(id + i) % workers.size()];
+
+    if (block) victim.lock();
+    else if (!victim.tryLock()) continue;
+
+    SmartLock lock(&victim, -1, true);
+    SmartPointer<Task> task = pop(victim);
+    if (task.isSet()) return task;
+  }
+
+  return 0;
+}
+
+
+SmartPointer<ConcurrentPool::Task> ConcurrentPool::next(unsigned id) {
+  Worker &worker = *workers[id];
+
+  {
+    SmartLock lock(&worker);
+    SmartPointer<Task> task = pop(worker);
+    if (task.isSet()) return task;
+  }
+
+  // Avoid contended queues first
+  SmartPointer<Task> task = steal(id, false);
+  if (task.isNull()) task = steal(id, true);
+
+  return task;
+}
+
+
+void ConcurrentPool::sleep() {
   SmartLock lock(this);
 
+  // A submitter either sees this thread sleeping or this thread sees its task
+  sleeping++;
+  if (!ready && !Thread::current().shouldShutdown()) Condition::wait();
+  sleeping--;
+}
+
+
+void ConcurrentPool::run() {
+  unsigned id = nextWorker++ % workers.size();
+  Worker &worker = *workers[id];
+
   while (!Thread::current().shouldShutdown()) {
-    if (ready.empty()) Condition::wait();
-    if (Thread::current().shouldShutdown()) break;
+    SmartPointer<Task> task = next(id);
+    if (task.isNull()) {sleep(); continue;}
 
-    // Get Task from ready queue
-    if (ready.empty()) continue;
-    SmartPointer<Task> task = ready.top();
-    ready.pop();
     active++;
 
-    {
-      SmartUnlock unlock(this);
-
-      // Run Task
-      try {
-        task->run();
+    // Run Task
+    try {
+      task->run();
 
-      } catch (const Exception &e) {
-        task->setException(e);
+    } catch (const Exception &e) {
+      task->setException(e);
 
-      } catch (const std::exception &e) {
-        task->setException(string(e.what()));
+    } catch (const std::exception &e) {
+      task->setException(string(e.what()));
 
-      } catch (...) {
-        task->setException(string("Unknown exception"));
-      }
+    } catch (...) {
+      task->setException(string("Unknown exception"));
     }
 
     // Put Task in completed queue
-    completed.push(task);
-    if (!event->isPending()) event->activate();
+    {
+      SmartLock lock(&worker);
+      worker.completed.push(task);
+    }
+
     active--;
+
+    // Only wake the event loop once per batch of completions
+    if (!completePending.exchange(true)) event->activate();
   }
 }
 
 
 void ConcurrentPool::complete() {
-  SmartLock lock(this);
+  completePending = false;
+
+  // Collect completed Tasks from all workers
+  queue_t completed;
+  for (unsigned i = 0; i < workers.size(); i++) {
+    Worker &worker = *workers[i];
+    SmartLock lock(&worker);
+
+    if (completed.empty()) swap(completed, worker.completed);
+    else while (!worker.completed.empty()) {
+        completed.push(worker.completed.top());
+        worker.completed.pop();
+      }
+  }
 
   // Dequeue completed tasks
   while (!completed.empty()) {
     SmartPointer<Task> task = completed.top();
     completed.pop();
 
-    SmartUnlock unlock(this);
-
     try {
       if (task->getFailed()) task->error(task->getException());
       else task->success();
@@ -35,6 +35,7 @@
 #include "Base.h"
 #include "Event.h"
 
+#include <cbang/os/Mutex.h>
 #include <cbang/os/ThreadPool.h>
 #include <cbang/os/Condition.h>
 #include <cbang/util/SmartLock.h>
@@ -42,14 +43,16 @@
 #include <cbang/time/Time.h>
 
 #include <queue>
+#include <vector>
 #include <functional>
+#include <atomic>
 
 
 namespace cb {
   namespace Event {
     class ConcurrentPool : protected ThreadPool, protected Condition {
     public:
-      class Task : public ProtectedRefCounterImpl<Task> {
+      class Task : public Mutex {
         int priority;
         uint64_t ts = Time::now();
         Exception e;
@@ -156,15 +159,26 @@ namespace cb {
       };
 
     protected:
-      Base &base;
-      SmartPointer<Event> event;
-
       typedef std::priority_queue<SmartPointer<Task>,
                                   std::vector<SmartPointer<Task> >,
                                   TaskPtrCompare> queue_t;
-      unsigned active = 0;
-      queue_t ready;
-      queue_t completed;
+
+      /// Per thread ready and completed queues.  Idle threads steal work.
+      struct Worker : public Mutex {
+        queue_t ready;
+        queue_t completed;
+      };
+
+      Base &base;
+      SmartPointer<Event> event;
+
+      std::vector<SmartPointer<Worker> > workers;
+      std::atomic<unsigned> nextWorker;
+      std::atomic<unsigned> nextSubmit;
+      std::atomic<unsigned> ready;
+      std::atomic<unsigned> active;
+      std::atomic<unsigned> sleeping;
+      std::atomic<bool> completePending;
 
     public:
       ConcurrentPool(Base &base, unsigned size);
@@ -193,6 +207,11 @@ namespace cb {
       void join();
 
     protected:
+      SmartPointer<Task> pop(Worker &worker);
+      SmartPointer<Task> steal(unsigned id, bool block);
+      SmartPointer<Task> next(unsigned id);
+      void sleep();
+
       void run();
 
       void complete();
@@ -165,8 +165,9 @@ void Connection::makeRequest(Request &req) {
   bool first = requests.empty();
   push(&req);
 
-  // If this is the active request dispatch it
-  if (first) dispatch();
+  // If this is the active request dispatch it, unless called from a response
+  // callback in which case done() will dispatch it
+  if (first && !responding) dispatch();
 }
 
 
@@ -320,7 +321,9 @@ void Connection::done() {
 
     try {
       // Callback
+      responding = true;
       req->onResponse(CONN_ERR_OK);
+      responding = false;
 
       // Close connection if needed
       bool needsClose = req->needsClose();
@@ -338,6 +341,7 @@ void Connection::done() {
       return;
     } CATCH_ERROR;
 
+    responding = false;
     free(CONN_ERR_EXCEPTION);
   }
 }
@@ -413,9 +417,13 @@ void Connection::websockReadBody() {
 
   auto &ws = getWebsocket();
 
-  if (ws.readBody(getInput())) {
-    if (ws.isActive()) setState(STATE_WEBSOCK_HEADER);
-    else setState(STATE_WRITING); // Writing close
+  // Process every frame already buffered
+  while (ws.readBody(getInput())) {
+    if (!ws.isActive()) return setState(STATE_WRITING); // Writing close
+
+    setState(STATE_WEBSOCK_HEADER);
+    if (!ws.readHeader(getInput())) return;
+    setState(STATE_WEBSOCK_BODY);
   }
 }
 
@@ -429,13 +437,23 @@ void Connection::startRead() {
 }
 
 
-void Connection::newRequest(const string &line) {
+void Connection::newRequest(const char *line, const char *end) {
   LOG_DEBUG(4, __func__ << "()");
 
-  vector<string> parts;
-  String::tokenize(line, parts, " ");
+  // Split on spaces in place
+  string parts[3];
+  unsigned count = 0;
+
+  for (const char *p = line; p < end;) {
+    while (p < end && *p == ' ') p++;
+    const char *start = p;
+    while (p < end && *p != ' ') p++;
+
+    if (start == p || 3 <= count++) break;
+    parts[count - 1].assign(start, p - start);
+  }
 
-  if (parts.size() != 3) THROW("Invalid HTTP request line: " << line);
+  if (count != 3) THROW("Invalid HTTP request line: " << string(line, end));
 
   RequestMethod method = RequestMethod::parse(parts[0]);
   URI uri = parts[1];
@@ -449,17 +467,36 @@ void Connection::readFirstLine() {
   LOG_DEBUG(4, __func__ << "()");
 
   try {
-    string line = getInput().readLine(maxHeaderSize);
-    if (line.empty()) return; // Need more data
+    Buffer &input = getInput();
+    unsigned length = 0;
+    const char *line;
+
+    // Skip empty lines before the first line
+    while ((line = input.peekLine(maxHeaderSize, length)) &&
+           (length == 1 || (length == 2 && line[0] == '\r')))
+      input.drain(length);
+
+    if (!line) {
+      if (maxHeaderSize && maxHeaderSize <= input.getLength())
+        return getRequest()->sendError(HTTP_BAD_REQUEST, "Header too long");
+      return; // Need more data
+    }
 
-    if (maxHeaderSize && maxHeaderSize < line.length())
-      return getRequest()->sendError(HTTP_BAD_REQUEST, "Header too long");
+    headerSize += length;
 
-    headerSize += line.length() + 2;
+    const char *end = line + length - 1;
+    if (line < end && end[-1] == '\r') end--;
 
-    if (incoming) newRequest(line);
-    else getRequest()->parseResponseLine(line);
+    try {
+      if (incoming) newRequest(line, end);
+      else getRequest()->parseResponseLine(string(line, end));
 
+    } catch (...) {
+      input.drain(length);
+      throw;
+    }
+
+    input.drain(length);
     readHeader();
 
   } catch (const Exception &e) {
@@ -512,12 +549,15 @@ void Connection::readHeader() {
   // Done reading headers
   if (incoming) {
     // Handle protocol upgrades
-    if (req->inHas("Upgrade")) {
-      string upgrade = String::toLower(req->inFind("Upgrade"));
+    const Headers &hdrs = req->getInputHeaders();
 
-      if (upgrade == "websocket") {
+    if (hdrs.has(Headers::HEADER_UPGRADE)) {
+      if (hdrs.keyEquals(Headers::HEADER_UPGRADE, "websocket")) {
         Websocket *websock = dynamic_cast<Websocket *>(req.get());
         if (websock && websock->upgrade()) {
+          // Don't hold small frames back waiting for ACKs
+          if (getSocket().isSet()) getSocket()->setNoDelay(true);
+
           TRY_CATCH_ERROR(websock->onOpen(); return);
           websock->close(WS_STATUS_UNEXPECTED, "Exception");
           return;
@@ -550,17 +590,16 @@ void Connection::getBody() {
   bodySize = 0;
   contentLength = -1;
   auto req = getRequest();
+  const Headers &hdrs = req->getInputHeaders();
 
-  string xferEnc = String::toLower(req->inFind("Transfer-Encoding"));
-  if (xferEnc == "chunked") chunkedRequest = true;
+  if (hdrs.keyEquals(Headers::HEADER_TRANSFER_ENCODING, "chunked"))
+    chunkedRequest = true;
   else {
-    string contentLength = req->inFind("Content-Length");
+    const string *contentLength = hdrs.find(Headers::HEADER_CONTENT_LENGTH);
 
-    if (contentLength.empty()) {
+    if (!contentLength || contentLength->empty()) {
       // Check for Connection: close
-      string connection = String::toLower(req->inFind("Connection"));
-
-      if (connection != "close") {
+      if (!hdrs.keyEquals(Headers::HEADER_CONNECTION, "close")) {
         // Bad combination, cannot tell when communication should end
         LOG_ERROR("No Content-Length but peer wants to keep connection open");
         return req->sendError(HTTP_BAD_REQUEST,
@@ -572,7 +611,7 @@ void Connection::getBody() {
 
     } else {
       try {
-        bytesToRead = String::parseU32(contentLength);
+        bytesToRead = String::parseU32(*contentLength);
         this->contentLength = bytesToRead;
       } catch (const Exception &e) {
         return req->sendError(HTTP_BAD_REQUEST, "Invalid Content-Length");
@@ -589,10 +628,10 @@ void Connection::getBody() {
   // 100 HTTP continue
   auto &version = req->getVersion();
   if (incoming && Version(1, 1) <= version && !getInput().getLength()) {
-    string expect = String::toLower(req->inFind("Expect"));
+    const string *expect = hdrs.find(Headers::HEADER_EXPECT);
 
-    if (!expect.empty()) {
-      if (expect == "100-continue")
+    if (expect && !expect->empty()) {
+      if (hdrs.keyEquals(Headers::HEADER_EXPECT, "100-continue"))
         try {
           if (req->onContinue()) {
             getOutput()
@@ -743,6 +782,7 @@ void Connection::writeCB() {
     if (state != STATE_WRITING) return;
 
     auto req = getRequest();
+    if (req->writeFileChunk()) return; // Still writing file body
 
     if (incoming) {
       if (req->isChunked()) return; // Still writing
@@ -815,6 +855,12 @@ void Connection::errorCB(short what, int err) {
 }
 
 
+void Connection::writableCB(bool writable) {
+  LOG_DEBUG(4, __func__ << '(' << writable << ')');
+  if (hasRequest()) getRequest()->onWritable(writable);
+}
+
+
 void Connection::received(unsigned bytes) {
   rateIn.event(bytes);
   if (stats.isSet()) stats->event("receiving", bytes);
@@ -99,6 +99,7 @@ namespace cb {
 
       bool detectClose    = false;
       bool chunkedRequest = false;
+      bool responding     = false;
 
       uint32_t headerSize = 0;
       uint32_t bodySize   = 0;
@@ -138,6 +139,7 @@ namespace cb {
       void setHTTP(const SmartPointer<HTTP> &http) {this->http = http;}
 
       bool hasRequest() const {return !requests.empty();}
+      unsigned getRequestCount() const {return requests.size();}
       const SmartPointer<Request> &getRequest() const;
       void checkActiveRequest(Request &req) const;
       bool isWebsocket() const;
@@ -208,7 +210,7 @@ namespace cb {
       void websockReadBody();
 
       void startRead();
-      void newRequest(const std::string &line);
+      void newRequest(const char *line, const char *end);
       void readFirstLine();
       bool tryReadHeader();
       void headersCallback();
@@ -231,6 +233,7 @@ namespace cb {
       void readCB();
       void writeCB();
       void errorCB(short what, int err);
+      void writableCB(bool writable);
 
       void received(unsigned bytes);
       void sent(unsigned bytes);
@@ -0,0 +1,457 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+#include "ContentCache.h"
+#include "Request.h"
+#include "Headers.h"
+
+#include <cbang/String.h>
+#include <cbang/config.h>
+#include <cbang/util/Resource.h>
+#include <cbang/util/SmartLock.h>
+#include <cbang/os/SystemUtilities.h>
+#include <cbang/os/SysError.h>
+#include <cbang/http/ContentTypes.h>
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+namespace io = boost::iostreams;
+
+#ifdef HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <cstdlib>
+#include <strings.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace cb;
+using namespace cb::Event;
+
+
+namespace {
+  const Request::compression_t compressions[] = {
+    Request::COMPRESS_BROTLI, Request::COMPRESS_ZSTD, Request::COMPRESS_GZIP,
+  };
+
+
+  uint64_t fnv1a(const char *data, uint64_t length) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (uint64_t i = 0; i < length; i++) {
+      hash ^= (uint8_t)data[i];
+      hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+  }
+
+
+  bool isSpace(char c) {return c == ' ' || c == '\t';}
+
+
+  // Parse Accept-Encoding in place, unset quality values are negative
+  void parseAccept(const string &accept, double q[], double &identityQ) {
+    double otherQ = -1;
+    identityQ = -1;
+    for (int i = 0; i < ContentCache::ENCODINGS; i++) q[i] = -1;
+
+    const char *s = accept.c_str();
+
+    while (*s) {
+      while (isSpace(*s) || *s == ',') s++;
+      if (!*s) break;
+
+      const char *name = s;
+      while (*s && *s != ',' && *s != ';' && !isSpace(*s)) s++;
+      unsigned len = s - name;
+
+      double value = 1;
+      while (*s && *s != ',') {
+        if ((*s == 'q' || *s == 'Q') && s[1] == '=') {
+          value = strtod(s + 2, 0);
+          s += 2;
+        } else s++;
+      }
+
+#define MATCH(NAME) (len == sizeof(NAME) - 1 && !strncasecmp(name, NAME, len))
+      if (MATCH("br")) q[ContentCache::ENCODING_BROTLI] = value;
+      else if (MATCH("zstd")) q[ContentCache::ENCODING_ZSTD] = value;
+      else if (MATCH("gzip") || MATCH("x-gzip"))
+        q[ContentCache::ENCODING_GZIP] = value;
+      else if (MATCH("identity")) identityQ = value;
+      else if (MATCH("*")) otherQ = value;
+#undef MATCH
+    }
+
+    for (int i = 0; i < ContentCache::ENCODINGS; i++)
+      if (q[i] < 0) q[i] = otherQ < 0 ? 0 : otherQ;
+
+    // Unless listed, identity is only the fallback, see RFC 7231 5.3.4
+    if (identityQ < 0) identityQ = 0;
+  }
+
+
+  bool etagMatches(const string &header, const string &etag) {
+    const char *s = header.c_str();
+
+    while (*s) {
+      while (isSpace(*s) || *s == ',') s++;
+      if (!*s) break;
+
+      if (*s == '*') return true;
+      if (s[0] == 'W' && s[1] == '/') s += 2;
+
+      const char *tag = s;
+      while (*s && *s != ',' && !isSpace(*s)) s++;
+
+      if ((unsigned)(s - tag) == etag.length() &&
+          !etag.compare(0, etag.length(), tag, s - tag)) return true;
+    }
+
+    return false;
+  }
+}
+
+
+uint64_t ContentCache::Entry::getBytes() const {
+  uint64_t bytes = ENTRY_OVERHEAD;
+  for (int i = 0; i < ENCODINGS; i++) bytes += encoded[i].length();
+  return bytes;
+}
+
+
+ContentCache::ContentCache(uint64_t maxBytes) :
+  minSize(256), maxFileSize(16 * 1024 * 1024), maxBytes(maxBytes) {}
+
+
+void ContentCache::clear() {
+  SmartLock lock(this);
+  entries.clear();
+  bytes = 0;
+}
+
+
+const char *ContentCache::getEncodingName(encoding_t encoding) {
+  switch (encoding) {
+  case ENCODING_BROTLI: return "br";
+  case ENCODING_ZSTD: return "zstd";
+  case ENCODING_GZIP: return "gzip";
+  default: THROW("Invalid encoding " << encoding);
+  }
+}
+
+
+bool ContentCache::isSupported(encoding_t encoding) {
+  switch (encoding) {
+#ifdef HAVE_BROTLI
+  case ENCODING_BROTLI: return true;
+#endif
+#ifdef HAVE_ZSTD
+  case ENCODING_ZSTD: return true;
+#endif
+  case ENCODING_GZIP: return true;
+  default: return false;
+  }
+}
+
+
+bool ContentCache::isCompressible(const string &path) {
+  auto &types = HTTP::ContentTypes::instance();
+  auto it = types.find(String::toLower(SystemUtilities::extension(path)));
+  if (it == types.end()) return false;
+
+  const string &type = it->second;
+  return String::startsWith(type, "text/") ||
+    type.find("json") != string::npos ||
+    type.find("javascript") != string::npos ||
+    type.find("xml") != string::npos;
+}
+
+
+string ContentCache::compress(encoding_t encoding, const char *data,
+                              uint64_t length) {
+  string out;
+
+  // Moderate levels so a cache miss does not stall the event loop, the
+  // maximum levels are many times slower for slightly smaller output
+  switch (encoding) {
+#ifdef HAVE_BROTLI
+  case ENCODING_BROTLI: {
+    size_t size = BrotliEncoderMaxCompressedSize(length);
+    out.resize(size);
+
+    if (!BrotliEncoderCompress
+        (5, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, length,
+         (const uint8_t *)data, &size, (uint8_t *)&out[0]))
+      THROW("Brotli compression failed");
+
+    out.resize(size);
+    break;
+  }
+#endif
+
+#ifdef HAVE_ZSTD
+  case ENCODING_ZSTD: {
+    out.resize(ZSTD_compressBound(length));
+    size_t size =
+      ZSTD_compress(&out[0], out.length(), data, length, 3);
+
+    if (ZSTD_isError(size))
+      THROW("Zstd compression failed: " << ZSTD_getErrorName(size));
+
+    out.resize(size);
+    break;
+  }
+#endif
+
+  case ENCODING_GZIP: {
+    io::filtering_ostream stream;
+    stream.push(io::gzip_compressor(io::gzip::default_compression));
+    stream.push(io::back_inserter(out));
+    stream.write(data, length);
+    stream.reset();
+    break;
+  }
+
+  default: THROW("Unsupported encoding " << encoding);
+  }
+
+  return out;
+}
+
+
+bool ContentCache::reply(Request &req, const Resource &res) {
+  const char *data = res.getData();
+  uint64_t length = res.getLength();
+  key_t key(&res, string());
+  EntryPtr entry = find(key, length, 0);
+
+  if (entry.isNull()) {
+    try {
+      string etag = SSTR(hex << fnv1a(data, length) << '-' << length);
+      entry = build(res.getName(), data, length, etag);
+
+    } catch (...) {
+      insert(key, 0);
+      throw;
+    }
+
+    insert(key, entry);
+  }
+
+  return reply(req, entry);
+}
+
+
+bool ContentCache::reply(Request &req, const string &path) {
+  struct stat buf;
+  if (stat(path.c_str(), &buf))
+    THROW("Accessing '" << path << "': " << SysError());
+
+  return reply(req, path, buf.st_size, buf.st_mtime);
+}
+
+
+bool ContentCache::reply(Request &req, const string &path, uint64_t size,
+                         uint64_t mtime) {
+  key_t key(0, path);
+  EntryPtr entry = find(key, size, mtime);
+
+  // Build if missing or the file changed
+  if (entry.isNull()) {
+    try {
+      string etag = SSTR(hex << size << '-' << mtime);
+
+      if (maxFileSize < size || size < minSize || !isCompressible(path))
+        entry = build(path, 0, 0, etag);
+
+      else {
+        string data = SystemUtilities::read(path);
+        entry = build(path, data.data(), data.length(), etag);
+      }
+
+      entry->size = size;
+      entry->mtime = mtime;
+
+    } catch (...) {
+      insert(key, 0);
+      throw;
+    }
+
+    insert(key, entry);
+  }
+
+  return reply(req, entry);
+}
+
+
+ContentCache::EntryPtr ContentCache::find(const key_t &key, uint64_t size,
+                                          uint64_t mtime) {
+  SmartLock lock(this);
+
+  // Wait for another thread building the same entry
+  while (building.count(key)) wait();
+
+  auto it = entries.find(key);
+  if (it != entries.end() && it->second->size == size &&
+      it->second->mtime == mtime) {
+    it->second->lastUsed = ++clock;
+    return it->second;
+  }
+
+  // The caller must build the entry then call insert()
+  building.insert(key);
+  return 0;
+}
+
+
+ContentCache::EntryPtr ContentCache::build(const string &name,
+                                           const char *data, uint64_t length,
+                                           const string &etag) {
+  EntryPtr entry = new Entry;
+  entry->etag = etag;
+  entry->size = length;
+
+  if (length < minSize || !isCompressible(name)) return entry;
+
+  for (int i = 0; i < ENCODINGS; i++) {
+    encoding_t encoding = (encoding_t)i;
+    if (!isSupported(encoding)) continue;
+
+    string out = compress(encoding, data, length);
+    if (out.length() < length) entry->encoded[i].swap(out);
+  }
+
+  return entry;
+}
+
+
+void ContentCache::insert(const key_t &key, const EntryPtr &entry) {
+  SmartLock lock(this);
+
+  building.erase(key);
+  broadcast();
+
+  if (entry.isNull()) return; // Build failed
+
+  auto it = entries.find(key);
+  if (it != entries.end()) {
+    bytes -= it->second->getBytes();
+    entries.erase(it);
+  }
+
+  // Content that can never fit keeps only its ETag
+  if (maxBytes < entry->getBytes())
+    for (int i = 0; i < ENCODINGS; i++) string().swap(entry->encoded[i]);
+
+  if (maxBytes < entry->getBytes()) return; // Not even the ETag fits
+
+  while (maxBytes < bytes + entry->getBytes()) evict();
+
+  entry->lastUsed = ++clock;
+  bytes += entry->getBytes();
+  entries[key] = entry;
+}
+
+
+void ContentCache::evict() {
+  auto lru = entries.end();
+
+  for (auto it = entries.begin(); it != entries.end(); it++)
+    if (lru == entries.end() || it->second->lastUsed < lru->second->lastUsed)
+      lru = it;
+
+  if (lru == entries.end()) THROW("Nothing to evict");
+
+  bytes -= lru->second->getBytes();
+  entries.erase(lru);
+}
+
+
+bool ContentCache::reply(Request &req, const EntryPtr &entry) {
+  bool vary = false;
+  for (int i = 0; i < ENCODINGS; i++)
+    if (!entry->encoded[i].empty()) vary = true;
+
+  if (vary) req.outSet("Vary", "Accept-Encoding");
+
+  // Select an encoding, ranges are only served from the identity encoding
+  auto &in = req.getInputHeaders();
+  const string *accept = in.find(Headers::HEADER_ACCEPT_ENCODING);
+  int encoding = -1;
+
+  if (vary && accept && !in.has(Headers::HEADER_RANGE)) {
+    double q[ENCODINGS];
+    double identityQ;
+    parseAccept(*accept, q, identityQ);
+
+    double best = 0;
+    for (int i = 0; i < ENCODINGS; i++)
+      if (!entry->encoded[i].empty() && best < q[i]) {
+        best = q[i];
+        encoding = i;
+      }
+
+    if (best < identityQ) encoding = -1;
+  }
+
+  string etag = "\"" + entry->etag;
+  if (0 <= encoding)
+    etag += string("-") + getEncodingName((encoding_t)encoding);
+  etag += "\"";
+  req.outSet("ETag", etag);
+
+  const string *match = in.find(Headers::HEADER_IF_NONE_MATCH);
+  if (match && etagMatches(*match, etag)) {
+    req.reply(HTTPStatus::HTTP_NOT_MODIFIED);
+    return true;
+  }
+
+  if (encoding < 0) return false;
+
+  const string &body = entry->encoded[encoding];
+  req.outSetContentEncoding(compressions[encoding]);
+
+  if (req.getMethod() == RequestMethod::HTTP_HEAD)
+    req.outSet("Content-Length", String(body.length()));
+  else req.getOutputBuffer().addRef(body.data(), body.length(), [entry] () {});
+
+  req.reply(HTTPStatus::HTTP_OK);
+
+  return true;
+}
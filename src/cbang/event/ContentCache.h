@@ -0,0 +1,133 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+#pragma once
+
+#include <cbang/SmartPointer.h>
+#include <cbang/os/Condition.h>
+
+#include <string>
+#include <map>
+#include <set>
+
+
+namespace cb {
+  class Resource;
+
+  namespace Event {
+    class Request;
+
+    /**
+     * Caches precompressed representations of static content.  Each
+     * resource or file is compressed once, on first request, with every
+     * supported encoding at a level fast enough to run on the event loop.
+     * Concurrent requests for content being compressed wait for that one
+     * build.  Later requests pick a representation from Accept-Encoding and
+     * send it by reference, so no compression work is done per request.
+     *
+     * When the budget is full the least recently used entries are evicted.
+     * Each entry is charged ENTRY_OVERHEAD bytes on top of its encodings.
+     * Content too large to fit at all is served uncompressed.
+     */
+    class ContentCache : public Condition {
+    public:
+      typedef enum {
+        ENCODING_BROTLI, ENCODING_ZSTD, ENCODING_GZIP, ENCODINGS
+      } encoding_t;
+
+      /// Bytes charged per entry, so entries without encodings are bounded
+      static const unsigned ENTRY_OVERHEAD = 256;
+
+      struct Entry {
+        std::string etag;
+        uint64_t size = 0;
+        uint64_t mtime = 0;
+        uint64_t lastUsed = 0;
+        std::string encoded[ENCODINGS];
+
+        uint64_t getBytes() const;
+      };
+
+      typedef SmartPointer<Entry>::Protected EntryPtr;
+
+    protected:
+      uint64_t minSize;
+      uint64_t maxFileSize;
+      uint64_t maxBytes;
+      uint64_t bytes = 0;
+      uint64_t clock = 0;
+
+      // Resources are keyed by address, files by path
+      typedef std::pair<const Resource *, std::string> key_t;
+      std::map<key_t, EntryPtr> entries;
+      std::set<key_t> building;
+
+    public:
+      ContentCache(uint64_t maxBytes = 64 * 1024 * 1024);
+
+      void setMinSize(uint64_t x) {minSize = x;}
+      uint64_t getMinSize() const {return minSize;}
+      void setMaxFileSize(uint64_t x) {maxFileSize = x;}
+      uint64_t getMaxFileSize() const {return maxFileSize;}
+      void setMaxBytes(uint64_t x) {maxBytes = x;}
+      uint64_t getMaxBytes() const {return maxBytes;}
+      uint64_t getBytes() const {return bytes;}
+
+      void clear();
+
+      static const char *getEncodingName(encoding_t encoding);
+      static bool isSupported(encoding_t encoding);
+      static bool isCompressible(const std::string &path);
+      static std::string compress(encoding_t encoding, const char *data,
+                                  uint64_t length);
+
+      /**
+       * Set ETag and Vary headers and reply with 304 Not Modified or a
+       * precompressed body when possible.
+       *
+       * @return false if the caller should send the identity encoding.
+       */
+      bool reply(Request &req, const Resource &res);
+      bool reply(Request &req, const std::string &path);
+      /// Use when the file has already been stat()ed
+      bool reply(Request &req, const std::string &path, uint64_t size,
+                 uint64_t mtime);
+
+    protected:
+      EntryPtr find(const key_t &key, uint64_t size, uint64_t mtime);
+      EntryPtr build(const std::string &name, const char *data,
+                     uint64_t length, const std::string &etag);
+      void insert(const key_t &key, const EntryPtr &entry);
+      void evict();
+      bool reply(Request &req, const EntryPtr &entry);
+    };
+  }
+}
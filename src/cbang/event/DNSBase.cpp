@@ -33,8 +33,12 @@
 #include "DNSBase.h"
 
 #include "Base.h"
+#include "Event.h"
 
 #include <cbang/Exception.h>
+#include <cbang/String.h>
+#include <cbang/os/SystemUtilities.h>
+#include <cbang/time/Timer.h>
 
 #include <event2/dns.h>
 
@@ -43,8 +47,31 @@ using namespace cb;
 using namespace cb::Event;
 
 
+struct DNSBase::Entry {
+  bool valid = false;
+  bool permanent = false;
+  int error = DNS_ERR_NONE;
+  vector<IPAddress> addrs;
+  double expires = 0;
+
+  bool querying = false;
+  SmartPointer<DNSRequest> query;
+  list<SmartPointer<DNSRequest> > waiting;
+
+  bool isFresh(double now) const {
+    return valid && (permanent || now < expires);
+  }
+
+  int getTTL(double now, double maxTTL) const {
+    if (permanent) return maxTTL;
+    return now < expires ? expires - now : 0;
+  }
+};
+
+
 DNSBase::DNSBase(cb::Event::Base &base, bool initialize,
                  bool failRequestsOnExit) :
+  base(base),
   dns(evdns_base_new
       (base.getBase(), (initialize ? EVDNS_BASE_INITIALIZE_NAMESERVERS : 0) |
        EVDNS_BASE_DISABLE_WHEN_INACTIVE)),
@@ -57,13 +84,101 @@ DNSBase::~DNSBase() {if (dns) evdns_base_free(dns, failRequestsOnExit);}
 
 
 void DNSBase::addNameserver(const IPAddress &ns) {
-  evdns_base_nameserver_add(dns, ns.getIP());
+  string addr = IPAddress::ipToString(ns.getIP());
+  if (ns.getPort()) addr += String::printf(":%d", ns.getPort());
+
+  if (evdns_base_nameserver_ip_add(dns, addr.c_str()))
+    THROW("Failed to add nameserver " << addr);
+}
+
+
+void DNSBase::loadHosts(const string &path) {
+  SmartPointer<istream> stream = SystemUtilities::iopen(path);
+
+  string line;
+  while (getline(*stream, line)) {
+    size_t comment = line.find('#');
+    if (comment != string::npos) line = line.substr(0, comment);
+
+    vector<string> tokens;
+    String::tokenize(line, tokens);
+
+    // Only IPv4 addresses are resolved
+    if (tokens.size() < 2 || tokens[0].find(':') != string::npos) continue;
+
+    IPAddress addr(tokens[0]);
+    for (unsigned i = 1; i < tokens.size(); i++) addHost(tokens[i], addr);
+  }
+}
+
+
+void DNSBase::addHost(const string &name, const IPAddress &addr) {
+  string key = String::toLower(name);
+  if (!key.empty() && key[key.length() - 1] == '.')
+    key = key.substr(0, key.length() - 1);
+
+  IPAddress a(addr.getIP());
+  a.setHost(name);
+
+  // Match lookups with and without search domains
+  for (int i = 0; i < 2; i++) {
+    auto entry = getEntry(i ? key + "." : key);
+
+    if (!entry->permanent) {
+      entry->permanent = entry->valid = true;
+      entry->error = DNS_ERR_NONE;
+      entry->addrs.clear();
+    }
+
+    entry->addrs.push_back(a);
+  }
+}
+
+
+void DNSBase::clearCache() {
+  for (auto it = cache.begin(); it != cache.end();)
+    if (it->second->querying) it++;
+    else cache.erase(it++);
 }
 
 
 SmartPointer<DNSRequest>
 DNSBase::resolve(const string &name, callback_t cb, bool search) {
-  return new DNSRequest(dns, name, cb, search);
+  if (!caching) return new DNSRequest(dns, name, cb, search);
+
+  // Lookups without search domains are for absolute names
+  string key = String::toLower(name) + (search ? "" : ".");
+  SmartPointer<Entry> entry = getEntry(key);
+  SmartPointer<DNSRequest> req = new DNSRequest(name, cb);
+  double now = Timer::now();
+
+  if (entry->isFresh(now)) {
+    hits++;
+    respond(req, entry);
+    return req;
+  }
+
+  if (maxStale && entry->valid && !entry->error &&
+      now < entry->expires + maxStale) {
+    staleHits++;
+    respond(req, entry);
+    if (!entry->querying) query(key, *entry, search);
+    return req;
+  }
+
+  if (entry->querying) coalesced++;
+  else misses++;
+
+  entry->waiting.push_back(req);
+
+  try {
+    if (!entry->querying) query(key, *entry, search);
+  } catch (...) {
+    entry->waiting.pop_back();
+    throw;
+  }
+
+  return req;
 }
 
 
@@ -71,3 +186,128 @@ SmartPointer<DNSRequest>
 DNSBase::reverse(uint32_t ip, callback_t cb, bool search) {
   return new DNSRequest(dns, ip, cb, search);
 }
+
+
+SmartPointer<DNSBase::Entry> DNSBase::getEntry(const string &key) {
+  auto it = cache.find(key);
+  if (it != cache.end()) return it->second;
+
+  if (maxEntries <= cache.size()) expire();
+
+  return cache[key] = new Entry;
+}
+
+
+void DNSBase::query(const string &key, Entry &entry, bool search) {
+  string name = key;
+  if (!search) name = name.substr(0, name.length() - 1);
+
+  auto cb =
+    [this, key] (int error, vector<IPAddress> &addrs, int ttl) {
+      queryCB(key, error, addrs, ttl);
+    };
+
+  entry.querying = true;
+
+  try {
+    SmartPointer<DNSRequest> req = new DNSRequest(dns, name, cb, search);
+    if (entry.querying) entry.query = req;
+  } catch (...) {
+    entry.querying = false;
+    throw;
+  }
+}
+
+
+void DNSBase::queryCB(const string &key, int error, vector<IPAddress> &addrs,
+                      int ttl) {
+  auto it = cache.find(key);
+  if (it == cache.end()) return;
+
+  SmartPointer<Entry> entry = it->second;
+  entry->querying = false;
+  entry->query.release();
+
+  double now = Timer::now();
+
+  if (error == DNS_ERR_NONE) {
+    if (maxTTL < ttl) ttl = maxTTL;
+    entry->valid = true;
+    entry->error = error;
+    entry->addrs = addrs;
+    entry->expires = now + ttl;
+
+  } else if (error == DNS_ERR_NOTEXIST ||
+             error == DNS_ERR_NODATA) {
+    ttl = negativeTTL;
+    entry->valid = 0 < negativeTTL;
+    entry->error = error;
+    entry->addrs.clear();
+    entry->expires = now + negativeTTL;
+  }
+
+  // Transient errors keep any stale answer
+  if (!entry->valid && !entry->permanent) cache.erase(it);
+
+  list<SmartPointer<DNSRequest> > waiting;
+  waiting.swap(entry->waiting);
+
+  for (auto it = waiting.begin(); it != waiting.end(); it++) {
+    vector<IPAddress> results = addrs;
+    (*it)->respond(error, results, ttl);
+  }
+}
+
+
+void DNSBase::respond(const SmartPointer<DNSRequest> &req,
+                      const SmartPointer<Entry> &entry) {
+  // Callback from the event loop as for an actual lookup
+  ready.push_back(ready_t(req, entry));
+
+  if (readyEvent.isNull())
+    readyEvent = base.newEvent(this, &DNSBase::readyCB, 0);
+  if (!readyEvent->isPending()) readyEvent->activate();
+}
+
+
+void DNSBase::readyCB() {
+  list<ready_t> ready;
+  ready.swap(this->ready);
+
+  double now = Timer::now();
+
+  for (auto it = ready.begin(); it != ready.end(); it++) {
+    auto &entry = *it->second;
+    vector<IPAddress> addrs = entry.addrs;
+    it->first->respond(entry.error, addrs, entry.getTTL(now, maxTTL));
+  }
+}
+
+
+void DNSBase::expire() {
+  double now = Timer::now();
+
+  for (auto it = cache.begin(); it != cache.end();) {
+    auto &entry = *it->second;
+
+    if (!entry.permanent && !entry.querying &&
+        entry.expires + maxStale <= now) cache.erase(it++);
+    else it++;
+  }
+
+  // Still full, evict the entries closest to expiring
+  while (maxEntries <= cache.size()) {
+    auto oldest = cache.end();
+
+    for (auto it = cache.begin(); it != cache.end(); it++) {
+      auto &entry = *it->second;
+
+      if (!entry.permanent && !entry.querying &&
+          (oldest == cache.end() || entry.expires < oldest->second->expires))
+        oldest = it;
+    }
+
+    if (oldest == cache.end()) break; // Only hosts and pending queries left
+    cache.erase(oldest);
+  }
+}
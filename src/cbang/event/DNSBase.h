@@ -34,6 +34,9 @@
 
 #include "DNSRequest.h"
 
+#include <map>
+#include <list>
+
 struct evdns_base;
 
 
@@ -41,11 +44,33 @@ namespace cb {
   namespace Event {
 
     class Base;
+    class Event;
 
     class DNSBase {
+      Base &base;
       evdns_base *dns;
       bool failRequestsOnExit;
 
+      bool caching = true;
+      double negativeTTL = 5;
+      double maxTTL = 3600;
+      double maxStale = 0;
+      unsigned maxEntries = 4096;
+
+      struct Entry;
+      typedef std::map<std::string, SmartPointer<Entry> > cache_t;
+      cache_t cache;
+
+      typedef std::pair<SmartPointer<DNSRequest>, SmartPointer<Entry> >
+      ready_t;
+      std::list<ready_t> ready;
+      SmartPointer<Event> readyEvent;
+
+      uint64_t hits = 0;
+      uint64_t staleHits = 0;
+      uint64_t misses = 0;
+      uint64_t coalesced = 0;
+
     public:
       DNSBase(Base &base, bool initialize = true,
               bool failRequestsOnExit = true);
@@ -55,6 +80,37 @@ namespace cb {
 
       void addNameserver(const IPAddress &ns);
 
+      void setCaching(bool caching) {this->caching = caching;}
+      bool getCaching() const {return caching;}
+
+      /// Seconds to remember that a name does not exist
+      void setNegativeTTL(double ttl) {negativeTTL = ttl;}
+      double getNegativeTTL() const {return negativeTTL;}
+
+      /// Upper bound on record TTLs
+      void setMaxTTL(double ttl) {maxTTL = ttl;}
+      double getMaxTTL() const {return maxTTL;}
+
+      /// Answer with expired records up to @param seconds old while a new
+      /// lookup runs in the background.  0 disables.
+      void setStaleWhileRevalidate(double seconds) {maxStale = seconds;}
+      double getStaleWhileRevalidate() const {return maxStale;}
+
+      /// When the cache is full the entries closest to expiring are evicted
+      void setMaxEntries(unsigned max) {maxEntries = max;}
+      unsigned getMaxEntries() const {return maxEntries;}
+      unsigned getCacheSize() const {return cache.size();}
+
+      /// Preload names from an /etc/hosts style file.  They never expire.
+      void loadHosts(const std::string &path);
+      void addHost(const std::string &name, const IPAddress &addr);
+      void clearCache();
+
+      uint64_t getHits() const {return hits;}
+      uint64_t getStaleHits() const {return staleHits;}
+      uint64_t getMisses() const {return misses;}
+      uint64_t getCoalesced() const {return coalesced;}
+
       typedef std::function<void (int, std::vector<IPAddress> &, int)>
       callback_t;
 
@@ -63,6 +119,16 @@ namespace cb {
               bool search = true);
       SmartPointer<DNSRequest>
       reverse(uint32_t ip, DNSRequest::callback_t cb, bool search = true);
+
+    protected:
+      SmartPointer<Entry> getEntry(const std::string &key);
+      void query(const std::string &key, Entry &entry, bool search);
+      void queryCB(const std::string &key, int error,
+                   std::vector<IPAddress> &addrs, int ttl);
+      void respond(const SmartPointer<DNSRequest> &req,
+                   const SmartPointer<Entry> &entry);
+      void readyCB();
+      void expire();
     };
   }
 }
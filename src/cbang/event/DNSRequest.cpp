@@ -55,6 +55,8 @@ namespace {
 DNSRequest::DNSRequest(evdns_base *dns, const string &name,
                        DNSRequest::callback_t cb, bool search) :
   dns(dns), cb(cb), self(this) {
+  source.setHost(name);
+
   req = evdns_base_resolve_ipv4
     (dns, name.c_str(), (search ? 0 : DNS_QUERY_NO_SEARCH), dns_cb, this);
 
@@ -66,6 +68,7 @@ DNSRequest::DNSRequest(evdns_base *dns, const string &name,
 
 DNSRequest::DNSRequest(evdns_base *dns, uint32_t ip, DNSRequest::callback_t cb,
                        bool search) : dns(dns), cb(cb), self(this) {
+  source.setIP(ip);
   struct in_addr addr = {hton32(ip)};
 
   req = evdns_base_resolve_reverse
@@ -77,14 +80,22 @@ DNSRequest::DNSRequest(evdns_base *dns, uint32_t ip, DNSRequest::callback_t cb,
 }
 
 
+DNSRequest::DNSRequest(const string &name, DNSRequest::callback_t cb) :
+  dns(0), req(0), cb(cb) {
+  source.setHost(name);
+}
+
+
 void DNSRequest::cancel() {
   cb = 0;
-  evdns_cancel_request(dns, req);
+  if (req) evdns_cancel_request(dns, req);
 }
 
 
 void DNSRequest::callback(int error, char type, int count, int ttl,
                           void *addresses) {
+  req = 0; // Freed by evdns after the callback
+
   LOG_DEBUG(5, "DNS: " << getErrorStr(error) << " " << (int)type
             << " " << count << " " << ttl);
 
@@ -124,6 +135,16 @@ void DNSRequest::callback(int error, char type, int count, int ttl,
 }
 
 
+void DNSRequest::respond(int error, vector<IPAddress> &addrs, int ttl) {
+  if (!cb) return;
+
+  callback_t cb = this->cb;
+  this->cb = 0;
+
+  TRY_CATCH_ERROR(cb(error, addrs, ttl));
+}
+
+
 const char *DNSRequest::getErrorStr(int error) {
   switch (error) {
   case -1:                   return "Unsupported response type";
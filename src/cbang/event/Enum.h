@@ -38,6 +38,7 @@
 #include "ConnectionError.h"
 #include "WebsockOpCode.h"
 #include "WebsockStatus.h"
+#include "OutputPolicy.h"
 
 namespace cb {
   namespace Event {
@@ -47,6 +48,7 @@ namespace cb {
       public EventFlag::Enum,
       public ConnectionError::Enum,
       public WebsockOpCode::Enum,
-      public WebsockStatus::Enum {};
+      public WebsockStatus::Enum,
+      public OutputPolicy::Enum {};
   }
 }
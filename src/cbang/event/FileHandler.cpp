@@ -32,18 +32,20 @@
 
 #include "FileHandler.h"
 #include "Request.h"
-#include "Buffer.h"
 
 #include <cbang/os/SystemUtilities.h>
 #include <cbang/log/Logger.h>
 
+#include <sys/stat.h>
+
 using namespace std;
 using namespace cb;
 using namespace cb::Event;
 
 
 FileHandler::FileHandler(const string &root, uint64_t timeout) :
-  root(root), timeout(timeout), directory(SystemUtilities::isDirectory(root)) {
+  root(root), timeout(timeout),
+  directory(SystemUtilities::isDirectory(root)) {
 }
 
 
@@ -76,15 +78,19 @@ bool FileHandler::operator()(Request &req) {
 
   LOG_INFO(5, "FileHandler() " << path);
 
-  if (!SystemUtilities::isFile(path)) return false;
-
-  // Send file
-  Buffer buf;
-  buf.addFile(path);
-  req.reply(buf);
+  // Stat once, the cache uses the size and modification time
+  struct stat buf;
+  if (stat(path.c_str(), &buf) || (buf.st_mode & S_IFMT) != S_IFREG)
+    return false;
 
   if (!req.outHas("Cache-Control"))
     req.outSet("Cache-Control", "max-age=" + String(timeout));
 
+  if (cache.isSet() && cache->reply(req, path, buf.st_size, buf.st_mtime))
+    return true;
+
+  // Send file
+  req.replyFile(path);
+
   return true;
 }
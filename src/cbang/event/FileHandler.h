@@ -33,6 +33,7 @@
 #pragma once
 
 #include "HTTPRequestHandler.h"
+#include "ContentCache.h"
 
 #include <cbang/time/Time.h>
 
@@ -46,6 +47,7 @@ namespace cb {
     class FileHandler : public HTTPRequestHandler {
       std::string root;
       uint64_t timeout;
+      SmartPointer<ContentCache> cache;
       bool directory;
 
     public:
@@ -54,6 +56,10 @@ namespace cb {
 
       void setTimeout(uint64_t timeout) {this->timeout = timeout;}
       uint64_t getTimeout() const {return timeout;}
+      /// Enables precompressed responses, off by default
+      void setCache(const SmartPointer<ContentCache> &cache)
+        {this->cache = cache;}
+      const SmartPointer<ContentCache> &getCache() const {return cache;}
 
       // From HTTPRequestHandler
       bool operator()(Request &req);
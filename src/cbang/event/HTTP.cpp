@@ -51,7 +51,7 @@ using namespace cb::Event;
 
 HTTP::HTTP(cb::Event::Base &base, const cb::SmartPointer<HTTPHandler> &handler,
            const cb::SmartPointer<cb::SSLContext> &sslCtx) :
-  base(base), handler(handler), sslCtx(sslCtx) {
+  base(base), handler(handler), sslCtx(sslCtx), connectionCount(0) {
 
 #ifndef HAVE_OPENSSL
   if (!sslCtx.isNull()) THROW("C! was not built with openssl support");
@@ -62,6 +62,18 @@ HTTP::HTTP(cb::Event::Base &base, const cb::SmartPointer<HTTPHandler> &handler,
 HTTP::~HTTP() {}
 
 
+void HTTP::setOutputWatermarks(unsigned high, unsigned low) {
+  if (high && high < low)
+    THROW("Output low watermark " << low << " above high watermark " << high);
+
+  outputHigh = high;
+  outputLow = low;
+}
+
+
+void HTTP::setOutputBudget(uint64_t bytes) {base.setOutputBudget(bytes);}
+
+
 void HTTP::setMaxConnectionTTL(unsigned x) {
   maxConnectionTTL = x;
 
@@ -89,6 +101,7 @@ void HTTP::setEventPriority(int priority) {
 
 void HTTP::remove(Connection &con) {
   connections.remove(&con);
+  connectionCount = connections.size();
   acceptEvent->add();
 }
 
@@ -99,6 +112,7 @@ void HTTP::bind(const cb::IPAddress &addr) {
 
   SmartPointer<Socket> socket = new Socket;
   socket->setReuseAddr(true);
+  if (reusePort) socket->setReusePort(true);
   socket->bind(addr);
   socket->listen(connectionBacklog);
   socket_t fd = socket->get();
@@ -178,6 +192,7 @@ void HTTP::expireCB() {
 
     } else it++;
 
+  connectionCount = connections.size();
   LOG_DEBUG(4, "Dropped " << count << " expired connections");
 }
 
@@ -212,8 +227,11 @@ void HTTP::acceptCB() {
   if (0 <= priority) con->setPriority(priority);
   con->setReadTimeout(readTimeout);
   con->setWriteTimeout(writeTimeout);
+  con->setOutputWatermarks(outputHigh, outputLow);
+  con->setOutputPolicy(outputPolicy);
   con->setStats(stats);
 
   connections.push_back(con);
+  connectionCount = connections.size();
   con->acceptRequest();
 }
@@ -40,6 +40,7 @@
 
 #include <list>
 #include <limits>
+#include <atomic>
 
 
 namespace cb {
@@ -70,11 +71,19 @@ namespace cb {
       int readTimeout = 50;
       int writeTimeout = 50;
       int priority = -1;
+      bool reusePort = false;
+      bool websockDeflate = false;
+      int websockDeflateLevel = 6;
+      bool websockNoContextTakeover = false;
+      unsigned outputHigh = 0;
+      unsigned outputLow = 0;
+      OutputPolicy outputPolicy = OUTPUT_PAUSE;
 
       IPAddress boundAddr;
       SmartPointer<Socket> socket;
       typedef std::list<SmartPointer<Connection> > connections_t;
       connections_t connections;
+      std::atomic<unsigned> connectionCount;
       SmartPointer<RateSet> stats;
 
     public:
@@ -110,7 +119,35 @@ namespace cb {
       int getEventPriority() const {return priority;}
       void setEventPriority(int priority);
 
-      unsigned getConnectionCount() const {return connections.size();}
+      bool getReusePort() const {return reusePort;}
+      /// Allow several HTTPs, usually on different threads, to bind a port
+      void setReusePort(bool x) {reusePort = x;}
+
+      bool getWebsockDeflate() const {return websockDeflate;}
+      /// Accept Websocket permessage-deflate offers from clients
+      void setWebsockDeflate(bool x) {websockDeflate = x;}
+
+      int getWebsockDeflateLevel() const {return websockDeflateLevel;}
+      void setWebsockDeflateLevel(int x) {websockDeflateLevel = x;}
+
+      bool getWebsockNoContextTakeover() const
+      {return websockNoContextTakeover;}
+      /// Trade compression ratio for less state kept between messages
+      void setWebsockNoContextTakeover(bool x) {websockNoContextTakeover = x;}
+
+      unsigned getOutputHighWatermark() const {return outputHigh;}
+      unsigned getOutputLowWatermark() const {return outputLow;}
+      /// See BufferEvent::setOutputWatermarks()
+      void setOutputWatermarks(unsigned high, unsigned low = 0);
+
+      OutputPolicy getOutputPolicy() const {return outputPolicy;}
+      void setOutputPolicy(OutputPolicy policy) {outputPolicy = policy;}
+
+      /// Limits the output of all connections on this HTTP's Base
+      void setOutputBudget(uint64_t bytes);
+
+      /// Safe to call from other threads
+      unsigned getConnectionCount() const {return connectionCount;}
       void remove(Connection &con);
 
       typedef connections_t::const_iterator iterator;
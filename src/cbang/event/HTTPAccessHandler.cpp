@@ -63,7 +63,7 @@ bool HTTPAccessHandler::groupDeny(const string &name) const {
 
 
 bool HTTPAccessHandler::operator()(Request &req) {
-  SmartPointer<Session> session = req.getSession();
+  SmartPointer<Session>::Protected session = req.getSession();
   string user = req.getUser();
   bool allow;
   bool deny;
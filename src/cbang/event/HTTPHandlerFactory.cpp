@@ -59,15 +59,29 @@ HTTPHandlerFactory::createMatcher
 }
 
 
+bool HTTPHandlerFactory::getRoute(unsigned methods, const string &search,
+                                  unsigned &routeMethods, string &pattern) {
+  routeMethods = methods;
+  pattern = search;
+  return true;
+}
+
+
 SmartPointer<HTTPRequestHandler>
 HTTPHandlerFactory::createHandler(const Resource &res) {
-  SmartPointer<HTTPRequestHandler> handler = new ResourceHTTPHandler(res);
+  ResourceHTTPHandler *resHandler = new ResourceHTTPHandler(res);
+  SmartPointer<HTTPRequestHandler> handler = resHandler;
+  resHandler->setCache(cache);
+
   return autoIndex ? new IndexHTMLHandler(handler) : handler;
 }
 
 
 SmartPointer<HTTPRequestHandler>
 HTTPHandlerFactory::createHandler(const string &path) {
-  SmartPointer<HTTPRequestHandler> handler = new FileHandler(path);
+  FileHandler *fileHandler = new FileHandler(path);
+  SmartPointer<HTTPRequestHandler> handler = fileHandler;
+  fileHandler->setCache(cache);
+
   return autoIndex ? new IndexHTMLHandler(handler) : handler;
 }
@@ -33,6 +33,7 @@
 #pragma once
 
 #include "HTTPRequestHandler.h"
+#include "ContentCache.h"
 
 #include <cbang/SmartPointer.h>
 
@@ -45,17 +46,32 @@ namespace cb {
   namespace Event {
     class HTTPHandlerFactory {
       bool autoIndex;
+      SmartPointer<ContentCache> cache;
 
     public:
       HTTPHandlerFactory(bool autoIndex = true) : autoIndex(autoIndex) {}
       virtual ~HTTPHandlerFactory() {}
 
       void setAutoIndex(bool autoIndex) {this->autoIndex = autoIndex;}
+      /// Shared by the file and resource handlers created after this call
+      void setCache(const SmartPointer<ContentCache> &cache)
+        {this->cache = cache;}
+      const SmartPointer<ContentCache> &getCache() const {return cache;}
 
       virtual SmartPointer<HTTPRequestHandler>
       createMatcher(unsigned methods, const std::string &search,
                     const std::string &replace,
                     const SmartPointer<HTTPRequestHandler> &child);
+      /**
+       * Get the RE2 pattern and methods which a matcher created by
+       * createMatcher() matches.  HTTPHandlerGroup uses this to index its
+       * routes.  Factories which match differently must override this.
+       *
+       * @return False if the route cannot be indexed.
+       */
+      virtual bool getRoute(unsigned methods, const std::string &search,
+                            unsigned &routeMethods, std::string &pattern);
+
       virtual SmartPointer<HTTPRequestHandler>
       createHandler(const Resource &res);
       virtual SmartPointer<HTTPRequestHandler>
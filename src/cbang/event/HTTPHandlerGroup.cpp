@@ -32,19 +32,33 @@
 
 #include "HTTPHandlerGroup.h"
 
+#include <cbang/util/SmartLock.h>
+
 using namespace cb::Event;
 using namespace cb;
 using namespace std;
 
 
 void HTTPHandlerGroup::addHandler
-(const SmartPointer<HTTPRequestHandler> &handler) {handlers.push_back(handler);}
+(const SmartPointer<HTTPRequestHandler> &handler) {
+  routes.add(RequestMethod::HTTP_ANY, "");
+  handlers.push_back(handler);
+}
 
 
 void HTTPHandlerGroup::addHandler
 (unsigned methods, const string &search, const string &replace,
  const SmartPointer<HTTPRequestHandler> &handler) {
-  addHandler(factory->createMatcher(methods, search, replace, handler));
+  unsigned routeMethods;
+  string pattern;
+
+  if (!factory->getRoute(methods, search, routeMethods, pattern)) {
+    routeMethods = RequestMethod::HTTP_ANY;
+    pattern.clear();
+  }
+
+  routes.add(routeMethods, pattern);
+  handlers.push_back(factory->createMatcher(methods, search, replace, handler));
 }
 
 
@@ -87,9 +101,27 @@ HTTPHandlerGroup::addGroup(unsigned methods, const string &search,
 }
 
 
-bool HTTPHandlerGroup::operator()(Request &req) {
-  for (unsigned i = 0; i < handlers.size(); i++)
-    if ((*handlers[i])(req)) return true;
+void HTTPHandlerGroup::compile() {
+  SmartLock lock(&compileLock);
+  if (!routes.isCompiled()) routes.compile();
+}
 
-  return false;
+
+bool HTTPHandlerGroup::operator()(Request &req) {
+  // Groups may be shared by several event loop threads
+  if (!routes.isCompiled()) compile();
+
+  // Only try handlers which may match, in the order they were added.  The
+  // per thread matches vector is reused but handlers may recurse.
+  static thread_local vector<unsigned> matches;
+  vector<unsigned> candidates;
+  candidates.swap(matches);
+  routes.match(req.getMethod(), req.getURI().getEscapedPath(), candidates);
+
+  bool handled = false;
+  for (unsigned i = 0; i < candidates.size() && !handled; i++)
+    handled = (*handlers[candidates[i]])(req);
+
+  candidates.swap(matches);
+  return handled;
 }
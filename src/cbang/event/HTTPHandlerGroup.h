@@ -34,6 +34,9 @@
 
 #include "HTTPHandlerFactory.h"
 #include "HTTPRequestHandler.h"
+#include "HTTPRouteIndex.h"
+
+#include <cbang/os/Mutex.h>
 
 #include <vector>
 
@@ -48,11 +51,17 @@ namespace cb {
       typedef std::vector<SmartPointer<HTTPRequestHandler> > handlers_t;
       handlers_t handlers;
 
+      HTTPRouteIndex routes;
+      Mutex compileLock;
+
     public:
       HTTPHandlerGroup(const SmartPointer<HTTPHandlerFactory> &factory =
                        new HTTPHandlerFactory) : factory(factory) {}
       virtual ~HTTPHandlerGroup() {}
 
+      /// Compile the route index.  Otherwise it is compiled on first use.
+      void compile();
+
       void addHandler(const SmartPointer<HTTPRequestHandler> &handler);
       void addHandler(unsigned methods, const std::string &search,
                       const std::string &replace,
@@ -38,6 +38,7 @@
 #include <cbang/net/SessionManager.h>
 #include <cbang/log/Logger.h>
 #include <cbang/json/Value.h>
+#include <cbang/util/SmartLock.h>
 
 using namespace cb::Event;
 using namespace cb;
@@ -62,10 +63,13 @@ void HTTPOAuth2LoginHandler::processProfile(Request &req,
 
   // Fill session
   Session &session = *req.getSession();
-  session.insert("provider",    profile->getString("provider"));
-  session.insert("provider_id", profile->getString("id"));
-  session.insert("name",        profile->getString("name"));
-  session.insert("avatar",      profile->getString("avatar"));
+  {
+    SmartLock lock(&session);
+    session.insert("provider",    profile->getString("provider"));
+    session.insert("provider_id", profile->getString("id"));
+    session.insert("name",        profile->getString("name"));
+    session.insert("avatar",      profile->getString("avatar"));
+  }
 
   // Authenticate Session
   string email = profile->getString("email");
@@ -87,7 +91,7 @@ bool HTTPOAuth2LoginHandler::operator()(Request &req) {
   }
 
   // Get Session
-  SmartPointer<Session> session = req.getSession();
+  SmartPointer<Session>::Protected session = req.getSession();
   if (session.isNull()) {
     // Open new Session
     session = sessionManager->openSession(req.getClientIP());
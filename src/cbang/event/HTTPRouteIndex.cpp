@@ -0,0 +1,237 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "HTTPRouteIndex.h"
+
+#include <cbang/Exception.h>
+#include <cbang/log/Logger.h>
+
+#include <map>
+#include <algorithm>
+#include <atomic>
+
+#include <string.h>
+
+#include <re2/re2.h>
+#include <re2/set.h>
+
+using namespace std;
+using namespace cb;
+using namespace cb::Event;
+
+
+namespace {
+  struct Route {
+    unsigned methods;
+    string pattern;
+
+    Route(unsigned methods, const string &pattern) :
+      methods(methods), pattern(pattern) {}
+  };
+
+
+  struct Node {
+    map<string, Node> children;
+    vector<unsigned> routes;
+
+    void insert(const string &path, unsigned route) {
+      Node *node = this;
+      size_t start = 0;
+
+      while (true) {
+        size_t end = path.find('/', start);
+        node = &node->children[path.substr(start, end - start)];
+        if (end == string::npos) break;
+        start = end + 1;
+      }
+
+      node->routes.push_back(route);
+    }
+
+
+    const Node *find(const string &path) const {
+      const Node *node = this;
+      size_t start = 0;
+
+      while (true) {
+        size_t end = path.find('/', start);
+        auto it = node->children.find(path.substr(start, end - start));
+        if (it == node->children.end()) return 0;
+        node = &it->second;
+        if (end == string::npos) return node;
+        start = end + 1;
+      }
+    }
+  };
+}
+
+
+struct HTTPRouteIndex::Private {
+  vector<Route> routes;
+
+  atomic<bool> compiled;
+  vector<unsigned> always;
+  Node literals;
+  SmartPointer<RE2::Set> patterns;
+  vector<unsigned> patternRoutes;
+
+  Private() : compiled(false) {}
+};
+
+
+HTTPRouteIndex::HTTPRouteIndex() : pri(new Private) {}
+HTTPRouteIndex::~HTTPRouteIndex() {}
+
+
+unsigned HTTPRouteIndex::add(unsigned methods, const string &pattern) {
+  pri->routes.push_back(Route(methods, pattern));
+  pri->compiled = false;
+  return pri->routes.size() - 1;
+}
+
+
+unsigned HTTPRouteIndex::size() const {return pri->routes.size();}
+void HTTPRouteIndex::clear() {pri = new Private;}
+
+
+void HTTPRouteIndex::compile() {
+  Private &p = *pri;
+
+  p.always.clear();
+  p.literals = Node();
+  p.patterns.release();
+  p.patternRoutes.clear();
+
+  RE2::Options opts;
+  opts.set_log_errors(false);
+  SmartPointer<RE2::Set> patterns = new RE2::Set(opts, RE2::ANCHOR_BOTH);
+  vector<unsigned> unindexed;
+
+  for (unsigned i = 0; i < p.routes.size(); i++) {
+    const string &pattern = p.routes[i].pattern;
+    string literal;
+
+    if (pattern.empty()) p.always.push_back(i);
+    else if (isLiteral(pattern, literal)) p.literals.insert(literal, i);
+    else {
+      string err;
+
+      if (patterns->Add(pattern, &err) < 0) {
+        LOG_WARNING("Not indexing HTTP route '" << pattern << "': " << err);
+        unindexed.push_back(i);
+
+      } else p.patternRoutes.push_back(i);
+    }
+  }
+
+  if (!p.patternRoutes.empty()) {
+    if (patterns->Compile()) p.patterns = patterns;
+    else {
+      LOG_WARNING("Failed to compile HTTP route set, falling back to "
+                  "linear matching");
+      unindexed.insert(unindexed.end(), p.patternRoutes.begin(),
+                       p.patternRoutes.end());
+      p.patternRoutes.clear();
+    }
+  }
+
+  // Unindexed routes must be tried on every request
+  if (!unindexed.empty()) {
+    p.always.insert(p.always.end(), unindexed.begin(), unindexed.end());
+    sort(p.always.begin(), p.always.end());
+  }
+
+  p.compiled = true;
+}
+
+
+bool HTTPRouteIndex::isCompiled() const {return pri->compiled;}
+
+
+void HTTPRouteIndex::match(unsigned method, const string &path,
+                           vector<unsigned> &routes) const {
+  const Private &p = *pri;
+  if (!p.compiled) THROW("HTTP route index not compiled");
+
+  routes.clear();
+  routes.insert(routes.end(), p.always.begin(), p.always.end());
+
+  const Node *node = p.literals.find(path);
+  if (node) routes.insert(routes.end(), node->routes.begin(),
+                          node->routes.end());
+
+  if (p.patterns.isSet()) {
+    vector<int> matches;
+    RE2::Set::ErrorInfo err;
+
+    if (p.patterns->Match(path, &matches, &err))
+      for (unsigned i = 0; i < matches.size(); i++)
+        routes.push_back(p.patternRoutes[matches[i]]);
+
+    else if (err.kind != RE2::Set::kNoError) {
+      // E.g. the DFA ran out of memory, every pattern route must be tried
+      LOG_DEBUG(3, "HTTP route set match failed with error " << err.kind
+                << ", falling back to linear matching");
+      routes.insert(routes.end(), p.patternRoutes.begin(),
+                    p.patternRoutes.end());
+    }
+  }
+
+  // Filter by method
+  unsigned j = 0;
+  for (unsigned i = 0; i < routes.size(); i++) {
+    unsigned methods = p.routes[routes[i]].methods;
+    if (methods == ~0U || (methods & method)) routes[j++] = routes[i];
+  }
+  routes.resize(j);
+
+  // Restore insertion order so the first match still wins
+  sort(routes.begin(), routes.end());
+}
+
+
+bool HTTPRouteIndex::isLiteral(const string &pattern, string &literal) {
+  literal.clear();
+
+  for (unsigned i = 0; i < pattern.size(); i++) {
+    char c = pattern[i];
+
+    if (c == '\\') {
+      if (++i == pattern.size() || isalnum(pattern[i])) return false;
+      literal += pattern[i];
+
+    } else if (c && strchr(".[]{}()*+?^$|", c)) return false;
+    else literal += c;
+  }
+
+  return true;
+}
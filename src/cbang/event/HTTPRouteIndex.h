@@ -0,0 +1,78 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include <cbang/SmartPointer.h>
+
+#include <string>
+#include <vector>
+
+
+namespace cb {
+  namespace Event {
+    /**
+     * Compiled index of HTTP routes.  Literal routes are found with a
+     * path segment trie and all pattern routes are matched in a single
+     * pass with an RE2::Set.  match() returns, in insertion order, the
+     * routes which may match a request.
+     */
+    class HTTPRouteIndex {
+      struct Private;
+      SmartPointer<Private> pri;
+
+    public:
+      HTTPRouteIndex();
+      ~HTTPRouteIndex();
+
+      /**
+       * Add a route.
+       *
+       * @param methods Bitmask of allowed request methods.  ~0 matches any.
+       * @param pattern RE2 pattern matched against the full escaped path.
+       *   Empty patterns match all paths.
+       * @return The route index.
+       */
+      unsigned add(unsigned methods, const std::string &pattern);
+      unsigned size() const;
+      void clear();
+
+      void compile();
+      bool isCompiled() const;
+
+      void match(unsigned method, const std::string &path,
+                 std::vector<unsigned> &routes) const;
+
+      static bool isLiteral(const std::string &pattern, std::string &literal);
+    };
+  }
+}
@@ -0,0 +1,165 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "HTTPServerPool.h"
+#include "HTTP.h"
+#include "Base.h"
+
+#include <cbang/Catch.h>
+#include <cbang/os/Thread.h>
+#include <cbang/util/RateSet.h>
+#include <cbang/openssl/SSLContext.h>
+
+using namespace std;
+using namespace cb::Event;
+
+
+struct HTTPServerPool::Loop : public cb::Thread {
+  Base base;
+  SmartPointer<HTTP> http;
+  cb::SmartPointer<cb::RateSet> stats;
+
+  Loop(const SmartPointer<HTTPHandler> &handler,
+       const cb::SmartPointer<cb::SSLContext> &sslCtx) :
+    base(true), http(new HTTP(base, handler, sslCtx)) {
+    http->setReusePort(true);
+  }
+
+  // From Thread
+  void run() {CBANG_TRY_CATCH_ERROR(base.dispatch());}
+};
+
+
+HTTPServerPool::HTTPServerPool(unsigned count,
+                               const SmartPointer<HTTPHandler> &handler,
+                               const cb::SmartPointer<cb::SSLContext> &sslCtx) {
+  if (!count) THROW("HTTPServerPool needs at least one loop");
+
+  for (unsigned i = 0; i < count; i++)
+    loops.push_back(new Loop(handler, sslCtx));
+}
+
+
+HTTPServerPool::~HTTPServerPool() {join();}
+
+
+HTTP &HTTPServerPool::get(unsigned i) const {return *loops.at(i)->http;}
+
+
+#define FOR_EACH_HTTP(CALL) \
+  for (unsigned i = 0; i < loops.size(); i++) loops[i]->http->CALL
+
+
+void HTTPServerPool::setMaxBodySize(unsigned size)
+{FOR_EACH_HTTP(setMaxBodySize(size));}
+void HTTPServerPool::setMaxHeadersSize(unsigned size)
+{FOR_EACH_HTTP(setMaxHeadersSize(size));}
+void HTTPServerPool::setReadTimeout(int timeout)
+{FOR_EACH_HTTP(setReadTimeout(timeout));}
+void HTTPServerPool::setWriteTimeout(int timeout)
+{FOR_EACH_HTTP(setWriteTimeout(timeout));}
+void HTTPServerPool::setMaxConnections(unsigned x)
+{FOR_EACH_HTTP(setMaxConnections(x));}
+void HTTPServerPool::setMaxConnectionTTL(unsigned x)
+{FOR_EACH_HTTP(setMaxConnectionTTL(x));}
+void HTTPServerPool::setConnectionBacklog(unsigned x)
+{FOR_EACH_HTTP(setConnectionBacklog(x));}
+void HTTPServerPool::setEventPriority(int priority)
+{FOR_EACH_HTTP(setEventPriority(priority));}
+void HTTPServerPool::setWebsockDeflate(bool x)
+{FOR_EACH_HTTP(setWebsockDeflate(x));}
+void HTTPServerPool::setWebsockDeflateLevel(int x)
+{FOR_EACH_HTTP(setWebsockDeflateLevel(x));}
+void HTTPServerPool::setWebsockNoContextTakeover(bool x)
+{FOR_EACH_HTTP(setWebsockNoContextTakeover(x));}
+void HTTPServerPool::setOutputWatermarks(unsigned high, unsigned low)
+{FOR_EACH_HTTP(setOutputWatermarks(high, low));}
+void HTTPServerPool::setOutputPolicy(OutputPolicy policy)
+{FOR_EACH_HTTP(setOutputPolicy(policy));}
+void HTTPServerPool::setOutputBudget(uint64_t bytes)
+{FOR_EACH_HTTP(setOutputBudget(bytes));}
+void HTTPServerPool::bind(const cb::IPAddress &addr)
+{FOR_EACH_HTTP(bind(addr));}
+
+
+void HTTPServerPool::setStats(const cb::SmartPointer<cb::RateSet> &stats)
+{FOR_EACH_HTTP(setStats(stats));}
+
+
+void HTTPServerPool::enableStats(unsigned size, unsigned period) {
+  for (unsigned i = 0; i < loops.size(); i++) {
+    loops[i]->stats = new cb::RateSet(size, period);
+    loops[i]->http->setStats(loops[i]->stats);
+  }
+}
+
+
+void HTTPServerPool::start() {
+  for (unsigned i = 0; i < loops.size(); i++) loops[i]->start();
+}
+
+
+void HTTPServerPool::stop() {
+  for (unsigned i = 0; i < loops.size(); i++) {
+    loops[i]->stop();
+    loops[i]->base.loopExit();
+  }
+}
+
+
+void HTTPServerPool::join() {
+  stop();
+  for (unsigned i = 0; i < loops.size(); i++) loops[i]->wait();
+}
+
+
+unsigned HTTPServerPool::getConnectionCount() const {
+  unsigned count = 0;
+
+  for (unsigned i = 0; i < loops.size(); i++)
+    count += loops[i]->http->getConnectionCount();
+
+  return count;
+}
+
+
+cb::SmartPointer<cb::RateSet> HTTPServerPool::getStats() const {
+  if (loops[0]->stats.isNull()) return 0;
+
+  const cb::RateSet &first = *loops[0]->stats;
+  cb::SmartPointer<cb::RateSet> stats =
+    new cb::RateSet(first.getSize(), first.getPeriod());
+
+  for (unsigned i = 0; i < loops.size(); i++) stats->add(*loops[i]->stats);
+
+  return stats;
+}
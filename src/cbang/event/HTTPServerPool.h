@@ -0,0 +1,105 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include "HTTPHandler.h"
+#include "OutputPolicy.h"
+
+#include <cbang/SmartPointer.h>
+#include <cbang/net/IPAddress.h>
+
+#include <vector>
+
+
+namespace cb {
+  class SSLContext;
+  class RateSet;
+
+  namespace Event {
+    class HTTP;
+
+    /**
+     * Runs several HTTP servers, each with its own Base on its own thread.
+     * Every loop binds the same addresses with SO_REUSEPORT so the kernel
+     * spreads incoming connections between them.
+     *
+     * The handler is shared by all loops and must be safe to call from
+     * several threads.  HTTPHandlerGroup is, once its handlers are added.
+     * Configure the pool before calling start().
+     */
+    class HTTPServerPool {
+      struct Loop;
+      std::vector<SmartPointer<Loop> > loops;
+
+    public:
+      HTTPServerPool(unsigned count, const SmartPointer<HTTPHandler> &handler,
+                     const SmartPointer<SSLContext> &sslCtx = 0);
+      ~HTTPServerPool();
+
+      unsigned size() const {return loops.size();}
+      HTTP &get(unsigned i) const;
+
+      void setMaxBodySize(unsigned size);
+      void setMaxHeadersSize(unsigned size);
+      void setReadTimeout(int timeout);
+      void setWriteTimeout(int timeout);
+      void setMaxConnections(unsigned x);
+      void setMaxConnectionTTL(unsigned x);
+      void setConnectionBacklog(unsigned x);
+      void setEventPriority(int priority);
+      void setWebsockDeflate(bool x);
+      void setWebsockDeflateLevel(int x);
+      void setWebsockNoContextTakeover(bool x);
+      void setOutputWatermarks(unsigned high, unsigned low);
+      void setOutputPolicy(OutputPolicy policy);
+      /// Each loop gets its own budget of @param bytes
+      void setOutputBudget(uint64_t bytes);
+
+      /// Share one RateSet between all loops
+      void setStats(const SmartPointer<RateSet> &stats);
+      /// Give each loop its own RateSet.  See getStats().
+      void enableStats(unsigned size = 60 * 5, unsigned period = 1);
+
+      void bind(const IPAddress &addr);
+
+      void start();
+      void stop();
+      void join();
+
+      unsigned getConnectionCount() const;
+
+      /// @return The sum of the loops' own stats or null if not enabled
+      SmartPointer<RateSet> getStats() const;
+    };
+  }
+}
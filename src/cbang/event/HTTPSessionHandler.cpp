@@ -53,9 +53,8 @@ bool HTTPSessionHandler::operator()(Request &req) {
   if (sid.empty()) return false;
 
   // Get session
-  try {
-    req.setSession(sessionManager->lookupSession(sid));
-  } catch (const Exception &) {}
+  SmartPointer<Session>::Protected session = sessionManager->findSession(sid);
+  if (session.isSet()) req.setSession(session);
 
   return false;
 }
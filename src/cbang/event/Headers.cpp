@@ -37,32 +37,174 @@
 #include <cbang/String.h>
 #include <cbang/http/ContentTypes.h>
 
+#include <cstring>
+
 using namespace cb::Event;
 using namespace std;
 
 
-string Headers::find(const string &key) const {return has(key) ? get(key) : "";}
+namespace {
+  const string names[] = {
+    "Accept",
+    "Accept-Encoding",
+    "Authorization",
+    "Cache-Control",
+    "Connection",
+    "Content-Encoding",
+    "Content-Length",
+    "Content-Type",
+    "Cookie",
+    "Date",
+    "Expect",
+    "Host",
+    "If-Modified-Since",
+    "If-None-Match",
+    "Location",
+    "Origin",
+    "Range",
+    "Referer",
+    "Sec-WebSocket-Extensions",
+    "Sec-WebSocket-Key",
+    "Sec-WebSocket-Version",
+    "Transfer-Encoding",
+    "Upgrade",
+    "User-Agent",
+    "X-Forwarded-For",
+  };
+
+
+  char lower(char c) {return 'A' <= c && c <= 'Z' ? c + 'a' - 'A' : c;}
+
+
+  bool equalsIgnoreCase(const char *a, const char *b, unsigned length) {
+    for (unsigned i = 0; i < length; i++)
+      if (lower(a[i]) != lower(b[i])) return false;
+    return true;
+  }
+
+
+  bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+
+  bool containsToken(const string &s, const char *token, unsigned length) {
+    const char *p = s.data();
+    const char *end = p + s.length();
+
+    while (p < end) {
+      while (p < end && (*p == ' ' || *p == ',')) p++;
+      const char *start = p;
+      while (p < end && *p != ' ' && *p != ',') p++;
+
+      if (start < p && (unsigned)(p - start) == length &&
+          equalsIgnoreCase(start, token, length)) return true;
+    }
+
+    return false;
+  }
+}
+
+
+Headers::Headers() {
+  for (unsigned i = 0; i < HEADER_UNKNOWN; i++) slots[i] = -1;
+}
+
+
+Headers::header_t Headers::getID(const char *name, unsigned length) {
+  for (unsigned i = 0; i < HEADER_UNKNOWN; i++)
+    if (names[i].length() == length &&
+        equalsIgnoreCase(names[i].data(), name, length))
+      return (header_t)i;
+
+  return HEADER_UNKNOWN;
+}
+
+
+const string &Headers::getName(header_t id) {
+  if (HEADER_UNKNOWN <= id) THROW("Invalid header ID " << id);
+  return names[id];
+}
+
+
+bool Headers::has(const string &key) const {
+  header_t id = getID(key);
+  return id == HEADER_UNKNOWN ? OrderedDict<string>::has(key) : has(id);
+}
+
+
+const string *Headers::find(header_t id) const {
+  if (HEADER_UNKNOWN <= id) return 0;
+
+  // The slot may be stale if the dict was modified through the base class
+  const string &name = getName(id);
+  int i = slots[id];
+  if (i < 0 || size() <= (unsigned)i || keyAt(i) != name) i = lookup(name);
+
+  return i < 0 ? 0 : &get((size_type)i);
+}
+
+
+string Headers::find(const string &key) const {
+  header_t id = getID(key);
+
+  if (id == HEADER_UNKNOWN) {
+    int i = lookup(key);
+    return i < 0 ? "" : get((size_type)i);
+  }
+
+  const string *value = find(id);
+  return value ? *value : "";
+}
+
+
+Headers::size_type Headers::insert(header_t id, const string &value) {
+  return slots[id] = OrderedDict<string>::insert(getName(id), value);
+}
+
+
+Headers::size_type Headers::insert(const string &key, const string &value) {
+  header_t id = getID(key);
+  if (id == HEADER_UNKNOWN) return OrderedDict<string>::insert(key, value);
+  return insert(id, value);
+}
+
+
 void Headers::remove(const std::string &key) {if (has(key)) insert(key, "");}
 
 
-bool Headers::keyContains(const string &key, const string &value) const{
-  string hdr = String::toLower(find(key));
-  vector<string> parts;
+bool Headers::keyEquals(header_t id, const char *value) const {
+  const string *s = find(id);
+  unsigned length = strlen(value);
+  return s && s->length() == length &&
+    equalsIgnoreCase(s->data(), value, length);
+}
+
+
+bool Headers::keyContains(header_t id, const char *value) const {
+  const string *s = find(id);
+  return s && containsToken(*s, value, strlen(value));
+}
 
-  String::tokenize(hdr, parts, " ,");
 
-  for (unsigned i = 0; i < parts.size(); i++)
-    if (parts[i] == String::toLower(value)) return true;
+bool Headers::keyContains(const string &key, const string &value) const {
+  header_t id = getID(key);
+  if (id != HEADER_UNKNOWN) return keyContains(id, value.c_str());
 
-  return false;
+  int i = lookup(key);
+  return 0 <= i &&
+    containsToken(get((size_type)i), value.data(), value.length());
 }
 
 
-string Headers::getContentType() const {return find("Content-Type");}
+string Headers::getContentType() const {
+  const string *contentType = find(HEADER_CONTENT_TYPE);
+  return contentType ? *contentType : "";
+}
 
 
 void Headers::setContentType(const string &contentType) {
-  insert("Content-Type", contentType);
+  insert(HEADER_CONTENT_TYPE, contentType);
 }
 
 
@@ -74,41 +216,73 @@ void Headers::guessContentType(const std::string &ext) {
 
 
 /// @return true if we should send a "Connection: close" when request done.
-bool Headers::needsClose() const {return keyContains("Connection", "close");}
+bool Headers::needsClose() const {
+  return keyContains(HEADER_CONNECTION, "close");
+}
+
+
 bool Headers::connectionKeepAlive() const {
-  return keyContains("Connection", "keep-alive");
+  return keyContains(HEADER_CONNECTION, "keep-alive");
 }
 
 
 bool Headers::parse(Buffer &buf, unsigned maxSize) {
-  unsigned bytes = 0;
+  unsigned length = 0;
+  const char *data = buf.peekLines(maxSize, length);
 
-  while (buf.getLength()) {
-    string line = buf.readLine(maxSize ? maxSize - bytes : 0);
+  if (!data) {
+    if (maxSize && maxSize <= buf.getLength()) THROW("Header too long");
+    return false;
+  }
 
-    // Last header
-    if (line.empty()) return true;
+  parse(data, length);
+  buf.drain(length);
+
+  return true;
+}
 
-    bytes += line.length() + 2;
-    if (maxSize && maxSize < bytes) THROW("Header too long");
+
+void Headers::parse(const char *data, unsigned length) {
+  const char *end = data + length;
+
+  // Size the dict once
+  unsigned lines = 0;
+  for (const char *p = data; (p = Buffer::findLF(p, end)); p++) lines++;
+  this->reserve(size() + lines);
+
+  for (const char *next; data < end; data = next) {
+    const char *eol = Buffer::findLF(data, end);
+    next = eol ? eol + 1 : end;
+    if (!eol) eol = end;
+    if (data < eol && eol[-1] == '\r') eol--;
+
+    // Last header
+    if (data == eol) break;
 
     // Continuation line
-    if (line[0] == ' ' || line[0] == '\t') {
-      if (empty()) THROW("Invalid header line: " << line);
-      get(size() - 1) += String::trim(line);
+    if (*data == ' ' || *data == '\t') {
+      if (empty()) THROW("Invalid header line: " << string(data, eol - data));
+
+      while (data < eol && isSpace(*data)) data++;
+      while (data < eol && isSpace(eol[-1])) eol--;
+      get(size() - 1).append(data, eol - data);
       continue;
     }
 
     // Parse
-    size_t semi = line.find_first_of(':');
-    if (semi == string::npos) THROW("Invalid header line: " << line);
-
-    string key = line.substr(0, semi);
-    string value = String::trim(line.substr(semi + 1));
-    insert(key, value);
+    const char *colon = (const char *)memchr(data, ':', eol - data);
+    if (!colon) THROW("Invalid header line: " << string(data, eol - data));
+
+    const char *value = colon + 1;
+    while (value < eol && isSpace(*value)) value++;
+    while (value < eol && isSpace(eol[-1])) eol--;
+
+    header_t id = getID(data, colon - data);
+    if (id == HEADER_UNKNOWN)
+      OrderedDict<string>::insert(string(data, colon - data),
+                                  string(value, eol - value));
+    else insert(id, string(value, eol - value));
   }
-
-  return false;
 }
 
 
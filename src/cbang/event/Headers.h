@@ -43,13 +43,64 @@ namespace cb {
 
     class Headers : public OrderedDict<std::string> {
     public:
+      typedef enum {
+        HEADER_ACCEPT,
+        HEADER_ACCEPT_ENCODING,
+        HEADER_AUTHORIZATION,
+        HEADER_CACHE_CONTROL,
+        HEADER_CONNECTION,
+        HEADER_CONTENT_ENCODING,
+        HEADER_CONTENT_LENGTH,
+        HEADER_CONTENT_TYPE,
+        HEADER_COOKIE,
+        HEADER_DATE,
+        HEADER_EXPECT,
+        HEADER_HOST,
+        HEADER_IF_MODIFIED_SINCE,
+        HEADER_IF_NONE_MATCH,
+        HEADER_LOCATION,
+        HEADER_ORIGIN,
+        HEADER_RANGE,
+        HEADER_REFERER,
+        HEADER_SEC_WEBSOCKET_EXTENSIONS,
+        HEADER_SEC_WEBSOCKET_KEY,
+        HEADER_SEC_WEBSOCKET_VERSION,
+        HEADER_TRANSFER_ENCODING,
+        HEADER_UPGRADE,
+        HEADER_USER_AGENT,
+        HEADER_X_FORWARDED_FOR,
+        HEADER_UNKNOWN,
+      } header_t;
+
+    protected:
+      // Index of each well-known header, checked before use
+      int slots[HEADER_UNKNOWN];
+
+    public:
+      Headers();
+
+      /// Case-insensitive lookup of a well-known header name
+      static header_t getID(const char *name, unsigned length);
+      static header_t getID(const std::string &name)
+        {return getID(name.data(), name.length());}
+      static const std::string &getName(header_t id);
+
+      bool has(header_t id) const {return find(id);}
+      bool has(const std::string &key) const;
+      /// @return a pointer to the value or 0 if not set.  No copy is made.
+      const std::string *find(header_t id) const;
       std::string find(const std::string &key) const;
+      size_type insert(header_t id, const std::string &value);
+      size_type insert(const std::string &key, const std::string &value);
       void set(const std::string &key, const std::string &value)
         {insert(key, value);}
       void remove(const std::string &key);
+      /// Case-insensitive compare of the whole value
+      bool keyEquals(header_t id, const char *value) const;
+      bool keyContains(header_t id, const char *value) const;
       bool keyContains(const std::string &key, const std::string &value) const;
 
-      bool hasContentType() const {return has("Content-Type");}
+      bool hasContentType() const {return has(HEADER_CONTENT_TYPE);}
       std::string getContentType() const;
       void setContentType(const std::string &contentType);
       void guessContentType(const std::string &ext);
@@ -57,6 +108,7 @@ namespace cb {
       bool connectionKeepAlive() const;
 
       bool parse(Buffer &buf, unsigned maxSize = 0);
+      void parse(const char *data, unsigned length);
       void write(std::ostream &stream) const;
     };
 
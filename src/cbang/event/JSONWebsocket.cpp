@@ -33,7 +33,7 @@
 #include "JSONWebsocket.h"
 
 #include <cbang/Catch.h>
-#include <cbang/iostream/VectorDevice.h>
+#include "BufferDevice.h"
 
 
 using namespace cb;
@@ -42,18 +42,19 @@ using namespace std;
 
 
 namespace {
-  struct JSONWriter : vector<char>, cb::VectorStream<>, public JSON::Writer {
+  struct JSONWriter : Event::Buffer, BufferStream<>, public JSON::Writer {
     SmartPointer<Websocket> ws;
 
     JSONWriter(const SmartPointer<Websocket> &ws) :
-      cb::VectorStream<>((vector<char> &)*this),
-      JSON::Writer((ostream &)*this), ws(ws) {}
+      BufferStream<>((Event::Buffer &)*this), JSON::Writer((ostream &)*this),
+      ws(ws) {}
 
     ~JSONWriter() {TRY_CATCH_ERROR(close(););}
 
     void close() {
       JSON::Writer::close();
-      ws->send(data(), size());
+      ((ostream &)*this).flush();
+      ws->send((Event::Buffer &)*this);
     }
   };
 }
@@ -71,5 +72,5 @@ void JSONWebsocket::onMessage(const JSON::ValuePtr &msg) {if (cb) cb(msg);}
 
 
 void JSONWebsocket::onMessage(const char *data, uint64_t length) {
-  onMessage(JSON::Reader::parse(InputSource(data, length)));
+  onMessage(JSON::BufferReader::parse(data, length));
 }
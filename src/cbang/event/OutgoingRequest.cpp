@@ -32,6 +32,7 @@
 
 #include "OutgoingRequest.h"
 #include "Client.h"
+#include "Connection.h"
 #include "Buffer.h"
 #include "Headers.h"
 
@@ -50,14 +51,12 @@ using namespace cb::Event;
 
 
 #undef CBANG_LOG_PREFIX
-#define CBANG_LOG_PREFIX << "OUT" << Connection::getID() << ':'
+#define CBANG_LOG_PREFIX << "OUT" << getID() << ':'
 
 
 OutgoingRequest::OutgoingRequest(Client &client, const URI &uri,
                                  RequestMethod method, callback_t cb) :
-  Connection(client.getBase(), false, uri.getIPAddress(), 0,
-             uri.getScheme() == "https" ? client.getSSLContext() : 0),
-  Request(method, uri), dns(client.getDNS()), cb(cb) {
+  Request(method, uri), client(client), pooled(client.isPooling()), cb(cb) {
   LOG_DEBUG(5, "Connecting to " << uri.getHost() << ':' << uri.getPort());
 }
 
@@ -74,7 +73,7 @@ void OutgoingRequest::setProgressCallback(progress_cb_t cb, double delay) {
 void OutgoingRequest::send() {
   // Set output headers
   if (!outHas("Host")) outSet("Host", getURI().getHost());
-  if (!outHas("Connection")) outSet("Connection", "close");
+  if (!pooled && !outHas("Connection")) outSet("Connection", "close");
 
   // Set Content-Length
   if (mayHaveBody() && !outHas("Content-Length"))
@@ -85,7 +84,7 @@ void OutgoingRequest::send() {
   LOG_DEBUG(6, getOutputBuffer().hexdump() << '\n');
 
   // Do it
-  Connection::makeRequest(*this);
+  client.send(*this);
 }
 
 
@@ -101,22 +100,25 @@ void OutgoingRequest::onProgress(unsigned bytes, int total) {
 
 
 void OutgoingRequest::onResponse(ConnectionError error) {
+  Connection &con = getConnection();
+
   if (error) {
-    LOG_ERROR("< " << getPeer() << ' ' << error);
+    LOG_ERROR("< " << con.getPeer() << ' ' << error);
 
-    string sslErrors = getSSLErrors();
+    string sslErrors = con.getSSLErrors();
     if (!sslErrors.empty()) sslErrors = " SSL:" + sslErrors;
 
     LOG_DEBUG(4, "SYS:" << SysError() << sslErrors);
 
   } else {
-    LOG_INFO(1, "< " << getPeer() << ' ' << getResponseLine());
+    LOG_INFO(1, "< " << con.getPeer() << ' ' << getResponseLine());
     LOG_DEBUG(5, getInputHeaders() << '\n');
     LOG_DEBUG(6, getInputBuffer().hexdump() << '\n');
   }
 
   setConnectionError(error);
+  TRY_CATCH_ERROR(client.release(*this));
   if (cb) TRY_CATCH_ERROR(cb(*this));
 
-  setConnection(0); // Release self reference
+  setConnection(0); // Release connection reference
 }
@@ -33,7 +33,6 @@
 #pragma once
 
 #include "Request.h"
-#include "Connection.h"
 
 #include <cbang/SmartPointer.h>
 
@@ -47,13 +46,14 @@ namespace cb {
     class Client;
     class HTTPHandler;
 
-    class OutgoingRequest : public Connection, public Request {
+    class OutgoingRequest : public Request {
     public:
       typedef std::function<void (Request &)> callback_t;
       typedef std::function<void (unsigned bytes, int total)> progress_cb_t;
 
     protected:
-      DNSBase &dns;
+      Client &client;
+      bool pooled;
       callback_t cb;
       double lastProgress = 0;
       double progressDelay;
@@ -69,9 +69,6 @@ namespace cb {
       using Request::send;
       void send();
 
-      // From Connection
-      DNSBase &getDNS() {return dns;}
-
       // From Request
       void onRequest() {}
       void onProgress(unsigned bytes, int total);
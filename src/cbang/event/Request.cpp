@@ -43,6 +43,19 @@
 #include <cbang/http/Cookie.h>
 #include <cbang/json/JSON.h>
 #include <cbang/time/Time.h>
+#include <cbang/os/SysError.h>
+
+#include <event2/buffer.h>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
@@ -62,6 +75,18 @@ namespace {
   };
 
 
+  const char *getContentEncoding(Request::compression_t compression) {
+    switch (compression) {
+    case Request::COMPRESS_ZLIB:  return "zlib";
+    case Request::COMPRESS_GZIP:  return "gzip";
+    case Request::COMPRESS_BZIP2: return "bzip2";
+    case Request::COMPRESS_BROTLI: return "br";
+    case Request::COMPRESS_ZSTD:  return "zstd";
+    default: return 0;
+    }
+  }
+
+
   SmartPointer<ostream> compressBufferStream
   (cb::Event::Buffer buffer, Request::compression_t compression) {
     SmartPointer<ostream> target = new BufferStream<>(buffer);
@@ -71,6 +96,9 @@ namespace {
     case Request::COMPRESS_ZLIB:  out->push(io::zlib_compressor()); break;
     case Request::COMPRESS_GZIP:  out->push(io::gzip_compressor()); break;
     case Request::COMPRESS_BZIP2: out->push(io::bzip2_compressor()); break;
+    case Request::COMPRESS_BROTLI: case Request::COMPRESS_ZSTD:
+      THROW("Stream compression not supported for "
+            << getContentEncoding(compression));
     default: return target;
     }
 
@@ -81,16 +109,6 @@ namespace {
   }
 
 
-  const char *getContentEncoding(Request::compression_t compression) {
-    switch (compression) {
-    case Request::COMPRESS_ZLIB:  return "zlib";
-    case Request::COMPRESS_GZIP:  return "gzip";
-    case Request::COMPRESS_BZIP2: return "bzip2";
-    default: return 0;
-    }
-  }
-
-
   struct JSONWriter :
     cb::Event::Buffer, SmartPointer<ostream>, public JSON::Writer {
     SmartPointer<Request> req;
@@ -164,6 +182,11 @@ bool Request::isConnected() const {
 }
 
 
+bool Request::isWritable() const {
+  return hasConnection() && getConnection().isWritable();
+}
+
+
 string Request::getSessionID(const string &cookie, const string &header) const {
   return inHas(header) ? inGet(header) : findCookie(cookie);
 }
@@ -186,7 +209,45 @@ bool Request::isSecure() const {
 
 
 SSL Request::getSSL() const {return connection->getSSL();}
-void Request::resetOutput() {getOutputBuffer().clear();}
+struct Request::FileBody {
+  string path;
+  int fd;
+  uint64_t size;
+  uint64_t offset = 0;
+  uint64_t length;
+
+  FileBody(const string &path) : path(path), fd(open(path.c_str(), O_RDONLY)) {
+    if (fd == -1) THROW("Failed to open file " << path);
+
+    struct stat buf;
+    if (fstat(fd, &buf)) {
+      ::close(fd);
+      THROW("Failed to stat file " << path);
+    }
+
+    length = size = buf.st_size;
+  }
+
+  ~FileBody() {if (fd != -1) ::close(fd);}
+
+
+  void select(uint64_t offset, int64_t length) {
+    this->offset = size < offset ? size : offset;
+    uint64_t remain = size - this->offset;
+    this->length = length < 0 || remain < (uint64_t)length ? remain : length;
+
+    if (this->offset && lseek(fd, this->offset, SEEK_SET) == -1)
+      THROW("Failed to seek in file " << path);
+  }
+
+  int release() {int x = fd; fd = -1; return x;}
+};
+
+
+void Request::resetOutput() {
+  getOutputBuffer().clear();
+  fileBody.release();
+}
 
 
 const JSON::ValuePtr &Request::parseJSONArgs() {
@@ -197,8 +258,7 @@ const JSON::ValuePtr &Request::parseJSONArgs() {
 
     Buffer buf = getInputBuffer();
     if (buf.getLength()) {
-      BufferStream<> stream(buf);
-      JSON::Reader reader(stream);
+      JSON::BufferReader reader(buf.pullup(), buf.getLength());
 
       // Find start of dict & parse keys into request args
       if (reader.next() == '{') {
@@ -329,6 +389,8 @@ void Request::outSetContentEncoding(compression_t compression) {
   case COMPRESS_ZLIB:
   case COMPRESS_GZIP:
   case COMPRESS_BZIP2:
+  case COMPRESS_BROTLI:
+  case COMPRESS_ZSTD:
     outSet("Content-Encoding", getContentEncoding(compression));
     break;
   default: break;
@@ -439,8 +501,7 @@ string Request::getOutput() const {return getOutputBuffer().toString();}
 SmartPointer<JSON::Value> Request::getInputJSON() const {
   Buffer buf = getInputBuffer();
   if (!buf.getLength()) return 0;
-  BufferStream<> stream(buf);
-  return JSON::Reader(stream).parse();
+  return JSON::BufferReader::parse(buf.pullup(), buf.getLength());
 }
 
 
@@ -591,7 +652,93 @@ void Request::send(const char *data, unsigned length) {
 
 void Request::send(const char *s) {getOutputBuffer().add(s);}
 void Request::send(const string &s) {getOutputBuffer().add(s);}
-void Request::sendFile(const string &path) {getOutputBuffer().addFile(path);}
+
+
+void Request::sendFile(const string &path, uint64_t offset, int64_t length) {
+  if (fileBody.isSet()) THROW("Request already has a file body");
+  SmartPointer<FileBody> body = new FileBody(path);
+  body->select(offset, length);
+  fileBody = body;
+}
+
+
+void Request::replyFile(const string &path) {
+  if (fileBody.isSet()) THROW("Request already has a file body");
+
+  // Open and stat the file once, the range is selected from its size
+  SmartPointer<FileBody> body = new FileBody(path);
+  uint64_t offset;
+  uint64_t length;
+  HTTPStatus code = selectRange(body->size, offset, length);
+
+  if (code == HTTP_REQUESTED_RANGE_NOT_SATISFIABLE) {
+    resetOutput();
+    outSet("Content-Length", "0");
+
+  } else if (method == HTTP_HEAD) outSet("Content-Length", String(length));
+  else {
+    body->select(offset, length);
+    fileBody = body;
+  }
+
+  reply(code);
+}
+
+
+HTTPStatus Request::selectRange(uint64_t size, uint64_t &offset,
+                                uint64_t &length) {
+  offset = 0;
+  length = size;
+  outSet("Accept-Ranges", "bytes");
+
+  if (!inHas("Range")) return HTTP_OK;
+
+  // Only a single byte range is supported, otherwise send everything
+  string range = String::trim(inGet("Range"));
+  if (!String::startsWith(range, "bytes=") ||
+      range.find(',') != string::npos) return HTTP_OK;
+
+  range = String::trim(range.substr(6));
+  size_t dash = range.find('-');
+  if (dash == string::npos) return HTTP_OK;
+
+  string first = String::trim(range.substr(0, dash));
+  string last = String::trim(range.substr(dash + 1));
+  uint64_t start;
+  uint64_t end = size ? size - 1 : 0;
+
+  try {
+    if (first.empty()) {
+      if (last.empty()) return HTTP_OK;
+
+      // Suffix range
+      uint64_t n = String::parseU64(last);
+      start = n < size ? size - n : 0;
+      if (!n) start = size;
+
+    } else {
+      start = String::parseU64(first);
+
+      if (!last.empty()) {
+        uint64_t n = String::parseU64(last);
+        if (n < start) return HTTP_OK; // Invalid, ignored per RFC 7233
+        end = min(end, n);
+      }
+    }
+  } catch (const Exception &) {return HTTP_OK;}
+
+  if (size <= start) {
+    outSet("Content-Range", "bytes */" + String(size));
+    return HTTP_REQUESTED_RANGE_NOT_SATISFIABLE;
+  }
+
+  offset = start;
+  length = end - start + 1;
+  outSet("Content-Range",
+         SSTR("bytes " << start << '-' << end << '/' << size));
+
+  return HTTP_PARTIAL_CONTENT;
+}
 
 
 void Request::reply(HTTPStatus code) {
@@ -739,14 +886,66 @@ void Request::parseResponseLine(const string &line) {
 }
 
 
+uint64_t Request::getBodyLength() const {
+  return outputBuffer.getLength() + (fileBody.isSet() ? fileBody->length : 0);
+}
+
+
+bool Request::writeFileChunk() {
+  if (fileBody.isNull()) return false;
+
+  if (!fileBody->length) {
+    fileBody.release();
+    return false;
+  }
+
+  const uint64_t chunkSize = 128 * 1024;
+  unsigned size = min(fileBody->length, chunkSize);
+
+  Buffer buf;
+  iovec space;
+  buf.reserve(size, space);
+
+  int ret = ::read(fileBody->fd, space.iov_base, size);
+  if (ret <= 0) {
+    // Called from the write callback, the response can only be cut short
+    LOG_ERROR("Failed to read file body from " << fileBody->path << ": "
+              << (ret ? SysError().toString() : string("truncated")));
+    fileBody.release();
+    connection->cancelRequest(*this);
+    return true;
+  }
+
+  space.iov_len = ret;
+  buf.commit(space);
+  fileBody->length -= ret;
+
+  bytesWritten += ret;
+  connection->write(*this, buf);
+
+  return true;
+}
+
+
 void Request::write() {
   Buffer out;
 
   writeHeaders(out);
   if (outputBuffer.getLength()) out.add(outputBuffer);
 
+  // Plain connections hand the file to the kernel with sendfile()
+  if (fileBody.isSet() && !isSecure()) {
+    out.setFlags(EVBUFFER_FLAG_DRAINS_TO_FD);
+    if (fileBody->length)
+      out.addFile(fileBody->release(), fileBody->offset, fileBody->length);
+    fileBody.release();
+  }
+
   bytesWritten += out.getLength();
   connection->write(*this, out);
+
+  // SSL connections read the file in chunks as the output drains
+  if (fileBody.isSet()) writeFileChunk();
 }
 
 
@@ -763,7 +962,7 @@ void Request::writeResponse(cb::Event::Buffer &buf) {
 
     if ((0 < version.getMinor() || keepAlive) && mustHaveBody() &&
         !outHas("Transfer-Encoding") && !outHas("Content-Length"))
-      outSet("Content-Length", String(outputBuffer.getLength()));
+      outSet("Content-Length", String(getBodyLength()));
   }
 
   // Add Content-Type
@@ -787,7 +986,7 @@ void Request::writeRequest(cb::Event::Buffer &buf) {
 
   // Add the content length on a post or put request if missing
   if ((method == HTTP_POST || method == HTTP_PUT) && !outHas("Content-Length"))
-    outSet("Content-Length", String(outputBuffer.getLength()));
+    outSet("Content-Length", String(getBodyLength()));
 }
 
 
@@ -59,11 +59,14 @@ namespace cb {
     class Connection;
 
     class Request : virtual public RefCounted, public Enum {
+      struct FileBody;
+
       Headers inputHeaders;
       Headers outputHeaders;
 
       Buffer inputBuffer;
       Buffer outputBuffer;
+      SmartPointer<FileBody> fileBody;
 
       RequestMethod method;
       URI originalURI;
@@ -75,7 +78,7 @@ namespace cb {
       SmartPointer<Connection> connection;
       ConnectionError connError;
 
-      SmartPointer<Session> session;
+      SmartPointer<Session>::Protected session;
       std::string user = "anonymous";
 
       bool chunked = false;
@@ -133,11 +136,14 @@ namespace cb {
       void setConnection(const SmartPointer<Connection> &con)
         {connection = con;}
       bool isConnected() const;
+      bool isWritable() const;
       ConnectionError getConnectionError() const {return connError;}
       void setConnectionError(ConnectionError err) {connError = err;}
 
-      const SmartPointer<Session> &getSession() const {return session;}
-      void setSession(const SmartPointer<Session> &session)
+      const SmartPointer<Session>::Protected &getSession() const {
+        return session;
+      }
+      void setSession(const SmartPointer<Session>::Protected &session)
       {this->session = session;}
       std::string
       getSessionID(const std::string &cookie = "sid",
@@ -199,7 +205,7 @@ namespace cb {
 
       typedef enum {
         COMPRESS_NONE, COMPRESS_AUTO, COMPRESS_ZLIB, COMPRESS_GZIP,
-        COMPRESS_BZIP2
+        COMPRESS_BZIP2, COMPRESS_BROTLI, COMPRESS_ZSTD
       } compression_t;
 
       void outSetContentEncoding(compression_t compression);
@@ -241,7 +247,14 @@ namespace cb {
       virtual void send(const char *data, unsigned length);
       virtual void send(const char *s);
       virtual void send(const std::string &s);
-      virtual void sendFile(const std::string &path);
+      /// Queue a file body, a negative @param length means to the end
+      virtual void sendFile(const std::string &path, uint64_t offset = 0,
+                            int64_t length = -1);
+      /// Reply with a file or the part selected by a Range header
+      virtual void replyFile(const std::string &path);
+      /// Apply a single byte Range header, returns the reply code
+      HTTPStatus selectRange(uint64_t size, uint64_t &offset,
+                             uint64_t &length);
 
       virtual void reply(HTTPStatus code = HTTP_OK);
       virtual void reply(const Buffer &buf);
@@ -257,6 +270,9 @@ namespace cb {
       virtual SmartPointer<JSON::Writer> getJSONChunkWriter();
       virtual void endChunked();
 
+      // Called by Connection
+      bool writeFileChunk();
+
       virtual void redirect(const URI &uri,
                             HTTPStatus code = HTTP_TEMPORARY_REDIRECT);
       virtual void cancel();
@@ -266,6 +282,8 @@ namespace cb {
       virtual void onRequest();
       virtual bool onContinue() {return true;}
       virtual void onProgress(unsigned bytes, int total) {}
+      /// Called when the connection's output crosses its watermarks
+      virtual void onWritable(bool writable) {}
       virtual void onResponse(ConnectionError code) {}
       virtual void onComplete() {}
 
@@ -273,6 +291,7 @@ namespace cb {
       bool mustHaveBody() const;
       bool mayHaveBody() const;
       bool needsClose() const;
+      uint64_t getBodyLength() const;
 
       static Version parseHTTPVersion(const std::string &s);
       void parseResponseLine(const std::string &line);
@@ -47,10 +47,23 @@ bool ResourceHTTPHandler::operator()(Request &req) {
 
   if (!res || res->isDirectory()) return false;
 
-  req.reply(HTTP_OK, res->getData(), res->getLength());
-
   if (!req.outHas("Cache-Control"))
     req.outSet("Cache-Control", "max-age=" + String(timeout));
 
+  if (cache.isSet() && cache->reply(req, *res)) return true;
+
+  // Reference the static resource data rather than copying it
+  uint64_t offset;
+  uint64_t length;
+  HTTPStatus code = req.selectRange(res->getLength(), offset, length);
+
+  if (code == HTTP_REQUESTED_RANGE_NOT_SATISFIABLE)
+    req.outSet("Content-Length", "0");
+  else if (req.getMethod() == HTTP_HEAD)
+    req.outSet("Content-Length", String(length));
+  else req.getOutputBuffer().addRef(res->getData() + offset, length);
+
+  req.reply(code);
+
   return true;
 }
@@ -33,6 +33,7 @@
 #pragma once
 
 #include "HTTPRequestHandler.h"
+#include "ContentCache.h"
 
 #include <cbang/time/Time.h>
 #include <cbang/util/Resource.h>
@@ -45,6 +46,7 @@ namespace cb {
     class ResourceHTTPHandler : public HTTPRequestHandler {
       const Resource &root;
       uint64_t timeout;
+      SmartPointer<ContentCache> cache;
 
     public:
       ResourceHTTPHandler(const Resource &root,
@@ -53,6 +55,10 @@ namespace cb {
 
       void setTimeout(uint64_t timeout) {this->timeout = timeout;}
       uint64_t getTimeout() const {return timeout;}
+      /// Enables precompressed responses, off by default
+      void setCache(const SmartPointer<ContentCache> &cache)
+        {this->cache = cache;}
+      const SmartPointer<ContentCache> &getCache() const {return cache;}
 
       // From HTTPRequestHandler
       bool operator()(Request &req);
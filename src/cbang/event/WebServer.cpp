@@ -32,6 +32,7 @@
 
 #include "WebServer.h"
 #include "HTTP.h"
+#include "HTTPServerPool.h"
 #include "Request.h"
 
 #include <cbang/config.h>
@@ -46,11 +47,32 @@ using namespace std;
 using namespace cb::Event;
 
 
+namespace {
+  void copySettings(HTTPServerPool &pool, const HTTP &http) {
+    pool.setMaxBodySize(http.getMaxBodySize());
+    pool.setMaxHeadersSize(http.getMaxHeadersSize());
+    pool.setReadTimeout(http.getReadTimeout());
+    pool.setWriteTimeout(http.getWriteTimeout());
+    pool.setMaxConnections(http.getMaxConnections());
+    pool.setConnectionBacklog(http.getConnectionBacklog());
+    pool.setStats(http.getStats());
+    pool.setWebsockDeflate(http.getWebsockDeflate());
+    pool.setWebsockDeflateLevel(http.getWebsockDeflateLevel());
+    pool.setWebsockNoContextTakeover(http.getWebsockNoContextTakeover());
+
+    if (http.getMaxConnectionTTL())
+      pool.setMaxConnectionTTL(http.getMaxConnectionTTL());
+    if (0 <= http.getEventPriority())
+      pool.setEventPriority(http.getEventPriority());
+  }
+}
+
+
 WebServer::WebServer(cb::Options &options, Base &base,
                      const cb::SmartPointer<cb::SSLContext> &sslCtx,
                      const cb::SmartPointer<HTTPHandlerFactory> &factory) :
   HTTPHandlerGroup(factory), options(options), sslCtx(sslCtx),
-  initialized(false), logPrefix(false) {
+  initialized(false), started(false), logPrefix(false) {
 
   SmartPointer<HTTPHandler>::Phony handler(this);
   http = new HTTP(base, handler);
@@ -87,6 +109,27 @@ void WebServer::addOptions(cb::Options &options) {
               "request times out.");
   options.add("http-connection-backlog", "Size of the connection backlog "
               "queue.  Once this is full connections are rejected.");
+  options.add("http-event-loops", "Number of event loops, each on its own "
+              "thread, serving HTTP requests.  Listening ports are shared "
+              "with SO_REUSEPORT.")->setDefault(1);
+  options.add("websocket-deflate", "Accept permessage-deflate Websocket "
+              "compression when offered by clients.")->setDefault(false);
+  options.add("websocket-deflate-level", "Websocket compression level from 0 "
+              "to 9.")->setDefault(6);
+  options.add("websocket-no-context-takeover", "Compress each Websocket "
+              "message independently.  Uses less memory per connection but "
+              "compresses less.")->setDefault(false);
+  options.add("http-output-high-watermark", "Bytes of output buffered on a "
+              "connection before it stops accepting more.  Zero for no limit."
+              )->setDefault(0);
+  options.add("http-output-low-watermark", "A connection accepts output "
+              "again once drained to this many bytes.")->setDefault(0);
+  options.add("http-output-budget", "Bytes of output which may be buffered "
+              "by all connections on each event loop.  Zero for no limit."
+              )->setDefault(0);
+  options.add("http-output-policy", "What to do with a connection over its "
+              "output limit.  Either PAUSE reading, DROP Websocket messages "
+              "or CLOSE the connection.")->setDefault("PAUSE");
 
   options.popCategory();
 
@@ -103,6 +146,16 @@ void WebServer::addOptions(cb::Options &options) {
                 "format.")->setDefault("certificate.pem");
     options.add("private-key-file", "The servers private key file in PEM "
                 "format.")->setDefault("private.pem");
+    options.add("ssl-session-cache-size", "Maximum number of TLS sessions "
+                "cached for resumption.  Zero disables the cache."
+                )->setDefault(20480);
+    options.add("ssl-session-timeout", "Seconds a cached TLS session or "
+                "session ticket may be resumed.")->setDefault(7200);
+    options.add("ssl-session-tickets", "Allow stateless TLS session "
+                "resumption with session tickets.")->setDefault(true);
+    options.add("ssl-ticket-key-lifetime", "Seconds before the session "
+                "ticket key is rotated.  The previous key is still accepted "
+                "for one more period.")->setDefault(43200);
     options.popCategory();
   }
 }
@@ -116,6 +169,9 @@ void WebServer::init() {
   ipFilter.allow(options["allow"]);
   ipFilter.deny(options["deny"]);
 
+  // Event loops
+  setEventLoops(options["http-event-loops"].toInteger());
+
   // Configure HTTP
   if (options["http-max-body-size"].hasValue())
     setMaxBodySize(options["http-max-body-size"].toInteger());
@@ -125,6 +181,15 @@ void WebServer::init() {
     setTimeout(options["http-server-timeout"].toInteger());
   if (options["http-connection-backlog"].hasValue())
     setConnectionBacklog(options["http-connection-backlog"].toInteger());
+  setWebsockDeflate(options["websocket-deflate"].toBoolean());
+  setWebsockDeflateLevel(options["websocket-deflate-level"].toInteger());
+  setWebsockNoContextTakeover
+    (options["websocket-no-context-takeover"].toBoolean());
+  setOutputWatermarks(options["http-output-high-watermark"].toInteger(),
+                      options["http-output-low-watermark"].toInteger());
+  setOutputBudget(options["http-output-budget"].toInteger());
+  setOutputPolicy
+    (OutputPolicy::parse(options["http-output-policy"].toString()));
 
   // Configure ports
   Option::strings_t addresses = options["http-addresses"].toStrings();
@@ -139,6 +204,13 @@ void WebServer::init() {
     for (unsigned i = 0; i < addresses.size(); i++)
       addSecureListenPort(addresses[i]);
 
+    // Session resumption
+    sslCtx->setSessionCacheSize(options["ssl-session-cache-size"].toInteger());
+    sslCtx->setSessionTimeout(options["ssl-session-timeout"].toInteger());
+    sslCtx->setSessionTickets(options["ssl-session-tickets"].toBoolean());
+    sslCtx->setTicketKeyLifetime
+      (options["ssl-ticket-key-lifetime"].toDouble());
+
     // Load server certificate
     // TODO should load file relative to configuration file
     if (options["certificate-file"].hasValue()) {
@@ -165,7 +237,32 @@ bool WebServer::allow(Request &req) const {
 }
 
 
+void WebServer::start() {
+  if (started) return;
+  started = true;
+
+  // Handler groups are compiled before they are shared between threads
+  compile();
+
+  // The extra loops only bind once they will accept, otherwise SO_REUSEPORT
+  // would send them connections which are never served
+  if (httpPool.isSet()) {
+    for (unsigned i = 0; i < ports.size(); i++) httpPool->bind(ports[i]);
+    httpPool->start();
+  }
+
+  if (httpsPool.isSet()) {
+    for (unsigned i = 0; i < securePorts.size(); i++)
+      httpsPool->bind(securePorts[i]);
+    httpsPool->start();
+  }
+}
+
+
 void WebServer::shutdown() {
+  started = false;
+  httpPool.release();
+  httpsPool.release();
   http.release();
   https.release();
 }
@@ -197,33 +294,75 @@ void WebServer::endRequest(Request &req) {
 }
 
 
+void WebServer::setEventLoops(unsigned count) {
+  if (count == getEventLoops()) return;
+  if (ports.size() || securePorts.size())
+    THROW("Cannot change event loops after listening");
+
+  httpPool.release();
+  httpsPool.release();
+  if (count < 2) return;
+
+  SmartPointer<HTTPHandler>::Phony handler(this);
+  http->setReusePort(true);
+  httpPool = new HTTPServerPool(count - 1, handler);
+
+  if (https.isSet()) {
+    https->setReusePort(true);
+    httpsPool = new HTTPServerPool(count - 1, handler, sslCtx);
+  }
+
+
+  copySettings(*httpPool, *http);
+  if (httpsPool.isSet()) copySettings(*httpsPool, *https);
+}
+
+
+unsigned WebServer::getEventLoops() const {
+  return httpPool.isSet() ? httpPool->size() + 1 : 1;
+}
+
+
+unsigned WebServer::getConnectionCount() const {
+  unsigned count = http.isSet() ? http->getConnectionCount() : 0;
+  if (https.isSet()) count += https->getConnectionCount();
+  if (httpPool.isSet()) count += httpPool->getConnectionCount();
+  if (httpsPool.isSet()) count += httpsPool->getConnectionCount();
+  return count;
+}
+
+
+#define FOR_EACH_HTTP(CALL)                     \
+  do {                                          \
+    http->CALL;                                 \
+    if (https.isSet()) https->CALL;             \
+    if (httpPool.isSet()) httpPool->CALL;       \
+    if (httpsPool.isSet()) httpsPool->CALL;     \
+  } while (false)
+
+
 void WebServer::setEventPriority(int priority) {
-  http->setEventPriority(priority);
-  if (!https.isNull()) http->setEventPriority(priority);
+  FOR_EACH_HTTP(setEventPriority(priority));
 }
 
 
 void WebServer::setMaxConnections(unsigned x) {
-  http->setMaxConnections(x);
-  if (!https.isNull()) http->setMaxConnections(x);
+  FOR_EACH_HTTP(setMaxConnections(x));
 }
 
 
 void WebServer::setMaxConnectionTTL(unsigned x) {
-  http->setMaxConnectionTTL(x);
-  if (!https.isNull()) http->setMaxConnectionTTL(x);
+  FOR_EACH_HTTP(setMaxConnectionTTL(x));
 }
 
 
 void WebServer::setConnectionBacklog(unsigned x) {
-  http->setConnectionBacklog(x);
-  if (!https.isNull()) http->setConnectionBacklog(x);
+  FOR_EACH_HTTP(setConnectionBacklog(x));
 }
 
 
 void WebServer::setStats(const cb::SmartPointer<cb::RateSet> &stats) {
-  http->setStats(stats);
-  if (https.isSet()) https->setStats(stats);
+  FOR_EACH_HTTP(setStats(stats));
 }
 
 
@@ -238,6 +377,9 @@ void WebServer::deny(const cb::IPAddress &addr) {ipFilter.deny(addr);}
 
 void WebServer::addListenPort(const cb::IPAddress &addr) {
   LOG_INFO(1, "Listening for HTTP on " << addr);
+  if (started && httpPool.isSet())
+    THROW("Cannot add listen ports after the event loops have started");
+
   http->bind(addr);
   ports.push_back(addr);
 }
@@ -245,29 +387,55 @@ void WebServer::addListenPort(const cb::IPAddress &addr) {
 
 void WebServer::addSecureListenPort(const cb::IPAddress &addr) {
   LOG_INFO(1, "Listening for HTTPS on " << addr);
+  if (started && httpsPool.isSet())
+    THROW("Cannot add listen ports after the event loops have started");
+
   https->bind(addr);
   securePorts.push_back(addr);
 }
 
 
 void WebServer::setMaxBodySize(unsigned size) {
-  http->setMaxBodySize(size);
-  if (!https.isNull()) https->setMaxBodySize(size);
+  FOR_EACH_HTTP(setMaxBodySize(size));
 }
 
 
 void WebServer::setMaxHeadersSize(unsigned size) {
-  http->setMaxHeadersSize(size);
-  if (!https.isNull()) https->setMaxHeadersSize(size);
+  FOR_EACH_HTTP(setMaxHeadersSize(size));
 }
 
 
 void WebServer::setTimeout(int timeout) {
-  http->setReadTimeout(timeout);
-  http->setWriteTimeout(timeout);
+  FOR_EACH_HTTP(setReadTimeout(timeout));
+  FOR_EACH_HTTP(setWriteTimeout(timeout));
+}
 
-  if (https.isSet()) {
-    https->setReadTimeout(timeout);
-    https->setWriteTimeout(timeout);
-  }
+
+void WebServer::setWebsockDeflate(bool x) {
+  FOR_EACH_HTTP(setWebsockDeflate(x));
+}
+
+
+void WebServer::setWebsockDeflateLevel(int x) {
+  FOR_EACH_HTTP(setWebsockDeflateLevel(x));
+}
+
+
+void WebServer::setWebsockNoContextTakeover(bool x) {
+  FOR_EACH_HTTP(setWebsockNoContextTakeover(x));
+}
+
+
+void WebServer::setOutputWatermarks(unsigned high, unsigned low) {
+  FOR_EACH_HTTP(setOutputWatermarks(high, low));
+}
+
+
+void WebServer::setOutputPolicy(OutputPolicy policy) {
+  FOR_EACH_HTTP(setOutputPolicy(policy));
+}
+
+
+void WebServer::setOutputBudget(uint64_t bytes) {
+  FOR_EACH_HTTP(setOutputBudget(bytes));
 }
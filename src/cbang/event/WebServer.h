@@ -34,6 +34,7 @@
 
 #include "HTTPHandler.h"
 #include "HTTPHandlerGroup.h"
+#include "OutputPolicy.h"
 
 #include <cbang/net/IPAddressFilter.h>
 
@@ -46,6 +47,7 @@ namespace cb {
   namespace Event {
     class Base;
     class HTTP;
+    class HTTPServerPool;
     class Request;
 
     class WebServer : public HTTPHandlerGroup, public HTTPHandler {
@@ -54,8 +56,11 @@ namespace cb {
 
       SmartPointer<HTTP> http;
       SmartPointer<HTTP> https;
+      SmartPointer<HTTPServerPool> httpPool;
+      SmartPointer<HTTPServerPool> httpsPool;
 
       bool initialized;
+      bool started;
 
       IPAddressFilter ipFilter;
 
@@ -77,7 +82,14 @@ namespace cb {
       bool getLogPrefix() const {return logPrefix;}
       void setLogPrefix(bool logPrefix) {this->logPrefix = logPrefix;}
 
+      /// Configure from options and bind listen ports
       virtual void init();
+      /**
+       * Compile the handlers, bind the listen ports on the extra event loops
+       * and start them.  Call once after init() when all handlers and listen
+       * ports have been added.  Until then only the main loop serves.
+       */
+      virtual void start();
       virtual bool allow(Request &req) const;
       virtual void shutdown();
 
@@ -96,6 +108,15 @@ namespace cb {
       const SmartPointer<HTTP> &getHTTP() const {return http;}
       const SmartPointer<HTTP> &getHTTPS() const {return https;}
 
+      /**
+       * Serve requests from @param count event loops.  The extra loops run
+       * on their own threads and listen with SO_REUSEPORT.  Must be called
+       * before any listen ports are added.
+       */
+      void setEventLoops(unsigned count);
+      unsigned getEventLoops() const;
+      unsigned getConnectionCount() const;
+
       void addListenPort(const IPAddress &addr);
       unsigned getNumListenPorts() const {return ports.size();}
       const IPAddress &getListenPort(unsigned i) const {return ports.at(i);}
@@ -119,6 +140,14 @@ namespace cb {
       void setMaxBodySize(unsigned size);
       void setMaxHeadersSize(unsigned size);
       void setTimeout(int timeout);
+
+      void setWebsockDeflate(bool x);
+      void setWebsockDeflateLevel(int x);
+      void setWebsockNoContextTakeover(bool x);
+
+      void setOutputWatermarks(unsigned high, unsigned low);
+      void setOutputPolicy(OutputPolicy policy);
+      void setOutputBudget(uint64_t bytes);
     };
   }
 }
@@ -0,0 +1,261 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "WebsockDeflate.h"
+#include "Buffer.h"
+
+#include <cbang/Exception.h>
+#include <cbang/String.h>
+
+#include <event2/buffer.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring> // memset()
+
+using namespace std;
+using namespace cb;
+using namespace cb::Event;
+
+
+namespace {
+  const unsigned char trailer[] = {0, 0, 0xff, 0xff};
+}
+
+
+struct WebsockDeflate::Private {
+  z_stream def;
+  z_stream inf;
+  bool defInit = false;
+  bool infInit = false;
+
+  Private() {
+    memset(&def, 0, sizeof(def));
+    memset(&inf, 0, sizeof(inf));
+  }
+
+  ~Private() {
+    if (defInit) deflateEnd(&def);
+    if (infInit) inflateEnd(&inf);
+  }
+};
+
+
+WebsockDeflate::WebsockDeflate(int level, bool noContextTakeover) :
+  pri(new Private), level(level), noContextTakeover(noContextTakeover) {}
+
+
+WebsockDeflate::~WebsockDeflate() {}
+
+
+bool WebsockDeflate::negotiate(const string &extensions) {
+  if (pri->defInit) THROW("Websocket deflate already negotiated");
+
+  vector<string> offers;
+  String::tokenize(extensions, offers, ",");
+
+  for (unsigned i = 0; i < offers.size(); i++)
+    if (parseOffer(offers[i])) {
+      // zlib cannot produce raw deflate streams with an 8 bit window
+      int bits = serverMaxWindowBits ? serverMaxWindowBits : 15;
+
+      if (deflateInit2(&pri->def, level, Z_DEFLATED, -bits, 8,
+                       Z_DEFAULT_STRATEGY) != Z_OK)
+        THROW("Failed to initialize deflate: " << pri->def.msg);
+      pri->defInit = true;
+
+      // A 15 bit window can decode any smaller window the client uses
+      if (inflateInit2(&pri->inf, -15) != Z_OK)
+        THROW("Failed to initialize inflate: " << pri->inf.msg);
+      pri->infInit = true;
+
+      return true;
+    }
+
+  return false;
+}
+
+
+string WebsockDeflate::getResponse() const {
+  string response = "permessage-deflate";
+
+  if (serverNoContextTakeover) response += "; server_no_context_takeover";
+  if (clientNoContextTakeover) response += "; client_no_context_takeover";
+  if (serverMaxWindowBits)
+    response += "; server_max_window_bits=" + String(serverMaxWindowBits);
+
+  return response;
+}
+
+
+void WebsockDeflate::compress(const char *data, uint64_t length, Buffer &out) {
+  if (!pri->defInit) THROW("Websocket deflate not negotiated");
+  if (0xffffffff < length) THROW("Websocket deflate message too large");
+
+  z_stream &z = pri->def;
+
+  // Deflate directly into contiguous space in the output buffer
+  iovec space;
+  out.reserve(deflateBound(&z, length) + 16, space);
+
+  z.next_in = (Bytef *)data;
+  z.avail_in = length;
+  z.next_out = (Bytef *)space.iov_base;
+  z.avail_out = space.iov_len;
+
+  int ret = deflate(&z, Z_SYNC_FLUSH);
+  if (ret != Z_OK || z.avail_in || !z.avail_out)
+    THROW("Websocket deflate failed: " << ret);
+
+  // Drop the sync flush trailer, the receiver adds it back
+  space.iov_len -= z.avail_out + sizeof(trailer);
+  out.commit(space);
+
+  if (serverNoContextTakeover) deflateReset(&z);
+}
+
+
+bool WebsockDeflate::decompress(const char *data, uint64_t length,
+                                vector<char> &out, uint64_t maxSize) {
+  if (!pri->infInit) THROW("Websocket deflate not negotiated");
+  if (0xffffffff < length) THROW("Websocket deflate message too large");
+
+  z_stream &z = pri->inf;
+  uint64_t size = 0;
+  bool end = false;
+
+  // Reuse the output vector's existing allocation
+  uint64_t space = max(length * 2, (uint64_t)1024);
+  out.resize(max((uint64_t)out.capacity(), space));
+
+  for (unsigned pass = 0; pass < 2 && !end; pass++) {
+    z.next_in = pass ? (Bytef *)trailer : (Bytef *)data;
+    z.avail_in = pass ? sizeof(trailer) : length;
+
+    do {
+      if (size == out.size()) {
+        if (maxSize && maxSize <= size) return false;
+        out.resize(size * 2);
+      }
+
+      z.next_out = (Bytef *)&out[size];
+      z.avail_out = out.size() - size;
+
+      int ret = inflate(&z, Z_SYNC_FLUSH);
+      size = out.size() - z.avail_out;
+
+      if (ret == Z_STREAM_END) end = true; // Sender set BFINAL
+      else if (ret == Z_BUF_ERROR) break;  // No more progress possible
+      else if (ret != Z_OK)
+        THROW("Websocket inflate failed: " << (z.msg ? z.msg : "error"));
+    } while (!end && (z.avail_in || !z.avail_out));
+  }
+
+  if (maxSize && maxSize < size) return false;
+  out.resize(size);
+
+  if (end || clientNoContextTakeover) inflateReset(&z);
+
+  return true;
+}
+
+
+bool WebsockDeflate::parseOffer(const string &offer) {
+  vector<string> params;
+  String::tokenize(offer, params, ";");
+  if (params.empty() || String::trim(params[0]) != "permessage-deflate")
+    return false;
+
+  serverNoContextTakeover = noContextTakeover;
+  clientNoContextTakeover = false;
+  serverMaxWindowBits = 0;
+
+  bool seenServerNCT = false;
+  bool seenClientNCT = false;
+  bool seenServerBits = false;
+  bool seenClientBits = false;
+
+  for (unsigned i = 1; i < params.size(); i++) {
+    string name = String::trim(params[i]);
+    string value;
+    bool hasValue = false;
+
+    size_t eq = name.find('=');
+    if (eq != string::npos) {
+      value = String::trim(name.substr(eq + 1));
+      name = String::trim(name.substr(0, eq));
+      hasValue = true;
+
+      if (1 < value.length() && value[0] == '"' &&
+          value[value.length() - 1] == '"')
+        value = value.substr(1, value.length() - 2);
+    }
+
+    if (name == "server_no_context_takeover") {
+      if (hasValue || seenServerNCT) return false;
+      seenServerNCT = serverNoContextTakeover = true;
+
+    } else if (name == "client_no_context_takeover") {
+      if (hasValue || seenClientNCT) return false;
+      seenClientNCT = clientNoContextTakeover = true;
+
+    } else if (name == "server_max_window_bits") {
+      if (!hasValue || seenServerBits) return false;
+      seenServerBits = true;
+
+      unsigned bits;
+      try {
+        bits = String::parseU32(value, true);
+      } catch (const Exception &) {return false;}
+
+      // See negotiate()
+      if (bits < 9 || 15 < bits) return false;
+      serverMaxWindowBits = bits;
+
+    } else if (name == "client_max_window_bits") {
+      if (seenClientBits) return false;
+      seenClientBits = true;
+
+      if (hasValue) {
+        unsigned bits;
+        try {
+          bits = String::parseU32(value, true);
+        } catch (const Exception &) {return false;}
+
+        if (bits < 8 || 15 < bits) return false;
+      }
+
+    } else return false; // Unknown parameter
+  }
+
+  return true;
+}
@@ -0,0 +1,84 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include <cbang/SmartPointer.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+namespace cb {
+  namespace Event {
+    class Buffer;
+
+    /// Server side of the RFC 7692 permessage-deflate Websocket extension
+    class WebsockDeflate {
+      struct Private;
+      SmartPointer<Private> pri;
+
+      int level;
+      bool noContextTakeover;
+
+      bool serverNoContextTakeover = false;
+      bool clientNoContextTakeover = false;
+      unsigned serverMaxWindowBits = 0;
+
+    public:
+      /// Messages smaller than this are sent uncompressed
+      static const unsigned MIN_SIZE = 64;
+
+      /// @param noContextTakeover reset the compressor after each message
+      WebsockDeflate(int level = 6, bool noContextTakeover = false);
+      ~WebsockDeflate();
+
+      /// Accept the first acceptable offer in a Sec-WebSocket-Extensions
+      bool negotiate(const std::string &extensions);
+      /// @return the Sec-WebSocket-Extensions response to a negotiate()
+      std::string getResponse() const;
+
+      /// Compress a whole message and append it to @param out
+      void compress(const char *data, uint64_t length, Buffer &out);
+      /**
+       * Decompress a whole message into @param out.
+       * @return false if the result would exceed @param maxSize.
+       */
+      bool decompress(const char *data, uint64_t length,
+                      std::vector<char> &out, uint64_t maxSize = 0);
+
+    protected:
+      bool parseOffer(const std::string &offer);
+    };
+  }
+}
@@ -32,6 +32,7 @@
 
 #include "Websocket.h"
 #include "Connection.h"
+#include "HTTP.h"
 
 #include <cbang/Catch.h>
 #include <cbang/net/Swab.h>
@@ -41,6 +42,8 @@
 #include <cbang/openssl/Digest.h>
 #endif
 
+#include <event2/buffer.h>
+
 #include <cstring> // memcpy()
 
 using namespace std;
@@ -48,16 +51,44 @@ using namespace cb;
 using namespace cb::Event;
 
 
-void Websocket::send(const char *data, unsigned length) {
-  if (!active) return Request::send(data, length);
-
+namespace {
   const unsigned frameSize = 0xffff;
+}
 
-  for (unsigned i = 0; length; i += frameSize) {
-    unsigned bytes = frameSize < length ? frameSize : length;
-    length -= bytes;
-    writeFrame(i ? WS_OP_CONTINUE : WS_OP_TEXT, !length, data + i, bytes);
-  }
+
+void Websocket::send(const Buffer &buf) {
+  if (!active) return Request::send(buf);
+  if (getConnection().dropOutput(buf.getLength())) {msgDropped++; return;}
+
+  if (deflate.isSet() && WebsockDeflate::MIN_SIZE <= buf.getLength()) {
+    Buffer src(buf);
+    unsigned length = src.getLength();
+    Buffer compressed;
+    deflate->compress(src.pullup(length), length, compressed);
+    src.drain(length);
+    writeFrames(compressed, true);
+
+  } else writeFrames(buf, false);
+
+  msgSent++;
+}
+
+
+void Websocket::send(const char *data, unsigned length) {
+  if (!active) return Request::send(data, length);
+  if (getConnection().dropOutput(length)) {msgDropped++; return;}
+
+  if (deflate.isSet() && WebsockDeflate::MIN_SIZE <= length) {
+    Buffer compressed;
+    deflate->compress(data, length, compressed);
+    writeFrames(compressed, true);
+
+  } else
+    for (unsigned i = 0; !i || length; i += frameSize) {
+      unsigned bytes = frameSize < length ? frameSize : length;
+      length -= bytes;
+      writeFrame(i ? WS_OP_CONTINUE : WS_OP_TEXT, !length, data + i, bytes);
+    }
 
   msgSent++;
 }
@@ -114,6 +145,21 @@ bool Websocket::upgrade() {
     outSet("Connection", "upgrade");
     outSet("Sec-WebSocket-Accept", key);
 
+    // Negotiate permessage-deflate
+    auto &http = getConnection().getHTTP();
+    string extensions = inFind("Sec-WebSocket-Extensions");
+
+    if (http.isSet() && http->getWebsockDeflate() && !extensions.empty()) {
+      SmartPointer<WebsockDeflate> deflate =
+        new WebsockDeflate(http->getWebsockDeflateLevel(),
+                           http->getWebsockNoContextTakeover());
+
+      if (deflate->negotiate(extensions)) {
+        outSet("Sec-WebSocket-Extensions", deflate->getResponse());
+        this->deflate = deflate;
+      }
+    }
+
     reply(HTTP_SWITCHING_PROTOCOLS);
     active = true; // Must be after above reply; See Connection::write()
 
@@ -163,7 +209,19 @@ bool Websocket::readHeader(Buffer &input) {
   uint8_t opcode = header[0] & 0xf;
   wsOpCode = (WebsockOpCode::enum_t)opcode;
 
-  if (wsOpCode != WS_OP_CONTINUE) wsMsg.clear();
+  // Check reserved bits, RSV1 marks a compressed message
+  bool rsv1 = header[0] & 0x40;
+  if ((header[0] & 0x30) || (rsv1 && (deflate.isNull() ||
+                                      (wsOpCode != WS_OP_TEXT &&
+                                       wsOpCode != WS_OP_BINARY)))) {
+    close(WS_STATUS_PROTOCOL);
+    return false;
+  }
+
+  if (wsOpCode != WS_OP_CONTINUE) {
+    wsMsg.clear();
+    wsCompressed = rsv1;
+  }
 
   switch (wsOpCode) {
   case WS_OP_TEXT:
@@ -210,8 +268,7 @@ bool Websocket::readBody(Buffer &input) {
   input.remove(&wsMsg[offset], bytesToRead);
 
   // Demask
-  for (uint64_t i = 0; i < bytesToRead; i++)
-    wsMsg[offset +  i] ^= wsMask[i & 3];
+  mask(wsMask, &wsMsg[offset], &wsMsg[offset], bytesToRead);
 
   LOG_DEBUG(5, "Frame body\n"
             << String::hexdump(string(wsMsg.begin() + offset, wsMsg.end()))
@@ -222,7 +279,26 @@ bool Websocket::readBody(Buffer &input) {
   case WS_OP_TEXT:
   case WS_OP_BINARY:
     if (wsFinish) {
-      message(wsMsg.data(), wsMsg.size());
+      if (wsCompressed) {
+        bool ok;
+
+        try {
+          ok = deflate->decompress(wsMsg.data(), wsMsg.size(), wsInflated,
+                                   getConnection().getMaxBodySize());
+        } catch (const Exception &e) {
+          close(WS_STATUS_PROTOCOL, e.getMessage());
+          break;
+        }
+
+        if (!ok) {
+          close(WS_STATUS_TOO_BIG);
+          break;
+        }
+
+        message(wsInflated.data(), wsInflated.size());
+
+      } else message(wsMsg.data(), wsMsg.size());
+
       wsMsg.clear();
     }
     break;
@@ -254,24 +330,37 @@ bool Websocket::readBody(Buffer &input) {
 }
 
 
-void Websocket::onMessage(const char *data, uint64_t length) {
-  if (cb) cb(data, length);
-}
+void Websocket::mask(const uint8_t key[4], const char *src, char *dst,
+                     uint64_t length) {
+  uint32_t key32;
+  memcpy(&key32, key, 4);
+  uint64_t key64 = (uint64_t)key32 << 32 | key32;
 
+  // Eight bytes at a time, memcpy() compiles to unaligned loads and stores
+  uint64_t i = 0;
+  for (; i + 8 <= length; i += 8) {
+    uint64_t word;
+    memcpy(&word, src + i, 8);
+    word ^= key64;
+    memcpy(dst + i, &word, 8);
+  }
 
+  for (; i < length; i++) dst[i] = src[i] ^ key[i & 3];
+}
 
-void Websocket::writeFrame(WebsockOpCode opcode, bool finish,
-                           const void *data, uint64_t len) {
-  LOG_DEBUG(4, __func__ << '(' << opcode << ", " << finish << ", " << len
-            << ')');
 
-  if (!active) THROW("Not active");
+void Websocket::onMessage(const char *data, uint64_t length) {
+  if (cb) cb(data, length);
+}
 
+
+bool Websocket::writeHeader(Buffer &out, WebsockOpCode opcode, bool finish,
+                            bool compressed, uint64_t len, uint8_t key[4]) {
   uint8_t header[14];
   uint8_t bytes = 2;
 
   // Opcode
-  header[0] = (finish ? 0x80 : 0) | opcode;
+  header[0] = (finish ? 0x80 : 0) | (compressed ? 0x40 : 0) | opcode;
 
   // Format payload length
   if (len < 126) header[1] = len;
@@ -290,31 +379,94 @@ void Websocket::writeFrame(WebsockOpCode opcode, bool finish,
   // Create mask
   bool maskData = !getConnection().isIncoming();
   if (maskData) {
-    header[1] &= 1 << 7; // Set mask bit
+    header[1] |= 1 << 7; // Set mask bit
 
     // Generate random mask
-    Random::instance().bytes(header + bytes, 4);
+    Random::instance().bytes(key, 4);
+    memcpy(header + bytes, key, 4);
     bytes += 4;
   }
 
-  Buffer out;
-  out.expand(len + bytes);
   out.add((char *)header, bytes);
-  out.add((char *)data, len);
 
-  // Mask data
-  if (maskData) {
-    uint8_t *ptr = (uint8_t *)out.pullup(len + bytes) + bytes;
-    uint8_t *mask = &header[bytes - 4];
+  return maskData;
+}
 
-    for (uint64_t i = 0; i < len; i++)
-      ptr[i] ^= mask[i & 3];
-  }
+
+void Websocket::writeFrame(WebsockOpCode opcode, bool finish,
+                           const void *data, uint64_t len, bool compressed) {
+  LOG_DEBUG(4, __func__ << '(' << opcode << ", " << finish << ", " << len
+            << ')');
+
+  if (!active) THROW("Not active");
+
+  Buffer out;
+  uint8_t key[4];
+
+  if (writeHeader(out, opcode, finish, compressed, len, key) && len) {
+    // Mask directly into the output buffer
+    iovec space;
+    out.reserve(len, space);
+    mask(key, (const char *)data, (char *)space.iov_base, len);
+    space.iov_len = len;
+    out.commit(space);
+
+  } else out.add((const char *)data, len);
+
+  getConnection().write(*this, out);
+}
+
+
+void Websocket::writeFrame(WebsockOpCode opcode, bool finish,
+                           const Buffer &payload, bool compressed) {
+  uint64_t len = payload.getLength();
+
+  LOG_DEBUG(4, __func__ << '(' << opcode << ", " << finish << ", " << len
+            << ')');
+
+  if (!active) THROW("Not active");
+
+  Buffer out;
+  uint8_t key[4];
+
+  if (writeHeader(out, opcode, finish, compressed, len, key)) {
+    Buffer src(payload);
+
+    if (len) {
+      iovec space;
+      out.reserve(len, space);
+      mask(key, src.pullup(len), (char *)space.iov_base, len);
+      space.iov_len = len;
+      out.commit(space);
+      src.drain(len);
+    }
+
+  } else out.add(payload); // Moves the data without copying
 
   getConnection().write(*this, out);
 }
 
 
+void Websocket::writeFrames(const Buffer &payload, bool compressed) {
+  Buffer src(payload);
+  unsigned length = src.getLength();
+
+  for (bool first = true; first || length; first = false) {
+    WebsockOpCode opcode = first ? WS_OP_TEXT : WS_OP_CONTINUE;
+    bool rsv1 = first && compressed;
+    unsigned bytes = frameSize < length ? frameSize : length;
+    length -= bytes;
+
+    if (length) {
+      Buffer frame;
+      src.remove(frame, bytes);
+      writeFrame(opcode, false, frame, rsv1);
+
+    } else writeFrame(opcode, true, src, rsv1);
+  }
+}
+
+
 void Websocket::pong() {
   writeFrame(WS_OP_PONG, true, pongPayload.data(), pongPayload.size());
   pongPayload.clear();
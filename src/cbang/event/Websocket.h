@@ -34,6 +34,7 @@
 
 #include "Request.h"
 #include "Event.h"
+#include "WebsockDeflate.h"
 
 #include <functional>
 
@@ -50,7 +51,11 @@ namespace cb {
       WebsockOpCode wsOpCode;
       uint8_t wsMask[4];
       bool wsFinish = false;
+      bool wsCompressed = false;
       std::vector<char> wsMsg;
+      std::vector<char> wsInflated;
+
+      SmartPointer<WebsockDeflate> deflate;
 
       std::string pongPayload;
       SmartPointer<Event> pingEvent;
@@ -58,6 +63,7 @@ namespace cb {
 
       uint64_t msgSent = 0;
       uint64_t msgReceived = 0;
+      uint64_t msgDropped = 0;
 
     public:
       using Request::Request;
@@ -68,7 +74,17 @@ namespace cb {
 
       uint64_t getMessagesSent() const {return msgSent;}
       uint64_t getMessagesReceived() const {return msgReceived;}
+      uint64_t getMessagesDropped() const {return msgDropped;}
+
+      /// True if permessage-deflate was negotiated
+      bool isCompressed() const {return deflate.isSet();}
 
+      /**
+       * Uncompressed Buffers are framed without copying and are drained.
+       * Messages are dropped while the Connection is not writable and its
+       * output policy is drop.
+       */
+      void send(const Buffer &buf);
       void send(const char *data, unsigned length);
       void send(const std::string &s);
       void send(const char *s) {send(std::string(s));}
@@ -84,6 +100,10 @@ namespace cb {
       // From Request
       bool isWebsocket() const {return active;}
 
+      /// XOR @param length bytes of @param src with @param key into @param dst
+      static void mask(const uint8_t key[4], const char *src, char *dst,
+                       uint64_t length);
+
       // Callbacks
       virtual bool onUpgrade() {return true;}
       virtual void onOpen() {}
@@ -94,8 +114,13 @@ namespace cb {
       using Request::send;
       using Request::reply;
 
+      bool writeHeader(Buffer &out, WebsockOpCode opcode, bool finish,
+                       bool compressed, uint64_t len, uint8_t key[4]);
       void writeFrame(WebsockOpCode opcode, bool finish,
-                      const void *data, uint64_t len);
+                      const void *data, uint64_t len, bool compressed = false);
+      void writeFrame(WebsockOpCode opcode, bool finish, const Buffer &payload,
+                      bool compressed = false);
+      void writeFrames(const Buffer &payload, bool compressed);
       void pong();
       void schedulePong();
       void schedulePing();
@@ -85,6 +85,7 @@ Connection::Connection(Server &server, SmartPointer<Socket> socket,
 
 
 Connection::~Connection() {
+  server.connectionDeleted(*this);
   zap(ctx);
 }
 
@@ -98,6 +99,7 @@ Connection::state_t Connection::getState() const {
 void Connection::setState(state_t state) {
   SmartLock lock(this);
   if (this->state != state) {
+    server.connectionStateChanged(*this, this->state, state);
     this->state = state;
     LOG_DEBUG(5, *this << " state=" << state);
 
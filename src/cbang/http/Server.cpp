@@ -46,6 +46,7 @@
 
 #include <cbang/os/SystemUtilities.h>
 #include <cbang/os/ThreadPoolFunc.h>
+#include <cbang/util/SmartLock.h>
 
 #include <cbang/log/Logger.h>
 #include <cbang/time/Time.h>
@@ -212,6 +213,8 @@ void Server::construct() {
   captureRequests = false;
   captureResponses = false;
   captureOnError = false;
+  processingCount = 0;
+  delayedCount = 0;
 
   SmartPointer<Option> opt;
 
@@ -480,42 +483,73 @@ Server::createConnection(SmartPointer<Socket> socket,
                          const IPAddress &clientIP) {
   limitConnections();
   if (maxConnections <= connections.size()) return 0;
-  return new Connection(*this, socket, clientIP);
+
+  Connection *con = new Connection(*this, socket, clientIP);
+
+  SmartLock lock(&changedLock);
+  changed[con] = Connection::READING_HEADER;
+
+  return con;
+}
+
+
+void Server::connectionStateChanged(Connection &con, Connection::state_t from,
+                                    Connection::state_t to) {
+  if (from == Connection::PROCESSING) processingCount--;
+  if (from == Connection::DELAY_PROCESSING) delayedCount--;
+  if (to == Connection::PROCESSING) processingCount++;
+  if (to == Connection::DELAY_PROCESSING) delayedCount++;
+
+  SmartLock lock(&changedLock);
+  changed[&con] = to;
+}
+
+
+void Server::connectionDeleted(Connection &con) {
+  SmartLock lock(&changedLock);
+  changed.erase(&con);
 }
 
 
 void Server::addConnectionSockets(SocketSet &sockSet) {
   SocketServer::addConnectionSockets(sockSet);
 
-  for (iterator it = begin(); it != end(); it++) {
-    Connection &con = *it->castPtr<Connection>();
+  // Only connections which changed state are visited.  Connections cannot
+  // be deleted while the lock is held.
+  SmartLock lock(&changedLock);
 
-    switch (con.getState()) {
+  for (auto it = changed.begin(); it != changed.end();) {
+    Connection &con = *it->first;
+    bool hold = false;
+    int type = 0;
+
+    switch (it->second) {
     case Connection::READING_HEADER:
     case Connection::READING_DATA:
-      sockSet.add(con.getSocket(), SocketSet::READ);
+      type = SocketSet::READ;
       break;
 
     case Connection::WRITING_HEADER:
     case Connection::WRITING_DATA:
+      // Revisit until the Context is ready
       if (!con.getContext() || con.getContext()->isReady())
-        sockSet.add(con.getSocket(), SocketSet::WRITE);
+        type = SocketSet::WRITE;
+      else hold = true;
       break;
 
     default: break;
     }
+
+    if (con.getSocket().isOpen()) sockSet.set(con.getSocket(), type);
+
+    if (hold) it++;
+    else it = changed.erase(it);
   }
 }
 
 
 bool Server::connectionsReady() const {
-  for (iterator it = begin(); it != end() && !shouldShutdown(); it++) {
-    Connection::state_t state = it->castPtr<Connection>()->getState();
-    if (state == Connection::DELAY_PROCESSING) return true;
-    if (!queueConnections && state == Connection::PROCESSING) return true;
-  }
-
-  return false;
+  return delayedCount || (!queueConnections && processingCount);
 }
 
 
@@ -33,6 +33,7 @@
 #pragma once
 
 #include "ConnectionQueue.h"
+#include "Connection.h"
 
 #include <cbang/socket/SocketServer.h>
 #include <cbang/os/ThreadPool.h>
@@ -41,6 +42,8 @@
 
 #include <vector>
 #include <list>
+#include <map>
+#include <atomic>
 
 
 namespace cb {
@@ -49,7 +52,6 @@ namespace cb {
 
   namespace HTTP {
     class Handler;
-    class Connection;
 
     class Server : public SocketServer {
     protected:
@@ -78,6 +80,14 @@ namespace cb {
       bool captureOnError;
       std::string captureDir;
 
+      // Connections which need processing without socket activity
+      std::atomic<unsigned> processingCount;
+      std::atomic<unsigned> delayedCount;
+
+      // Connections whose socket interest needs updating, with their state
+      Mutex changedLock;
+      std::map<Connection *, Connection::state_t> changed;
+
     public:
       Server(Options &options);
       Server(Options &options, SmartPointer<SSLContext> sslCtx);
@@ -100,6 +110,9 @@ namespace cb {
       virtual void init();
 
       bool handleConnection(double timeout);
+      void connectionStateChanged(Connection &con, Connection::state_t from,
+                                  Connection::state_t to);
+      void connectionDeleted(Connection &con);
 
       void createThreadPool(unsigned size);
       void startThreadPool() {if (!pool.isNull()) pool->start();}
@@ -0,0 +1,435 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "BufferReader.h"
+#include "Builder.h"
+#include "DocumentBuilder.h"
+
+#include <cbang/String.h>
+
+#include <cctype>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CBANG_JSON_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace std;
+using namespace cb;
+using namespace cb::JSON;
+
+
+namespace {
+  inline unsigned firstBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+  }
+
+
+  inline bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+  }
+
+
+  // Find the first non-whitespace character
+  const char *skipSpace(const char *p, const char *end) {
+#if defined(__AVX2__)
+    const __m256i sp = _mm256_set1_epi8(' ');
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i tab = _mm256_set1_epi8('\t');
+
+    for (; 32 <= end - p; p += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)p);
+      __m256i ws = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, sp), _mm256_cmpeq_epi8(v, nl)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, tab)));
+      uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(ws);
+      if (mask) return p + firstBit(mask);
+    }
+
+#elif defined(CBANG_JSON_SSE2)
+    const __m128i sp = _mm_set1_epi8(' ');
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+
+    for (; 16 <= end - p; p += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)p);
+      __m128i ws = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, nl)),
+        _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, tab)));
+      uint32_t mask = ~_mm_movemask_epi8(ws) & 0xffff;
+      if (mask) return p + firstBit(mask);
+    }
+#endif
+
+    while (p < end && isSpace(*p)) p++;
+    return p;
+  }
+
+
+  // Find the first quote or backslash
+  const char *findQuoteOrEscape(const char *p, const char *end) {
+#if defined(__AVX2__)
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i escape = _mm256_set1_epi8('\\');
+
+    for (; 32 <= end - p; p += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)p);
+      uint32_t mask = _mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+                        _mm256_cmpeq_epi8(v, escape)));
+      if (mask) return p + firstBit(mask);
+    }
+
+#elif defined(CBANG_JSON_SSE2)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i escape = _mm_set1_epi8('\\');
+
+    for (; 16 <= end - p; p += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)p);
+      uint32_t mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, escape)));
+      if (mask) return p + firstBit(mask);
+    }
+#endif
+
+    while (p < end && *p != '"' && *p != '\\') p++;
+    return p;
+  }
+
+
+  bool isKeyword(const char *s, size_t length, const char *keyword) {
+    return strlen(keyword) == length && !strncasecmp(s, keyword, length);
+  }
+}
+
+
+void BufferReader::parse(Sink &sink) {
+  switch (next()) {
+  case 'N': case 'n':
+    parseNull();
+    return sink.writeNull();
+
+  case 'T': case 't': case 'F': case 'f':
+    return sink.writeBoolean(parseBoolean());
+
+  case '-': case '.':
+  case '0': case '1': case '2': case '3': case '4':
+  case '5': case '6': case '7': case '8': case '9':
+    return parseNumber(sink);
+
+  case '"': return sink.write(parseString());
+
+  case '[':
+    sink.beginList();
+    parseList(sink);
+    return sink.endList();
+
+  case '{':
+    sink.beginDict();
+    parseDict(sink);
+    return sink.endDict();
+
+  default: match("NnTtFf-.0123456789\"[{");
+  }
+}
+
+
+ValuePtr BufferReader::parse() {
+  Builder builder;
+  parse(builder);
+  return builder.getRoot();
+}
+
+
+ValuePtr BufferReader::parse(const char *data, size_t length) {
+  return BufferReader(data, length).parse();
+}
+
+
+ValuePtr BufferReader::parseString(const string &s) {
+  return parse(s.data(), s.length());
+}
+
+
+void BufferReader::parse(const char *data, size_t length, Sink &sink) {
+  BufferReader(data, length).parse(sink);
+}
+
+
+void BufferReader::parseString(const string &s, Sink &sink) {
+  parse(s.data(), s.length(), sink);
+}
+
+
+DocumentPtr BufferReader::parseDocument() {
+  DocumentPtr doc = new Document;
+
+  // Roughly one arena byte per input byte
+  doc->reserve((end - ptr) / sizeof(uint64_t) + 1);
+
+  DocumentBuilder builder(*doc);
+  parse(builder);
+  return doc;
+}
+
+
+DocumentPtr BufferReader::parseDocument(const char *data, size_t length) {
+  return BufferReader(data, length).parseDocument();
+}
+
+
+DocumentPtr BufferReader::parseDocumentString(const string &s) {
+  return parseDocument(s.data(), s.length());
+}
+
+
+unsigned BufferReader::getLine() const {
+  unsigned line = 0;
+  for (const char *p = start; p < ptr; p++)
+    if (*p == '\n') line++;
+  return line;
+}
+
+
+unsigned BufferReader::getColumn() const {
+  unsigned column = 0;
+
+  for (const char *p = ptr; start < p && p[-1] != '\n'; p--)
+    if (p[-1] != '\r') column++;
+
+  return column;
+}
+
+
+char BufferReader::next() {
+  while (true) {
+    ptr = skipSpace(ptr, end);
+    if (ptr == end) break;
+    if (*ptr != '#') return *ptr;
+
+    // Skip comment
+    const char *eol = (const char *)memchr(ptr, '\n', end - ptr);
+    ptr = eol ? eol : end;
+  }
+
+  error("Unexpected end of expression");
+  throw "Unreachable";
+}
+
+
+bool BufferReader::tryMatch(char c) {
+  if (c == next()) {
+    ptr++;
+    return true;
+  }
+
+  return false;
+}
+
+
+char BufferReader::match(const char *chars) {
+  char x = next();
+
+  for (int i = 0; chars[i]; i++)
+    if (x == chars[i]) {
+      ptr++;
+      return x;
+    }
+
+  error(SSTR("Expected one of '" << cb::String::escapeC(chars)
+             << "' but found '" << cb::String::escapeC(string(1, x)) << '\''));
+  throw "Unreachable";
+}
+
+
+void BufferReader::parseNull() {
+  const char *s = ptr;
+  while (ptr < end && isalpha(*ptr)) ptr++;
+
+  if (!isKeyword(s, ptr - s, "null") && !isKeyword(s, ptr - s, "none"))
+    error(SSTR("Expected keyword 'None' or 'null' but found '"
+               << String::toLower(string(s, ptr)) << '\''));
+}
+
+
+bool BufferReader::parseBoolean() {
+  const char *s = ptr;
+  while (ptr < end && isalpha(*ptr)) ptr++;
+
+  if (isKeyword(s, ptr - s, "true")) return true;
+  if (isKeyword(s, ptr - s, "false")) return false;
+
+  error(SSTR("Expected keyword 'true' or 'false' but found '"
+             << String::toLower(string(s, ptr)) << '\''));
+  throw "Unreachable";
+}
+
+
+void BufferReader::parseNumber(Sink &sink) {
+  bool negative = next() == '-';
+  bool decimal = false;
+  bool overflow = false;
+  uint64_t x = 0;
+  const char *s = ptr;
+
+  if (negative) ptr++;
+
+  const char *digits = ptr;
+
+  if (ptr < end && *ptr == '0') ptr++;
+  else while (ptr < end && isdigit(*ptr)) {
+      unsigned d = *ptr++ - '0';
+      if ((~(uint64_t)0 - d) / 10 < x) overflow = true;
+      x = x * 10 + d;
+    }
+
+  bool hasDigits = digits < ptr;
+
+  if (ptr < end && *ptr == '.') {
+    decimal = true;
+    ptr++;
+    while (ptr < end && isdigit(*ptr)) ptr++;
+  }
+
+  if (ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+    decimal = true;
+    ptr++;
+    if (ptr < end && (*ptr == '+' || *ptr == '-')) ptr++;
+    while (ptr < end && isdigit(*ptr)) ptr++;
+  }
+
+  if (!decimal && hasDigits && !overflow) {
+    if (!negative) return sink.write(x);
+    if (x <= (uint64_t)1 << 63) return sink.write((int64_t)(0 - x));
+  }
+
+  // Copy to a terminated buffer for strtod()
+  size_t length = ptr - s;
+  char buf[64];
+  string big;
+  const char *str = buf;
+
+  if (length < sizeof(buf)) {
+    memcpy(buf, s, length);
+    buf[length] = 0;
+
+  } else {
+    big = string(s, length);
+    str = big.c_str();
+  }
+
+  char *strEnd;
+  errno = 0;
+  double v = strtod(str, &strEnd);
+
+  if (errno || (size_t)(strEnd - str) != length)
+    error(SSTR("Invalid JSON number '" << string(s, length) << "'"));
+
+  sink.write(v);
+}
+
+
+const string &BufferReader::parseString() {
+  match("\"");
+
+  const char *s = ptr;
+  bool escaped = false;
+
+  while (true) {
+    ptr = findQuoteOrEscape(ptr, end);
+    if (end <= ptr) error("Unterminated string");
+
+    if (*ptr == '"') break;
+
+    // Skip escaped character
+    escaped = true;
+    ptr += 2;
+  }
+
+  str.assign(s, ptr++);
+  if (escaped) str = String::unescapeC(str);
+
+  return str;
+}
+
+
+void BufferReader::parseList(Sink &sink) {
+  match("[");
+
+  while (true) {
+    if (tryMatch(']')) return; // End or trailing comma
+
+    sink.beginAppend();
+    parse(sink);
+
+    if (match(",]") == ']') return; // Continuation or end
+  }
+}
+
+
+void BufferReader::parseDict(Sink &sink) {
+  match("{");
+
+  while (true) {
+    if (tryMatch('}')) return; // Empty or trailing comma
+
+    const string &key = parseString();
+    match(":");
+    sink.beginInsert(key);
+    parse(sink);
+
+    if (match(",}") == '}') return; // Continuation or end
+  }
+}
+
+
+void BufferReader::error(const string &msg) const {
+  throw ParseError(msg, FileLocation(name, getLine(), getColumn()));
+}
@@ -0,0 +1,95 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include "Value.h"
+#include "Document.h"
+
+#include <string>
+
+
+namespace cb {
+  namespace JSON {
+    class Sink;
+
+    /**
+     * Parses JSON directly from a contiguous block of memory.  Accepts the
+     * same syntax as Reader but does not go through std::istream, scans
+     * strings and whitespace with SIMD instructions, when available, and
+     * parses numbers without allocating memory.
+     *
+     * The data must remain valid while the reader is in use.
+     */
+    class BufferReader {
+      std::string name;
+      const char *start;
+      const char *end;
+      const char *ptr;
+      std::string str;
+
+    public:
+      BufferReader(const char *data, size_t length,
+                   const std::string &name = "<memory>") :
+        name(name), start(data), end(data + length), ptr(data) {}
+
+      void parse(Sink &sink);
+      ValuePtr parse();
+      static ValuePtr parse(const char *data, size_t length);
+      static ValuePtr parseString(const std::string &s);
+      static void parse(const char *data, size_t length, Sink &sink);
+      static void parseString(const std::string &s, Sink &sink);
+      DocumentPtr parseDocument();
+      static DocumentPtr parseDocument(const char *data, size_t length);
+      static DocumentPtr parseDocumentString(const std::string &s);
+
+      size_t getOffset() const {return ptr - start;}
+      unsigned getLine() const;
+      unsigned getColumn() const;
+
+      bool good() const {return ptr < end;}
+      char next();
+      bool tryMatch(char c);
+      char match(const char *chars);
+
+      void parseNull();
+      bool parseBoolean();
+      void parseNumber(Sink &sink);
+      /// The result is only valid until the next call
+      const std::string &parseString();
+      void parseList(Sink &sink);
+      void parseDict(Sink &sink);
+
+      void error(const std::string &msg) const;
+    };
+  }
+}
@@ -34,20 +34,20 @@
 
 #include "Value.h"
 
-#include <cbang/util/OrderedDict.h>
+#include <cbang/util/HashOrderedDict.h>
 
 
 namespace cb {
   namespace JSON {
-    class Dict : public Value, protected OrderedDict<ValuePtr> {
-      typedef OrderedDict<ValuePtr> Super_T;
+    class Dict : public Value, protected HashOrderedDict<ValuePtr> {
+      typedef HashOrderedDict<ValuePtr> Super_T;
 
       bool simple;
 
     public:
       Dict() : simple(true) {}
 
-      // From OrderedDict<ValuePtr>
+      // From HashOrderedDict<ValuePtr>
       using Super_T::empty;
       using Super_T::has;
 
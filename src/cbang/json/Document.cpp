@@ -0,0 +1,299 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "Document.h"
+#include "Sink.h"
+#include "Builder.h"
+#include "Writer.h"
+
+#include <sstream>
+#include <cstring>
+
+using namespace std;
+using namespace cb;
+using namespace cb::JSON;
+
+
+ValueType Document::Node::getType() const {
+  if (isUndefined()) return JSON_UNDEFINED;
+
+  switch (getTag()) {
+  case TAG_NULL:    return JSON_NULL;
+  case TAG_BOOLEAN: return JSON_BOOLEAN;
+  case TAG_STRING:  return JSON_STRING;
+  case TAG_LIST:    return JSON_LIST;
+  case TAG_DICT:    return JSON_DICT;
+  default:          return JSON_NUMBER;
+  }
+}
+
+
+bool Document::Node::isNumber() const {
+  if (isUndefined()) return false;
+
+  switch (getTag()) {
+  case TAG_NUMBER: case TAG_S64: case TAG_U64: return true;
+  default: return false;
+  }
+}
+
+
+bool Document::Node::getBoolean() const {
+  checkType(TAG_BOOLEAN, "Boolean");
+  return ref >> TAG_BITS;
+}
+
+
+double Document::Node::getNumber() const {
+  if (!isNumber()) CBANG_TYPE_ERROR("Not a Number");
+
+  const uint64_t *data = getData();
+
+  switch (getTag()) {
+  case TAG_S64: return (int64_t)*data;
+  case TAG_U64: return *data;
+  default: {
+    double x;
+    memcpy(&x, data, sizeof(x));
+    return x;
+  }
+  }
+}
+
+
+string Document::Node::getString() const {
+  return string(getCString(), getLength());
+}
+
+
+const char *Document::Node::getCString() const {
+  checkType(TAG_STRING, "String");
+  return (const char *)(getData() + 1);
+}
+
+
+unsigned Document::Node::getLength() const {
+  checkType(TAG_STRING, "String");
+  return *getData();
+}
+
+
+bool Document::Node::toBoolean() const {
+  if (isUndefined()) return false;
+
+  switch (getTag()) {
+  case TAG_BOOLEAN: return getBoolean();
+  case TAG_NUMBER: case TAG_S64: case TAG_U64: return getNumber();
+  case TAG_STRING: return getLength();
+  case TAG_LIST: case TAG_DICT: return size();
+  default: return false;
+  }
+}
+
+
+unsigned Document::Node::size() const {
+  if (!isList() && !isDict()) CBANG_TYPE_ERROR("Not a List or Dict");
+  return *getData();
+}
+
+
+Document::Node Document::Node::get(unsigned i) const {
+  check(i);
+
+  const uint64_t *data = getData() + 1;
+  return Node(doc, isDict() ? data[i * 2 + 1] : data[i]);
+}
+
+
+string Document::Node::keyAt(unsigned i) const {
+  checkType(TAG_DICT, "Dict");
+  check(i);
+  return Node(doc, getData()[i * 2 + 1]).getString();
+}
+
+
+int Document::Node::indexOf(const char *key, unsigned length) const {
+  checkType(TAG_DICT, "Dict");
+
+  const uint64_t *data = getData();
+  unsigned n = *data++;
+
+  auto match = [&] (unsigned i) {
+    const uint64_t *k = doc->getData(data[i * 2]);
+    return *k == length && !memcmp(k + 1, key, length);
+  };
+
+  if (n <= LINEAR_MAX) {
+    for (unsigned i = 0; i < n; i++)
+      if (match(i)) return i;
+
+    return -1;
+  }
+
+  // Binary search the sorted hash index which follows the entries
+  const uint64_t *index = data + n * 2;
+  uint64_t hash = (uint64_t)Document::hash(key, length) << 32;
+  unsigned lo = 0;
+  unsigned hi = n;
+
+  while (lo < hi) {
+    unsigned mid = (lo + hi) / 2;
+    if (index[mid] < hash) lo = mid + 1;
+    else hi = mid;
+  }
+
+  for (; lo < n && (index[lo] & ~0xffffffffULL) == hash; lo++) {
+    unsigned i = (uint32_t)index[lo];
+    if (match(i)) return i;
+  }
+
+  return -1;
+}
+
+
+Document::Node Document::Node::get(const string &key) const {
+  int i = indexOf(key);
+  if (i == -1) CBANG_KEY_ERROR("Key '" << key << "' not found");
+  return get(i);
+}
+
+
+Document::Node Document::Node::get(const string &key,
+                                   const Node &defaultValue) const {
+  int i = indexOf(key);
+  return i == -1 ? defaultValue : get(i);
+}
+
+
+void Document::Node::visit(visitor_t visitor, bool depthFirst) const {
+  if (!depthFirst) visitor(*this, 0, 0);
+  visitChildren(visitor, depthFirst);
+  if (depthFirst) visitor(*this, 0, 0);
+}
+
+
+void Document::Node::visitChildren(visitor_t visitor, bool depthFirst) const {
+  if (!isList() && !isDict()) return;
+
+  for (unsigned i = 0; i < size(); i++) {
+    Node child = get(i);
+
+    if (depthFirst) child.visitChildren(visitor, depthFirst);
+    visitor(child, this, i);
+    if (!depthFirst) child.visitChildren(visitor, depthFirst);
+  }
+}
+
+
+void Document::Node::write(Sink &sink) const {
+  switch (isUndefined() ? TAG_NULL : getTag()) {
+  case TAG_NULL: return sink.writeNull();
+  case TAG_BOOLEAN: return sink.writeBoolean(getBoolean());
+  case TAG_NUMBER: return sink.write(getNumber());
+  case TAG_S64: return sink.write((int64_t)*getData());
+  case TAG_U64: return sink.write((uint64_t)*getData());
+  case TAG_STRING: return sink.write(getString());
+
+  case TAG_LIST: {
+    bool simple = true;
+    for (unsigned i = 0; i < size() && simple; i++)
+      simple = get(i).isSimple();
+
+    sink.beginList(simple);
+
+    for (unsigned i = 0; i < size(); i++) {
+      sink.beginAppend();
+      get(i).write(sink);
+    }
+
+    return sink.endList();
+  }
+
+  case TAG_DICT: {
+    bool simple = true;
+    for (unsigned i = 0; i < size() && simple; i++)
+      simple = get(i).isSimple();
+
+    sink.beginDict(simple);
+
+    for (unsigned i = 0; i < size(); i++) {
+      sink.beginInsert(keyAt(i));
+      get(i).write(sink);
+    }
+
+    return sink.endDict();
+  }
+  }
+}
+
+
+ValuePtr Document::Node::toValue() const {
+  Builder builder;
+  write(builder);
+  return builder.getRoot();
+}
+
+
+string Document::Node::toString(unsigned indentStart, bool compact,
+                                unsigned indentSpace, int precision) const {
+  ostringstream str;
+  Writer writer(str, indentStart, compact, indentSpace, precision);
+  write(writer);
+  str << flush;
+  return str.str();
+}
+
+
+const uint64_t *Document::Node::getData() const {return doc->getData(ref);}
+
+
+void Document::Node::checkType(unsigned tag, const char *name) const {
+  if (isUndefined() || getTag() != tag) CBANG_TYPE_ERROR("Not a " << name);
+}
+
+
+void Document::Node::check(unsigned i) const {
+  if (size() <= i) CBANG_KEY_ERROR("Index " << i << " out of range " << size());
+}
+
+
+uint32_t Document::hash(const char *s, unsigned length) {
+  // FNV-1a
+  uint32_t h = 2166136261U;
+
+  for (unsigned i = 0; i < length; i++) {
+    h ^= (uint8_t)s[i];
+    h *= 16777619U;
+  }
+
+  return h;
+}
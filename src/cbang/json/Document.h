@@ -0,0 +1,237 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include "ValueType.h"
+#include "Value.h"
+#include "Number.h"
+
+#include <cbang/SmartPointer.h>
+#include <cbang/StdTypes.h>
+#include <cbang/Errors.h>
+
+#include <vector>
+#include <string>
+#include <functional>
+
+
+namespace cb {
+  namespace JSON {
+    class Sink;
+    class DocumentBuilder;
+
+    /**
+     * An immutable JSON document.  All values, strings and keys are packed
+     * into a single arena of 64-bit words so that building and freeing a
+     * document costs a few large allocations rather than one per value.
+     *
+     * Values are referenced by tagged offsets.  The low three bits hold the
+     * value type and the rest is either the word offset of the value's data
+     * in the arena or, for booleans, the value itself.
+     *
+     * Documents are produced by DocumentBuilder, usually via
+     * Reader::parseDocument() or BufferReader::parseDocument().  A Node is
+     * only valid while its Document exists.
+     */
+    class Document : public ValueType::Enum {
+    public:
+      enum {
+        TAG_NULL,
+        TAG_BOOLEAN,
+        TAG_NUMBER,
+        TAG_S64,
+        TAG_U64,
+        TAG_STRING,
+        TAG_LIST,
+        TAG_DICT,
+      };
+
+      static const unsigned TAG_BITS = 3;
+      static const uint64_t TAG_MASK = (1 << TAG_BITS) - 1;
+
+      /// Dicts larger than this have a sorted hash index after their entries
+      static const unsigned LINEAR_MAX = 8;
+
+      static const uint64_t NO_ROOT = ~(uint64_t)0;
+
+      class Node {
+        const Document *doc;
+        uint64_t ref;
+
+      public:
+        Node() : doc(0), ref(0) {}
+        Node(const Document *doc, uint64_t ref) : doc(doc), ref(ref) {}
+
+        const Document *getDocument() const {return doc;}
+        uint64_t getRef() const {return ref;}
+
+        ValueType getType() const;
+
+        bool isUndefined() const {return !doc;}
+        bool isNull() const {return doc && getTag() == TAG_NULL;}
+        bool isBoolean() const {return doc && getTag() == TAG_BOOLEAN;}
+        bool isNumber() const;
+        bool isString() const {return doc && getTag() == TAG_STRING;}
+        bool isList() const {return doc && getTag() == TAG_LIST;}
+        bool isDict() const {return doc && getTag() == TAG_DICT;}
+        bool isSimple() const {return !isList() && !isDict();}
+
+        bool getBoolean() const;
+        double getNumber() const;
+        int32_t getS32() const {return getInteger<int32_t>("32-bit signed");}
+        uint32_t getU32() const
+        {return getInteger<uint32_t>("32-bit unsigned");}
+        int64_t getS64() const {return getInteger<int64_t>("64-bit signed");}
+        uint64_t getU64() const
+        {return getInteger<uint64_t>("64-bit unsigned");}
+        std::string getString() const;
+
+        /// Null terminated string data, valid while the Document exists
+        const char *getCString() const;
+        unsigned getLength() const;
+
+        bool toBoolean() const;
+        unsigned size() const;
+        bool empty() const {return !size();}
+
+        // List accessors
+        Node get(unsigned i) const;
+
+#define CBANG_JSON_DOC_GET(NAME, TYPE)                                  \
+        TYPE get##NAME(unsigned i) const {return get(i).get##NAME();}   \
+        TYPE get##NAME(const std::string &key) const                    \
+        {return get(key).get##NAME();}                                  \
+        TYPE get##NAME(const std::string &key, TYPE defaultValue) const { \
+          int index = indexOf(key);                                     \
+          return index == -1 ? defaultValue : get(index).get##NAME();   \
+        }
+
+        CBANG_JSON_DOC_GET(Boolean, bool);
+        CBANG_JSON_DOC_GET(Number,  double);
+        CBANG_JSON_DOC_GET(S32,     int32_t);
+        CBANG_JSON_DOC_GET(U32,     uint32_t);
+        CBANG_JSON_DOC_GET(S64,     int64_t);
+        CBANG_JSON_DOC_GET(U64,     uint64_t);
+        CBANG_JSON_DOC_GET(String,  std::string);
+#undef CBANG_JSON_DOC_GET
+
+        // Dict accessors
+        std::string keyAt(unsigned i) const;
+        int indexOf(const char *key, unsigned length) const;
+        int indexOf(const std::string &key) const
+        {return indexOf(key.data(), key.length());}
+        bool has(const std::string &key) const {return indexOf(key) != -1;}
+        Node get(const std::string &key) const;
+        Node get(const std::string &key, const Node &defaultValue) const;
+
+        Node operator[](unsigned i) const {return get(i);}
+        Node operator[](const std::string &key) const {return get(key);}
+
+        // Visitor
+        typedef std::function<void (const Node &value, const Node *parent,
+                                    unsigned index)> visitor_t;
+
+        void visit(visitor_t visitor, bool depthFirst = true) const;
+        void visitChildren(visitor_t visitor, bool depthFirst = true) const;
+
+        // Conversion
+        void write(Sink &sink) const;
+        ValuePtr toValue() const;
+        std::string toString(unsigned indentStart = 0, bool compact = false,
+                             unsigned indentSpace = 2,
+                             int precision = 6) const;
+
+      protected:
+        unsigned getTag() const {return ref & TAG_MASK;}
+        const uint64_t *getData() const;
+        void checkType(unsigned tag, const char *name) const;
+        void check(unsigned i) const;
+
+        template <typename T>
+        T getInteger(const char *name) const {
+          switch (isUndefined() ? (unsigned)TAG_NULL : getTag()) {
+          case TAG_S64: {
+            int64_t x = (int64_t)*getData();
+            if (Num::InRange<T>(x)) return (T)x;
+            CBANG_TYPE_ERROR("Value " << x << " is not a " << name
+                             << " integer");
+          }
+
+          case TAG_U64: {
+            uint64_t x = *getData();
+            if (Num::InRange<T>(x)) return (T)x;
+            CBANG_TYPE_ERROR("Value " << x << " is not a " << name
+                             << " integer");
+          }
+
+          case TAG_NUMBER: {
+            double x = getNumber();
+            if (Num::InRange<T>(x)) return (T)x;
+            CBANG_TYPE_ERROR("Value " << x << " is not a " << name
+                             << " integer");
+          }
+
+          default: CBANG_TYPE_ERROR("Not a Number");
+          }
+        }
+      };
+
+    protected:
+      std::vector<uint64_t> arena;
+      uint64_t root;
+
+      friend class DocumentBuilder;
+
+    public:
+      Document() : root(NO_ROOT) {}
+
+      Node getRoot() const
+      {return root == NO_ROOT ? Node() : Node(this, root);}
+      void clear() {arena.clear(); root = NO_ROOT;}
+      void reserve(size_t words) {arena.reserve(words);}
+
+      size_t getMemoryUsage() const
+      {return sizeof(Document) + arena.capacity() * sizeof(uint64_t);}
+
+      const uint64_t *getData(uint64_t ref) const
+      {return arena.data() + (ref >> TAG_BITS);}
+
+      static uint32_t hash(const char *s, unsigned length);
+      static uint64_t makeRef(unsigned tag, uint64_t offset)
+      {return (offset << TAG_BITS) | tag;}
+    };
+
+
+    typedef SmartPointer<Document> DocumentPtr;
+  }
+}
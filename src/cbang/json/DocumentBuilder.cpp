@@ -0,0 +1,294 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "DocumentBuilder.h"
+
+#include <cbang/Exception.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace cb;
+using namespace cb::JSON;
+
+
+DocumentBuilder::DocumentBuilder(Document &doc) :
+  doc(doc), appendNext(false), insertNext(false) {
+  doc.clear();
+}
+
+
+void DocumentBuilder::writeNull() {
+  expectValue();
+  add(Document::makeRef(Document::TAG_NULL, 0));
+}
+
+
+void DocumentBuilder::writeBoolean(bool value) {
+  expectValue();
+  add(Document::makeRef(Document::TAG_BOOLEAN, value));
+}
+
+
+void DocumentBuilder::write(double value) {
+  expectValue();
+
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  add(addWord(Document::TAG_NUMBER, bits));
+}
+
+
+void DocumentBuilder::write(uint64_t value) {
+  expectValue();
+  add(addWord(Document::TAG_U64, value));
+}
+
+
+void DocumentBuilder::write(int64_t value) {
+  expectValue();
+  add(addWord(Document::TAG_S64, (uint64_t)value));
+}
+
+
+void DocumentBuilder::write(const string &value) {
+  expectValue();
+  add(addString(value.data(), value.length()));
+}
+
+
+void DocumentBuilder::beginList(bool simple) {
+  expectValue();
+  stack.push_back(Frame{false, refs.size()});
+}
+
+
+void DocumentBuilder::beginAppend() {
+  top(false);
+  assertNotPending();
+  appendNext = true;
+}
+
+
+void DocumentBuilder::endList() {
+  assertNotPending();
+
+  size_t start = top(false).start;
+  uint64_t offset = doc.arena.size();
+
+  doc.arena.push_back(refs.size() - start);
+  doc.arena.insert(doc.arena.end(), refs.begin() + start, refs.end());
+
+  refs.resize(start);
+  stack.pop_back();
+  add(Document::makeRef(Document::TAG_LIST, offset));
+}
+
+
+void DocumentBuilder::beginDict(bool simple) {
+  expectValue();
+  stack.push_back(Frame{true, refs.size()});
+}
+
+
+bool DocumentBuilder::has(const string &key) const {
+  for (size_t i = top(true).start; i < refs.size(); i += 2) {
+    const uint64_t *k = doc.getData(refs[i]);
+    if (*k == key.length() && !memcmp(k + 1, key.data(), key.length()))
+      return true;
+  }
+
+  return false;
+}
+
+
+void DocumentBuilder::beginInsert(const string &key) {
+  top(true);
+  assertNotPending();
+  refs.push_back(addString(key.data(), key.length()));
+  insertNext = true;
+}
+
+
+void DocumentBuilder::endDict() {
+  assertNotPending();
+
+  size_t start = top(true).start;
+  unsigned n = (refs.size() - start) / 2;
+
+  if (Document::LINEAR_MAX < n) indexKeys(start);
+  if (dedupe(start)) {
+    n = (refs.size() - start) / 2;
+    if (Document::LINEAR_MAX < n) indexKeys(start);
+  }
+
+  uint64_t offset = doc.arena.size();
+
+  doc.arena.push_back(n);
+  doc.arena.insert(doc.arena.end(), refs.begin() + start, refs.end());
+  if (Document::LINEAR_MAX < n)
+    doc.arena.insert(doc.arena.end(), index.begin(), index.end());
+
+  refs.resize(start);
+  stack.pop_back();
+  add(Document::makeRef(Document::TAG_DICT, offset));
+}
+
+
+uint64_t DocumentBuilder::addString(const char *s, unsigned length) {
+  uint64_t offset = doc.arena.size();
+
+  // Length word followed by the null terminated string, zero padded
+  doc.arena.resize(offset + 1 + (length + 8) / 8);
+  doc.arena[offset] = length;
+  memcpy(&doc.arena[offset + 1], s, length);
+
+  return Document::makeRef(Document::TAG_STRING, offset);
+}
+
+
+uint64_t DocumentBuilder::addWord(unsigned tag, uint64_t value) {
+  uint64_t offset = doc.arena.size();
+  doc.arena.push_back(value);
+  return Document::makeRef(tag, offset);
+}
+
+
+void DocumentBuilder::expectValue() {
+  if (stack.empty()) {
+    if (doc.root != Document::NO_ROOT) THROW("Document already has a root");
+
+  } else if (stack.back().dict) {
+    if (!insertNext) THROW("Must call beginInsert() first");
+    insertNext = false;
+
+  } else {
+    if (!appendNext) THROW("Must call beginAppend() first");
+    appendNext = false;
+  }
+}
+
+
+void DocumentBuilder::add(uint64_t ref) {
+  if (stack.empty()) doc.root = ref;
+  else refs.push_back(ref);
+}
+
+
+void DocumentBuilder::assertNotPending() const {
+  if (appendNext) THROW("Already called append()");
+  if (insertNext) THROW("Already called insert()");
+}
+
+
+const DocumentBuilder::Frame &DocumentBuilder::top(bool dict) const {
+  if (stack.empty() || stack.back().dict != dict)
+    TYPE_ERROR("Not a " << (dict ? "Dict" : "List"));
+
+  return stack.back();
+}
+
+
+bool DocumentBuilder::keysEqual(uint64_t a, uint64_t b) const {
+  const uint64_t *x = doc.getData(a);
+  const uint64_t *y = doc.getData(b);
+  return *x == *y && !memcmp(x + 1, y + 1, *x);
+}
+
+
+void DocumentBuilder::indexKeys(size_t start) {
+  unsigned n = (refs.size() - start) / 2;
+
+  index.resize(n);
+  for (unsigned i = 0; i < n; i++) {
+    const uint64_t *key = doc.getData(refs[start + i * 2]);
+    uint32_t hash = Document::hash((const char *)(key + 1), *key);
+    index[i] = (uint64_t)hash << 32 | i;
+  }
+
+  sort(index.begin(), index.end());
+}
+
+
+bool DocumentBuilder::dedupe(size_t start) {
+  unsigned n = (refs.size() - start) / 2;
+  uint64_t *entries = &refs[start];
+  bool removed = false;
+
+  // Within a run of possibly equal keys move later values to the first
+  // occurrence of the key and mark the later entries removed
+  auto merge = [&] (const uint64_t *run, unsigned length) {
+    for (unsigned j = 1; j < length; j++) {
+      unsigned b = (uint32_t)run[j];
+
+      for (unsigned k = 0; k < j; k++) {
+        unsigned a = (uint32_t)run[k];
+        if (entries[a * 2] == Document::NO_ROOT ||
+            !keysEqual(entries[a * 2], entries[b * 2])) continue;
+
+        entries[a * 2 + 1] = entries[b * 2 + 1];
+        entries[b * 2] = Document::NO_ROOT;
+        removed = true;
+        break;
+      }
+    }
+  };
+
+  if (n <= Document::LINEAR_MAX) {
+    uint64_t run[Document::LINEAR_MAX];
+    for (unsigned i = 0; i < n; i++) run[i] = i;
+    merge(run, n);
+
+  } else
+    for (unsigned i = 0; i < n;) {
+      unsigned j = i + 1;
+      while (j < n && index[i] >> 32 == index[j] >> 32) j++;
+      if (1 < j - i) merge(&index[i], j - i);
+      i = j;
+    }
+
+  if (!removed) return false;
+
+  // Compact
+  unsigned count = 0;
+  for (unsigned i = 0; i < n; i++)
+    if (entries[i * 2] != Document::NO_ROOT) {
+      entries[count * 2] = entries[i * 2];
+      entries[count * 2 + 1] = entries[i * 2 + 1];
+      count++;
+    }
+
+  refs.resize(start + count * 2);
+
+  return true;
+}
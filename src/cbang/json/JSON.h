@@ -40,9 +40,12 @@
 #include "List.h"
 #include "Dict.h"
 #include "Reader.h"
+#include "BufferReader.h"
 #include "YAMLReader.h"
 #include "Writer.h"
 #include "Builder.h"
+#include "Document.h"
+#include "DocumentBuilder.h"
 #include "NullSink.h"
 #include "BufferWriter.h"
 #include "Integer.h"
@@ -31,7 +31,9 @@
 \******************************************************************************/
 
 #include "Reader.h"
+#include "BufferReader.h"
 #include "Builder.h"
+#include "DocumentBuilder.h"
 
 #include <cbang/String.h>
 #include <cbang/io/StringInputSource.h>
@@ -100,7 +102,7 @@ SmartPointer<Value> Reader::parse(const InputSource &src) {
 
 
 SmartPointer<Value> Reader::parseString(const string &s) {
-  return parse(StringInputSource(s));
+  return BufferReader::parseString(s);
 }
 
 
@@ -110,7 +112,25 @@ void Reader::parse(const InputSource &src, Sink &sink) {
 
 
 void Reader::parseString(const string &s, Sink &sink) {
-  parse(StringInputSource(s), sink);
+  BufferReader::parseString(s, sink);
+}
+
+
+DocumentPtr Reader::parseDocument() {
+  DocumentPtr doc = new Document;
+  DocumentBuilder builder(*doc);
+  parse(builder);
+  return doc;
+}
+
+
+DocumentPtr Reader::parseDocument(const InputSource &src) {
+  return Reader(src).parseDocument();
+}
+
+
+DocumentPtr Reader::parseDocumentString(const string &s) {
+  return BufferReader::parseDocumentString(s);
 }
 
 
@@ -246,6 +266,7 @@ void Reader::parseNumber(Sink &sink) {
     }
   }
 
+  errno = 0;
   double v = strtod(start, &end);
   if (errno || (size_t)(end - start) != value.length())
     error(SSTR("Invalid JSON number '" << value << "'"));
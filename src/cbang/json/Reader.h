@@ -33,6 +33,7 @@
 #pragma once
 
 #include "Value.h"
+#include "Document.h"
 
 #include <cbang/io/InputSource.h>
 
@@ -60,6 +61,9 @@ namespace cb {
       static ValuePtr parseString(const std::string &s);
       static void parse(const InputSource &src, Sink &sink);
       static void parseString(const std::string &s, Sink &sink);
+      DocumentPtr parseDocument();
+      static DocumentPtr parseDocument(const InputSource &src);
+      static DocumentPtr parseDocumentString(const std::string &s);
 
       unsigned getLine() const {return line;}
       unsigned getColumn() const {return column;}
@@ -0,0 +1,301 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "AsyncLogWriter.h"
+
+#include <cbang/Exception.h>
+#include <cbang/String.h>
+#include <cbang/util/SmartLock.h>
+#include <cbang/os/SysError.h>
+
+#include <iostream>
+
+#include <errno.h>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+
+struct iovec {
+  void *iov_base;
+  size_t iov_len;
+};
+
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+using namespace std;
+using namespace cb;
+
+
+namespace {
+  void writeAll(int fd, struct iovec *iov, unsigned count) {
+    while (count) {
+#ifdef _WIN32
+      int ret = _write(fd, iov->iov_base, iov->iov_len);
+#else
+      ssize_t ret = writev(fd, iov, count);
+#endif
+      if (ret < 0) {
+        if (errno == EINTR) continue;
+        return; // Nowhere to report log errors
+      }
+
+      // Skip completely written buffers and adjust a partially written one
+      size_t n = ret;
+      while (count && iov->iov_len <= n) {
+        n -= iov->iov_len;
+        iov++;
+        count--;
+      }
+
+      if (count) {
+        iov->iov_base = (char *)iov->iov_base + n;
+        iov->iov_len -= n;
+      }
+    }
+  }
+}
+
+
+AsyncLogWriter::AsyncLogWriter(unsigned capacity, overflow_t overflow,
+                               bool crlf) :
+  overflow(overflow), crlf(crlf), head(0), tail(0), sleeping(false),
+  blocked(0), dropped(0), unreported(0), fileFD(-1), screenFD(-1) {
+
+  unsigned size = 2;
+  while (size < capacity) size <<= 1;
+
+  cells = vector<Cell>(size);
+  mask = size - 1;
+  for (unsigned i = 0; i < size; i++) cells[i].sequence = i;
+}
+
+
+AsyncLogWriter::~AsyncLogWriter() {closeFile();}
+
+
+AsyncLogWriter::overflow_t AsyncLogWriter::parseOverflow(const string &name) {
+  string s = String::toLower(name);
+
+  if (s == "block") return OVERFLOW_BLOCK;
+  if (s == "drop") return OVERFLOW_DROP;
+  if (s == "count") return OVERFLOW_COUNT;
+
+  THROW("Invalid log overflow policy '" << name << "'");
+}
+
+
+void AsyncLogWriter::openFile(const string &filename) {
+#ifdef _WIN32
+  int fd = _open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND |
+                 _O_BINARY, 0600);
+#else
+  int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+#endif
+  if (fd < 0) THROW("Failed to open log file '" << filename << "': "
+                     << SysError());
+
+  SmartLock lock(this);
+  closeFile();
+  fileFD = fd;
+}
+
+
+void AsyncLogWriter::closeFile() {
+  SmartLock lock(this);
+
+  if (fileFD < 0) return;
+#ifdef _WIN32
+  _close(fileFD);
+#else
+  ::close(fileFD);
+#endif
+  fileFD = -1;
+}
+
+
+void AsyncLogWriter::setScreen(const SmartPointer<ostream> &screen) {
+  SmartLock lock(this);
+
+  this->screen = screen;
+
+  // Write directly to stdout when possible
+  if (screen.get() == &cout) {
+    cout.flush();
+    screenFD = 1;
+
+  } else screenFD = -1;
+}
+
+
+bool AsyncLogWriter::push(vector<char> &line) {
+  uint64_t pos = head.load(memory_order_relaxed);
+  Cell *cell;
+
+  while (true) {
+    cell = &cells[pos & mask];
+    int64_t diff = (int64_t)(cell->sequence.load() - pos);
+
+    if (!diff) {
+      if (head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+        break;
+
+    } else if (diff < 0) {
+      // Full
+      if (overflow != OVERFLOW_BLOCK) {
+        dropped++;
+        if (overflow == OVERFLOW_COUNT) unreported++;
+        return false;
+      }
+
+      SmartLock lock(&spaceReady);
+      blocked++;
+      if ((int64_t)(cell->sequence.load() - pos) < 0)
+        spaceReady.timedWait(0.1);
+      blocked--;
+
+      pos = head.load(memory_order_relaxed);
+
+    } else pos = head.load(memory_order_relaxed);
+  }
+
+  cell->data.swap(line);
+  cell->sequence = pos + 1;
+
+  if (sleeping) {
+    SmartLock lock(&dataReady);
+    dataReady.signal();
+  }
+
+  return true;
+}
+
+
+bool AsyncLogWriter::push(const char *s, unsigned n) {
+  vector<char> line(s, s + n);
+  return push(line);
+}
+
+
+void AsyncLogWriter::drain() {while (writeBatch()) continue;}
+
+
+void AsyncLogWriter::stop() {
+  Thread::stop();
+
+  SmartLock lock(&dataReady);
+  dataReady.signal();
+}
+
+
+bool AsyncLogWriter::writeBatch() {
+  struct iovec iov[BATCH_SIZE + 1];
+  unsigned count = 0;
+  string notice;
+
+  uint64_t lost = unreported.exchange(0);
+  if (lost) {
+    notice = SSTR("WARNING: Dropped " << lost << " log lines"
+                  << (crlf ? "\r\n" : "\n"));
+    iov[count].iov_base = (void *)notice.data();
+    iov[count++].iov_len = notice.length();
+  }
+
+  unsigned lines = 0;
+  while (lines < BATCH_SIZE) {
+    Cell &cell = cells[(tail + lines) & mask];
+    if (cell.sequence.load() != tail + lines + 1) break;
+
+    iov[count].iov_base = (void *)cell.data.data();
+    iov[count++].iov_len = cell.data.size();
+    lines++;
+  }
+
+  if (!count) return false;
+
+  {
+    SmartLock lock(this);
+
+    if (0 <= fileFD) {
+      struct iovec tmp[BATCH_SIZE + 1];
+      copy(iov, iov + count, tmp);
+      writeAll(fileFD, tmp, count);
+    }
+
+    if (0 <= screenFD) writeAll(screenFD, iov, count);
+    else if (!screen.isNull()) {
+      for (unsigned i = 0; i < count; i++)
+        screen->write((const char *)iov[i].iov_base, iov[i].iov_len);
+      screen->flush();
+    }
+  }
+
+  // Release the cells
+  for (unsigned i = 0; i < lines; i++) {
+    Cell &cell = cells[(tail + i) & mask];
+    cell.data.clear();
+    cell.sequence = tail + i + cells.size();
+  }
+
+  tail += lines;
+
+  if (blocked) {
+    SmartLock lock(&spaceReady);
+    spaceReady.broadcast();
+  }
+
+  return true;
+}
+
+
+void AsyncLogWriter::run() {
+  while (true) {
+    if (writeBatch()) continue;
+    if (shouldShutdown()) break;
+
+    // Give producers a chance to fill a batch before sleeping
+    Thread::yield();
+    if (writeBatch()) continue;
+
+    SmartLock lock(&dataReady);
+    sleeping = true;
+
+    // Recheck after announcing that we are sleeping so a push cannot be missed
+    if (cells[tail & mask].sequence.load() != tail + 1 && !shouldShutdown())
+      dataReady.timedWait(1);
+
+    sleeping = false;
+  }
+}
@@ -0,0 +1,131 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include <cbang/SmartPointer.h>
+#include <cbang/StdTypes.h>
+#include <cbang/os/Thread.h>
+#include <cbang/os/Mutex.h>
+#include <cbang/os/Condition.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <atomic>
+
+
+namespace cb {
+  /**
+   * Writes log lines from a dedicated thread.  Lines are passed through a
+   * bounded multi-producer, single-consumer ring.  Producers swap their line
+   * buffer with the ring slot's so the buffers are recycled rather than
+   * copied.  The writer thread collects ready lines in batches and writes
+   * each batch to the log file and screen with a single writev() call.
+   *
+   * When the ring is full the overflow policy decides whether producers
+   * wait for space, drop the line or drop the line and have the writer
+   * report how many lines were lost.
+   */
+  class AsyncLogWriter : public Thread, public Mutex {
+  public:
+    enum overflow_t {
+      OVERFLOW_BLOCK,
+      OVERFLOW_DROP,
+      OVERFLOW_COUNT,
+    };
+
+    static const unsigned BATCH_SIZE = 64;
+
+  private:
+    struct Cell {
+      std::atomic<uint64_t> sequence;
+      std::vector<char> data;
+    };
+
+    std::vector<Cell> cells;
+    uint64_t mask;
+    overflow_t overflow;
+    bool crlf;
+
+    std::atomic<uint64_t> head;
+    uint64_t tail;
+
+    std::atomic<bool> sleeping;
+    std::atomic<unsigned> blocked;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> unreported;
+
+    Condition dataReady;
+    Condition spaceReady;
+
+    int fileFD;
+    int screenFD;
+    SmartPointer<std::ostream> screen;
+
+  public:
+    /// @param capacity Rounded up to a power of two
+    AsyncLogWriter(unsigned capacity = 4096,
+                   overflow_t overflow = OVERFLOW_BLOCK, bool crlf = false);
+    ~AsyncLogWriter();
+
+    static overflow_t parseOverflow(const std::string &name);
+
+    unsigned getCapacity() const {return cells.size();}
+    uint64_t getDropped() const {return dropped;}
+
+    void openFile(const std::string &filename);
+    void closeFile();
+    void setScreen(const SmartPointer<std::ostream> &screen);
+
+    /**
+     * Queue a complete line, including its EOL.  On success @param line is
+     * swapped with a recycled buffer and should be cleared before reuse.
+     * @return False if the line was dropped.
+     */
+    bool push(std::vector<char> &line);
+    bool push(const char *s, unsigned n);
+
+    /// Write all queued lines from the calling thread.  Call after join().
+    void drain();
+
+    // From Thread
+    void stop();
+
+  protected:
+    bool writeBatch();
+    void write(const char *s, unsigned n);
+
+    // From Thread
+    void run();
+  };
+}
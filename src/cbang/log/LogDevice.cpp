@@ -38,11 +38,19 @@ using namespace std;
 using namespace cb;
 
 
+namespace {
+  // Line buffers are recycled per thread
+  thread_local vector<char> spareBuffer;
+}
+
+
 LogDevice::impl::impl(const std::string &prefix, const std::string &suffix,
                       const std::string &trailer) :
   prefix(prefix), suffix(suffix), trailer(trailer), startOfLine(true),
   locked(false) {
 
+  buffer.swap(spareBuffer);
+  buffer.clear();
   buffer.reserve(1024);
 }
 
@@ -50,6 +58,7 @@ LogDevice::impl::impl(const std::string &prefix, const std::string &suffix,
 LogDevice::impl::~impl() {
   write(&trailer[0], trailer.size());
   flushLine();
+  spareBuffer.swap(buffer);
 }
 
 
@@ -100,6 +109,13 @@ void LogDevice::impl::flushLine() {
   if (logger.getLogCRLF()) buffer.push_back('\r');
   buffer.push_back('\n');
 
+  if (logger.getLogAsync()) {
+    logger.writeLine(buffer);
+    buffer.clear();
+    startOfLine = true;
+    return;
+  }
+
   flush();
 
   logger.unlock();
@@ -113,6 +129,9 @@ bool LogDevice::impl::flush() {
 
   Logger &logger = Logger::instance();
 
+  // In async mode only whole lines are written
+  if (logger.getLogAsync()) return true;
+
   if (!locked) {
     logger.lock();
     locked = true;
@@ -33,6 +33,7 @@
 #include "Logger.h"
 
 #include "LogDevice.h"
+#include "AsyncLogWriter.h"
 
 #include <cbang/config.h>
 #include <cbang/Exception.h>
@@ -69,6 +70,33 @@ using namespace cb;
 #endif
 
 
+namespace {
+  // Sets an option target and invalidates cached log level checks
+  template <typename T>
+  class LevelOptionAction : public OptionActionSet<T> {
+  public:
+    LevelOptionAction(T &ref) : OptionActionSet<T>(ref) {}
+
+    int operator()(Option &option) {
+      OptionActionSet<T>::operator()(option);
+      Logger::levelsChanged();
+      return 0;
+    }
+  };
+
+
+  template <typename T>
+  void setLevelAction(const SmartPointer<Option> &option, T &target) {
+    SmartPointer<OptionActionBase> action = new LevelOptionAction<T>(target);
+    option->setAction(action);
+    option->setDefaultSetAction(action);
+  }
+}
+
+
+atomic<unsigned> Logger::generation(1);
+
+
 Logger::Logger(Inaccessible) :
   verbosity(DEFAULT_VERBOSITY), logCRLF(false),
 #ifdef DEBUG
@@ -81,6 +109,8 @@ Logger::Logger(Inaccessible) :
   logSimpleDomains(true), logThreadID(false), logHeader(true),
   logNoInfoHeader(false), logColor(true), logToScreen(true), logTrunc(false),
   logRedirect(false), logRotate(true), logRotateMax(0), logRotateDir("logs"),
+  logAsync(false), logAsyncQueue(4096), logAsyncOverflow("block"),
+  logDropped(0),
   threadIDStorage(new ThreadLocalStorage<unsigned long>),
   threadPrefixStorage(new ThreadLocalStorage<string>),
   screenStream(SmartPointer<ostream>::Phony(&cout)), idWidth(1),
@@ -93,18 +123,23 @@ Logger::Logger(Inaccessible) :
 }
 
 
+Logger::~Logger() {setLogAsync(false);}
+
+
 void Logger::addOptions(Options &options) {
   options.pushCategory("Logging");
   options.add("log", "Set log file.");
-  options.addTarget("verbosity", verbosity, "Set logging level for INFO "
+  setLevelAction(options.addTarget("verbosity", verbosity, "Set logging level "
+                                   "for INFO "
 #ifdef DEBUG
-                    "and DEBUG "
+                                   "and DEBUG "
 #endif
-                    "messages.");
+                                   "messages."), verbosity);
   options.addTarget("log-crlf", logCRLF, "Print carriage return and line feed "
                     "at end of log lines.");
 #ifdef DEBUG
-  options.addTarget("log-debug", logDebug, "Disable or enable debugging info.");
+  setLevelAction(options.addTarget("log-debug", logDebug, "Disable or enable "
+                                   "debugging info."), logDebug);
 #endif
   options.addTarget("log-time", logTime,
                     "Print time information with log entries.");
@@ -121,10 +156,11 @@ void Logger::addOptions(Options &options) {
                     "Print thread prefixes, if set, with log entries.");
   options.addTarget("log-domain", logDomain,
                     "Print domain information with log entries.");
-  options.addTarget("log-simple-domains", logSimpleDomains, "Remove any "
-                    "leading directories and trailing file extensions from "
-                    "domains so that source code file names can be easily used "
-                    "as log domains.");
+  setLevelAction(options.addTarget("log-simple-domains", logSimpleDomains,
+                                   "Remove any leading directories and "
+                                   "trailing file extensions from domains so "
+                                   "that source code file names can be easily "
+                                   "used as log domains."), logSimpleDomains);
   options.add("log-domain-levels", 0,
               new OptionAction<Logger>(this, &Logger::domainLevelsAction),
               "Set log levels by domain.  Format is:\n"
@@ -162,12 +198,22 @@ void Logger::addOptions(Options &options) {
                     "Put rotated logs in this directory.");
   options.addTarget("log-rotate-max", logRotateMax,
                     "Maximum number of rotated logs to keep.");
+  options.addTarget("log-async", logAsync, "Write log messages from a "
+                    "separate thread so that logging threads do not wait on "
+                    "file or screen output.");
+  options.addTarget("log-async-queue", logAsyncQueue, "Maximum number of log "
+                    "lines waiting to be written in async mode.");
+  options.addTarget("log-async-overflow", logAsyncOverflow, "What to do when "
+                    "the async log queue is full.  One of 'block', 'drop' or "
+                    "'count'.  'count' drops lines but logs how many were "
+                    "lost.");
   options.popCategory();
 }
 
 
 void Logger::setOptions(Options &options) {
   if (options["log"].hasValue()) startLogFile(options["log"]);
+  if (logAsync) setLogAsync(true);
 }
 
 
@@ -184,6 +230,44 @@ void Logger::setScreenStream(ostream &stream) {
 
 void Logger::setScreenStream(const SmartPointer<std::ostream> &stream) {
   screenStream = stream;
+  updateAsyncTargets();
+}
+
+
+void Logger::setLogToScreen(bool x) {
+  logToScreen = x;
+  updateAsyncTargets();
+}
+
+
+void Logger::setLogAsync(bool x) {
+  if (x == getLogAsync()) return;
+
+  if (x) {
+    flush();
+    asyncWriter =
+      new AsyncLogWriter(logAsyncQueue,
+                         AsyncLogWriter::parseOverflow(logAsyncOverflow),
+                         logCRLF);
+    if (!logFilename.empty()) asyncWriter->openFile(logFilename);
+    updateAsyncTargets();
+    asyncWriter->start();
+
+  } else {
+    SmartPointer<AsyncLogWriter> writer = asyncWriter;
+    asyncWriter.release();
+
+    writer->join();
+    writer->drain();
+    logDropped += writer->getDropped();
+  }
+
+  logAsync = x;
+}
+
+
+uint64_t Logger::getLogDropped() const {
+  return logDropped + (asyncWriter.isNull() ? 0 : asyncWriter->getDropped());
 }
 
 
@@ -198,6 +282,8 @@ void Logger::startLogFile(const string &filename) {
            << (logCRLF ? "\r\n" : "\n");
   logFile->flush();
   lastDate = Time::now();
+  logFilename = filename;
+  if (!asyncWriter.isNull()) asyncWriter->openFile(filename);
 
   if (logRedirect) {
     setLogToScreen(false);
@@ -245,9 +331,14 @@ void Logger::setLogDomainLevels(const string &levels) {
       }
     }
 
-    if (invalid) THROW("Invalid log domain level entry " << (i + 1)
-                        << " '" << entries[i] << "'");
+    if (invalid) {
+      levelsChanged(); // Earlier entries were applied
+      THROW("Invalid log domain level entry " << (i + 1) << " '"
+            << entries[i] << "'");
+    }
   }
+
+  levelsChanged();
 }
 
 
@@ -450,6 +541,11 @@ Logger::LogStream Logger::createStream(const string &_domain, int level,
 
 
 streamsize Logger::write(const char *s, streamsize n) {
+  if (!asyncWriter.isNull()) {
+    asyncWriter->push(s, n);
+    return n;
+  }
+
   if (!logFile.isNull()) logFile->write(s, n);
   if (logToScreen && !screenStream.isNull()) screenStream->write(s, n);
   return n;
@@ -459,8 +555,21 @@ streamsize Logger::write(const char *s, streamsize n) {
 void Logger::write(const string &s) {write(s.c_str(), s.length());}
 
 
+void Logger::writeLine(vector<char> &line) {
+  if (asyncWriter.isNull()) THROW("Async logging not enabled");
+  asyncWriter->push(line);
+}
+
+
 bool Logger::flush() {
+  if (!asyncWriter.isNull()) return true;
   if (!logFile.isNull()) logFile->flush();
   if (logToScreen && !screenStream.isNull()) screenStream->flush();
   return true;
 }
+
+
+void Logger::updateAsyncTargets() {
+  if (asyncWriter.isNull()) return;
+  asyncWriter->setScreen(logToScreen ? screenStream : 0);
+}
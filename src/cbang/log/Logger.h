@@ -36,6 +36,8 @@
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
+#include <atomic>
 
 #include <cbang/SStream.h>
 #include <cbang/SmartPointer.h>
@@ -49,6 +51,7 @@ namespace cb {
   class Option;
   class Options;
   class CommandLine;
+  class AsyncLogWriter;
   template <typename T> class ThreadLocalStorage;
 
   /**
@@ -92,6 +95,10 @@ namespace cb {
     bool logRotate;
     unsigned logRotateMax;
     std::string logRotateDir;
+    bool logAsync;
+    unsigned logAsyncQueue;
+    std::string logAsyncOverflow;
+    uint64_t logDropped;
 
     uint64_t errorCount;
     uint64_t warningCount;
@@ -102,6 +109,8 @@ namespace cb {
 
     SmartPointer<std::iostream> logFile;
     SmartPointer<std::ostream> screenStream;
+    SmartPointer<AsyncLogWriter> asyncWriter;
+    std::string logFilename;
 
     mutable unsigned idWidth;
 
@@ -114,8 +123,11 @@ namespace cb {
 
     uint64_t lastDate;
 
+    static std::atomic<unsigned> generation;
+
   public:
     Logger(Inaccessible);
+    ~Logger();
 
     void addOptions(Options &options);
     void setOptions(Options &options);
@@ -135,8 +147,8 @@ namespace cb {
      * Set the logging verbosity level.
      * @param verbosity The level.
      */
-    void setVerbosity(unsigned x) {verbosity = x;}
-    void setLogDebug(bool x) {logDebug = x;}
+    void setVerbosity(unsigned x) {verbosity = x; levelsChanged();}
+    void setLogDebug(bool x) {logDebug = x; levelsChanged();}
     void setLogCRLF(bool x) {logCRLF = x;}
     void setLogTime(bool x) {logTime = x;}
     void setLogDate(bool x) {logDate = x;}
@@ -144,16 +156,26 @@ namespace cb {
     void setLogLevel(bool x) {logLevel = x;}
     void setLogThreadPrefix(bool x) {logThreadPrefix = x;}
     void setLogDomain(bool x) {logDomain = x;}
-    void setLogSimpleDomains(bool x) {logSimpleDomains = x;}
+    void setLogSimpleDomains(bool x) {logSimpleDomains = x; levelsChanged();}
     void setLogThreadID(bool x) {logThreadID = x;}
     void setLogNoInfoHeader(bool x) {logNoInfoHeader = x;}
     void setLogHeader(bool x) {logHeader = x;}
     void setLogColor(bool x) {logColor = x;}
-    void setLogToScreen(bool x) {logToScreen = x;}
+    void setLogToScreen(bool x);
     void setLogTruncate(bool x) {logTrunc = x;}
     void setLogRedirect(bool x) {logRedirect = x;}
     void setLogRotate(bool x) {logRotate = x;}
     void setLogRotateMax(unsigned x) {logRotateMax = x;}
+    void setLogAsyncQueue(unsigned x) {logAsyncQueue = x;}
+    void setLogAsyncOverflow(const std::string &x) {logAsyncOverflow = x;}
+
+    /**
+     * Write log lines from a separate thread.  Should be enabled before and
+     * disabled after other threads are logging.
+     */
+    void setLogAsync(bool x);
+    bool getLogAsync() const {return !asyncWriter.isNull();}
+    uint64_t getLogDropped() const;
     void setLogDomainLevels(const std::string &levels);
 
     unsigned getVerbosity() const {return verbosity;}
@@ -171,6 +193,11 @@ namespace cb {
     const char *startColor(int level) const;
     const char *endColor(int level) const;
 
+    /// Invalidates the enabled() results cached at each log callsite
+    static void levelsChanged() {generation++;}
+    static unsigned getGeneration()
+    {return generation.load(std::memory_order_acquire);}
+
     // These functions should not be called directly.  Use the macros.
     bool enabled(const std::string &domain, int level) const;
     typedef SmartPointer<std::ostream> LogStream;
@@ -180,10 +207,40 @@ namespace cb {
   protected:
     std::streamsize write(const char *s, std::streamsize n);
     void write(const std::string &s);
+    /// Queue a complete line in async mode.  @param line may be swapped.
+    void writeLine(std::vector<char> &line);
     bool flush();
+    void updateAsyncTargets();
 
     friend class LogDevice;
   };
+
+
+  /**
+   * Caches Logger::enabled() for one log statement.  The result is valid
+   * until Logger::levelsChanged() is called so the disabled case does not
+   * touch the Logger at all.  The generation, level and result are packed
+   * into one word so concurrent updates cannot tear.
+   */
+  class LogSite {
+    std::atomic<uint64_t> state;
+
+  public:
+    constexpr LogSite() : state(0) {}
+
+    template <typename T>
+    bool enabled(const T &domain, int level) {
+      // Levels never use bit 0 so it holds the result
+      uint64_t key =
+        (uint64_t)Logger::getGeneration() << 32 | (uint32_t)(level & ~1);
+      uint64_t s = state.load(std::memory_order_relaxed);
+      if ((s & ~(uint64_t)1) == key) return s & 1;
+
+      bool enabled = Logger::instance().enabled(domain, level);
+      state.store(key | enabled, std::memory_order_relaxed);
+      return enabled;
+    }
+  };
 }
 
 #ifndef CBANG_LOG_DOMAIN
@@ -206,14 +263,22 @@ namespace cb {
 // Check if logging level is enabled
 #define CBANG_LOG_ENABLED(domain, level)        \
   cb::Logger::instance().enabled(domain, level)
+
+// Cached per callsite, domain must not change between calls
+#define CBANG_LOG_SITE_ENABLED(domain, level)                           \
+  ([&] () -> bool {                                                     \
+    static cb::LogSite _logSite;                                        \
+    return _logSite.enabled(domain, level);                             \
+  }())
+
 #ifdef DEBUG
-#define CBANG_LOG_DEBUG_ENABLED(x)                              \
-  CBANG_LOG_ENABLED(CBANG_LOG_DOMAIN, CBANG_LOG_DEBUG_LEVEL(x))
+#define CBANG_LOG_DEBUG_ENABLED(x)                                      \
+  CBANG_LOG_SITE_ENABLED(CBANG_LOG_DOMAIN, CBANG_LOG_DEBUG_LEVEL(x))
 #else
 #define CBANG_LOG_DEBUG_ENABLED(x) false
 #endif
-#define CBANG_LOG_INFO_ENABLED(x)                               \
-  CBANG_LOG_ENABLED(CBANG_LOG_DOMAIN, CBANG_LOG_INFO_LEVEL(x))
+#define CBANG_LOG_INFO_ENABLED(x)                                       \
+  CBANG_LOG_SITE_ENABLED(CBANG_LOG_DOMAIN, CBANG_LOG_INFO_LEVEL(x))
 
 
 // Create logger streams
@@ -244,7 +309,11 @@ namespace cb {
       *CBANG_LOG_STREAM(domain, level) CBANG_LOG_PREFIX << msg;       \
   } while (false)
 
-#define CBANG_LOG_LEVEL(level, msg) CBANG_LOG(CBANG_LOG_DOMAIN, level, msg)
+#define CBANG_LOG_LEVEL(level, msg)                                     \
+  do {                                                                  \
+    if (CBANG_LOG_SITE_ENABLED(CBANG_LOG_DOMAIN, level))                \
+      *CBANG_LOG_STREAM(CBANG_LOG_DOMAIN, level) CBANG_LOG_PREFIX << msg; \
+  } while (false)
 
 #define CBANG_LOG_RAW(msg)      CBANG_LOG_LEVEL(CBANG_LOG_RAW_LEVEL, msg)
 #define CBANG_LOG_ERROR(msg)    CBANG_LOG_LEVEL(CBANG_LOG_ERROR_LEVEL, msg)
@@ -32,35 +32,118 @@
 
 #include <cbang/net/IPAddressFilter.h>
 
+#include <cbang/util/SmartLock.h>
+
 using namespace std;
 using namespace cb;
 
 
+IPAddressFilter::IPAddressFilter() :
+  whiteList(new IPTrie), blackList(new IPTrie), whiteDirty(false),
+  blackDirty(false) {}
+
+
 void IPAddressFilter::deny(const string &spec) {
-  blackList.insert(spec);
+  SmartLock lock(this);
+  blackSpecs.insert(spec);
+  blackDirty = true;
 }
 
 
 void IPAddressFilter::allow(const string &spec) {
-  whiteList.insert(spec);
+  SmartLock lock(this);
+  whiteSpecs.insert(spec);
+  whiteDirty = true;
 }
 
 
 void IPAddressFilter::deny(IPAddressRange &range) {
-  blackList.insert(range);
+  SmartLock lock(this);
+  blackSpecs.insert(range);
+  blackDirty = true;
 }
 
 
 void IPAddressFilter::allow(IPAddressRange &range) {
-  whiteList.insert(range);
+  SmartLock lock(this);
+  whiteSpecs.insert(range);
+  whiteDirty = true;
+}
+
+
+void IPAddressFilter::denyFile(const string &path) {
+  SmartLock lock(this);
+  blackSpecs.read(path);
+  blackDirty = true;
+}
+
+
+void IPAddressFilter::allowFile(const string &path) {
+  SmartLock lock(this);
+  whiteSpecs.read(path);
+  whiteDirty = true;
+}
+
+
+void IPAddressFilter::reloadDeny(const string &path) {
+  // Build off to the side so lookups use the old list until the swap
+  IPTrie::Builder specs;
+  specs.read(path);
+  SmartPointer<IPTrie>::Protected list = specs.build();
+
+  SmartLock lock(this);
+  blackSpecs = specs;
+  blackList.set(list);
+  blackDirty = false;
+}
+
+
+void IPAddressFilter::reloadAllow(const string &path) {
+  IPTrie::Builder specs;
+  specs.read(path);
+  SmartPointer<IPTrie>::Protected list = specs.build();
+
+  SmartLock lock(this);
+  whiteSpecs = specs;
+  whiteList.set(list);
+  whiteDirty = false;
 }
 
 
 bool IPAddressFilter::isAllowed(const IPAddress &addr) const {
-  return whiteList.contains(addr) || !blackList.contains(addr);
+  return isExplicitlyAllowed(addr) ||
+    !getList(blackList, blackSpecs, blackDirty)->contains(addr);
+}
+
+
+bool IPAddressFilter::isAllowed(const IPTrie::Address &addr) const {
+  return isExplicitlyAllowed(addr) ||
+    !getList(blackList, blackSpecs, blackDirty)->contains(addr);
 }
 
 
 bool IPAddressFilter::isExplicitlyAllowed(const IPAddress &addr) const {
-  return whiteList.contains(addr);
+  return getList(whiteList, whiteSpecs, whiteDirty)->contains(addr);
+}
+
+
+bool IPAddressFilter::isExplicitlyAllowed(const IPTrie::Address &addr) const {
+  return getList(whiteList, whiteSpecs, whiteDirty)->contains(addr);
+}
+
+
+Snapshot<IPTrie>::ptr_t
+IPAddressFilter::getList(Snapshot<IPTrie> &list, const IPTrie::Builder &specs,
+                         atomic<bool> &dirty) const {
+  if (dirty) {
+    SmartLock lock(this);
+
+    // Another lookup may have rebuilt it while we waited
+    if (dirty) {
+      list.set(specs.build());
+      dirty = false;
+    }
+  }
+
+  return list.get();
 }
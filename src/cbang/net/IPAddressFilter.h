@@ -34,20 +34,38 @@
 
 #include <string>
 
-#include <cbang/net/IPRangeSet.h>
+#include <cbang/net/IPTrie.h>
+#include <cbang/os/Mutex.h>
+#include <cbang/util/Snapshot.h>
+
+#include <atomic>
 
 namespace cb {
   /**
    * Used to allow or deny clients by IP address.
    * Used a white (allow) and black (deny) list to filter IPs.
    *
-   * @see IPRangeSet
+   * Lists are compiled to IPTries.  A change only marks its list dirty and
+   * the next lookup rebuilds it, so many single adds cost one rebuild.
+   * Lookups may run in other threads while the lists are changed or
+   * reloaded but changes must not be made from more than one thread at a
+   * time.
+   *
+   * @see IPTrie
    */
-  class IPAddressFilter {
-    IPRangeSet whiteList;
-    IPRangeSet blackList;
+  class IPAddressFilter : public Mutex {
+    IPTrie::Builder whiteSpecs;
+    IPTrie::Builder blackSpecs;
+
+    mutable Snapshot<IPTrie> whiteList;
+    mutable Snapshot<IPTrie> blackList;
+
+    mutable std::atomic<bool> whiteDirty;
+    mutable std::atomic<bool> blackDirty;
 
   public:
+    IPAddressFilter();
+
     /// Add a IP address specification to the deny list.
     void deny(const std::string &spec);
     /// Add a IP address specification to the allow list.
@@ -58,10 +76,27 @@ namespace cb {
     /// Add a IP address range to the allow list.
     void allow(IPAddressRange &range);
 
+    /// Add IP address specifications from a file to the deny list.
+    void denyFile(const std::string &path);
+    /// Add IP address specifications from a file to the allow list.
+    void allowFile(const std::string &path);
+
+    /// Replace the deny list with the specifications in a file
+    void reloadDeny(const std::string &path);
+    /// Replace the allow list with the specifications in a file
+    void reloadAllow(const std::string &path);
+
     /// @return True if the IP address is allowed by the current rules.
     bool isAllowed(const IPAddress &addr) const;
+    bool isAllowed(const IPTrie::Address &addr) const;
 
     /// @return True if the IP address is in the white list
     bool isExplicitlyAllowed(const IPAddress &addr) const;
+    bool isExplicitlyAllowed(const IPTrie::Address &addr) const;
+
+  protected:
+    Snapshot<IPTrie>::ptr_t getList(Snapshot<IPTrie> &list,
+                                    const IPTrie::Builder &specs,
+                                    std::atomic<bool> &dirty) const;
   };
 }
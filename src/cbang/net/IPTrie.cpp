@@ -0,0 +1,361 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include "IPTrie.h"
+
+#include <cbang/Exception.h>
+#include <cbang/String.h>
+#include <cbang/os/SystemUtilities.h>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+using namespace std;
+using namespace cb;
+
+
+namespace {
+  inline unsigned popcount(uint64_t x) {
+#ifdef _MSC_VER
+    return (unsigned)__popcnt64(x);
+#else
+    return __builtin_popcountll(x);
+#endif
+  }
+
+
+  const uint8_t ipv4Prefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+}
+
+
+IPTrie::Address::Address() {memset(bytes, 0, 16);}
+
+
+IPTrie::Address::Address(uint32_t ipv4) {
+  memcpy(bytes, ipv4Prefix, 12);
+  bytes[12] = ipv4 >> 24;
+  bytes[13] = ipv4 >> 16;
+  bytes[14] = ipv4 >> 8;
+  bytes[15] = ipv4;
+}
+
+
+IPTrie::Address::Address(const IPAddress &ip) : Address(ip.getIP()) {}
+
+
+IPTrie::Address IPTrie::Address::parse(const string &s) {
+  Address addr;
+  if (!parse(s, addr)) THROW("Invalid IP address '" << s << "'");
+  return addr;
+}
+
+
+bool IPTrie::Address::parse(const string &s, Address &addr) {
+  if (s.find(':') != string::npos)
+    return inet_pton(AF_INET6, s.c_str(), addr.bytes) == 1;
+
+  struct in_addr in;
+  if (inet_pton(AF_INET, s.c_str(), &in) != 1) return false;
+  addr = Address((uint32_t)ntohl(in.s_addr));
+  return true;
+}
+
+
+bool IPTrie::Address::fromSockAddr(const sockaddr *sa, Address &addr) {
+  switch (sa->sa_family) {
+  case AF_INET:
+    addr = Address((uint32_t)ntohl(((sockaddr_in *)sa)->sin_addr.s_addr));
+    return true;
+
+  case AF_INET6:
+    memcpy(addr.bytes, &((sockaddr_in6 *)sa)->sin6_addr, 16);
+    return true;
+
+  default: return false;
+  }
+}
+
+
+bool IPTrie::Address::isIPv4() const {
+  return !memcmp(bytes, ipv4Prefix, 12);
+}
+
+
+string IPTrie::Address::toString() const {
+  if (isIPv4())
+    return IPAddress::ipToString(
+      (uint32_t)bytes[12] << 24 | (uint32_t)bytes[13] << 16 |
+      (uint32_t)bytes[14] << 8 | bytes[15]);
+
+  char buf[INET6_ADDRSTRLEN];
+  if (!inet_ntop(AF_INET6, (void *)bytes, buf, sizeof(buf)))
+    THROW("Failed to format IPv6 address");
+
+  return buf;
+}
+
+
+bool IPTrie::Address::operator<(const Address &o) const {
+  return memcmp(bytes, o.bytes, 16) < 0;
+}
+
+
+bool IPTrie::Address::operator==(const Address &o) const {
+  return !memcmp(bytes, o.bytes, 16);
+}
+
+
+IPTrie::Range::Range(const Address &start, const Address &end) :
+  start(start), end(end) {
+  if (end < start) swap(this->start, this->end);
+}
+
+
+IPTrie::Range::Range(const IPAddressRange &range) :
+  start(range.getStart()), end(range.getEnd()) {}
+
+
+IPTrie::Range IPTrie::Range::parse(const string &_spec) {
+  string spec = String::trim(_spec);
+  if (spec.find(':') == string::npos) return IPAddressRange(spec);
+
+  size_t dash = spec.find('-');
+  if (dash != string::npos)
+    return Range(Address::parse(String::trim(spec.substr(0, dash))),
+                 Address::parse(String::trim(spec.substr(dash + 1))));
+
+  size_t slash = spec.find('/');
+  if (slash == string::npos) {
+    Address addr = Address::parse(spec);
+    return Range(addr, addr);
+  }
+
+  Address start = Address::parse(spec.substr(0, slash));
+  unsigned bits = String::parseU8(spec.substr(slash + 1));
+  if (128 < bits) THROW("Invalid IPv6 bit mask /" << bits);
+
+  Address end = start;
+  for (unsigned i = 0; i < 16; i++) {
+    unsigned keep = bits < i * 8 ? 0 : min(8U, bits - i * 8);
+    uint8_t mask = keep ? (uint8_t)(0xff << (8 - keep)) : 0;
+
+    start.bytes[i] &= mask;
+    end.bytes[i] = start.bytes[i] | (uint8_t)~mask;
+  }
+
+  return Range(start, end);
+}
+
+
+void IPTrie::Builder::insert(const string &spec) {
+  vector<string> tokens;
+  String::tokenize(spec, tokens, " \r\n\t,;");
+
+  for (unsigned i = 0; i < tokens.size(); i++)
+    insert(Range::parse(tokens[i]));
+}
+
+
+void IPTrie::Builder::read(istream &stream) {
+  string line;
+
+  while (getline(stream, line)) {
+    size_t comment = line.find('#');
+    if (comment != string::npos) line = line.substr(0, comment);
+    insert(line);
+  }
+}
+
+
+void IPTrie::Builder::read(const string &path) {
+  read(*SystemUtilities::iopen(path));
+}
+
+
+SmartPointer<IPTrie>::Protected IPTrie::Builder::build() const {
+  // Sort and merge overlapping ranges
+  vector<Range> ranges(this->ranges);
+
+  sort(ranges.begin(), ranges.end(),
+       [] (const Range &a, const Range &b) {return a.start < b.start;});
+
+  unsigned count = 0;
+  for (unsigned i = 0; i < ranges.size(); i++)
+    if (count && ranges[i].start <= ranges[count - 1].end) {
+      if (ranges[count - 1].end < ranges[i].end)
+        ranges[count - 1].end = ranges[i].end;
+
+    } else ranges[count++] = ranges[i];
+
+  ranges.resize(count);
+
+  SmartPointer<IPTrie>::Protected trie = new IPTrie;
+  trie->ranges = count;
+
+  Address prefix;
+  trie->build(ranges, 0, count, prefix, 0, 0);
+
+  // Find the IPv4 subtree
+  uint32_t node = 0;
+  for (unsigned depth = 0; depth < 12; depth++) {
+    const Node &n = trie->nodes[node];
+    unsigned slot = ipv4Prefix[depth];
+    unsigned w = slot >> 6;
+    uint64_t bit = (uint64_t)1 << (slot & 63);
+
+    if (!(n.children[w] & bit)) {
+      trie->ipv4Root = ~0;
+      trie->ipv4Value = n.values[w] & bit;
+      return trie;
+    }
+
+    node = n.base[w] + popcount(n.children[w] & (bit - 1));
+  }
+
+  trie->ipv4Root = node;
+  return trie;
+}
+
+
+IPTrie::IPTrie() : nodes(1), ranges(0), ipv4Root(~0), ipv4Value(false) {
+  memset(&nodes[0], 0, sizeof(Node));
+}
+
+
+bool IPTrie::contains(uint32_t ipv4) const {
+  if (ipv4Root == (uint32_t)~0) return ipv4Value;
+
+  uint8_t key[4] = {
+    (uint8_t)(ipv4 >> 24), (uint8_t)(ipv4 >> 16), (uint8_t)(ipv4 >> 8),
+    (uint8_t)ipv4};
+
+  return lookup(key, ipv4Root);
+}
+
+
+bool IPTrie::contains(const Address &addr) const {
+  return lookup(addr.bytes, 0);
+}
+
+
+bool IPTrie::contains(const sockaddr *sa) const {
+  Address addr;
+  return Address::fromSockAddr(sa, addr) && contains(addr);
+}
+
+
+bool IPTrie::lookup(const uint8_t *key, uint32_t node) const {
+  // Terminates because slots at the last address byte are never partial
+  while (true) {
+    const Node &n = nodes[node];
+    unsigned slot = *key++;
+    unsigned w = slot >> 6;
+    uint64_t bit = (uint64_t)1 << (slot & 63);
+
+    if (!(n.children[w] & bit)) return n.values[w] & bit;
+    node = n.base[w] + popcount(n.children[w] & (bit - 1));
+  }
+}
+
+
+void IPTrie::build(const vector<Range> &ranges, unsigned first,
+                   unsigned last, Address &prefix, unsigned depth,
+                   uint32_t index) {
+  struct Child {
+    unsigned slot;
+    unsigned first;
+    unsigned last;
+  };
+
+  vector<Child> children;
+  Node node;
+  memset(&node, 0, sizeof(node));
+
+  // The span of each slot
+  Address lo = prefix;
+  Address hi = prefix;
+  for (unsigned i = depth + 1; i < 16; i++) hi.bytes[i] = 0xff;
+
+  unsigned k = first;
+  for (unsigned slot = 0; slot < 256; slot++) {
+    lo.bytes[depth] = hi.bytes[depth] = slot;
+
+    while (k < last && ranges[k].end < lo) k++;
+    if (k == last || hi < ranges[k].start) continue; // Outside
+
+    unsigned w = slot >> 6;
+    uint64_t bit = (uint64_t)1 << (slot & 63);
+
+    if (ranges[k].start <= lo && hi <= ranges[k].end) {
+      node.values[w] |= bit; // Inside
+      continue;
+    }
+
+    // Partially covered
+    unsigned m = k;
+    while (m < last && ranges[m].start <= hi) m++;
+
+    node.children[w] |= bit;
+    children.push_back(Child{slot, k, m});
+
+    // The last range may continue in to the next slot
+    k = m - 1;
+  }
+
+  // Children are stored contiguously
+  uint32_t base = nodes.size();
+  nodes.resize(base + children.size());
+
+  for (unsigned w = 0; w < 4; w++) {
+    node.base[w] = base;
+    base += popcount(node.children[w]);
+  }
+
+  nodes[index] = node;
+
+  for (unsigned i = 0; i < children.size(); i++) {
+    prefix.bytes[depth] = children[i].slot;
+    build(ranges, children[i].first, children[i].last, prefix, depth + 1,
+          node.base[0] + i);
+  }
+
+  prefix.bytes[depth] = 0;
+}
@@ -0,0 +1,143 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include <cbang/SmartPointer.h>
+#include <cbang/net/IPAddressRange.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+struct sockaddr;
+
+
+namespace cb {
+  /**
+   * A compressed multibit trie over IPv4 and IPv6 address ranges.  Each
+   * node covers one byte of the address and stores 256 bit bitmaps of its
+   * children and of the slots wholly inside the set, so a lookup costs at
+   * most one node per address byte plus a popcount.
+   *
+   * IPv4 addresses are stored as IPv4 mapped IPv6 addresses, ::ffff:0:0/96.
+   * A built trie is never modified so it may be shared between threads.
+   */
+  class IPTrie {
+  public:
+    struct Address {
+      uint8_t bytes[16]; // Network byte order
+
+      Address();
+      explicit Address(uint32_t ipv4);
+      explicit Address(const IPAddress &ip);
+
+      static Address parse(const std::string &s);
+      static bool parse(const std::string &s, Address &addr);
+      static bool fromSockAddr(const sockaddr *sa, Address &addr);
+
+      bool isIPv4() const;
+      std::string toString() const;
+
+      bool operator<(const Address &o) const;
+      bool operator<=(const Address &o) const {return !(o < *this);}
+      bool operator==(const Address &o) const;
+    };
+
+
+    struct Range {
+      Address start;
+      Address end;
+
+      Range() {}
+      Range(const Address &start, const Address &end);
+      Range(const IPAddressRange &range);
+
+      /// IPv4 specs are parsed by IPAddressRange, IPv6 specs have the form
+      /// <addr>, <addr>/<bits> or <addr>-<addr>
+      static Range parse(const std::string &spec);
+    };
+
+
+    class Builder {
+      std::vector<Range> ranges;
+
+    public:
+      void clear() {ranges.clear();}
+      bool empty() const {return ranges.empty();}
+      unsigned size() const {return ranges.size();}
+
+      void insert(const std::string &spec);
+      void insert(const IPAddressRange &range) {insert(Range(range));}
+      void insert(const Range &range) {ranges.push_back(range);}
+
+      /// One or more specs per line, '#' starts a comment
+      void read(std::istream &stream);
+      void read(const std::string &path);
+
+      SmartPointer<IPTrie>::Protected build() const;
+    };
+
+
+  private:
+    struct Node {
+      uint64_t children[4]; // Slots with a child node
+      uint64_t values[4];   // Slots wholly inside the set
+      uint32_t base[4];     // Index of the first child for each word
+    };
+
+    std::vector<Node> nodes;
+    unsigned ranges;
+
+    // Node for ::ffff:0:0/96 or ~0 if all of IPv4 is in or out of the set
+    uint32_t ipv4Root;
+    bool ipv4Value;
+
+  public:
+    IPTrie();
+
+    bool empty() const {return !ranges;}
+    unsigned getRangeCount() const {return ranges;}
+    unsigned getNodeCount() const {return nodes.size();}
+
+    bool contains(uint32_t ipv4) const;
+    bool contains(const IPAddress &ip) const {return contains(ip.getIP());}
+    bool contains(const Address &addr) const;
+    bool contains(const sockaddr *sa) const;
+
+  protected:
+    bool lookup(const uint8_t *key, uint32_t node) const;
+    void build(const std::vector<Range> &ranges, unsigned first,
+               unsigned last, Address &prefix, unsigned depth,
+               uint32_t index);
+  };
+}
@@ -33,6 +33,7 @@
 #include "Session.h"
 
 #include <cbang/json/JSON.h>
+#include <cbang/util/SmartLock.h>
 
 using namespace std;
 using namespace cb;
@@ -53,23 +54,27 @@ Session::Session(const string &id, const IPAddress &ip) {
 }
 
 
-uint64_t Session::getCreationTime() const {
-  return Time::parse(getString("created"));
+void Session::setID(const string &id) {
+  SmartLock lock(this);
+  insert("id", id);
 }
 
 
-void Session::setCreationTime(uint64_t creationTime) {
-  insert("created", Time(creationTime).toString());
+void Session::setUser(const string &user) {
+  SmartLock lock(this);
+  insert("user", user);
 }
 
 
-uint64_t Session::getLastUsed() const {
-  return Time::parse(getString("last_used"));
+IPAddress Session::getIP() const {
+  SmartLock lock(this);
+  return getString("ip");
 }
 
 
-void Session::setLastUsed(uint64_t lastUsed) {
-  insert("last_used", Time(lastUsed).toString());
+void Session::setIP(const IPAddress &ip) {
+  SmartLock lock(this);
+  insert("ip", ip.toString());
 }
 
 
@@ -80,16 +85,51 @@ void Session::matchIP(const IPAddress &ip) const {
 
 
 bool Session::hasGroup(const string &group) const {
+  SmartLock lock(this);
   return get("group")->getBoolean(group, false);
 }
 
 
 void Session::addGroup(const string &group) {
+  SmartLock lock(this);
   get("group")->insertBoolean(group, true);
 }
 
 
+void Session::setData(const string &data) {
+  read(*JSON::Reader::parseString(data));
+}
+
+
 void Session::read(const JSON::Value &value) {
-  for (unsigned i = 0; i < value.size(); i++)
-    insert(value.keyAt(i), value.get(i));
+  SmartLock lock(this);
+
+  for (unsigned i = 0; i < value.size(); i++) {
+    const string &key = value.keyAt(i);
+
+    if (key == "created") created = Time::parse(value.getString(i));
+    else if (key == "last_used") lastUsed = Time::parse(value.getString(i));
+    else if (key == "timeout") timeout = value.getU64(i);
+    else if (key == "lifetime") lifetime = value.getU64(i);
+    else insert(key, value.get(i));
+  }
+}
+
+
+void Session::write(JSON::Sink &sink) const {
+  SmartLock lock(this);
+
+  sink.beginDict();
+
+  for (unsigned i = 0; i < size(); i++) {
+    sink.beginInsert(keyAt(i));
+    get(i)->write(sink);
+  }
+
+  sink.insert("created", Time(created).toString());
+  sink.insert("last_used", Time(lastUsed).toString());
+  if (hasTimeout()) sink.insert("timeout", getTimeout());
+  if (hasLifetime()) sink.insert("lifetime", getLifetime());
+
+  sink.endDict();
 }
@@ -37,39 +37,65 @@
 #include <cbang/json/Serializable.h>
 #include <cbang/json/Dict.h>
 #include <cbang/time/Time.h>
+#include <cbang/os/Mutex.h>
 
 #include <string>
 #include <set>
+#include <atomic>
 
 
 namespace cb {
-  class Session : public JSON::Dict {
+  /**
+   * Sessions shared through a SessionManager are used from many threads.
+   * The expiry fields are atomic.  The methods below hold the Session's lock
+   * while they access the Dict.  Other code changing a shared Session's Dict
+   * must hold the lock too.
+   */
+  class Session : public JSON::Dict, public Mutex {
+    // Expiry fields are native so checks need no lookups or parsing
+    std::atomic<uint64_t> created{0};
+    std::atomic<uint64_t> lastUsed{0};
+    std::atomic<int64_t> timeout{-1}; // -1 uses the SessionManager default
+    std::atomic<int64_t> lifetime{-1};
+
   public:
     Session(const JSON::Value &value);
     Session(const std::string &id, const IPAddress &ip);
 
     const std::string &getID() const {return getString("id");}
-    void setID(const std::string &id) {insert("id", id);}
+    void setID(const std::string &id);
 
-    uint64_t getCreationTime() const;
-    void setCreationTime(uint64_t creationTime);
+    uint64_t getCreationTime() const {return created;}
+    void setCreationTime(uint64_t creationTime) {created = creationTime;}
 
     void touch() {setLastUsed(Time::now());}
-    uint64_t getLastUsed() const;
-    void setLastUsed(uint64_t lastUsed);
+    uint64_t getLastUsed() const {return lastUsed;}
+    void setLastUsed(uint64_t lastUsed) {this->lastUsed = lastUsed;}
+
+    bool hasTimeout() const {return 0 <= timeout;}
+    uint64_t getTimeout() const {return timeout;}
+    void setTimeout(uint64_t timeout) {this->timeout = timeout;}
+
+    bool hasLifetime() const {return 0 <= lifetime;}
+    uint64_t getLifetime() const {return lifetime;}
+    void setLifetime(uint64_t lifetime) {this->lifetime = lifetime;}
 
     bool hasUser() const {return hasString("user");}
     const std::string &getUser() const {return getString("user");}
-    void setUser(const std::string &user) {insert("user", user);}
+    void setUser(const std::string &user);
 
-    IPAddress getIP() const {return getString("ip");}
-    void setIP(const IPAddress &ip) {insert("ip", ip.toString());}
+    IPAddress getIP() const;
+    void setIP(const IPAddress &ip);
     void matchIP(const IPAddress &ip) const;
 
     bool hasGroup(const std::string &group) const;
     void addGroup(const std::string &group);
 
+    /// The whole session as compact JSON, for SessionsTable
+    std::string getData() const {return toString(0, true);}
+    void setData(const std::string &data);
+
     void read(const JSON::Value &value);
-    void write(JSON::Sink &sink) const {JSON::Dict::write(sink);}
+    void write(JSON::Sink &sink) const;
   };
 }
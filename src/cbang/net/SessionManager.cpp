@@ -35,7 +35,10 @@
 #include <cbang/config.h>
 #include <cbang/config/Options.h>
 #include <cbang/util/Random.h>
+#include <cbang/util/SmartLock.h>
 #include <cbang/json/JSON.h>
+#include <cbang/db/Database.h>
+#include <cbang/db/Transaction.h>
 
 #ifdef HAVE_OPENSSL
 #include <cbang/openssl/Digest.h>
@@ -47,6 +50,9 @@ using namespace cb;
 using namespace std;
 
 
+SessionManager::Shard::Shard() : wheel(Time::now()) {}
+
+
 SessionManager::SessionManager() :
   lifetime(Time::SEC_PER_DAY), timeout(Time::SEC_PER_HOUR), cookie("sid") {}
 
@@ -87,40 +93,93 @@ string SessionManager::generateID(const IPAddress &ip) {
 }
 
 
-bool SessionManager::isExpired(const Session &session) const {
-  uint64_t now = Time::now();
-  uint64_t timeout = session.getU64("timeout", this->timeout);
-  uint64_t lifetime = session.getU64("lifetime", this->lifetime);
+uint64_t SessionManager::getExpiration(const Session &session) const {
+  uint64_t timeout =
+    session.hasTimeout() ? session.getTimeout() : this->timeout;
+  uint64_t lifetime =
+    session.hasLifetime() ? session.getLifetime() : this->lifetime;
+  uint64_t expires = 0;
+
+  if (timeout) expires = session.getLastUsed() + timeout;
 
-  return (timeout && session.getLastUsed() + timeout < now) ||
-    (lifetime && session.getCreationTime() + lifetime < now);
+  if (lifetime) {
+    uint64_t end = session.getCreationTime() + lifetime;
+    if (!expires || end < expires) expires = end;
+  }
+
+  return expires;
+}
+
+
+bool SessionManager::isExpired(const Session &session) const {
+  uint64_t expires = getExpiration(session);
+  return expires && expires < Time::now();
 }
 
 
 bool SessionManager::hasSession(const string &sid) const {
-  sessions_t::const_iterator it = sessions.find(sid);
-  return it != sessions.end() && !isExpired(*it->second);
+  Shard &shard = getShard(sid);
+  SmartLock lock(&shard);
+
+  auto it = shard.sessions.find(sid);
+  return it != shard.sessions.end() && !isExpired(*it->second.session);
 }
 
 
-SmartPointer<Session> SessionManager::lookupSession(const string &sid) const {
-  iterator it = sessions.find(sid);
-  if (it == end()) THROW("Session ID '" << sid << "' does not exist");
-  if (isExpired(*it->second))
-    THROW("Session ID '" << sid << "' has expired, last_used="
-           << Time(it->second->getLastUsed()).toString() << " created="
-           << Time(it->second->getCreationTime()).toString() << " now="
-           << Time().toString());
+SessionManager::SessionPtr
+SessionManager::findSession(const string &sid) const {
+  Shard &shard = getShard(sid);
+  SmartLock lock(&shard);
+
+  auto it = shard.sessions.find(sid);
+  if (it == shard.sessions.end()) return 0;
+
+  Entry &entry = it->second;
+  if (isExpired(*entry.session)) {
+    remove(shard, it);
+    return 0;
+  }
+
+  entry.session->touch(); // Update timestamp
+  if (writeBehind) shard.dirty.insert(sid);
+
+  // Expire sooner if the session's timeout or lifetime was reduced
+  uint64_t expires = getExpiration(*entry.session);
+  if (expires && (!entry.scheduled || expires + 1 < entry.scheduled))
+    schedule(shard, entry);
+
+  return entry.session;
+}
+
+
+SessionManager::SessionPtr
+SessionManager::lookupSession(const string &sid) const {
+  {
+    Shard &shard = getShard(sid);
+    SmartLock lock(&shard);
+
+    auto it = shard.sessions.find(sid);
+    if (it == shard.sessions.end())
+      THROW("Session ID '" << sid << "' does not exist");
 
-  it->second->touch(); // Update timestamp
+    const Session &session = *it->second.session;
+    if (isExpired(session))
+      THROW("Session ID '" << sid << "' has expired, last_used="
+            << Time(session.getLastUsed()).toString() << " created="
+            << Time(session.getCreationTime()).toString() << " now="
+            << Time().toString());
+  }
+
+  SessionPtr session = findSession(sid);
+  if (session.isNull()) THROW("Session ID '" << sid << "' has expired");
 
-  return it->second;
+  return session;
 }
 
 
-SmartPointer<Session> SessionManager::openSession(const IPAddress &ip) {
+SessionManager::SessionPtr SessionManager::openSession(const IPAddress &ip) {
   // Create new session
-  SmartPointer<Session> session = new Session(generateID(ip), ip);
+  SessionPtr session = new Session(generateID(ip), ip);
 
   // Insert
   addSession(session);
@@ -129,28 +188,134 @@ SmartPointer<Session> SessionManager::openSession(const IPAddress &ip) {
 }
 
 
-void SessionManager::closeSession(const string &sid) {sessions.erase(sid);}
+void SessionManager::closeSession(const string &sid) {
+  Shard &shard = getShard(sid);
+  SmartLock lock(&shard);
 
+  // Its timer is dropped when it fires
+  auto it = shard.sessions.find(sid);
+  if (it != shard.sessions.end()) remove(shard, it);
+}
 
-void SessionManager::addSession(const SmartPointer<Session> &session) {
-  pair<sessions_t::iterator, bool> result =
-    sessions.insert(sessions_t::value_type(session->getID(), session));
 
-  if (!result.second) result.first->second = session;
+void SessionManager::addSession(const SessionPtr &session) {
+  insert(session, writeBehind);
 }
 
 
 void SessionManager::cleanup() {
-  // Remove expired Sessions
-  for (sessions_t::iterator it = sessions.begin(); it != sessions.end();)
-    if (isExpired(*it->second)) sessions.erase(it++);
-    else it++;
+  uint64_t now = Time::now();
+
+  // Only sessions whose timers are due are visited
+  for (unsigned i = 0; i < SHARDS; i++) {
+    Shard &shard = shards[i];
+    SmartLock lock(&shard);
+
+    shard.wheel.advance(now, [&] (const string &sid) {
+      auto it = shard.sessions.find(sid);
+      if (it == shard.sessions.end()) return;
+
+      // Skip timers replaced by an earlier one
+      Entry &entry = it->second;
+      if (shard.wheel.getCurrent() < entry.scheduled) return;
+
+      if (isExpired(*entry.session)) remove(shard, it);
+      else schedule(shard, entry);
+    });
+  }
+}
+
+
+unsigned SessionManager::getSessionCount() const {
+  unsigned count = 0;
+
+  for (unsigned i = 0; i < SHARDS; i++) {
+    SmartLock lock(&shards[i]);
+    count += shards[i].sessions.size();
+  }
+
+  return count;
+}
+
+
+SessionManager::snapshot_t SessionManager::getSessions() const {
+  snapshot_t sessions;
+
+  for (unsigned i = 0; i < SHARDS; i++) {
+    SmartLock lock(&shards[i]);
+
+    for (auto it = shards[i].sessions.begin();
+         it != shards[i].sessions.end(); it++)
+      sessions[it->first] = it->second.session;
+  }
+
+  return sessions;
+}
+
+
+void SessionManager::forEach(const callback_t &cb) const {
+  for (unsigned i = 0; i < SHARDS; i++) {
+    SmartLock lock(&shards[i]);
+
+    for (auto it = shards[i].sessions.begin();
+         it != shards[i].sessions.end(); it++)
+      cb(it->second.session);
+  }
+}
+
+
+void SessionManager::create(DB::Database &db) {table.create(db);}
+
+
+void SessionManager::load(DB::Database &db) {
+  SmartPointer<DB::Statement> readStmt = table.makeReadStmt(db);
+
+  while (readStmt->next()) {
+    SessionPtr session = new Session("", IPAddress());
+    table.readRow(readStmt, *session);
+    insert(session, false);
+  }
+}
+
+
+void SessionManager::save(DB::Database &db) {
+  SmartPointer<DB::Statement> writeStmt = table.makeWriteStmt(db);
+  SmartPointer<DB::Statement> deleteStmt =
+    db.prepare("DELETE FROM " + table.getEscapedName() + " WHERE id=?");
+  SmartPointer<DB::Transaction> transaction = db.begin();
+
+  for (unsigned i = 0; i < SHARDS; i++) {
+    Shard &shard = shards[i];
+    SmartLock lock(&shard);
+
+    for (auto it = shard.dirty.begin(); it != shard.dirty.end(); it++) {
+      auto it2 = shard.sessions.find(*it);
+      if (it2 == shard.sessions.end()) continue;
+
+      // Bind a consistent row
+      const Session &session = *it2->second.session;
+      SmartLock sessionLock(&session);
+      table.bindWriteStmt(writeStmt, session);
+      writeStmt->execute();
+    }
+
+    for (auto it = shard.removed.begin(); it != shard.removed.end(); it++) {
+      deleteStmt->reset();
+      deleteStmt->parameter(0).bind(*it);
+      deleteStmt->execute();
+    }
+
+    shard.dirty.clear();
+    shard.removed.clear();
+  }
+
+  db.commit();
 }
 
 
 void SessionManager::read(const JSON::Value &value) {
   for (unsigned i = 0; i < value.size(); i++) {
-    SmartPointer<Session> session = new Session(*value.get(i));
+    SessionPtr session = new Session(*value.get(i));
     session->setID(value.keyAt(i));
     addSession(session);
   }
@@ -160,10 +325,61 @@ void SessionManager::read(const JSON::Value &value) {
 void SessionManager::write(JSON::Sink &sink) const {
   sink.beginDict();
 
-  for (iterator it = begin(); it != end(); it++) {
-    sink.beginInsert(it->first);
-    it->second->write(sink);
+  for (unsigned i = 0; i < SHARDS; i++) {
+    SmartLock lock(&shards[i]);
+
+    for (auto it = shards[i].sessions.begin();
+         it != shards[i].sessions.end(); it++) {
+      sink.beginInsert(it->first);
+      it->second.session->write(sink);
+    }
   }
 
   sink.endDict();
 }
+
+
+SessionManager::Shard &SessionManager::getShard(const string &sid) const {
+  return shards[hash<string>()(sid) % SHARDS];
+}
+
+
+void SessionManager::schedule(Shard &shard, Entry &entry) const {
+  uint64_t expires = getExpiration(*entry.session);
+  if (!expires) {entry.scheduled = 0; return;}
+
+  uint64_t when = max(expires + 1, shard.wheel.getCurrent() + 1);
+  shard.wheel.add(when, entry.session->getID());
+  entry.scheduled = when;
+}
+
+
+void SessionManager::remove(Shard &shard, sessions_t::iterator it) const {
+  if (writeBehind) {
+    shard.dirty.erase(it->first);
+    shard.removed.insert(it->first);
+  }
+
+  shard.sessions.erase(it);
+}
+
+
+void SessionManager::insert(const SessionPtr &session, bool dirty) {
+  // A SessionPtr converted from an unprotected SmartPointer is not safe
+  RefCounter *counter = RefCounter::getRefPtr(session.get());
+  if (!counter || !counter->isProtected())
+    THROW("Session '" << session->getID() << "' is not protected");
+
+  const string &sid = session->getID();
+  Shard &shard = getShard(sid);
+  SmartLock lock(&shard);
+
+  Entry &entry = shard.sessions[sid];
+  entry.session = session;
+  schedule(shard, entry);
+
+  if (dirty) {
+    shard.removed.erase(sid);
+    shard.dirty.insert(sid);
+  }
+}
@@ -33,24 +33,70 @@
 #pragma once
 
 #include "Session.h"
+#include "SessionsTable.h"
 
 #include <cbang/SmartPointer.h>
+#include <cbang/os/Mutex.h>
+#include <cbang/util/TimerWheel.h>
 
 #include <string>
+#include <vector>
+#include <functional>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 
 namespace cb {
   class Options;
 
 
+  /**
+   * Sessions are spread over SHARDS hash maps, each with its own lock, so
+   * concurrent lookups rarely contend.  Each shard schedules its sessions
+   * on a TimerWheel so cleanup() only visits sessions that are due.  A due
+   * session which was used since it was scheduled is rescheduled.  Expired
+   * sessions found by a lookup are removed immediately.
+   *
+   * Sessions are shared between threads so they are held by protected
+   * SmartPointers.
+   *
+   * With write-behind enabled, changed and closed sessions are queued and
+   * written by save() in a single transaction.
+   */
   class SessionManager : public JSON::Serializable {
-    typedef std::map<std::string, SmartPointer<Session> > sessions_t;
-    sessions_t sessions;
+  public:
+    static const unsigned SHARDS = 64;
+
+    typedef SmartPointer<Session>::Protected SessionPtr;
+    typedef std::map<std::string, SessionPtr> snapshot_t;
+    typedef std::function<void (const SessionPtr &)> callback_t;
+
+  protected:
+    struct Entry {
+      SessionPtr session;
+      uint64_t scheduled = 0; // Time of this session's live timer
+    };
+
+    typedef std::unordered_map<std::string, Entry> sessions_t;
+
+    struct Shard : public Mutex {
+      sessions_t sessions;
+      TimerWheel<std::string> wheel;
+      std::unordered_set<std::string> dirty;
+      std::unordered_set<std::string> removed;
+
+      Shard();
+    };
+
+    mutable Shard shards[SHARDS];
 
     uint64_t lifetime;
     uint64_t timeout;
     std::string cookie;
+    bool writeBehind = false;
+
+    SessionsTable table;
 
   public:
     SessionManager();
@@ -67,22 +113,43 @@ namespace cb {
     const std::string &getSessionCookie() const {return cookie;}
     void setSessionCookie(const std::string &cookie) {this->cookie = cookie;}
 
+    bool getWriteBehind() const {return writeBehind;}
+    void setWriteBehind(bool writeBehind) {this->writeBehind = writeBehind;}
+
     std::string generateID(const IPAddress &ip);
 
+    /// @return the time after which @param session expires or zero for never
+    virtual uint64_t getExpiration(const Session &session) const;
     virtual bool isExpired(const Session &session) const;
     virtual bool hasSession(const std::string &sid) const;
-    virtual SmartPointer<Session> lookupSession(const std::string &sid) const;
-    virtual SmartPointer<Session> openSession(const IPAddress &ip);
+    /// @return the session, touched, or null if it is missing or expired
+    virtual SessionPtr findSession(const std::string &sid) const;
+    virtual SessionPtr lookupSession(const std::string &sid) const;
+    virtual SessionPtr openSession(const IPAddress &ip);
     virtual void closeSession(const std::string &sid);
-    virtual void addSession(const SmartPointer<Session> &session);
+    virtual void addSession(const SessionPtr &session);
     virtual void cleanup();
 
-    typedef sessions_t::const_iterator iterator;
-    iterator begin() const {return sessions.begin();}
-    iterator end() const {return sessions.end();}
+    unsigned getSessionCount() const;
+
+    /// A sorted copy of the session map, replaces begin()/end()
+    snapshot_t getSessions() const;
+    /// Calls @param cb for each session with its shard locked, unordered
+    void forEach(const callback_t &cb) const;
+
+    // Write-behind persistence
+    void create(DB::Database &db);
+    void load(DB::Database &db);
+    void save(DB::Database &db);
 
     // From JSON::Serializable
     void read(const JSON::Value &value);
     void write(JSON::Sink &sink) const;
+
+  protected:
+    Shard &getShard(const std::string &sid) const;
+    void schedule(Shard &shard, Entry &entry) const;
+    void remove(Shard &shard, sessions_t::iterator it) const;
+    void insert(const SessionPtr &session, bool dirty);
   };
 }
@@ -40,6 +40,10 @@
 #include "CRL.h"
 
 #include <cbang/Exception.h>
+#include <cbang/Catch.h>
+#include <cbang/String.h>
+#include <cbang/util/SmartLock.h>
+#include <cbang/time/Timer.h>
 
 // This avoids a conflict with OCSP_RESPONSE in wincrypt.h
 #ifdef OCSP_RESPONSE
@@ -52,6 +56,15 @@
 #include <openssl/x509.h>
 #include <openssl/x509_vfy.h>
 #include <openssl/opensslv.h>
+#include <openssl/rand.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#if 0x30000000L <= OPENSSL_VERSION_NUMBER
+#include <openssl/core_names.h>
+#endif
+
+#include <string.h>
 
 using namespace std;
 using namespace cb;
@@ -62,13 +75,40 @@ using namespace cb;
 #endif // OPENSSL_VERSION_NUMBER < 0x1010000fL
 
 
-SSLContext::SSLContext() : ctx(0) {
+namespace {
+  int sessionKeyIndex() {
+    static int index =
+      SSL_get_ex_new_index(0, 0, 0, 0, [] (void *, void *ptr, CRYPTO_EX_DATA *,
+                                           int, long, void *) {
+                             delete (string *)ptr;
+                           });
+    return index;
+  }
+
+
+#if 0x30000000L <= OPENSSL_VERSION_NUMBER
+  int ticketKeyCB(::SSL *ssl, unsigned char *name, unsigned char *iv,
+                  EVP_CIPHER_CTX *cipherCtx, EVP_MAC_CTX *hmacCtx, int enc) {
+#else
+  int ticketKeyCB(::SSL *ssl, unsigned char *name, unsigned char *iv,
+                  EVP_CIPHER_CTX *cipherCtx, HMAC_CTX *hmacCtx, int enc) {
+#endif
+    return SSLContext::ticketKeyCallback(ssl, name, iv, cipherCtx, hmacCtx,
+                                         enc);
+  }
+}
+
+
+SSLContext::SSLContext() :
+  ctx(0), serverHandshakes(0), serverResumed(0), clientHandshakes(0),
+  clientResumed(0) {
   cb::SSL::init();
 
   ctx = SSL_CTX_new(TLS_method());
   if (!ctx) THROW("Failed to create SSL context: " << cb::SSL::getErrorStr());
 
   SSL_CTX_set_default_passwd_cb(ctx, cb::SSL::passwordCallback);
+  SSL_CTX_set_app_data(ctx, this);
 
   // A session ID is required for session caching to work
   SSL_CTX_set_session_id_context(ctx, (unsigned char *)"cbang", 5);
@@ -76,6 +116,8 @@ SSLContext::SSLContext() : ctx(0) {
 
 
 SSLContext::~SSLContext() {
+  clearClientSessions();
+
   if (ctx) {
     SSL_CTX_free(ctx);
     ctx = 0;
@@ -273,3 +315,248 @@ void SSLContext::setCheckCRL(bool x) {
 
 long SSLContext::getOptions() const {return SSL_CTX_get_options(ctx);}
 void SSLContext::setOptions(long options) {SSL_CTX_set_options(ctx, options);}
+
+
+void SSLContext::setSessionCacheSize(unsigned size) {
+  SSL_CTX_sess_set_cache_size(ctx, size);
+
+  long mode = SSL_CTX_get_session_cache_mode(ctx);
+  if (size) mode |= SSL_SESS_CACHE_SERVER;
+  else mode &= ~SSL_SESS_CACHE_SERVER;
+  SSL_CTX_set_session_cache_mode(ctx, mode);
+}
+
+
+void SSLContext::setSessionTimeout(unsigned seconds) {
+  SSL_CTX_set_timeout(ctx, seconds);
+}
+
+
+void SSLContext::setSessionTickets(bool enable) {
+  if (enable) SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+  else SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+}
+
+
+void SSLContext::setTicketKeyLifetime(double seconds) {
+  ticketKeyLifetime = seconds;
+  if (seconds) rotateTicketKeys();
+}
+
+
+void SSLContext::addTicketKey(const string &key) {
+  TicketKey k;
+  if (key.length() != sizeof(k.name) + sizeof(k.aesKey) + sizeof(k.hmacKey))
+    THROW("Session ticket key must be 80 bytes");
+
+  memcpy(k.name, key.data(), sizeof(k.name));
+  memcpy(k.aesKey, key.data() + 16, sizeof(k.aesKey));
+  memcpy(k.hmacKey, key.data() + 48, sizeof(k.hmacKey));
+
+  addTicketKey(k);
+}
+
+
+void SSLContext::rotateTicketKeys() {
+  TicketKey k;
+
+  if (RAND_bytes(k.name, sizeof(k.name)) != 1 ||
+      RAND_bytes(k.aesKey, sizeof(k.aesKey)) != 1 ||
+      RAND_bytes(k.hmacKey, sizeof(k.hmacKey)) != 1)
+    THROW("Failed to generate session ticket key: "
+          << cb::SSL::getErrorStr());
+
+  addTicketKey(k);
+}
+
+
+void SSLContext::setClientSessionCache(bool enable, unsigned maxSessions) {
+  SmartLock lock(this);
+
+  clientSessions = enable;
+  maxClientSessions = maxSessions;
+
+  long mode = SSL_CTX_get_session_cache_mode(ctx);
+  if (enable) mode |= SSL_SESS_CACHE_CLIENT;
+  else mode &= ~SSL_SESS_CACHE_CLIENT;
+  SSL_CTX_set_session_cache_mode(ctx, mode);
+
+  if (enable) SSL_CTX_sess_set_new_cb(ctx, newSessionCallback);
+  else SSL_CTX_sess_set_new_cb(ctx, 0);
+}
+
+
+void SSLContext::setClientSession(_SSL *ssl, const string &host,
+                                  unsigned port) {
+  if (!clientSessions) return;
+
+  string key = host + ":" + String(port);
+  delete (string *)SSL_get_ex_data(ssl, sessionKeyIndex());
+  SSL_set_ex_data(ssl, sessionKeyIndex(), new string(key));
+
+  SmartLock lock(this);
+
+  auto it = sessions.find(key);
+  if (it != sessions.end() && !SSL_set_session(ssl, it->second))
+    THROW("Failed to set SSL session: " << cb::SSL::getErrorStr());
+}
+
+
+void SSLContext::clearClientSessions() {
+  SmartLock lock(this);
+
+  for (auto it = sessions.begin(); it != sessions.end(); it++)
+    SSL_SESSION_free(it->second);
+
+  sessions.clear();
+}
+
+
+void SSLContext::handshakeComplete(_SSL *ssl) {
+  bool reused = SSL_session_reused(ssl);
+
+  if (SSL_is_server(ssl)) {
+    serverHandshakes++;
+    if (reused) serverResumed++;
+
+  } else {
+    clientHandshakes++;
+    if (reused) clientResumed++;
+  }
+}
+
+
+double SSLContext::getResumptionRate(bool server) const {
+  uint64_t total = getHandshakes(server);
+  return total ? (double)getResumedHandshakes(server) / total : 0;
+}
+
+
+int SSLContext::ticketKeyCallback(_SSL *ssl, unsigned char *name,
+                                  unsigned char *iv, void *cipherCtx,
+                                  void *hmacCtx, int enc) {
+  SSLContext *ctx = (SSLContext *)SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+  if (!ctx) return -1;
+
+  TicketKey key;
+  bool current = true;
+  if (!ctx->getTicketKey(enc ? 0 : name, key, current))
+    return 0; // Unknown key, do a full handshake
+
+  const EVP_CIPHER *cipher = EVP_aes_256_cbc();
+
+  if (enc) {
+    memcpy(name, key.name, sizeof(key.name));
+    if (RAND_bytes(iv, EVP_CIPHER_iv_length(cipher)) != 1) return -1;
+  }
+
+  if (!EVP_CipherInit_ex((EVP_CIPHER_CTX *)cipherCtx, cipher, 0, key.aesKey,
+                         iv, enc)) return -1;
+
+#if 0x30000000L <= OPENSSL_VERSION_NUMBER
+  OSSL_PARAM params[] = {
+    OSSL_PARAM_construct_octet_string
+    (OSSL_MAC_PARAM_KEY, (void *)key.hmacKey, sizeof(key.hmacKey)),
+    OSSL_PARAM_construct_utf8_string
+    (OSSL_MAC_PARAM_DIGEST, (char *)"sha256", 0),
+    OSSL_PARAM_construct_end(),
+  };
+
+  if (!EVP_MAC_CTX_set_params((EVP_MAC_CTX *)hmacCtx, params)) return -1;
+#else
+  if (!HMAC_Init_ex((HMAC_CTX *)hmacCtx, key.hmacKey, sizeof(key.hmacKey),
+                    EVP_sha256(), 0)) return -1;
+#endif
+
+  // Renew tickets from old keys.  TLS 1.3 clients use each ticket only once.
+#if 0x10101000L <= OPENSSL_VERSION_NUMBER
+  if (TLS1_3_VERSION <= SSL_version(ssl)) return 2;
+#endif
+  return current ? 1 : 2;
+}
+
+
+int SSLContext::newSessionCallback(_SSL *ssl, SSL_SESSION *session) {
+  SSLContext *ctx = (SSLContext *)SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+  if (!ctx) return 0;
+
+  ctx->storeClientSession(ssl, session);
+  return 1; // Session is ours
+}
+
+
+void SSLContext::addTicketKey(const TicketKey &key) {
+  SmartLock lock(this);
+
+  ticketKeys.push_front(key);
+  ticketKeys.front().created = Timer::now();
+  while (maxTicketKeys < ticketKeys.size()) ticketKeys.pop_back();
+
+#if 0x30000000L <= OPENSSL_VERSION_NUMBER
+  SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticketKeyCB);
+#else
+  SSL_CTX_set_tlsext_ticket_key_cb(ctx, ticketKeyCB);
+#endif
+}
+
+
+bool SSLContext::getTicketKey(const unsigned char *name, TicketKey &key,
+                              bool &current) {
+  SmartLock lock(this);
+
+  if (ticketKeys.empty()) return false;
+
+  // Encrypt with the newest key, rotating it if it is too old
+  if (!name) {
+    if (ticketKeyLifetime &&
+        ticketKeys.front().created + ticketKeyLifetime < Timer::now())
+      TRY_CATCH_ERROR(rotateTicketKeys());
+
+    key = ticketKeys.front();
+    current = true;
+    return true;
+  }
+
+  for (auto it = ticketKeys.begin(); it != ticketKeys.end(); it++)
+    if (!memcmp(it->name, name, sizeof(it->name))) {
+      key = *it;
+      current = it == ticketKeys.begin();
+      return true;
+    }
+
+  return false;
+}
+
+
+void SSLContext::storeClientSession(_SSL *ssl, SSL_SESSION *session) {
+  string *key = (string *)SSL_get_ex_data(ssl, sessionKeyIndex());
+
+#if 0x10101000L <= OPENSSL_VERSION_NUMBER
+  bool resumable = SSL_SESSION_is_resumable(session);
+#else
+  bool resumable = true; // Sessions are always resumable before TLS 1.3
+#endif
+
+  if (!key || !resumable) {
+    SSL_SESSION_free(session);
+    return;
+  }
+
+  SmartLock lock(this);
+
+  auto it = sessions.find(*key);
+
+  if (it != sessions.end()) {
+    SSL_SESSION_free(it->second);
+    it->second = session;
+    return;
+  }
+
+  // Evict an arbitrary session when full
+  if (maxClientSessions <= sessions.size() && !sessions.empty()) {
+    SSL_SESSION_free(sessions.begin()->second);
+    sessions.erase(sessions.begin());
+  }
+
+  sessions[*key] = session;
+}
@@ -34,11 +34,17 @@
 
 #include <cbang/config.h>
 #include <cbang/io/InputSource.h>
+#include <cbang/os/Mutex.h>
 
 #include <string>
+#include <map>
+#include <list>
+#include <atomic>
 
 #ifdef HAVE_OPENSSL
+typedef struct ssl_st _SSL;
 typedef struct ssl_ctx_st SSL_CTX;
+typedef struct ssl_session_st SSL_SESSION;
 typedef struct x509_store_st X509_STORE;
 typedef struct bio_st BIO;
 
@@ -49,9 +55,29 @@ namespace cb {
   class CertificateChain;
   class CRL;
 
-  class SSLContext {
+  class SSLContext : public Mutex {
     SSL_CTX *ctx;
 
+    struct TicketKey {
+      unsigned char name[16];
+      unsigned char aesKey[32];
+      unsigned char hmacKey[32];
+      double created;
+    };
+
+    std::list<TicketKey> ticketKeys;
+    double ticketKeyLifetime = 0;
+    unsigned maxTicketKeys = 2;
+
+    bool clientSessions = false;
+    unsigned maxClientSessions = 1024;
+    std::map<std::string, SSL_SESSION *> sessions;
+
+    std::atomic<uint64_t> serverHandshakes;
+    std::atomic<uint64_t> serverResumed;
+    std::atomic<uint64_t> clientHandshakes;
+    std::atomic<uint64_t> clientResumed;
+
   public:
     SSLContext();
     ~SSLContext();
@@ -95,6 +121,42 @@ namespace cb {
 
     long getOptions() const;
     void setOptions(long options);
+
+    // Server session resumption
+    void setSessionCacheSize(unsigned size);
+    void setSessionTimeout(unsigned seconds);
+    void setSessionTickets(bool enable);
+    /// Ticket keys older than @param seconds are rotated, 0 disables
+    void setTicketKeyLifetime(double seconds);
+    /// Previous keys are kept to decrypt tickets issued before rotation
+    void setMaxTicketKeys(unsigned max) {maxTicketKeys = max ? max : 1;}
+    /// An 80 byte key name, AES key and HMAC key shared between servers
+    void addTicketKey(const std::string &key);
+    void rotateTicketKeys();
+
+    // Client session resumption, keyed by host and port
+    void setClientSessionCache(bool enable, unsigned maxSessions = 1024);
+    void setClientSession(_SSL *ssl, const std::string &host, unsigned port);
+    void clearClientSessions();
+
+    // Resumption statistics, @param server selects the side of the handshake
+    void handshakeComplete(_SSL *ssl);
+    uint64_t getHandshakes(bool server = true) const
+    {return server ? serverHandshakes : clientHandshakes;}
+    uint64_t getResumedHandshakes(bool server = true) const
+    {return server ? serverResumed : clientResumed;}
+    double getResumptionRate(bool server = true) const;
+
+    static int ticketKeyCallback(_SSL *ssl, unsigned char *name,
+                                 unsigned char *iv, void *cipherCtx,
+                                 void *hmacCtx, int enc);
+    static int newSessionCallback(_SSL *ssl, SSL_SESSION *session);
+
+  protected:
+    void addTicketKey(const TicketKey &key);
+    bool getTicketKey(const unsigned char *name, TicketKey &key,
+                      bool &current);
+    void storeClientSession(_SSL *ssl, SSL_SESSION *session);
   };
 }
 
@@ -107,7 +107,7 @@ void Socket::setTimeout(double timeout) {
 
 bool Socket::canRead(double timeout) const {
   if (!isOpen()) return false;
-  SocketSet set;
+  SocketSet set(SocketSet::BACKEND_POLL);
   set.add(*this, SocketSet::READ);
   return set.select(timeout);
 }
@@ -115,7 +115,7 @@ bool Socket::canRead(double timeout) const {
 
 bool Socket::canWrite(double timeout) const {
   if (!isOpen()) return false;
-  SocketSet set;
+  SocketSet set(SocketSet::BACKEND_POLL);
   set.add(*this, SocketSet::WRITE);
   return set.select(timeout);
 }
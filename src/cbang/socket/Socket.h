@@ -85,6 +85,9 @@ namespace cb {
     virtual bool canWrite(double timeout = 0) const;
 
     virtual void setReuseAddr(bool reuse) {impl->setReuseAddr(reuse);}
+    virtual void setReusePort(bool reuse) {impl->setReusePort(reuse);}
+    /// Disable Nagle's algorithm
+    virtual void setNoDelay(bool noDelay) {impl->setNoDelay(noDelay);}
     virtual void setBlocking(bool blocking) {impl->setBlocking(blocking);}
     virtual bool getBlocking() const {return impl->getBlocking();}
     virtual void setKeepAlive(bool keepAlive) {impl->setKeepAlive(keepAlive);}
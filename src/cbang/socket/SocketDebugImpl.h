@@ -61,6 +61,8 @@ namespace cb {
     // From SocketImpl
     bool isOpen() const {return socketOpen;}
     void setReuseAddr(bool reuse) {}
+    void setReusePort(bool reuse) {}
+    void setNoDelay(bool noDelay) {}
     void setBlocking(bool blocking) {this->blocking = blocking;}
     bool getBlocking() const {return blocking;}
     void open() {socketOpen = true;}
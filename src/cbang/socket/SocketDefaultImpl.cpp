@@ -57,6 +57,7 @@ typedef int socklen_t;  // Unix socket length
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -114,6 +115,35 @@ void SocketDefaultImpl::setReuseAddr(bool reuse) {
 }
 
 
+void SocketDefaultImpl::setReusePort(bool reuse) {
+#ifdef SO_REUSEPORT
+  if (!isOpen()) open();
+
+  int opt = reuse;
+
+  SysError::clear();
+  if (setsockopt((socket_t)socket, SOL_SOCKET, SO_REUSEPORT, (char *)&opt,
+                 sizeof(opt)))
+    THROW("Failed to set reuse port: " << SysError());
+
+#else
+  if (reuse) THROW("SO_REUSEPORT not supported on this platform");
+#endif
+}
+
+
+void SocketDefaultImpl::setNoDelay(bool noDelay) {
+  if (!isOpen()) open();
+
+  int opt = noDelay;
+
+  SysError::clear();
+  if (setsockopt((socket_t)socket, IPPROTO_TCP, TCP_NODELAY, (char *)&opt,
+                 sizeof(opt)))
+    THROW("Failed to set TCP no delay: " << SysError());
+}
+
+
 void SocketDefaultImpl::setBlocking(bool blocking) {
   if (!isOpen()) open();
 
@@ -58,6 +58,8 @@ namespace cb {
     // From SocketImpl
     bool isOpen() const;
     void setReuseAddr(bool reuse);
+    void setReusePort(bool reuse);
+    void setNoDelay(bool noDelay);
     void setBlocking(bool blocking);
     bool getBlocking() const {return blocking;}
     void setKeepAlive(bool keepAlive);
@@ -63,6 +63,9 @@ namespace cb {
     virtual Socket *createSocket();
     virtual bool isOpen() const = 0;
     virtual void setReuseAddr(bool reuse) = 0;
+    virtual void setReusePort(bool reuse)
+    {THROW("Reuse port not supported by this socket type");}
+    virtual void setNoDelay(bool noDelay) {}
     virtual void setBlocking(bool blocking) = 0;
     virtual bool getBlocking() const = 0;
     virtual void setKeepAlive(bool keepAlive) {}
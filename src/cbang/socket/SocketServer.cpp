@@ -88,16 +88,21 @@ void SocketServer::startup() {
       LOG_DEBUG(5, "SocketServer bound " << ports[i]->ip);
     }
   }
+
+  // Sockets stay in the set, connections update their interest incrementally
+  sockSet = new SocketSet(backend);
+  for (unsigned i = 0; i < ports.size(); i++)
+    sockSet->add(ports[i]->socket, SocketSet::READ);
+
+  LOG_DEBUG(5, "SocketServer using "
+            << SocketSet::getBackendName(sockSet->getBackend()));
 }
 
 
 void SocketServer::service() {
-  // Add listeners
-  SocketSet sockSet;
-  for (unsigned i = 0; i < ports.size(); i++)
-    sockSet.add(ports[i]->socket, SocketSet::READ);
+  if (sockSet.isNull()) THROW("SocketServer not started");
+  SocketSet &sockSet = *this->sockSet;
 
-  // Add others
   addConnectionSockets(sockSet);
 
   if (sockSet.select(0.1) || connectionsReady()) {
@@ -116,6 +121,9 @@ void SocketServer::service() {
           SmartPointer<Socket> client = socket.accept(&clientIP);
           if (client.isNull()) break;
 
+          // Drop interest left by a closed socket with the same descriptor
+          sockSet.set(*client, 0);
+
           // Check access
           if (!allow(clientIP.getIP())) {
             LOG_INFO(3, "Server access denied for " << clientIP);
@@ -156,6 +164,8 @@ void SocketServer::shutdown() {
   for (it = connections.begin(); it != connections.end(); it++)
     closeConnection(*it);
   connections.clear();
+
+  sockSet.release();
 }
 
 
@@ -168,6 +178,8 @@ void SocketServer::cleanupConnections() {
       LOG_INFO(3, "Server connection id=" << con->getID() << " ended");
 
       closeConnection(con);
+      if (sockSet.isSet() && con->getSocket().isOpen())
+        sockSet->set(con->getSocket(), 0);
       it = connections.erase(it);
 
     } else it++;
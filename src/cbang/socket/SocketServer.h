@@ -34,6 +34,7 @@
 
 #include "Socket.h"
 #include "SocketConnection.h"
+#include "SocketSet.h"
 
 #include <cbang/os/Thread.h>
 #include <cbang/os/Mutex.h>
@@ -44,7 +45,6 @@
 #include <list>
 
 namespace cb {
-  class SocketSet;
   class SSLContext;
 
   class SocketServer : public Thread, public Mutex {
@@ -65,11 +65,19 @@ namespace cb {
 
     IPAddressFilter ipFilter;
 
+    SocketSet::backend_t backend;
+    SmartPointer<SocketSet> sockSet;
+
   public:
     typedef connections_t::const_iterator iterator;
 
+    SocketServer() : backend(SocketSet::BACKEND_DEFAULT) {}
     virtual ~SocketServer();
 
+    SocketSet::backend_t getBackend() const {return backend;}
+    /// Takes effect on the next startup()
+    void setBackend(SocketSet::backend_t backend) {this->backend = backend;}
+
     Socket &addListenPort(const IPAddress &ip,
                           const SmartPointer<SSLContext> &sslCtx);
     Socket &addListenPort(const IPAddress &ip);
@@ -88,6 +96,7 @@ namespace cb {
     virtual bool allow(const IPAddress &clientIP) const;
     virtual SocketConnectionPtr
     createConnection(SmartPointer<Socket> sock, const IPAddress &clientIP) = 0;
+    /// @param sockSet persists between calls, update it with set()
     virtual void addConnectionSockets(SocketSet &sockSet) {}
     virtual bool connectionsReady() const {return false;}
     virtual void processConnections(SocketSet &sockSet) {}
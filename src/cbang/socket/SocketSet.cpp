@@ -45,28 +45,262 @@
 
 #include <cbang/os/SysError.h>
 
+#include <map>
+#include <vector>
+#include <cmath>
+
 #ifndef _WIN32
 #include <sys/select.h>
 #include <sys/types.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
 #endif
 
+using namespace std;
 using namespace cb;
 
+
+namespace {
+  SocketSet::backend_t defaultBackend = SocketSet::BACKEND_DEFAULT;
+
+
+  int toMS(double timeout) {
+    return timeout < 0 ? -1 : (int)ceil(timeout * 1000);
+  }
+}
+
+
 struct SocketSet::private_t {
-  fd_set read;
-  fd_set write;
-  fd_set except;
+  backend_t backend;
+
+  typedef map<socket_t, int> sockets_t;
+  sockets_t interest;
+  sockets_t ready;
+
+#ifndef _WIN32
+  vector<pollfd> pollFDs;
+#endif
+
+#ifdef __linux__
+  int epollFD;
+  vector<epoll_event> events;
+#endif
+
+
+  private_t(backend_t backend) : backend(backend) {
+#ifdef __linux__
+    epollFD = -1;
+    if (backend == BACKEND_EPOLL) openEPoll();
+#endif
+  }
+
+
+  ~private_t() {
+#ifdef __linux__
+    if (epollFD != -1) ::close(epollFD);
+#endif
+  }
+
+
+  void clear() {
+    interest.clear();
+    ready.clear();
+
+#ifdef __linux__
+    if (epollFD != -1) {
+      ::close(epollFD);
+      openEPoll();
+    }
+#endif
+  }
+
+
+  void update(socket_t s, int oldType, int newType) {
+    ready.erase(s);
+
+#ifdef __linux__
+    if (backend == BACKEND_EPOLL) {
+      epoll_event event;
+      event.events =
+        ((newType & READ)   ? EPOLLIN  : 0) |
+        ((newType & WRITE)  ? EPOLLOUT : 0) |
+        ((newType & EXCEPT) ? EPOLLPRI : 0);
+      event.data.fd = s;
+
+      int op = !oldType ? EPOLL_CTL_ADD :
+        (newType ? EPOLL_CTL_MOD : EPOLL_CTL_DEL);
+
+      if (epoll_ctl(epollFD, op, s, &event)) {
+        // The descriptor may have been closed and reused while in the set
+        if (op == EPOLL_CTL_ADD && errno == EEXIST) op = EPOLL_CTL_MOD;
+        else if (op == EPOLL_CTL_MOD && errno == ENOENT) op = EPOLL_CTL_ADD;
+        else if (op == EPOLL_CTL_DEL && (errno == ENOENT || errno == EBADF))
+          return;
+        else THROW("epoll_ctl() " << SysError());
+
+        if (epoll_ctl(epollFD, op, s, &event))
+          THROW("epoll_ctl() " << SysError());
+      }
+    }
+#endif
+  }
+
+
+  int wait(double timeout) {
+    ready.clear();
+
+    switch (backend) {
+#ifdef __linux__
+    case BACKEND_EPOLL: return waitEPoll(timeout);
+#endif
+#ifndef _WIN32
+    case BACKEND_POLL: return waitPoll(timeout);
+#endif
+    default: return waitSelect(timeout);
+    }
+  }
+
+
+  void setReady(socket_t s, int type) {
+    sockets_t::iterator it = interest.find(s);
+    if (it == interest.end()) return;
+
+    // Errors wake whatever the socket is waiting for
+    type &= it->second;
+    ready[s] = type ? type : it->second;
+  }
+
+
+  int waitSelect(double timeout) {
+    fd_set read;
+    fd_set write;
+    fd_set except;
+    int maxFD = -1;
+
+    FD_ZERO(&read);
+    FD_ZERO(&write);
+    FD_ZERO(&except);
+
+    for (auto &it: interest) {
+      socket_t s = it.first;
+
+#ifndef _WIN32
+      if (FD_SETSIZE <= s)
+        THROW("Socket " << s << " exceeds FD_SETSIZE, use another backend");
+#endif
+
+      if (it.second & READ) FD_SET(s, &read);
+      if (it.second & WRITE) FD_SET(s, &write);
+      if (it.second & EXCEPT) FD_SET(s, &except);
+      if (maxFD < (int)s) maxFD = s;
+    }
+
+    struct timeval t;
+    if (0 <= timeout) t = Timer::toTimeVal(timeout);
+
+    SysError::clear();
+    int ret = ::select(maxFD + 1, &read, &write, &except, 0 <= timeout ? &t : 0);
+    if (ret < 0) THROW("select() " << SysError());
+
+    if (ret)
+      for (auto &it: interest) {
+        socket_t s = it.first;
+        int type =
+          (FD_ISSET(s, &read)   ? READ   : 0) |
+          (FD_ISSET(s, &write)  ? WRITE  : 0) |
+          (FD_ISSET(s, &except) ? EXCEPT : 0);
+        if (type) ready[s] = type;
+      }
+
+    return ret;
+  }
+
+
+#ifndef _WIN32
+  int waitPoll(double timeout) {
+    pollFDs.clear();
+
+    for (auto &it: interest) {
+      pollfd pfd;
+      pfd.fd = it.first;
+      pfd.events =
+        ((it.second & READ)   ? POLLIN  : 0) |
+        ((it.second & WRITE)  ? POLLOUT : 0) |
+        ((it.second & EXCEPT) ? POLLPRI : 0);
+      pfd.revents = 0;
+      pollFDs.push_back(pfd);
+    }
+
+    SysError::clear();
+    int ret = ::poll(pollFDs.data(), pollFDs.size(), toMS(timeout));
+    if (ret < 0) THROW("poll() " << SysError());
+
+    for (unsigned i = 0; i < pollFDs.size() && ready.size() < (unsigned)ret;
+         i++) {
+      short e = pollFDs[i].revents;
+      if (!e) continue;
+
+      setReady(pollFDs[i].fd,
+               ((e & (POLLIN | POLLHUP | POLLERR)) ? READ   : 0) |
+               ((e & (POLLOUT | POLLERR))          ? WRITE  : 0) |
+               ((e & POLLPRI)                      ? EXCEPT : 0));
+    }
+
+    return ret;
+  }
+#endif // !_WIN32
+
+
+#ifdef __linux__
+  void openEPoll() {
+    epollFD = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFD == -1) THROW("epoll_create1() " << SysError());
+  }
+
+
+  int waitEPoll(double timeout) {
+    unsigned size = interest.size();
+    if (size < 1) size = 1;
+    if (1024 < size) size = 1024; // More are returned by the next call
+    if (events.size() != size) events.resize(size);
+
+    SysError::clear();
+    int ret = epoll_wait(epollFD, events.data(), size, toMS(timeout));
+    if (ret < 0) THROW("epoll_wait() " << SysError());
+
+    for (int i = 0; i < ret; i++) {
+      uint32_t e = events[i].events;
+
+      setReady(events[i].data.fd,
+               ((e & (EPOLLIN | EPOLLHUP | EPOLLERR)) ? READ   : 0) |
+               ((e & (EPOLLOUT | EPOLLERR))           ? WRITE  : 0) |
+               ((e & EPOLLPRI)                        ? EXCEPT : 0));
+    }
+
+    return ret;
+  }
+#endif // __linux__
 };
 
 
-SocketSet::SocketSet() : p(new private_t) {
+SocketSet::SocketSet(backend_t backend) {
   Socket::initialize();
-  clear();
+
+  if (backend == BACKEND_DEFAULT) backend = getDefaultBackend();
+  if (!isAvailable(backend)) backend = BACKEND_SELECT;
+
+  p = new private_t(backend);
 }
 
 
-SocketSet::SocketSet(const SocketSet &s) : p(new private_t), maxFD(s.maxFD) {
-  *p = *s.p;
+SocketSet::SocketSet(const SocketSet &s) : p(new private_t(s.p->backend)) {
+  for (auto &it: s.p->interest) set(it.first, it.second);
+  p->ready = s.p->ready;
 }
 
 
@@ -75,22 +309,62 @@ SocketSet::~SocketSet() {
 }
 
 
-void SocketSet::clear() {
-  FD_ZERO(&p->read);
-  FD_ZERO(&p->write);
-  FD_ZERO(&p->except);
-  maxFD = -1;
+SocketSet::backend_t SocketSet::getDefaultBackend() {
+  if (defaultBackend != BACKEND_DEFAULT) return defaultBackend;
+  if (isAvailable(BACKEND_EPOLL)) return BACKEND_EPOLL;
+  if (isAvailable(BACKEND_POLL)) return BACKEND_POLL;
+  return BACKEND_SELECT;
+}
+
+
+void SocketSet::setDefaultBackend(backend_t backend) {
+  defaultBackend = backend;
 }
 
 
+bool SocketSet::isAvailable(backend_t backend) {
+  switch (backend) {
+  case BACKEND_SELECT: return true;
+#ifndef _WIN32
+  case BACKEND_POLL: return true;
+#endif
+#ifdef __linux__
+  case BACKEND_EPOLL: return true;
+#endif
+  default: return false;
+  }
+}
+
+
+const char *SocketSet::getBackendName(backend_t backend) {
+  switch (backend) {
+  case BACKEND_DEFAULT: return "default";
+  case BACKEND_SELECT: return "select";
+  case BACKEND_POLL: return "poll";
+  case BACKEND_EPOLL: return "epoll";
+  }
+
+  return "unknown";
+}
+
+
+SocketSet::backend_t SocketSet::getBackend() const {return p->backend;}
+unsigned SocketSet::size() const {return p->interest.size();}
+void SocketSet::clear() {p->clear();}
+
+
 void SocketSet::add(const Socket &socket, int type) {
   if (!socket.isOpen()) THROW("Socket not open");
   socket_t s = (socket_t)socket.get();
 
-  if (type & READ) FD_SET(s, &p->read);
-  if (type & WRITE) FD_SET(s, &p->write);
-  if (type & EXCEPT) FD_SET(s, &p->except);
-  if (maxFD < (int)s) maxFD = s;
+  auto it = p->interest.find(s);
+  set(s, (it == p->interest.end() ? 0 : it->second) | (type & ALL));
+}
+
+
+void SocketSet::set(const Socket &socket, int type) {
+  if (!socket.isOpen()) THROW("Socket not open");
+  set((socket_t)socket.get(), type & ALL);
 }
 
 
@@ -98,9 +372,8 @@ void SocketSet::remove(const Socket &socket, int type) {
   if (!socket.isOpen()) THROW("Socket not open");
   socket_t s = (socket_t)socket.get();
 
-  if (type & READ) FD_CLR(s, &p->read);
-  if (type & WRITE) FD_CLR(s, &p->write);
-  if (type & EXCEPT) FD_CLR(s, &p->except);
+  auto it = p->interest.find(s);
+  if (it != p->interest.end()) set(s, it->second & ~type);
 }
 
 
@@ -108,25 +381,30 @@ bool SocketSet::isSet(const Socket &socket, int type) const {
   if (!socket.isOpen()) THROW("Socket not open");
   socket_t s = (socket_t)socket.get();
 
-  return
-    ((type & READ)   && FD_ISSET(s, &p->read))  ||
-    ((type & WRITE)  && FD_ISSET(s, &p->write)) ||
+  // With the debugger every socket in the set is ready
+  if (SocketDebugger::instance().isEnabled()) {
+    auto it = p->interest.find(s);
+    return it != p->interest.end() && (it->second & type & (READ | WRITE));
+  }
 
-    (!SocketDebugger::instance().isEnabled() &&
-     ((type & EXCEPT) && FD_ISSET(s, &p->except)));
+  auto it = p->ready.find(s);
+  return it != p->ready.end() && (it->second & type);
 }
 
 
 bool SocketSet::select(double timeout) {
   if (SocketDebugger::instance().isEnabled()) return true;
+  return p->wait(timeout);
+}
+
 
-  struct timeval t;
-  if (0 <= timeout) t = Timer::toTimeVal(timeout);
+void SocketSet::set(socket_t s, int type) {
+  auto it = p->interest.find(s);
+  int oldType = it == p->interest.end() ? 0 : it->second;
+  if (oldType == type) return;
 
-  SysError::clear();
-  int ret =
-    ::select(maxFD + 1, &p->read, &p->write, &p->except, 0 <= timeout ? &t : 0);
+  p->update(s, oldType, type);
 
-  if (ret < 0) THROW("select() " << SysError());
-  return ret;
+  if (type) p->interest[s] = type;
+  else p->interest.erase(s);
 }
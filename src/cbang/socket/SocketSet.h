@@ -32,15 +32,19 @@
 
 #pragma once
 
-#include <map>
+#include "SocketType.h"
 
 namespace cb {
   class Socket;
 
+  /**
+   * Sockets stay in the set across calls to select() so a long lived set
+   * only needs to be told about changes.  After select() isSet() reports
+   * which sockets are ready.
+   */
   class SocketSet {
     struct private_t;
     private_t *p;
-    int maxFD;
 
   public:
     typedef enum {
@@ -50,12 +54,30 @@ namespace cb {
       ALL    = READ | WRITE | EXCEPT
     } type_t;
 
-    SocketSet();
+    typedef enum {
+      BACKEND_DEFAULT,
+      BACKEND_SELECT,
+      BACKEND_POLL,
+      BACKEND_EPOLL,
+    } backend_t;
+
+    /// Unavailable backends fall back to select()
+    SocketSet(backend_t backend = BACKEND_DEFAULT);
     SocketSet(const SocketSet &s);
     ~SocketSet();
 
+    static backend_t getDefaultBackend();
+    static void setDefaultBackend(backend_t backend);
+    static bool isAvailable(backend_t backend);
+    static const char *getBackendName(backend_t backend);
+
+    backend_t getBackend() const;
+    unsigned size() const;
+
     void clear();
     void add(const Socket &socket, int type = ALL);
+    /// Replaces the socket's interest, @param type 0 removes it
+    void set(const Socket &socket, int type);
     void remove(const Socket &socket, int type = ALL);
     bool isSet(const Socket &socket, int type = ALL) const;
 
@@ -68,5 +90,8 @@ namespace cb {
      * @return True if at least one socket in the set is ready.
      */
     bool select(double timeout = -1);
+
+  protected:
+    void set(socket_t s, int type);
   };
 }
@@ -0,0 +1,200 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+#include "ACLIndex.h"
+
+#include <cbang/Exception.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace cb;
+
+
+void ACLIndex::Bits::set(unsigned i) {
+  if (words.size() <= i / 64) words.resize(i / 64 + 1, 0);
+  words[i / 64] |= (uint64_t)1 << (i % 64);
+}
+
+
+bool ACLIndex::Bits::test(unsigned i) const {
+  return i / 64 < words.size() && (words[i / 64] >> (i % 64)) & 1;
+}
+
+
+ACLIndex::Bits &ACLIndex::Bits::operator|=(const Bits &o) {
+  if (words.size() < o.words.size()) words.resize(o.words.size(), 0);
+  for (unsigned i = 0; i < o.words.size(); i++) words[i] |= o.words[i];
+  return *this;
+}
+
+
+ACLIndex::ACLIndex() : nodes(1), rootACL(-1) {}
+
+
+void ACLIndex::addUser(const string &user) {
+  userIDs.insert(ids_t::value_type(user, userIDs.size()));
+}
+
+
+void ACLIndex::addGroup(const string &group) {
+  if (groupIDs.insert(ids_t::value_type(group, groupIDs.size())).second)
+    groupUsers.push_back(Bits());
+}
+
+
+void ACLIndex::groupAddUser(const string &group, const string &user) {
+  ids_t::const_iterator it = groupIDs.find(group);
+  if (it == groupIDs.end()) THROW("Group '" << group << "' does not exist");
+
+  ids_t::const_iterator it2 = userIDs.find(user);
+  if (it2 != userIDs.end()) groupUsers[it->second].set(it2->second);
+}
+
+
+unsigned ACLIndex::addACL(const string &path) {
+  unsigned acl = acls.size();
+  acls.push_back(ACL());
+  if (path == "/") rootACL = acl;
+
+  // Insert one trie node per '/' separated segment
+  unsigned node = 0;
+  size_t start = 0;
+
+  while (true) {
+    size_t end = path.find('/', start);
+    if (end == string::npos) end = path.size();
+
+    unsigned next = child(node, path.data() + start, end - start);
+
+    if (!next) {
+      Edge edge = {path.substr(start, end - start), (unsigned)nodes.size()};
+      vector<Edge> &children = nodes[node].children;
+
+      vector<Edge>::iterator it = children.begin();
+      while (it != children.end() && it->segment < edge.segment) it++;
+      children.insert(it, edge);
+
+      next = edge.node;
+      nodes.push_back(Node());
+    }
+
+    node = next;
+    if (end == path.size()) break;
+    start = end + 1;
+  }
+
+  nodes[node].acl = acl;
+
+  return acl;
+}
+
+
+void ACLIndex::aclAddUser(unsigned acl, const string &user) {
+  ids_t::const_iterator it = userIDs.find(user);
+  if (it != userIDs.end()) acls.at(acl).users.set(it->second);
+}
+
+
+void ACLIndex::aclAddGroup(unsigned acl, const string &group) {
+  ids_t::const_iterator it = groupIDs.find(group);
+  if (it == groupIDs.end())
+    THROW("ACL contains non-existant group '" << group << "'");
+
+  acls.at(acl).groups.set(it->second);
+  acls.at(acl).users |= groupUsers[it->second];
+}
+
+
+bool ACLIndex::allow(const string &path, const string &user) const {
+  ids_t::const_iterator it = userIDs.find(user);
+  if (it == userIDs.end()) return false;
+
+  int acl = find(path);
+  return acl != -1 && acls[acl].users.test(it->second);
+}
+
+
+bool ACLIndex::allowGroup(const string &path, const string &group) const {
+  ids_t::const_iterator it = groupIDs.find(group);
+  if (it == groupIDs.end()) return false;
+
+  int acl = find(path);
+  return acl != -1 && acls[acl].groups.test(it->second);
+}
+
+
+int ACLIndex::find(const string &path) const {
+  if (path.empty()) return -1;
+
+  // The nearest ACL is the one on the longest prefix of the path which ends
+  // before a '/' or at the end of the path.  "/" is the shortest of these.
+  int acl = path[0] == '/' ? rootACL : -1;
+
+  const char *start = path.data();
+  const char *end = start + path.size();
+  unsigned node = 0;
+
+  for (const char *s = start;; s++) {
+    const char *e = (const char *)memchr(s, '/', end - s);
+    if (!e) e = end;
+
+    if (!(node = child(node, s, e - s))) break;
+    if (e != start && nodes[node].acl != -1) acl = nodes[node].acl;
+
+    if (e == end) break;
+    s = e;
+  }
+
+  return acl;
+}
+
+
+unsigned ACLIndex::child(unsigned node, const char *segment,
+                         unsigned length) const {
+  const vector<Edge> &children = nodes[node].children;
+
+  // Binary search
+  unsigned lo = 0;
+  unsigned hi = children.size();
+
+  while (lo < hi) {
+    unsigned mid = (lo + hi) / 2;
+    int cmp = children[mid].segment.compare(0, string::npos, segment, length);
+
+    if (!cmp) return children[mid].node;
+    if (cmp < 0) lo = mid + 1;
+    else hi = mid;
+  }
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+
+namespace cb {
+  /**
+   * The compiled, read only form of an ACLSet.  Users and groups are
+   * interned to integer IDs and each ACL stores bitsets of the users and
+   * groups it allows, with group members already expanded.  ACL paths are
+   * stored in a trie of '/' separated segments so the nearest ACL is found
+   * in a single pass over the path without allocating.
+   *
+   * An ACLIndex is built once and then never modified so it may be shared
+   * between threads.
+   */
+  class ACLIndex {
+    class Bits {
+      std::vector<uint64_t> words;
+
+    public:
+      void set(unsigned i);
+      bool test(unsigned i) const;
+      Bits &operator|=(const Bits &o);
+    };
+
+    struct Edge {
+      std::string segment;
+      unsigned node;
+    };
+
+    struct Node {
+      int acl;
+      std::vector<Edge> children; // Sorted by segment
+      Node() : acl(-1) {}
+    };
+
+    struct ACL {
+      Bits users;
+      Bits groups;
+    };
+
+    typedef std::unordered_map<std::string, unsigned> ids_t;
+    ids_t userIDs;
+    ids_t groupIDs;
+
+    std::vector<Bits> groupUsers;
+    std::vector<ACL> acls;
+    std::vector<Node> nodes;
+    int rootACL;
+
+  public:
+    ACLIndex();
+
+    // Building
+    void addUser(const std::string &user);
+    void addGroup(const std::string &group);
+    void groupAddUser(const std::string &group, const std::string &user);
+    unsigned addACL(const std::string &path);
+    void aclAddUser(unsigned acl, const std::string &user);
+    void aclAddGroup(unsigned acl, const std::string &group);
+
+    // Lookup
+    bool allow(const std::string &path, const std::string &user) const;
+    bool allowGroup(const std::string &path, const std::string &group) const;
+
+  protected:
+    int find(const std::string &path) const;
+    unsigned child(unsigned node, const char *segment, unsigned length) const;
+  };
+}
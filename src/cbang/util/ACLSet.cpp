@@ -34,45 +34,30 @@
 
 #include <cbang/Exception.h>
 #include <cbang/json/JSON.h>
-#include <cbang/log/Logger.h>
+#include <cbang/util/SmartLock.h>
 
 using namespace std;
 using namespace cb;
 
 
 void ACLSet::clear() {
-  cache.clear();
+  SmartLock lock(this);
   acls.clear();
   groups.clear();
   users.clear();
+  changed();
 }
 
 
 bool ACLSet::allow(const string &path, const string &user) const {
-  // Check cache
-  if (!flushDirtyCache()) {
-    cache_t::const_iterator it = cache.find(path);
-    if (it != cache.end()) {
-      cache_users_t::const_iterator it2 = it->second.find(user);
-      if (it2 != it->second.end()) return it2->second;
-    }
-  }
-
-  return cache[path][user] = allowNoCache(path, user);
+  Snapshot<ACLIndex>::ptr_t idx = getIndex();
+  return !idx.isNull() && idx->allow(path, user);
 }
 
 
 bool ACLSet::allowGroup(const string &path, const string &group) const {
-  // Check cache
-  if (!flushDirtyCache()) {
-    cache_t::const_iterator it = groupCache.find(path);
-    if (it != groupCache.end()) {
-      cache_users_t::const_iterator it2 = it->second.find(group);
-      if (it2 != it->second.end()) return it2->second;
-    }
-  }
-
-  return groupCache[path][group] = allowGroupNoCache(path, group);
+  Snapshot<ACLIndex>::ptr_t idx = getIndex();
+  return !idx.isNull() && idx->allowGroup(path, group);
 }
 
 
@@ -82,13 +67,14 @@ bool ACLSet::hasUser(const string &user) const {
 
 
 void ACLSet::addUser(const string &user) {
-  dirty = true;
+  SmartLock lock(this);
   users.insert(user);
+  changed();
 }
 
 
 void ACLSet::delUser(const string &user) {
-  dirty = true;
+  SmartLock lock(this);
   users.erase(user);
 
   // Remove from groups
@@ -98,6 +84,8 @@ void ACLSet::delUser(const string &user) {
   // Remove from ACLS
   for (acls_t::iterator it = acls.begin(); it != acls.end(); it++)
     it->second.users.erase(user);
+
+  changed();
 }
 
 
@@ -108,18 +96,21 @@ bool ACLSet::hasGroup(const string &group) const {
 
 
 void ACLSet::addGroup(const string &group) {
-  dirty = true;
+  SmartLock lock(this);
   groups.insert(groups_t::value_type(group, Group()));
+  changed();
 }
 
 
 void ACLSet::delGroup(const string &group) {
-  dirty = true;
+  SmartLock lock(this);
   groups.erase(group);
 
   // Remove from ACLS
   for (acls_t::iterator it = acls.begin(); it != acls.end(); it++)
     it->second.groups.erase(group);
+
+  changed();
 }
 
 
@@ -133,20 +124,24 @@ bool ACLSet::groupHasUser(const string &groupName, const string &user) const {
 
 
 void ACLSet::groupAddUser(const string &group, const string &user) {
-  dirty = true;
-  addUser(user);
+  SmartLock lock(this);
+  users.insert(user);
   groups.insert(groups_t::value_type(group, Group())).
     first->second.users.insert(user);
+
+  changed();
 }
 
 
 void ACLSet::groupDelUser(const string &groupName, const string &user) {
-  dirty = true;
+  SmartLock lock(this);
   groups_t::iterator it = groups.find(groupName);
   if (it == groups.end()) THROW("Group '" << groupName << "' does not exist");
   Group &group = it->second;
 
   group.users.erase(user);
+
+  changed();
 }
 
 
@@ -156,14 +151,16 @@ bool ACLSet::hasACL(const string &path) const {
 
 
 void ACLSet::addACL(const string &path) {
-  dirty = true;
+  SmartLock lock(this);
   acls.insert(acls_t::value_type(path, ACL()));
+  changed();
 }
 
 
 void ACLSet::delACL(const string &path) {
-  dirty = true;
+  SmartLock lock(this);
   acls.erase(path);
+  changed();
 }
 
 
@@ -177,20 +174,24 @@ bool ACLSet::aclHasUser(const string &path, const string &user) const {
 
 
 void ACLSet::aclAddUser(const string &path, const string &user) {
-  dirty = true;
-  addUser(user);
+  SmartLock lock(this);
+  users.insert(user);
   acls.insert(acls_t::value_type(path, ACL())).
     first->second.users.insert(user);
+
+  changed();
 }
 
 
 void ACLSet::aclDelUser(const string &path, const string &user) {
-  dirty = true;
+  SmartLock lock(this);
   acls_t::iterator it = acls.find(path);
   if (it == acls.end()) THROW("ACL '" << path << "' does not exist");
   ACL &acl = it->second;
 
   acl.users.erase(user);
+
+  changed();
 }
 
 
@@ -204,27 +205,35 @@ bool ACLSet::aclHasGroup(const string &path, const string &group) const {
 
 
 void ACLSet::aclAddGroup(const string &path, const string &group) {
-  dirty = true;
-  addGroup(group);
+  SmartLock lock(this);
+  groups.insert(groups_t::value_type(group, Group()));
   acls.insert(acls_t::value_type(path, ACL())).
     first->second.groups.insert(group);
+
+  changed();
 }
 
 
 void ACLSet::aclDelGroup(const string &path, const string &group) {
-  dirty = true;
+  SmartLock lock(this);
   acls_t::iterator it = acls.find(path);
   if (it == acls.end()) THROW("ACL '" << path << "' does not exist");
   ACL &acl = it->second;
 
   acl.groups.erase(group);
+
+  changed();
 }
 
 
 void ACLSet::read(const JSON::Value &json) {
+  SmartLock lock(this); // Lookups wait for the whole set
   clear();
+  load(json.getDict());
+}
 
-  auto &dict = json.getDict();
+
+void ACLSet::load(const JSON::Value &dict) {
 
   // Users
   if (dict.has("users")) {
@@ -341,75 +350,48 @@ void ACLSet::write(JSON::Sink &sink) const {
 }
 
 
-bool ACLSet::flushDirtyCache() const {
-  if (!dirty) return false;
+void ACLSet::changed() {dirty = true;}
 
-  cache.clear();
-  groupCache.clear();
-  dirty = false;
-
-  return true;
-}
 
+Snapshot<ACLIndex>::ptr_t ACLSet::getIndex() const {
+  if (dirty) {
+    SmartLock lock(this);
+    if (dirty) compile(); // Unless rebuilt while we waited
+  }
 
-string ACLSet::parentPath(const string &path) {
-  size_t pos = path.find_last_of('/');
-  if (!pos && path != "/") return "/";
-  if (!pos || pos == string::npos) return "";
-  return path.substr(0, pos);
+  return index.get();
 }
 
 
-bool ACLSet::allowNoCache(const string &_path, const string &user) const {
-  // Check if user exists
-  if (users.find(user) == users.end()) return false;
+void ACLSet::compile() const {
+  SmartPointer<ACLIndex>::Protected idx = new ACLIndex;
 
-  // Find ACL
-  for (string path = _path; !path.empty(); path = parentPath(path)) {
-    LOG_DEBUG(5, __func__ << '(' << path << ", " << user << ')');
+  for (users_t::const_iterator it = users.begin(); it != users.end(); it++)
+    idx->addUser(*it);
 
-    acls_t::const_iterator it = acls.find(path);
-    if (it != acls.end()) {
-      const ACL &acl = it->second;
+  for (groups_t::const_iterator it = groups.begin(); it != groups.end();
+       it++) {
+    idx->addGroup(it->first);
 
-      // Check users
-      if (acl.users.find(user) != acl.users.end()) return true;
-
-      // Check groups
-      string_set_t::const_iterator it2;
-      for (it2 = acl.groups.begin(); it2 != acl.groups.end(); it2++) {
-        groups_t::const_iterator it3 = groups.find(*it2);
-        if (it3 == groups.end())
-          THROW("ACL contains non-existant group '" << *it2);
-
-        const Group &group = it3->second;
-        if (group.users.find(user) != group.users.end()) return true;
-      }
-
-      break;
-    }
+    const string_set_t &users = it->second.users;
+    string_set_t::const_iterator it2;
+    for (it2 = users.begin(); it2 != users.end(); it2++)
+      idx->groupAddUser(it->first, *it2);
   }
 
-  return false;
-}
-
+  for (acls_t::const_iterator it = acls.begin(); it != acls.end(); it++) {
+    unsigned acl = idx->addACL(it->first);
+    string_set_t::const_iterator it2;
 
-bool ACLSet::allowGroupNoCache(const string &_path, const string &group) const {
-  // Check if group exists
-  if (groups.find(group) == groups.end()) return false;
+    const string_set_t &users = it->second.users;
+    for (it2 = users.begin(); it2 != users.end(); it2++)
+      idx->aclAddUser(acl, *it2);
 
-  // Find ACL
-  for (string path = _path; !path.empty(); path = parentPath(path)) {
-    LOG_DEBUG(5, __func__ << '(' << path << ", @" << group << ')');
-
-    acls_t::const_iterator it = acls.find(path);
-    if (it != acls.end()) {
-      const ACL &acl = it->second;
-
-      // Check groups
-      return acl.groups.find(group) != acl.groups.end();
-    }
+    const string_set_t &groups = it->second.groups;
+    for (it2 = groups.begin(); it2 != groups.end(); it2++)
+      idx->aclAddGroup(acl, *it2);
   }
 
-  return false;
+  index.set(idx);
+  dirty = false;
 }
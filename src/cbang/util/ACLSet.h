@@ -32,8 +32,13 @@
 
 #pragma once
 
+#include "ACLIndex.h"
+#include "Snapshot.h"
+
 #include <cbang/json/Serializable.h>
+#include <cbang/os/Mutex.h>
 
+#include <atomic>
 #include <map>
 #include <set>
 #include <string>
@@ -45,12 +50,13 @@ namespace cb {
     class Value;
   }
 
-  class ACLSet : public JSON::Serializable {
-    mutable bool dirty;
-    typedef std::map<std::string, bool> cache_users_t;
-    typedef std::map<std::string, cache_users_t> cache_t;
-    mutable cache_t cache;
-    mutable cache_t groupCache;
+  /**
+   * A change only marks the index dirty, the next allow() or allowGroup()
+   * compiles it once.
+   */
+  class ACLSet : public JSON::Serializable, public Mutex {
+    mutable Snapshot<ACLIndex> index;
+    mutable std::atomic<bool> dirty;
 
     typedef std::set<std::string> string_set_t;
 
@@ -130,11 +136,10 @@ namespace cb {
     using cb::Serializable::write;
 
   protected:
-    bool flushDirtyCache() const;
-    static std::string parentPath(const std::string &path);
-    bool allowNoCache(const std::string &path, const std::string &user) const;
-    bool allowGroupNoCache(const std::string &path,
-                           const std::string &group) const;
+    void load(const JSON::Value &dict);
+    void changed();
+    Snapshot<ACLIndex>::ptr_t getIndex() const;
+    void compile() const;
   };
 
 
@@ -0,0 +1,248 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+
+#include <cbang/Errors.h>
+#include <cbang/StdTypes.h>
+
+
+namespace cb {
+  /**
+   * A dictionary which preserves insertion order.  Like OrderedDict but
+   * keys are stored only once, in the insertion ordered vector.  Small
+   * dictionaries are searched linearly.  Larger ones are indexed with an
+   * open addressing hash table of positions in the vector.
+   */
+  template <typename T, typename KEY = std::string,
+            typename HASH = std::hash<KEY>, unsigned LINEAR_MAX = 8>
+  class HashOrderedDict : protected std::vector<std::pair<KEY, T> > {
+    typedef T type_t;
+    typedef std::vector<std::pair<KEY, type_t> > vector_t;
+
+    /// Position is offset by one so that zero marks an empty slot
+    struct Slot {
+      uint32_t position;
+      uint32_t hash;
+    };
+
+    std::vector<Slot> table;
+
+  public:
+    void clear() {
+      vector_t::clear();
+      table.clear();
+    }
+
+
+    typedef typename vector_t::size_type size_type;
+    using vector_t::empty;
+    using vector_t::size;
+
+    typedef typename vector_t::const_iterator iterator;
+    typedef typename vector_t::const_iterator const_iterator;
+    iterator begin() const {return vector_t::begin();}
+    iterator end() const {return vector_t::end();}
+
+
+    void update(const HashOrderedDict &o) {
+      for (iterator it = o.begin(); it != o.end(); it++)
+        insert(it->first, it->second);
+    }
+
+
+    int lookup(const KEY &key) const {
+      if (table.empty()) {
+        for (size_type i = 0; i < size(); i++)
+          if (vector_t::operator[](i).first == key) return i;
+
+        return -1;
+      }
+
+      uint32_t hash = hashKey(key);
+      size_type mask = table.size() - 1;
+
+      for (size_type i = hash & mask; true; i = (i + 1) & mask) {
+        const Slot &slot = table[i];
+        if (!slot.position) return -1;
+
+        if (slot.hash == hash &&
+            vector_t::operator[](slot.position - 1).first == key)
+          return slot.position - 1;
+      }
+    }
+
+
+    size_type indexOf(const KEY &key) const {
+      int i = lookup(key);
+      if (i == -1) CBANG_KEY_ERROR("Key '" << key << "' not found");
+      return i;
+    }
+
+
+    const KEY &keyAt(size_type i) const {
+      if (size() <= i) CBANG_KEY_ERROR("Index " << i << " out of range");
+      return this->at(i).first;
+    }
+
+
+    bool has(const KEY &key) const {return lookup(key) != -1;}
+
+
+    const type_t &get(size_type i) const {
+      if (size() <= i) CBANG_KEY_ERROR("Index " << i << " out of range");
+      return this->at(i).second;
+    }
+
+
+    type_t &get(size_type i) {
+      if (size() <= i) CBANG_KEY_ERROR("Index " << i << " out of range");
+      return this->at(i).second;
+    }
+
+
+    const type_t &get(size_type i, const type_t &defaultValue) const {
+      if (size() <= i) return defaultValue;
+      return this->at(i).second;
+    }
+
+
+    const type_t &get(const KEY &key) const {
+      return vector_t::operator[](indexOf(key)).second;
+    }
+
+
+    type_t &get(const KEY &key) {
+      return vector_t::operator[](indexOf(key)).second;
+    }
+
+
+    const type_t &get(const KEY &key, const type_t &defaultValue) const {
+      int i = lookup(key);
+      return i == -1 ? defaultValue : vector_t::operator[](i).second;
+    }
+
+
+    size_type insert(const KEY &key, const type_t &value) {
+      int i = lookup(key);
+
+      if (i == -1) {
+        append(key, value);
+        return size() - 1;
+      }
+
+      vector_t::operator[](i).second = value;
+
+      return i;
+    }
+
+
+    type_t &operator[](size_type i) {return get(i);}
+    const type_t &operator[](size_type i) const {return get(i);}
+
+
+    type_t &operator[](const KEY &key) {
+      int i = lookup(key);
+      if (i != -1) return vector_t::operator[](i).second;
+
+      append(key, T());
+      return vector_t::back().second;
+    }
+
+
+    const type_t &operator[](const KEY &key) const {return get(key);}
+
+
+    /// Note, erase() takes linear time
+    void erase(size_type i) {
+      if (size() <= i) CBANG_KEY_ERROR("Index " << i << " out of range");
+      vector_t::erase(vector_t::begin() + i);
+      rehash();
+    }
+
+
+    /// Note, erase() takes linear time
+    void erase(const KEY &key) {erase(indexOf(key));}
+
+
+    /// @return The approximate number of bytes used, excluding keys and values
+    size_t getMemoryUsage() const {
+      return sizeof(*this) + vector_t::capacity() * sizeof(*begin()) +
+        table.capacity() * sizeof(Slot);
+    }
+
+
+  protected:
+    static uint32_t hashKey(const KEY &key) {
+      uint64_t hash = HASH()(key);
+      return (uint32_t)(hash ^ (hash >> 32));
+    }
+
+
+    void append(const KEY &key, const type_t &value) {
+      vector_t::push_back(typename vector_t::value_type(key, value));
+
+      // Keep the load factor at or below one half
+      if (size() <= LINEAR_MAX) return;
+      if (table.size() < size() * 2) rehash();
+      else index(size() - 1, hashKey(key));
+    }
+
+
+    void index(size_type position, uint32_t hash) {
+      size_type mask = table.size() - 1;
+      size_type i = hash & mask;
+
+      while (table[i].position) i = (i + 1) & mask;
+
+      table[i].position = position + 1;
+      table[i].hash = hash;
+    }
+
+
+    void rehash() {
+      table.clear();
+      if (size() <= LINEAR_MAX) return;
+
+      size_type capacity = 16;
+      while (capacity < size() * 4) capacity *= 2;
+      table.resize(capacity, Slot());
+
+      for (size_type i = 0; i < size(); i++)
+        index(i, hashKey(vector_t::operator[](i).first));
+    }
+  };
+}
@@ -32,6 +32,7 @@
 
 #pragma once
 
+#include <cbang/Exception.h>
 #include <cbang/time/Time.h>
 
 #include <vector>
@@ -102,5 +103,30 @@ namespace cb {
       total += value;
       last = time;
     }
+
+
+    /// Add the events recorded in another Rate of the same size and period
+    void add(const Rate &o) {
+      if (buckets.size() != o.buckets.size() || period != o.period)
+        CBANG_THROW("Cannot add Rates with different sizes or periods");
+
+      if (!o.last) return;
+      if (last < o.last) event(0, (uint64_t)o.last * period); // Advance
+
+      unsigned size = buckets.size();
+
+      for (unsigned i = 0; i < o.fill; i++) {
+        unsigned delta = last - (o.last - i);
+        if (size <= delta) break;
+
+        // Extend fill to cover older buckets
+        while (fill <= delta) buckets[(head + size - fill++) % size] = 0;
+
+        buckets[(head + size - delta) % size] +=
+          o.buckets[(o.head + size - i) % size];
+      }
+
+      total += o.total;
+    }
   };
 }
@@ -37,13 +37,16 @@
 #include <cbang/Exception.h>
 #include <cbang/json/Serializable.h>
 #include <cbang/json/Sink.h>
+#include <cbang/os/Mutex.h>
+#include <cbang/util/SmartLock.h>
 
 #include <string>
 #include <map>
 
 
 namespace cb {
-  class RateSet : public JSON::Serializable {
+  /// Methods lock the set so it can be read from other threads
+  class RateSet : public JSON::Serializable, public Mutex {
     const unsigned size;
     const unsigned period;
 
@@ -55,13 +58,19 @@ namespace cb {
       size(size), period(period) {}
 
 
+    unsigned getSize() const {return size;}
+    unsigned getPeriod() const {return period;}
+
+
     Rate &getRate(const std::string &key) {
+      SmartLock lock(this);
       return rates.insert(rates_t::value_type(key, Rate(size, period)))
         .first->second;
     }
 
 
     const Rate &getRate(const std::string &key) const {
+      SmartLock lock(this);
       auto it = rates.find(key);
       if (it == rates.end()) CBANG_THROW("Rate '" << key << "' not in set");
       return it->second;
@@ -69,29 +78,44 @@ namespace cb {
 
 
     void reset() {
+      SmartLock lock(this);
       for (auto it = rates.begin(); it != rates.end(); it++)
         it->second.reset();
     }
 
 
     bool has(const std::string &key) const {
+      SmartLock lock(this);
       return rates.find(key) != rates.end();
     }
 
 
     double get(const std::string &key, uint64_t now = Time::now()) const {
+      SmartLock lock(this);
       return getRate(key).get(now);
     }
 
 
     void event(const std::string &key, double value = 1,
                uint64_t now = Time::now()) {
+      SmartLock lock(this);
       getRate(key).event(value, now);
     }
 
 
+    /// Add the rates from another set with the same size and period
+    void add(const RateSet &o) {
+      SmartLock lock(this);
+      SmartLock oLock(&o);
+
+      for (auto it = o.rates.begin(); it != o.rates.end(); it++)
+        getRate(it->first).add(it->second);
+    }
+
+
     // From JSON::Serializable
     void write(JSON::Sink &sink) const {
+      SmartLock lock(this);
       sink.beginDict();
       for (auto it = rates.begin(); it != rates.end(); it++)
         sink.insert(it->first, it->second.get());
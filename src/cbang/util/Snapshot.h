@@ -0,0 +1,87 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#pragma once
+
+#include <cbang/SmartPointer.h>
+
+#include <atomic>
+
+namespace cb {
+  /**
+   * Holds the current version of an object which is not modified once
+   * published.  Readers get their own reference which stays valid after
+   * set() publishes a replacement.  Readers never wait on a rebuild, only
+   * the pointer copy itself is guarded by a short spin.
+   */
+  template <typename T>
+  class Snapshot {
+  public:
+    typedef typename SmartPointer<T>::Protected ptr_t;
+
+  private:
+    ptr_t ptr;
+    mutable std::atomic_flag busy;
+
+  public:
+    Snapshot(const ptr_t &ptr = 0) : ptr(ptr) {busy.clear();}
+    Snapshot(const Snapshot &o) : ptr(o.get()) {busy.clear();}
+    Snapshot &operator=(const Snapshot &o) {set(o.get()); return *this;}
+
+
+    ptr_t get() const {
+      acquire();
+      ptr_t p = ptr;
+      release();
+      return p;
+    }
+
+
+    void set(const ptr_t &p) {
+      ptr_t old;
+
+      acquire();
+      old = ptr;
+      ptr = p;
+      release();
+
+      // The old version is freed outside the spin, if this was the last user
+    }
+
+  private:
+    void acquire() const {
+      while (busy.test_and_set(std::memory_order_acquire)) continue;
+    }
+
+    void release() const {busy.clear(std::memory_order_release);}
+  };
+}
@@ -0,0 +1,134 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+#pragma once
+
+#include <cbang/StdTypes.h>
+
+#include <vector>
+
+
+namespace cb {
+  /**
+   * A hierarchical timer wheel.  Each of the LEVELS wheels has 2^BITS
+   * slots and each slot of a level spans a whole turn of the level below.
+   * Adding a timer is O(1) and advance() only touches timers which expire
+   * or move down a level, so the cost is proportional to the number of
+   * expired timers rather than the number of timers.  Timers further out
+   * than the top wheel wait in an overflow list until it turns.
+   */
+  template <typename T, unsigned BITS = 6, unsigned LEVELS = 4>
+  class TimerWheel {
+  public:
+    static const unsigned SLOTS = 1 << BITS;
+
+  protected:
+    struct Timer {
+      uint64_t when;
+      T value;
+      Timer(uint64_t when, const T &value) : when(when), value(value) {}
+    };
+
+    typedef std::vector<Timer> slot_t;
+    slot_t slots[LEVELS][SLOTS];
+    slot_t overflow;
+
+    uint64_t current;
+    uint64_t count = 0;
+
+  public:
+    TimerWheel(uint64_t now = 0) : current(now) {}
+
+    uint64_t getCurrent() const {return current;}
+    uint64_t size() const {return count;}
+    bool empty() const {return !count;}
+
+
+    void add(uint64_t when, const T &value) {
+      // Timers at or before the current tick fire on the next one
+      if (when <= current) when = current + 1;
+      place(Timer(when, value));
+      count++;
+    }
+
+
+    /// Call @param cb with the value of every timer due at or before @param now
+    template <typename CB>
+    void advance(uint64_t now, CB cb) {
+      while (current < now) {
+        if (!count) {current = now; break;}
+
+        current++;
+
+        // Move timers from the slots now reached down a level
+        if (!lowBits(current, LEVELS)) cascade(overflow);
+        for (unsigned level = LEVELS - 1; level; level--)
+          if (!lowBits(current, level))
+            cascade(slots[level][digit(current, level)]);
+
+        slot_t expired;
+        expired.swap(slots[0][digit(current, 0)]);
+        count -= expired.size();
+
+        for (unsigned i = 0; i < expired.size(); i++) cb(expired[i].value);
+      }
+    }
+
+
+  protected:
+    static uint64_t lowBits(uint64_t t, unsigned level)
+    {return t & ((1ULL << (BITS * level)) - 1);}
+    static unsigned digit(uint64_t t, unsigned level)
+    {return (t >> (BITS * level)) & (SLOTS - 1);}
+
+
+    void place(const Timer &timer) {
+      // The lowest level whose parent slot also holds the current time
+      for (unsigned level = 0; level < LEVELS; level++) {
+        unsigned shift = BITS * (level + 1);
+
+        if ((timer.when >> shift) == (current >> shift)) {
+          slots[level][digit(timer.when, level)].push_back(timer);
+          return;
+        }
+      }
+
+      overflow.push_back(timer);
+    }
+
+
+    void cascade(slot_t &slot) {
+      slot_t timers;
+      timers.swap(slot);
+      for (unsigned i = 0; i < timers.size(); i++) place(timers[i]);
+    }
+  };
+}
@@ -34,9 +34,12 @@
 
 #include <cbang/json/Value.h>
 #include <cbang/json/Reader.h>
+#include <cbang/json/BufferReader.h>
+#include <cbang/json/Document.h>
 #include <cbang/json/YAMLReader.h>
 
 #include <iostream>
+#include <sstream>
 
 using namespace std;
 using namespace cb::JSON;
@@ -56,6 +59,18 @@ int main(int argc, char *argv[]) {
         cout << *docs[i];
       }
 
+    } else if (argc == 2 && string(argv[1]) == "--buffer") {
+      ostringstream str;
+      str << cin.rdbuf();
+      data = BufferReader::parseString(str.str());
+      if (!data.isNull()) cout << *data;
+
+    } else if (argc == 2 && string(argv[1]) == "--document") {
+      ostringstream str;
+      str << cin.rdbuf();
+      DocumentPtr doc = BufferReader::parseDocumentString(str.str());
+      if (!doc->getRoot().isUndefined()) cout << doc->getRoot().toString();
+
     } else {
       Reader reader(cin);
       data = reader.parse();
@@ -0,0 +1,207 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/String.h>
+#include <cbang/log/AsyncLogWriter.h>
+#include <cbang/log/Logger.h>
+
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  SmartPointer<stringstream> screen;
+
+
+  bool push(AsyncLogWriter &writer, const string &line) {
+    return writer.push(line.data(), line.length());
+  }
+
+
+  void print(const string &output) {
+    unsigned lines = 0;
+    for (unsigned i = 0; i < output.size(); i++)
+      if (output[i] == '\n') lines++;
+    cout << "lines=" << lines << endl << output;
+  }
+
+
+  // Check that every thread's lines arrived complete and in order
+  void checkOrder(const string &output, unsigned threads, unsigned count) {
+    vector<unsigned> next(threads);
+    istringstream in(output);
+    string line;
+
+    while (getline(in, line)) {
+      vector<string> parts;
+      String::tokenize(line, parts);
+      if (parts.size() != 2) THROW("Corrupt line '" << line << "'");
+
+      unsigned t = String::parseU32(parts[0]);
+      unsigned i = String::parseU32(parts[1]);
+      if (threads <= t || next[t] != i)
+        THROW("Out of order line '" << line << "'");
+      next[t]++;
+    }
+
+    for (unsigned t = 0; t < threads; t++)
+      if (next[t] != count)
+        THROW("Thread " << t << " lost lines, got " << next[t]);
+
+    cout << "threads=" << threads << " lines=" << threads * count
+         << " ordered=true" << endl;
+  }
+
+
+  void pushLines(AsyncLogWriter &writer, unsigned threads, unsigned count) {
+    vector<thread> producers;
+
+    for (unsigned t = 0; t < threads; t++)
+      producers.push_back(thread([&writer, t, count] () {
+            for (unsigned i = 0; i < count; i++)
+              push(writer, SSTR(t << ' ' << i << '\n'));
+          }));
+
+    for (unsigned t = 0; t < threads; t++) producers[t].join();
+  }
+}
+
+
+void testOrder() {
+  AsyncLogWriter writer(64);
+  writer.setScreen(screen);
+  writer.start();
+
+  pushLines(writer, 4, 5000);
+
+  writer.join();
+  writer.drain();
+
+  checkOrder(screen->str(), 4, 5000);
+  cout << "dropped=" << writer.getDropped() << endl;
+}
+
+
+void testDrop() {
+  AsyncLogWriter writer(4, AsyncLogWriter::OVERFLOW_DROP);
+  writer.setScreen(screen);
+
+  // The writer thread is not running so the ring fills up
+  for (unsigned i = 0; i < 10; i++)
+    cout << "push " << i << ' '
+         << (push(writer, SSTR("line " << i << '\n')) ? "queued" : "dropped")
+         << endl;
+
+  writer.drain();
+  cout << "dropped=" << writer.getDropped() << endl;
+  print(screen->str());
+}
+
+
+void testCount() {
+  AsyncLogWriter writer(2, AsyncLogWriter::OVERFLOW_COUNT);
+  writer.setScreen(screen);
+
+  for (unsigned i = 0; i < 5; i++) push(writer, SSTR("line " << i << '\n'));
+
+  writer.drain();
+  push(writer, "after\n");
+  writer.drain();
+
+  cout << "dropped=" << writer.getDropped() << endl;
+  print(screen->str());
+}
+
+
+void testBlock() {
+  // A ring much smaller than the output makes producers wait for the writer
+  AsyncLogWriter writer(2, AsyncLogWriter::OVERFLOW_BLOCK);
+  writer.setScreen(screen);
+  writer.start();
+
+  pushLines(writer, 3, 2000);
+
+  writer.join();
+  writer.drain();
+
+  checkOrder(screen->str(), 3, 2000);
+  cout << "dropped=" << writer.getDropped() << endl;
+}
+
+
+void testLogger() {
+  Logger &log = Logger::instance();
+  log.setScreenStream(screen);
+  log.setLogHeader(false);
+  log.setLogColor(false);
+  log.setLogAsync(true);
+
+  cout << "async=" << log.getLogAsync() << endl;
+
+  for (unsigned i = 0; i < 3; i++) LOG_INFO(1, "message " << i);
+  LOG_WARNING("warning");
+
+  log.setLogAsync(false);
+  cout << "async=" << log.getLogAsync() << " dropped=" << log.getLogDropped()
+       << endl;
+
+  LOG_INFO(1, "sync");
+  print(screen->str());
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc != 2) THROW("Usage: " << argv[0] << " <test>");
+    string name = argv[1];
+
+    screen = new stringstream;
+
+    if (name == "order") testOrder();
+    else if (name == "drop") testDrop();
+    else if (name == "count") testCount();
+    else if (name == "block") testBlock();
+    else if (name == "logger") testLogger();
+    else THROW("Unknown test " << name);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,150 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/async/AsyncScheduler.h>
+#include <cbang/event/Base.h>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace cb;
+using namespace std;
+
+
+void testCallbacks() {
+  Event::Base base;
+  AsyncScheduler sched(base, 2);
+
+  const unsigned count = 8;
+  thread::id loopID = this_thread::get_id();
+  vector<unsigned> results(count);
+  atomic<unsigned> onPool(0);
+  unsigned onLoop = 0;
+  unsigned done = 0;
+
+  for (unsigned i = 0; i < count; i++) {
+    auto work = [&, i] () {
+      results[i] = i * i;
+      if (this_thread::get_id() != loopID) onPool++;
+    };
+
+    auto cb = [&, i] () {
+      if (this_thread::get_id() == loopID) onLoop++;
+      if (++done == count) base.loopExit();
+    };
+
+    sched.add(work, cb);
+  }
+
+  base.dispatch();
+
+  cout << "done " << done << "/" << count << endl;
+  cout << "work on pool " << onPool << endl;
+  cout << "callbacks on loop " << onLoop << endl;
+  for (unsigned i = 0; i < count; i++) cout << results[i] << ' ';
+  cout << endl;
+}
+
+
+void testErrors() {
+  Event::Base base;
+  AsyncScheduler sched(base, 1);
+
+  auto fail = [] (const string &msg) {
+    return [msg] () {THROW(msg);};
+  };
+  auto never = [] () {cout << "callback after error" << endl;};
+
+  sched.setErrorHandler([&] (const Exception &e) {
+    cout << "default handler: " << e.getMessage() << endl;
+    base.loopExit();
+  });
+
+  sched.add(fail("first"), never);
+  base.dispatch();
+
+  sched.add(fail("second"), never, [&] (const Exception &e) {
+    cout << "call handler: " << e.getMessage() << endl;
+    base.loopExit();
+  });
+  base.dispatch();
+
+  sched.add([] () {}, [&] () {cout << "success" << endl; base.loopExit();});
+  base.dispatch();
+}
+
+
+void testPriority() {
+  Event::Base base;
+  AsyncScheduler sched(base, 1);
+
+  // Block the only thread until all tasks are queued
+  Mutex lock;
+  lock.lock();
+  sched.add([&] () {lock.lock(); lock.unlock();});
+
+  unsigned done = 0;
+  for (int priority: {1, 3, 2}) {
+    auto cb = [&, priority] () {
+      cout << "priority " << priority << endl;
+      if (++done == 3) base.loopExit();
+    };
+
+    sched.add([] () {}, cb, 0, priority);
+  }
+
+  lock.unlock();
+  base.dispatch();
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+    string test = argv[1];
+
+    Event::Base::enableThreads();
+
+    if (test == "callbacks") testCallbacks();
+    else if (test == "errors") testErrors();
+    else if (test == "priority") testPriority();
+    else THROW("Unknown test " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,284 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/Connection.h>
+#include <cbang/event/HTTPServerPool.h>
+#include <cbang/event/HTTPHandler.h>
+#include <cbang/event/Websocket.h>
+#include <cbang/log/Logger.h>
+#include <cbang/openssl/SSLContext.h>
+#include <cbang/socket/Socket.h>
+#include <cbang/util/Random.h>
+
+#include <iostream>
+
+using namespace cb;
+using namespace cb::Event;
+using namespace std;
+
+
+namespace {
+  // A 1KiB payload is framed with a 4 byte header
+  const unsigned FRAME = 1028;
+  const unsigned TOTAL = 1000;
+
+  string payload(1024, 'x');
+  bool honorWritable = false;
+
+  // Written on the server thread, read after the pool is joined
+  unsigned firstBlock = 0;
+  unsigned blocked = 0;
+  unsigned resumed = 0;
+  uint64_t peak = 0;
+  uint64_t dropped = 0;
+}
+
+
+struct StreamWebsocket : public Websocket {
+  unsigned sent = 0;
+
+  using Websocket::Websocket;
+
+  void pump() {
+    while (sent < TOTAL && (isWritable() || !honorWritable)) {
+      sent++;
+      send(payload);
+    }
+
+    if (sent < TOTAL) return; // Resume in onWritable()
+
+    peak = getConnection().getBase().getOutputPeak();
+    dropped = getMessagesDropped();
+    close(WS_STATUS_NORMAL);
+  }
+
+
+  // From Websocket
+  void onMessage(const char *data, uint64_t length) {pump();}
+
+  // From Request
+  void onWritable(bool writable) {
+    if (writable) resumed++;
+    else if (!blocked++) firstBlock = sent;
+
+    if (writable && sent < TOTAL) pump();
+  }
+};
+
+
+struct StreamHandler : public HTTPHandler {
+  // From HTTPHandler
+  SmartPointer<Request> createRequest
+  (Connection &con, RequestMethod method, const URI &uri,
+   const Version &version) {return new StreamWebsocket(method, uri, version);}
+
+  bool handleRequest(Request &req) {return false;}
+  void endRequest(Request &req) {}
+};
+
+
+class Client {
+  Socket socket;
+  string input;
+
+public:
+  Client(const IPAddress &addr) {
+    socket.connect(addr);
+
+    string request =
+      "GET /stream HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Upgrade: websocket\r\n"
+      "Connection: Upgrade\r\n"
+      "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+      "Sec-WebSocket-Version: 13\r\n\r\n";
+    socket.write(request.data(), request.length());
+
+    size_t end;
+    while ((end = input.find("\r\n\r\n")) == string::npos) fill();
+
+    if (input.find(" 101 ") == string::npos)
+      THROW("Upgrade failed: " << input.substr(0, end));
+    input = input.substr(end + 4);
+  }
+
+
+  void fill() {
+    char buf[16 * 1024];
+    input.append(buf, socket.read(buf, sizeof(buf)));
+  }
+
+
+  void send(const string &msg, uint8_t opcode = 1) {
+    uint8_t header[8] = {(uint8_t)(0x80 | opcode),
+                         (uint8_t)(0x80 | msg.length())};
+    Random::instance().bytes(header + 2, 4);
+
+    string frame((char *)header, 6);
+    frame.resize(6 + msg.length());
+    Websocket::mask(header + 2, msg.data(), &frame[6], msg.length());
+    socket.write(frame.data(), frame.length());
+  }
+
+
+  /// @return The number of messages received before the connection ended
+  unsigned receive(bool &closeFrame) {
+    unsigned count = 0;
+    closeFrame = false;
+
+    try {
+      while (true) {
+        while (input.length() < 2) fill();
+        const uint8_t *header = (const uint8_t *)input.data();
+        uint8_t opcode = header[0] & 0xf;
+        uint64_t length = header[1] & 0x7f;
+        unsigned bytes = 2;
+
+        if (length == 126) {
+          while (input.length() < 4) fill();
+          header = (const uint8_t *)input.data();
+          length = (uint64_t)header[2] << 8 | header[3];
+          bytes = 4;
+
+        } else if (length == 127) THROW("Unexpected large frame");
+
+        while (input.length() < bytes + length) fill();
+        input.erase(0, bytes + length);
+
+        if (opcode == 8) {closeFrame = true; break;}
+        count++;
+      }
+
+      send(string("\x03\xe8", 2), 8); // Reply to close
+    } catch (const Socket::EndOfStream &e) {}
+
+    socket.close();
+
+    return count;
+  }
+};
+
+
+unsigned run(unsigned port, OutputPolicy policy, unsigned high, unsigned low,
+         uint64_t budget, bool honor) {
+  IPAddress addr("127.0.0.1", port);
+
+  HTTPServerPool pool(1, new StreamHandler);
+  pool.setOutputWatermarks(high, low);
+  pool.setOutputPolicy(policy);
+  pool.setOutputBudget(budget);
+  pool.bind(addr);
+  pool.start();
+
+  honorWritable = honor;
+
+  Client client(addr);
+  client.send("go");
+
+  bool closeFrame;
+  unsigned received = client.receive(closeFrame);
+  pool.join();
+
+  cout << "close frame " << closeFrame << endl
+       << "dropped " << dropped << endl;
+
+  return received;
+}
+
+
+void testWatermarks() {
+  // Blocks on the frame which takes output past 64KiB
+  unsigned received =
+    run(28291, OutputPolicy::OUTPUT_PAUSE, 64 * 1024, 16 * 1024, 0, true);
+
+  cout << "received " << received << endl
+       << "first block after " << firstBlock << endl
+       << "resumed " << (bool)resumed << endl
+       << "peak within watermark " << (peak <= 64 * 1024 + FRAME) << endl;
+}
+
+
+void testBudget() {
+  // No per connection limit, blocks once the Base is over budget
+  unsigned received =
+    run(28292, OutputPolicy::OUTPUT_PAUSE, 0, 0, 32 * 1024, true);
+
+  cout << "received " << received << endl
+       << "first block after " << firstBlock << endl
+       << "resumed " << (bool)resumed << endl
+       << "peak within budget " << (peak <= 32 * 1024 + FRAME) << endl;
+}
+
+
+void testDrop() {
+  // Nothing drains while the producer sends, all after the block are dropped
+  unsigned received =
+    run(28293, OutputPolicy::OUTPUT_DROP, 64 * 1024, 16 * 1024, 0, false);
+
+  cout << "received " << received << endl
+       << "first block after " << firstBlock << endl
+       << "dropped bytes " << dropped * payload.length() << endl;
+}
+
+
+void testClose() {
+  // The connection is closed without a Websocket close frame
+  unsigned received =
+    run(28294, OutputPolicy::OUTPUT_CLOSE, 64 * 1024, 16 * 1024, 0, false);
+
+  cout << "received some " << (received < TOTAL) << endl
+       << "writable callbacks " << (blocked + resumed) << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+
+    Logger::instance().setVerbosity(0);
+
+    string test = argv[1];
+
+    if (test == "watermarks") testWatermarks();
+    else if (test == "budget") testBudget();
+    else if (test == "drop") testDrop();
+    else if (test == "close") testClose();
+    else THROW("Unknown test: " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,222 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/config.h>
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/Event.h>
+#include <cbang/os/TemporaryDirectory.h>
+#include <cbang/time/Timer.h>
+
+#ifdef HAVE_LEVELDB
+#include <cbang/db/AsyncLevelDB.h>
+#endif
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+using namespace cb;
+using namespace std;
+
+
+#ifdef HAVE_LEVELDB
+// Measures how late a 1ms timer fires while the DB is busy
+class Ticker {
+  SmartPointer<Event::Event> event;
+  double interval = 0.001;
+  double expected;
+
+public:
+  vector<double> lateness;
+
+  Ticker(Event::Base &base) :
+    event(base.newEvent(this, &Ticker::tick)) {
+    expected = Timer::now() + interval;
+    event->add(interval);
+  }
+
+  ~Ticker() {event->del();}
+
+  void tick() {
+    double now = Timer::now();
+    lateness.push_back(max(0.0, now - expected));
+    expected = now + interval;
+  }
+};
+
+
+struct Load {
+  Event::Base &base;
+  unsigned count;
+  unsigned chunk;
+  string value;
+  unsigned next = 0;
+  unsigned done = 0;
+
+  Load(Event::Base &base, unsigned count, unsigned chunk) :
+    base(base), count(count), chunk(chunk), value(100, 'x') {}
+
+  bool more() const {return next < count;}
+
+  void nextChunk(AsyncLevelDB::pairs_t &pairs, AsyncLevelDB::keys_t &keys) {
+    for (unsigned i = 0; i < chunk && next < count; i++, next++) {
+      string key = String::printf("key%08u", (next * 7919) % count);
+      pairs.push_back(AsyncLevelDB::pairs_t::value_type(key, value));
+      keys.push_back(key);
+    }
+  }
+
+  void finished(unsigned n) {if ((done += n) == count) base.loopExit();}
+};
+
+
+// DB calls made directly from the event loop, one chunk per callback
+void runSync(Event::Base &base, LevelDB &db, Load &load) {
+  SmartPointer<Event::Event> event;
+
+  event = base.newEvent([&] () {
+      AsyncLevelDB::pairs_t pairs;
+      AsyncLevelDB::keys_t keys;
+      load.nextChunk(pairs, keys);
+
+      LevelDB::Batch batch = db.batch();
+      for (unsigned i = 0; i < pairs.size(); i++)
+        batch.set(pairs[i].first, pairs[i].second);
+      batch.commit();
+
+      for (unsigned i = 0; i < keys.size(); i++) db.get(keys[i]);
+
+      load.finished(keys.size());
+      if (load.more()) event->add(0); // Let timers run between chunks
+    }, 0);
+
+  event->add(0);
+  base.dispatch();
+}
+
+
+void runAsync(Event::Base &base, AsyncLevelDB &db, Load &load,
+              unsigned parallel) {
+  function<void ()> issue = [&] () {
+    if (!load.more()) return;
+
+    AsyncLevelDB::pairs_t pairs;
+    AsyncLevelDB::keys_t keys;
+    load.nextChunk(pairs, keys);
+
+    db.set(pairs, [&, keys] () {
+        db.get(keys, "", [&] (const AsyncLevelDB::values_t &values) {
+            load.finished(values.size());
+            issue();
+          });
+      });
+  };
+
+  for (unsigned i = 0; i < parallel; i++) issue();
+  base.dispatch();
+}
+
+
+void report(const char *name, unsigned count, double delta,
+            vector<double> &lateness) {
+  sort(lateness.begin(), lateness.end());
+  double avg = 0;
+  for (unsigned i = 0; i < lateness.size(); i++) avg += lateness[i];
+  if (lateness.size()) avg /= lateness.size();
+  else lateness.push_back(delta); // Never ran
+
+  cout << setw(8) << name
+       << setw(14) << fixed << setprecision(0) << count * 2 / delta
+       << setw(10) << lateness.size()
+       << setw(14) << setprecision(1) << avg * 1e6
+       << setw(14) << lateness[lateness.size() * 99 / 100] * 1e6
+       << setw(14) << lateness.back() * 1e6 << endl;
+}
+
+
+void bench(const string &mode, unsigned count, unsigned chunk,
+           unsigned threads) {
+  Event::Base base(true);
+  SmartPointer<AsyncScheduler> scheduler = new AsyncScheduler(base, threads);
+  TemporaryDirectory tmp(".");
+
+  AsyncLevelDB db(scheduler);
+  db.LevelDB::open(tmp.getPath() + "/db", LevelDB::CREATE_IF_MISSING);
+
+  Load load(base, count, chunk);
+  double start = Timer::now();
+  vector<double> lateness;
+
+  {
+    Ticker ticker(base);
+
+    if (mode == "sync") runSync(base, db, load);
+    else runAsync(base, db, load, threads);
+
+    lateness = ticker.lateness;
+  }
+
+  report(mode.c_str(), count, Timer::now() - start, lateness);
+}
+#endif // HAVE_LEVELDB
+
+
+int main(int argc, char *argv[]) {
+  try {
+#ifdef HAVE_LEVELDB
+    unsigned count = 200000;
+    unsigned chunk = 500;
+    unsigned threads = 4;
+
+    if (1 < argc) count = String::parseU32(argv[1]);
+    if (2 < argc) chunk = String::parseU32(argv[2]);
+    if (3 < argc) threads = String::parseU32(argv[3]);
+
+    Event::Base::enableThreads();
+
+    cout << setw(8) << "mode" << setw(14) << "ops/sec" << setw(10) << "ticks"
+         << setw(14) << "avg late us" << setw(14) << "p99 late us"
+         << setw(14) << "max late us" << endl;
+
+    bench("sync", count, chunk, threads);
+    bench("async", count, chunk, threads);
+
+    return 0;
+#else
+    THROW("Built without LevelDB");
+#endif
+  } CATCH_ERROR;
+
+  return 1;
+}
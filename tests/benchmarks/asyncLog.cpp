@@ -0,0 +1,115 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/log/Logger.h>
+#include <cbang/os/ThreadPool.h>
+#include <cbang/os/SystemUtilities.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+
+using namespace cb;
+using namespace std;
+
+
+class LogPool : public ThreadPool {
+  unsigned count;
+
+public:
+  LogPool(unsigned threads, unsigned count) :
+    ThreadPool(threads), count(count) {}
+
+  // From ThreadPool
+  void run() {
+    for (unsigned i = 0; i < count; i++)
+      CBANG_LOG_INFO(1, "Benchmark line " << i << " value=" << i * 0.5);
+  }
+};
+
+
+double bench(bool async, unsigned threads, unsigned count) {
+  Logger &logger = Logger::instance();
+  LogPool pool(threads, count);
+
+  double start = Timer::now();
+  logger.setLogAsync(async);
+  pool.start();
+  pool.wait();
+  logger.setLogAsync(false); // Waits for all lines to be written
+
+  return (double)threads * count / (Timer::now() - start);
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned count = 100000;
+    unsigned maxThreads = 16;
+    string path = "asyncLog.log";
+
+    if (1 < argc) count = String::parseU32(argv[1]);
+    if (2 < argc) maxThreads = String::parseU32(argv[2]);
+    if (3 < argc) path = argv[3];
+
+    Logger &logger = Logger::instance();
+    logger.setLogToScreen(false);
+    logger.setLogRotate(false);
+    logger.setLogTruncate(true);
+    logger.setLogThreadID(true);
+    logger.setLogAsyncQueue(8192);
+    logger.startLogFile(path);
+
+    cout << "Logged lines per second" << endl
+         << setw(8) << "threads" << setw(14) << "sync"
+         << setw(14) << "async" << setw(10) << "speedup" << endl;
+
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+      double syncRate = bench(false, threads, count);
+      double asyncRate = bench(true, threads, count);
+
+      cout << setw(8) << threads
+           << setw(14) << fixed << setprecision(0) << syncRate
+           << setw(14) << asyncRate
+           << setw(9) << setprecision(2) << asyncRate / syncRate << 'x'
+           << endl;
+    }
+
+    SystemUtilities::unlink(path);
+
+    return 0;
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,251 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/Connection.h>
+#include <cbang/event/HTTPServerPool.h>
+#include <cbang/event/HTTPHandler.h>
+#include <cbang/event/Websocket.h>
+#include <cbang/log/Logger.h>
+#include <cbang/openssl/SSLContext.h>
+#include <cbang/socket/Socket.h>
+#include <cbang/time/Timer.h>
+#include <cbang/util/Random.h>
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+
+using namespace cb;
+using namespace cb::Event;
+using namespace std;
+
+
+namespace {
+  string payload;
+  unsigned total = 0;
+  bool honorWritable = false;
+
+  atomic<uint64_t> peakBuffered(0);
+  atomic<uint64_t> dropped(0);
+}
+
+
+struct StreamWebsocket : public Websocket {
+  unsigned remaining = 0;
+
+  using Websocket::Websocket;
+
+  void pump() {
+    while (remaining && (isWritable() || !honorWritable)) {
+      send(payload);
+      remaining--;
+    }
+
+    if (remaining) return; // Resume in onWritable()
+
+    peakBuffered = getConnection().getBase().getOutputPeak();
+    dropped = getMessagesDropped();
+    close(WS_STATUS_NORMAL);
+  }
+
+
+  // From Websocket
+  void onMessage(const char *data, uint64_t length) {
+    remaining = total;
+    pump();
+  }
+
+  // From Request
+  void onWritable(bool writable) {if (writable && remaining) pump();}
+};
+
+
+struct StreamHandler : public HTTPHandler {
+  // From HTTPHandler
+  SmartPointer<Request> createRequest
+  (Connection &con, RequestMethod method, const URI &uri,
+   const Version &version) {return new StreamWebsocket(method, uri, version);}
+
+  bool handleRequest(Request &req) {return false;}
+  void endRequest(Request &req) {}
+};
+
+
+class Client {
+  Socket socket;
+  string input;
+
+public:
+  Client(const IPAddress &addr) {
+    socket.connect(addr);
+
+    string request =
+      "GET /stream HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Upgrade: websocket\r\n"
+      "Connection: Upgrade\r\n"
+      "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+      "Sec-WebSocket-Version: 13\r\n\r\n";
+    socket.write(request.data(), request.length());
+
+    size_t end;
+    while ((end = input.find("\r\n\r\n")) == string::npos) fill();
+
+    if (input.find(" 101 ") == string::npos)
+      THROW("Upgrade failed: " << input.substr(0, end));
+    input = input.substr(end + 4);
+  }
+
+
+  void fill() {
+    char buf[16 * 1024];
+    input.append(buf, socket.read(buf, sizeof(buf)));
+  }
+
+
+  void send(const string &msg, uint8_t opcode = 1) {
+    uint8_t header[8] = {(uint8_t)(0x80 | opcode),
+                         (uint8_t)(0x80 | msg.length())};
+    Random::instance().bytes(header + 2, 4);
+
+    string frame((char *)header, 6);
+    frame.resize(6 + msg.length());
+    Websocket::mask(header + 2, msg.data(), &frame[6], msg.length());
+    socket.write(frame.data(), frame.length());
+  }
+
+
+  /// @return The number of messages received before the server closed
+  unsigned receive() {
+    unsigned count = 0;
+
+    while (true) {
+      while (input.length() < 2) fill();
+      const uint8_t *header = (const uint8_t *)input.data();
+      uint8_t opcode = header[0] & 0xf;
+      uint64_t length = header[1] & 0x7f;
+      unsigned bytes = 2;
+
+      if (length == 126) {
+        while (input.length() < 4) fill();
+        header = (const uint8_t *)input.data();
+        length = (uint64_t)header[2] << 8 | header[3];
+        bytes = 4;
+
+      } else if (length == 127) THROW("Unexpected large frame");
+
+      while (input.length() < bytes + length) fill();
+      input.erase(0, bytes + length);
+
+      if (opcode == 8) break;
+      count++;
+    }
+
+    send(string("\x03\xe8", 2), 8); // Reply to close
+    socket.close();
+
+    return count;
+  }
+};
+
+
+void bench(const IPAddress &addr, const string &name, OutputPolicy policy,
+           unsigned high, unsigned low, uint64_t budget, bool honor) {
+  HTTPServerPool pool(1, new StreamHandler);
+  pool.setOutputWatermarks(high, low);
+  pool.setOutputPolicy(policy);
+  pool.setOutputBudget(budget);
+  pool.bind(addr);
+  pool.start();
+
+  honorWritable = honor;
+  peakBuffered = dropped = 0;
+
+  Client client(addr);
+
+  double start = Timer::now();
+  client.send("go");
+  unsigned received = client.receive();
+  double delta = Timer::now() - start;
+
+  cout << setw(24) << name << setw(12) << fixed << setprecision(0)
+       << received / delta << setw(12) << received << setw(10) << dropped
+       << setw(14) << setprecision(1) << peakBuffered / 1024.0 << endl;
+
+  pool.join();
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned size = 1024;
+    unsigned high = 256 * 1024;
+    unsigned low = 64 * 1024;
+    IPAddress addr("127.0.0.1:18091");
+
+    total = 50000;
+    if (1 < argc) total = String::parseU32(argv[1]);
+    if (2 < argc) size = String::parseU32(argv[2]);
+    if (3 < argc) high = String::parseU32(argv[3]);
+    if (4 < argc) low = String::parseU32(argv[4]);
+    if (5 < argc) addr = IPAddress(argv[5]);
+
+    Logger::instance().setVerbosity(0);
+
+    if (0xffff < size) THROW("Message too large");
+    payload = string(size, 'x');
+
+    cout << "Streaming " << total << " Websocket messages of " << size
+         << " bytes, high " << high << " low " << low << endl
+         << setw(24) << "mode" << setw(12) << "msgs/sec" << setw(12)
+         << "received" << setw(10) << "dropped" << setw(14) << "peak KiB"
+         << endl;
+
+    // A fresh port for each run, the previous server may linger
+    bench(addr, "unbounded", OutputPolicy::OUTPUT_PAUSE, 0, 0, 0, false);
+    addr.setPort(addr.getPort() + 1);
+    bench(addr, "pause watermarks", OutputPolicy::OUTPUT_PAUSE, high, low, 0,
+          true);
+    addr.setPort(addr.getPort() + 1);
+    bench(addr, "pause budget", OutputPolicy::OUTPUT_PAUSE, 0, 0, high, true);
+    addr.setPort(addr.getPort() + 1);
+    bench(addr, "drop watermarks", OutputPolicy::OUTPUT_DROP, high, low, 0,
+          false);
+
+    return 0;
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,230 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/Event.h>
+#include <cbang/event/ConcurrentPool.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+using namespace cb;
+using namespace std;
+
+typedef Event::ConcurrentPool::Task Task;
+
+
+// The original single queue pool, for comparison
+class GlobalQueuePool : protected ThreadPool, protected Condition {
+  Event::Base &base;
+  SmartPointer<Event::Event> event;
+
+  typedef priority_queue<SmartPointer<Task>, vector<SmartPointer<Task> >,
+                         Event::ConcurrentPool::TaskPtrCompare> queue_t;
+  queue_t ready;
+  queue_t completed;
+
+public:
+  GlobalQueuePool(Event::Base &base, unsigned size) :
+    ThreadPool(size), base(base),
+    event(base.newEvent(this, &GlobalQueuePool::complete,
+                        Event::EventFlag::EVENT_NO_SELF_REF)) {}
+
+  using ThreadPool::start;
+
+  void submit(const SmartPointer<Task> &task) {
+    SmartLock lock(this);
+    ready.push(task);
+    Condition::signal();
+  }
+
+  void join() {
+    ThreadPool::stop();
+    Condition::broadcast();
+    ThreadPool::wait();
+  }
+
+protected:
+  void run() {
+    SmartLock lock(this);
+
+    while (!Thread::current().shouldShutdown()) {
+      if (ready.empty()) Condition::wait();
+      if (ready.empty()) continue;
+
+      SmartPointer<Task> task = ready.top();
+      ready.pop();
+
+      {
+        SmartUnlock unlock(this);
+        try {task->run();} catch (const Exception &e) {task->setException(e);}
+      }
+
+      completed.push(task);
+      if (!event->isPending()) event->activate();
+    }
+  }
+
+  void complete() {
+    SmartLock lock(this);
+
+    while (!completed.empty()) {
+      SmartPointer<Task> task = completed.top();
+      completed.pop();
+
+      SmartUnlock unlock(this);
+      task->success();
+      task->complete();
+    }
+  }
+};
+
+
+struct Results {
+  Event::Base &base;
+  unsigned total;
+  unsigned done = 0;
+  vector<double> latencies;
+
+  Results(Event::Base &base, unsigned total) : base(base), total(total) {
+    latencies.reserve(total);
+  }
+};
+
+
+class BenchTask : public Task {
+  Results &results;
+  unsigned work;
+  double submitted;
+
+public:
+  volatile unsigned sum = 0;
+
+  BenchTask(Results &results, unsigned work) :
+    Task(0), results(results), work(work), submitted(Timer::now()) {}
+
+  // From Task
+  void run() {for (unsigned i = 0; i < work; i++) sum += i;}
+
+  void success() {
+    results.latencies.push_back(Timer::now() - submitted);
+    if (++results.done == results.total) results.base.loopExit();
+  }
+};
+
+
+template <typename Pool>
+class Producers : public ThreadPool {
+  Pool &pool;
+  Results &results;
+  unsigned count;
+  unsigned work;
+
+public:
+  Producers(Pool &pool, Results &results, unsigned threads, unsigned count,
+            unsigned work) :
+    ThreadPool(threads), pool(pool), results(results), count(count),
+    work(work) {}
+
+  // From ThreadPool
+  void run() {
+    for (unsigned i = 0; i < count; i++)
+      pool.submit(new BenchTask(results, work));
+  }
+};
+
+
+template <typename Pool>
+void bench(const char *name, unsigned workers, unsigned producers,
+           unsigned count, unsigned work) {
+  Event::Base base(true);
+  Results results(base, producers * count);
+  Pool pool(base, workers);
+  Producers<Pool> submitters(pool, results, producers, count, work);
+
+  // Keep the event loop alive until all tasks complete
+  SmartPointer<Event::Event> keepAlive = base.newEvent([] () {});
+  keepAlive->add(1);
+
+  double start = Timer::now();
+  pool.start();
+  submitters.start();
+  base.dispatch();
+  double delta = Timer::now() - start;
+
+  submitters.wait();
+  pool.join();
+
+  sort(results.latencies.begin(), results.latencies.end());
+  double p50 = results.latencies[results.latencies.size() / 2];
+  double p99 = results.latencies[results.latencies.size() * 99 / 100];
+
+  cout << setw(16) << name << setw(8) << workers << setw(10) << producers
+       << setw(14) << fixed << setprecision(0) << results.total / delta
+       << setw(12) << setprecision(1) << p50 * 1e6
+       << setw(12) << p99 * 1e6 << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned count = 100000;
+    unsigned work = 100;
+    unsigned maxWorkers = 32;
+
+    if (1 < argc) count = String::parseU32(argv[1]);
+    if (2 < argc) work = String::parseU32(argv[2]);
+    if (3 < argc) maxWorkers = String::parseU32(argv[3]);
+
+    Event::Base::enableThreads();
+
+    cout << setw(16) << "pool" << setw(8) << "workers"
+         << setw(10) << "producers" << setw(14) << "tasks/sec"
+         << setw(12) << "p50 usec" << setw(12) << "p99 usec" << endl;
+
+    for (unsigned workers = 1; workers <= maxWorkers; workers *= 2) {
+      unsigned producers = workers < 4 ? 1 : workers / 4;
+
+      bench<GlobalQueuePool>("global-queue", workers, producers, count, work);
+      bench<Event::ConcurrentPool>("work-stealing", workers, producers, count,
+                                   work);
+    }
+
+    return 0;
+  } CATCH_ERROR;
+
+  return 1;
+}
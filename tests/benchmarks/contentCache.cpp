@@ -0,0 +1,226 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/event/HTTPServerPool.h>
+#include <cbang/event/HTTPHandler.h>
+#include <cbang/event/ContentCache.h>
+#include <cbang/event/Request.h>
+#include <cbang/openssl/SSLContext.h>
+#include <cbang/os/ThreadPool.h>
+#include <cbang/log/Logger.h>
+#include <cbang/socket/Socket.h>
+#include <cbang/util/Resource.h>
+#include <cbang/time/Timer.h>
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+namespace io = boost::iostreams;
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+
+#include <string.h>
+#include <sys/resource.h>
+
+using namespace cb;
+using namespace cb::Event;
+using namespace std;
+
+
+typedef enum {MODE_IDENTITY, MODE_GZIP, MODE_CACHED} serve_t;
+const char *modeNames[] = {"identity", "gzip", "cached"};
+
+
+struct AssetHandler : public HTTPHandler {
+  const Resource &res;
+  serve_t mode;
+  ContentCache cache;
+
+  AssetHandler(const Resource &res, serve_t mode) : res(res), mode(mode) {}
+
+  // From HTTPHandler
+  SmartPointer<Request> createRequest
+  (Connection &con, RequestMethod method, const URI &uri,
+   const Version &version) {return new Request(method, uri, version);}
+
+  bool handleRequest(Request &req) {
+    switch (mode) {
+    case MODE_GZIP: {
+      // Compress on every request at the default level
+      string body;
+      io::filtering_ostream stream;
+      stream.push(io::gzip_compressor());
+      stream.push(io::back_inserter(body));
+      stream.write(res.getData(), res.getLength());
+      stream.reset();
+
+      req.outSetContentEncoding(Request::COMPRESS_GZIP);
+      req.send(body);
+      break;
+    }
+
+    case MODE_CACHED: if (cache.reply(req, res)) return true;
+      // Fall through
+
+    case MODE_IDENTITY:
+      req.getOutputBuffer().addRef(res.getData(), res.getLength());
+      break;
+    }
+
+    req.reply(HTTPStatus::HTTP_OK);
+    return true;
+  }
+
+  void endRequest(Request &req) {}
+};
+
+
+class ClientPool : public ThreadPool {
+  IPAddress addr;
+  unsigned count;
+
+public:
+  atomic<uint64_t> bytes;
+
+  ClientPool(const IPAddress &addr, unsigned threads, unsigned count) :
+    ThreadPool(threads), addr(addr), count(count), bytes(0) {}
+
+  // From ThreadPool
+  void run() {
+    const char *request =
+      "GET /app.js HTTP/1.1\r\nHost: localhost\r\n"
+      "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+      "Connection: close\r\n\r\n";
+    char buf[4096];
+
+    try {
+      for (unsigned i = 0; i < count; i++) {
+        Socket socket;
+        socket.connect(addr);
+        socket.write(request, strlen(request));
+
+        try {
+          while (true) bytes += socket.read(buf, sizeof(buf));
+        } catch (const Socket::EndOfStream &) {}
+      }
+    } CATCH_ERROR;
+  }
+};
+
+
+double getCPUTime() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+    (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+
+void bench(const IPAddress &addr, const Resource &res, serve_t mode,
+           unsigned clients, unsigned count) {
+  HTTPServerPool pool(1, new AssetHandler(res, mode));
+  pool.bind(addr);
+  pool.start();
+
+  // Warm up, the cached mode compresses on the first request
+  ClientPool warmup(addr, 1, 1);
+  warmup.start();
+  warmup.wait();
+
+  ClientPool clientPool(addr, clients, count);
+
+  double start = Timer::now();
+  double cpuStart = getCPUTime();
+  clientPool.start();
+  clientPool.wait();
+  double cpu = getCPUTime() - cpuStart;
+  double elapsed = Timer::now() - start;
+
+  pool.join();
+
+  unsigned total = clients * count;
+  cout << setw(10) << modeNames[mode]
+       << setw(14) << fixed << setprecision(0) << total / elapsed
+       << setw(14) << setprecision(1) << cpu / total * 1e6
+       << setw(14) << setprecision(0) << (double)clientPool.bytes / total
+       << endl;
+}
+
+
+string makeAsset(unsigned size) {
+  string s;
+
+  for (unsigned i = 0; s.length() < size; i++)
+    s += String::printf("function handler%u(event) {\n"
+                        "  if (!event.target) return false;\n"
+                        "  return update('item-%u', event.target.value);\n"
+                        "}\n\n", i, i * 7 % 1000);
+
+  return s;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned count = 500;
+    unsigned clients = 4;
+    unsigned size = 64 * 1024;
+    IPAddress addr("127.0.0.1:18081");
+
+    if (1 < argc) count = String::parseU32(argv[1]);
+    if (2 < argc) clients = String::parseU32(argv[2]);
+    if (3 < argc) size = String::parseU32(argv[3]);
+    if (4 < argc) addr = IPAddress(argv[4]);
+
+    // Request logging would dominate the measurement
+    Logger::instance().setVerbosity(0);
+
+    string asset = makeAsset(size);
+    FileResource res("app.js", asset.data(), asset.length());
+
+    cout << "Serving a " << asset.length() << " byte asset to " << clients
+         << " clients" << endl
+         << setw(10) << "mode" << setw(14) << "requests/sec"
+         << setw(14) << "CPU us/resp" << setw(14) << "bytes/resp" << endl;
+
+    for (int mode = MODE_IDENTITY; mode <= MODE_CACHED; mode++)
+      bench(addr, res, (serve_t)mode, clients, count);
+
+    return 0;
+  } CATCH_ERROR;
+
+  return 1;
+}
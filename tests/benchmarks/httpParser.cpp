@@ -0,0 +1,183 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/event/Buffer.h>
+#include <cbang/event/Headers.h>
+#include <cbang/event/Request.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+#include <new>
+
+#include <stdlib.h>
+
+using namespace cb;
+using namespace cb::Event;
+using namespace std;
+
+
+// Count heap allocations
+static uint64_t allocations = 0;
+
+
+void *operator new(size_t size) {
+  allocations++;
+  void *ptr = malloc(size);
+  if (!ptr) throw bad_alloc();
+  return ptr;
+}
+
+
+void operator delete(void *ptr) noexcept {free(ptr);}
+
+
+string makeRequest(unsigned headers) {
+  string s = "GET /api/v1/items/1234?fields=name,size HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Firefox/115.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Connection: keep-alive\r\n"
+    "Cookie: sid=8f14e45fceea167a5a36dedd4bea2543\r\n";
+
+  for (unsigned i = 0; i < headers; i++)
+    s += String::printf("X-Custom-Header-%u: value %u\r\n", i, i);
+
+  return s + "\r\n";
+}
+
+
+// The line at a time parse Connection and Headers used before
+void parseLines(Buffer &buf) {
+  string line = buf.readLine(0);
+
+  vector<string> parts;
+  String::tokenize(line, parts, " ");
+  if (parts.size() != 3) THROW("Invalid HTTP request line: " << line);
+
+  Request req(RequestMethod::parse(parts[0]), URI(parts[1]),
+              Request::parseHTTPVersion(parts[2]));
+  Headers &hdrs = req.getInputHeaders();
+
+  while (buf.getLength()) {
+    string line = buf.readLine(0);
+    if (line.empty()) break;
+
+    size_t semi = line.find_first_of(':');
+    if (semi == string::npos) THROW("Invalid header line: " << line);
+
+    hdrs.OrderedDict<string>::insert
+      (line.substr(0, semi), String::trim(line.substr(semi + 1)));
+  }
+
+  if (String::toLower(req.inFind("Transfer-Encoding")) == "chunked" ||
+      !req.inFind("Content-Length").empty() ||
+      String::toLower(req.inFind("Connection")) != "keep-alive" ||
+      req.inFind("Host").empty())
+    THROW("Unexpected headers");
+}
+
+
+// The single pass parse Connection uses now
+void parseScan(Buffer &buf) {
+  unsigned length = 0;
+  const char *line = buf.peekLine(0, length);
+  const char *end = line + length - 2;
+
+  string parts[3];
+  unsigned count = 0;
+  for (const char *p = line; p < end;) {
+    while (p < end && *p == ' ') p++;
+    const char *start = p;
+    while (p < end && *p != ' ') p++;
+    if (start == p || 3 <= count++) break;
+    parts[count - 1].assign(start, p - start);
+  }
+  buf.drain(length);
+
+  Request req(RequestMethod::parse(parts[0]), URI(parts[1]),
+              Request::parseHTTPVersion(parts[2]));
+  Headers &hdrs = req.getInputHeaders();
+  hdrs.parse(buf);
+
+  if (hdrs.keyEquals(Headers::HEADER_TRANSFER_ENCODING, "chunked") ||
+      hdrs.has(Headers::HEADER_CONTENT_LENGTH) ||
+      !hdrs.keyEquals(Headers::HEADER_CONNECTION, "keep-alive") ||
+      !hdrs.has(Headers::HEADER_HOST))
+    THROW("Unexpected headers");
+}
+
+
+void bench(const char *name, void (*parse)(Buffer &), const string &request,
+           unsigned headers, unsigned count) {
+  Buffer buf;
+
+  uint64_t startAllocs = allocations;
+  double start = Timer::now();
+
+  for (unsigned i = 0; i < count; i++) {
+    buf.add(request);
+    parse(buf);
+  }
+
+  double elapsed = Timer::now() - start;
+  double allocs = (double)(allocations - startAllocs) / count;
+
+  cout << setw(8) << headers + 6 << setw(8) << name
+       << setw(14) << fixed << setprecision(0) << count / elapsed
+       << setw(14) << setprecision(1) << allocs << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned count = 200000;
+    if (1 < argc) count = String::parseU32(argv[1]);
+
+    cout << setw(8) << "headers" << setw(8) << "parser"
+         << setw(14) << "requests/sec" << setw(14) << "allocs/req" << endl;
+
+    unsigned sizes[] = {0, 10, 30};
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(unsigned); i++) {
+      string request = makeRequest(sizes[i]);
+      bench("lines", parseLines, request, sizes[i], count);
+      bench("scan", parseScan, request, sizes[i], count);
+    }
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,138 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/event/HTTPHandlerGroup.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+
+using namespace cb;
+using namespace cb::Event;
+using namespace std;
+
+
+string routePattern(unsigned i) {
+  if (i & 1) return String::printf("/api/v1/item%u/(?P<id>\\d+)", i);
+  return String::printf("/api/v1/resource%u/list", i);
+}
+
+
+string routePath(unsigned i) {
+  if (i & 1) return String::printf("/api/v1/item%u/1234", i);
+  return String::printf("/api/v1/resource%u/list", i);
+}
+
+
+void bench(unsigned routes, unsigned count) {
+  SmartPointer<HTTPHandlerFactory> factory = new HTTPHandlerFactory;
+  vector<SmartPointer<HTTPRequestHandler> > linear;
+  HTTPHandlerGroup group(factory);
+  unsigned hit = ~0U;
+
+  for (unsigned i = 0; i < routes; i++) {
+    SmartPointer<HTTPRequestHandler> handler =
+      new HTTPRequestFunctionHandler([&hit, i] (Request &) {
+          hit = i;
+          return true;
+        });
+
+    unsigned methods = RequestMethod::HTTP_GET | RequestMethod::HTTP_POST;
+    linear.push_back(factory->createMatcher(methods, routePattern(i), "",
+                                            handler));
+    group.addHandler(methods, routePattern(i), handler);
+  }
+
+  group.compile();
+
+  // Dispatch to the last, middle and a missing route
+  vector<string> paths;
+  paths.push_back(routePath(routes - 1));
+  paths.push_back(routePath(routes - 2));
+  paths.push_back(routePath(routes / 2));
+  paths.push_back("/api/v1/missing");
+
+  vector<SmartPointer<Request> > reqs;
+  for (unsigned i = 0; i < paths.size(); i++)
+    reqs.push_back(new Request(RequestMethod::HTTP_GET,
+                               URI("http://localhost" + paths[i])));
+
+  // Check both dispatchers agree
+  for (unsigned i = 0; i < reqs.size(); i++) {
+    hit = ~0U;
+    for (unsigned j = 0; j < linear.size(); j++)
+      if ((*linear[j])(*reqs[i])) break;
+    unsigned expected = hit;
+
+    hit = ~0U;
+    group(*reqs[i]);
+    if (hit != expected)
+      THROW("Route mismatch for " << paths[i] << " expected " << expected
+            << " got " << hit);
+  }
+
+  double start = Timer::now();
+  for (unsigned n = 0; n < count; n++)
+    for (unsigned j = 0; j < linear.size(); j++)
+      if ((*linear[j])(*reqs[n % reqs.size()])) break;
+  double linearRate = count / (Timer::now() - start);
+
+  start = Timer::now();
+  for (unsigned n = 0; n < count; n++) group(*reqs[n % reqs.size()]);
+  double indexedRate = count / (Timer::now() - start);
+
+  cout << setw(8) << routes << setw(16) << fixed << setprecision(0)
+       << linearRate << setw(16) << indexedRate << setw(9) << setprecision(2)
+       << indexedRate / linearRate << 'x' << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned count = 10000;
+    if (1 < argc) count = String::parseU32(argv[1]);
+
+    cout << "Dispatches per second" << endl
+         << setw(8) << "routes" << setw(16) << "linear" << setw(16)
+         << "indexed" << setw(10) << "speedup" << endl;
+
+    bench(10, count);
+    bench(100, count);
+    bench(1000, count);
+
+    return 0;
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,151 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/event/HTTPServerPool.h>
+#include <cbang/event/HTTPHandler.h>
+#include <cbang/event/Request.h>
+#include <cbang/openssl/SSLContext.h>
+#include <cbang/os/ThreadPool.h>
+#include <cbang/log/Logger.h>
+#include <cbang/socket/Socket.h>
+#include <cbang/util/RateSet.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+
+#include <string.h>
+
+using namespace cb;
+using namespace cb::Event;
+using namespace std;
+
+
+struct HelloHandler : public HTTPHandler {
+  // From HTTPHandler
+  SmartPointer<Request> createRequest
+  (Connection &con, RequestMethod method, const URI &uri,
+   const Version &version) {return new Request(method, uri, version);}
+
+  bool handleRequest(Request &req) {
+    req.reply("Hello World!", 12);
+    return true;
+  }
+
+  void endRequest(Request &req) {}
+};
+
+
+class ClientPool : public ThreadPool {
+  IPAddress addr;
+  unsigned count;
+
+public:
+  ClientPool(const IPAddress &addr, unsigned threads, unsigned count) :
+    ThreadPool(threads), addr(addr), count(count) {}
+
+  // From ThreadPool
+  void run() {
+    const char *request =
+      "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    char buf[4096];
+
+    try {
+      for (unsigned i = 0; i < count; i++) {
+        Socket socket;
+        socket.connect(addr);
+        socket.write(request, strlen(request));
+
+        try {
+          while (true) socket.read(buf, sizeof(buf));
+        } catch (const Socket::EndOfStream &) {}
+      }
+    } CATCH_ERROR;
+  }
+};
+
+
+double bench(const IPAddress &addr, unsigned loops, unsigned clients,
+             unsigned count) {
+  HTTPServerPool pool(loops, new HelloHandler);
+  pool.enableStats();
+  pool.bind(addr);
+  pool.start();
+
+  ClientPool clientPool(addr, clients, count);
+
+  double start = Timer::now();
+  clientPool.start();
+  clientPool.wait();
+  double rate = (double)clients * count / (Timer::now() - start);
+
+  SmartPointer<RateSet> stats = pool.getStats();
+  uint64_t total = stats->getRate("HTTP_OK").getTotal();
+  if (total != clients * count)
+    THROW("Expected " << clients * count << " responses, stats counted "
+          << total);
+
+  pool.join();
+
+  return rate;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned count = 2000;
+    unsigned clients = 8;
+    unsigned maxLoops = 16;
+    IPAddress addr("127.0.0.1:18080");
+
+    if (1 < argc) count = String::parseU32(argv[1]);
+    if (2 < argc) clients = String::parseU32(argv[2]);
+    if (3 < argc) maxLoops = String::parseU32(argv[3]);
+    if (4 < argc) addr = IPAddress(argv[4]);
+
+    // Request logging would dominate the measurement
+    Logger::instance().setVerbosity(0);
+
+    cout << "HTTP requests per second with " << clients << " clients" << endl
+         << setw(8) << "loops" << setw(14) << "requests/sec" << endl;
+
+    for (unsigned loops = 1; loops <= maxLoops; loops *= 2)
+      cout << setw(8) << loops << setw(14) << fixed << setprecision(0)
+           << bench(addr, loops, clients, count) << endl;
+
+    return 0;
+  } CATCH_ERROR;
+
+  return 1;
+}
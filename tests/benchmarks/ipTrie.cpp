@@ -0,0 +1,174 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/net/IPRangeSet.h>
+#include <cbang/net/IPTrie.h>
+#include <cbang/net/IPAddressFilter.h>
+#include <cbang/os/SystemUtilities.h>
+#include <cbang/os/TemporaryDirectory.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+using namespace cb;
+using namespace std;
+
+
+// Cheap pseudo random sequence so the RNG does not dominate
+struct Random {
+  uint64_t state;
+  Random(uint64_t seed) : state(seed) {}
+
+  uint32_t next() {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return state >> 32;
+  }
+};
+
+
+void report(const char *op, const char *mode, unsigned count, double delta) {
+  cout << setw(8) << op << setw(10) << mode << setw(14) << fixed
+       << setprecision(0) << count / delta << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned count = 300000;
+    unsigned lookups = 10000000;
+
+    if (1 < argc) count = String::parseU32(argv[1]);
+    if (2 < argc) lookups = String::parseU32(argv[2]);
+
+    // Random CIDRs, mostly /24s
+    Random rand(1);
+    vector<IPAddressRange> v4;
+
+    for (unsigned i = 0; i < count; i++) {
+      uint32_t r = rand.next();
+      unsigned bits = 16 + r % 17;
+      if (r & 0x100000) bits = 24;
+
+      uint32_t mask = bits == 32 ? ~0 : ~(~(uint32_t)0 >> bits);
+      uint32_t start = rand.next() & mask;
+      v4.push_back(IPAddressRange(start, start | ~mask));
+    }
+
+    vector<string> v6;
+    for (unsigned i = 0; i < count / 4; i++)
+      v6.push_back(String::printf("2001:db8:%x::/48", rand.next() & 0xffff));
+
+    cout << setw(8) << "op" << setw(10) << "mode" << setw(14) << "ops/sec"
+         << endl;
+
+    // Build
+    sort(v4.begin(), v4.end());
+    double start = Timer::now();
+    IPRangeSet rangeSet;
+    for (unsigned i = 0; i < v4.size(); i++) rangeSet.insert(v4[i]);
+    report("insert", "rangeset", count, Timer::now() - start);
+
+    start = Timer::now();
+    IPTrie::Builder builder;
+    for (unsigned i = 0; i < v4.size(); i++) builder.insert(v4[i]);
+    SmartPointer<IPTrie>::Protected trie = builder.build();
+    report("insert", "trie", count, Timer::now() - start);
+
+    cerr << trie->getRangeCount() << " ranges " << trie->getNodeCount()
+         << " nodes" << endl;
+
+    // Lookup keys
+    vector<IPAddress> keys(1 << 16);
+    for (unsigned i = 0; i < keys.size(); i++) keys[i] = rand.next();
+
+    // Check
+    for (unsigned i = 0; i < keys.size(); i++)
+      if (rangeSet.contains(keys[i]) != trie->contains(keys[i]))
+        THROW("Mismatch at " << IPAddress(keys[i]));
+
+    unsigned found = 0;
+    start = Timer::now();
+    for (unsigned i = 0; i < lookups; i++)
+      found += rangeSet.contains(keys[i & 0xffff]);
+    report("lookup", "rangeset", lookups, Timer::now() - start);
+
+    start = Timer::now();
+    for (unsigned i = 0; i < lookups; i++)
+      found += trie->contains(keys[i & 0xffff]);
+    report("lookup", "trie", lookups, Timer::now() - start);
+
+    // Through the filter, including the snapshot
+    TemporaryDirectory tmp(".");
+    string path = tmp.getPath() + "/deny.txt";
+    {
+      ofstream f(path.c_str());
+      f << "# Blocklist\n";
+      for (unsigned i = 0; i < v4.size(); i++) f << v4[i] << '\n';
+      for (unsigned i = 0; i < v6.size(); i++) f << v6[i] << '\n';
+    }
+
+    IPAddressFilter filter;
+    start = Timer::now();
+    filter.reloadDeny(path);
+    report("load", "filter", count + v6.size(), Timer::now() - start);
+
+    start = Timer::now();
+    for (unsigned i = 0; i < lookups; i++)
+      found += filter.isAllowed(keys[i & 0xffff]);
+    report("lookup", "filter", lookups, Timer::now() - start);
+
+    // IPv6
+    vector<IPTrie::Address> keys6(1 << 16);
+    for (unsigned i = 0; i < keys6.size(); i++) {
+      uint8_t *b = keys6[i].bytes;
+      b[0] = 0x20; b[1] = 0x01; b[2] = 0x0d; b[3] = 0xb8;
+      for (unsigned j = 4; j < 16; j++) b[j] = rand.next();
+    }
+
+    start = Timer::now();
+    for (unsigned i = 0; i < lookups; i++)
+      found += filter.isAllowed(keys6[i & 0xffff]);
+    report("lookup6", "filter", lookups, Timer::now() - start);
+
+    cerr << found << " found" << endl;
+
+    return 0;
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,165 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/json/Reader.h>
+#include <cbang/json/BufferReader.h>
+#include <cbang/json/Builder.h>
+#include <cbang/json/Document.h>
+#include <cbang/json/NullSink.h>
+#include <cbang/io/StringInputSource.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <new>
+
+#include <stdlib.h>
+
+using namespace cb;
+using namespace cb::JSON;
+using namespace std;
+
+
+// Count heap allocations
+static uint64_t allocations = 0;
+
+
+void *operator new(size_t size) {
+  void *ptr = malloc(size ? size : 1);
+  if (!ptr) throw bad_alloc();
+  allocations++;
+  return ptr;
+}
+
+
+void operator delete(void *ptr) noexcept {free(ptr);}
+
+
+string makeDocument(unsigned size) {
+  ostringstream str;
+
+  str << "[\n";
+  for (unsigned i = 0; str.tellp() < size; i++)
+    str << (i ? ",\n" : "")
+        << "  {\n"
+        << "    \"id\": " << i << ",\n"
+        << "    \"name\": \"item-" << i << " with a \\\"quoted\\\" name\",\n"
+        << "    \"score\": " << (i * 0.37) << ",\n"
+        << "    \"delta\": -" << (i * 17) << ",\n"
+        << "    \"active\": " << (i & 1 ? "true" : "false") << ",\n"
+        << "    \"tags\": [\"alpha\", \"beta\", \"gamma\", null],\n"
+        << "    \"description\": \"Lorem ipsum dolor sit amet, consectetur "
+        << "adipiscing elit, sed do eiusmod tempor incididunt\"\n"
+        << "  }";
+  str << "\n]\n";
+
+  return str.str();
+}
+
+
+template <typename Sink_T>
+void bench(const char *name, const string &doc, unsigned count) {
+  double start = Timer::now();
+  for (unsigned i = 0; i < count; i++) {
+    Sink_T sink;
+    Reader(StringInputSource(doc)).parse(sink);
+  }
+  double streamRate = doc.size() * count / (Timer::now() - start) / 1e6;
+
+  start = Timer::now();
+  for (unsigned i = 0; i < count; i++) {
+    Sink_T sink;
+    BufferReader(doc.data(), doc.size()).parse(sink);
+  }
+  double bufferRate = doc.size() * count / (Timer::now() - start) / 1e6;
+
+  cout << setw(10) << name << setw(14) << fixed << setprecision(1)
+       << streamRate << setw(14) << bufferRate << setw(9)
+       << setprecision(2) << bufferRate / streamRate << 'x' << endl;
+}
+
+
+template <typename T>
+void benchTree(const char *name, const string &doc, unsigned count,
+               T (*parse)(const char *, size_t)) {
+  uint64_t startAllocs = allocations;
+  double start = Timer::now();
+  double parseTime = 0;
+
+  for (unsigned i = 0; i < count; i++) {
+    double parseStart = Timer::now();
+    T root = parse(doc.data(), doc.size());
+    parseTime += Timer::now() - parseStart;
+  }
+
+  double total = Timer::now() - start;
+
+  cout << setw(10) << name << setw(14) << fixed << setprecision(1)
+       << doc.size() * count / parseTime / 1e6 << setw(14)
+       << (total - parseTime) / count * 1e3 << setw(16)
+       << (allocations - startAllocs) / count << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned size = 8;
+    unsigned count = 5;
+
+    if (1 < argc) size = String::parseU32(argv[1]);
+    if (2 < argc) count = String::parseU32(argv[2]);
+
+    string doc = makeDocument(size << 20);
+
+    cout << "Parse throughput in MB/sec for a " << size << " MiB document"
+         << endl << setw(10) << "sink" << setw(14) << "istream"
+         << setw(14) << "buffer" << setw(10) << "speedup" << endl;
+
+    bench<NullSink>("null", doc, count);
+    bench<Builder>("builder", doc, count);
+
+    cout << endl << "Parse and free" << endl << setw(10) << "tree"
+         << setw(14) << "MB/sec" << setw(14) << "free ms"
+         << setw(16) << "allocations" << endl;
+
+    benchTree<ValuePtr>("value", doc, count, &BufferReader::parse);
+    benchTree<DocumentPtr>("document", doc, count,
+                           &BufferReader::parseDocument);
+
+    return 0;
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,209 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/config.h>
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/os/TemporaryDirectory.h>
+#include <cbang/time/Timer.h>
+
+#ifdef HAVE_LEVELDB
+#include <cbang/db/LevelDB.h>
+#endif
+
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+
+using namespace cb;
+using namespace std;
+
+
+#ifdef HAVE_LEVELDB
+// Only implements the string comparison, allocates on every compare
+struct StringComparator : public LevelDB::Comparator {
+  StringComparator() : LevelDB::Comparator("bench") {}
+
+  int operator()(const string &a, const string &b) const {
+    return a.compare(b);
+  }
+};
+
+
+struct SliceComparator : public LevelDB::Comparator {
+  SliceComparator() : LevelDB::Comparator("bench") {}
+
+  int compare(const LevelDB::Slice &a, const LevelDB::Slice &b) const {
+    return a.compare(b);
+  }
+};
+
+
+string makeKey(unsigned i) {return String::printf("%010u", i);}
+
+
+// Cheap pseudo random sequence so the RNG does not dominate
+unsigned nextRandom(unsigned &state) {return state = state * 1103515245 + 12345;}
+
+
+void report(const char *op, const char *mode, unsigned count, double delta) {
+  cout << setw(8) << op << setw(10) << mode << setw(14) << fixed
+       << setprecision(0) << count / delta << endl;
+}
+
+
+void fill(LevelDB &db, unsigned count) {
+  LevelDB::Batch batch = db.batch();
+  string value(64, 'v');
+
+  for (unsigned i = 0; i < count; i++) {
+    batch.set(makeKey(i), value);
+
+    if (i % 10000 == 9999) {
+      batch.commit();
+      batch.clear();
+    }
+  }
+
+  batch.commit();
+}
+
+
+LevelDB open(const string &path, const SmartPointer<LevelDB::Comparator> &cmp,
+             unsigned count, const char *mode) {
+  LevelDB db(cmp);
+  db.open(path, LevelDB::CREATE_IF_MISSING);
+
+  // Keys outside the namespace on either side
+  db.set("a", "");
+  db.set("z", "");
+
+  LevelDB ns = db.ns("bench:");
+  double start = Timer::now();
+  fill(ns, count);
+  report("fill", mode, count, Timer::now() - start);
+
+  return ns;
+}
+
+
+void scan(LevelDB &db, bool slices) {
+  double start = Timer::now();
+  unsigned count = 0;
+  size_t bytes = 0;
+
+  for (LevelDB::Iterator it = db.first(); it.valid(); it++, count++)
+    if (slices) bytes += it.keySlice().size() + it.valueSlice().size();
+    else bytes += it.key().size() + it.value().size();
+
+  if (!bytes) THROW("Nothing scanned");
+  report("scan", slices ? "slice" : "string", count, Timer::now() - start);
+}
+
+
+void seek(LevelDB &db, unsigned count, unsigned seeks, bool slices) {
+  LevelDB::Iterator it = db.iterator();
+  unsigned state = 1;
+  double start = Timer::now();
+  size_t bytes = 0;
+
+  for (unsigned i = 0; i < seeks; i++) {
+    it.seek(makeKey(nextRandom(state) % count));
+    if (!it.valid()) continue;
+
+    if (slices) bytes += it.keySlice().size() + it.valueSlice().size();
+    else bytes += it.key().size() + it.value().size();
+  }
+
+  if (!bytes) THROW("Nothing found");
+  report("seek", slices ? "slice" : "string", seeks, Timer::now() - start);
+}
+
+
+void get(LevelDB &db, unsigned count, unsigned gets, bool lookup) {
+  unsigned state = 1;
+  double start = Timer::now();
+  size_t bytes = 0;
+  string value;
+
+  for (unsigned i = 0; i < gets; i++) {
+    string key = makeKey(nextRandom(state) % count);
+
+    if (lookup) {
+      if (db.lookup(key, value)) bytes += value.size();
+    } else bytes += db.get(key).size();
+  }
+
+  if (!bytes) THROW("Nothing found");
+  report("get", lookup ? "lookup" : "get", gets, Timer::now() - start);
+}
+#endif // HAVE_LEVELDB
+
+
+int main(int argc, char *argv[]) {
+  try {
+#ifdef HAVE_LEVELDB
+    unsigned count = 10000000;
+    unsigned seeks = 1000000;
+
+    if (1 < argc) count = String::parseU32(argv[1]);
+    if (2 < argc) seeks = String::parseU32(argv[2]);
+
+    TemporaryDirectory tmp(".");
+
+    cout << setw(8) << "op" << setw(10) << "mode" << setw(14) << "ops/sec"
+         << endl;
+
+    {
+      LevelDB db = open(tmp.getPath() + "/string", new StringComparator,
+                        count, "string");
+      scan(db, false);
+      seek(db, count, seeks, false);
+    }
+
+    LevelDB db = open(tmp.getPath() + "/slice", new SliceComparator, count,
+                      "slice");
+    scan(db, false);
+    scan(db, true);
+    seek(db, count, seeks, false);
+    seek(db, count, seeks, true);
+    get(db, count, seeks, false);
+    get(db, count, seeks, true);
+
+    return 0;
+#else
+    THROW("Built without LevelDB");
+#endif
+  } CATCH_ERROR;
+
+  return 1;
+}
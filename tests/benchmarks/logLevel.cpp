@@ -0,0 +1,104 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/log/Logger.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+
+using namespace cb;
+using namespace std;
+
+
+unsigned counter = 0;
+
+
+void cached(unsigned count) {
+  for (unsigned i = 0; i < count; i++)
+    LOG_INFO(5, "value " << counter++);
+}
+
+
+void uncached(unsigned count) {
+  for (unsigned i = 0; i < count; i++)
+    LOG(CBANG_LOG_DOMAIN, LOG_INFO_LEVEL(5), "value " << counter++);
+}
+
+
+bool infoEnabled() {return LOG_INFO_ENABLED(5);}
+
+
+void bench(const char *name, void (*fn)(unsigned), unsigned count) {
+  double start = Timer::now();
+  fn(count);
+  double elapsed = Timer::now() - start;
+
+  cout << setw(10) << name << setw(14) << fixed << setprecision(2)
+       << elapsed / count * 1e9 << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned count = 10000000;
+    if (1 < argc) count = String::parseU32(argv[1]);
+
+    Logger &log = Logger::instance();
+    log.setScreenStream(cerr);
+    log.setVerbosity(1);
+
+    cout << "Disabled LOG_INFO(5) cost" << endl;
+    cout << setw(10) << "check" << setw(14) << "ns/call" << endl;
+
+    bench("cached", cached, count);
+    bench("uncached", uncached, count);
+
+    // With some domain levels the uncached lookup has a map to search
+    log.setLogDomainLevels("server:3 module:i:4 other:d:2");
+    bench("cached", cached, count);
+    bench("uncached", uncached, count);
+
+    if (counter) THROW("Disabled log message was formatted");
+
+    // Changing the levels must take effect at a cached callsite
+    bool before = infoEnabled();
+    log.setVerbosity(5);
+    if (before || !infoEnabled()) THROW("Cached level check was not updated");
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,154 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/config.h>
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/time/Timer.h>
+#include <cbang/json/JSON.h>
+
+#ifdef HAVE_MARIADB
+#include <cbang/event/Base.h>
+#include <cbang/db/maria/EventDBPool.h>
+#endif
+
+#include <iostream>
+#include <iomanip>
+
+using namespace cb;
+using namespace std;
+
+
+#ifdef HAVE_MARIADB
+class Bench {
+  Event::Base &base;
+  MariaDB::EventDBPool &pool;
+  unsigned count;
+  bool prepared;
+
+  unsigned issued;
+  unsigned completed;
+  unsigned errors;
+
+public:
+  Bench(Event::Base &base, MariaDB::EventDBPool &pool, unsigned count,
+        bool prepared) :
+    base(base), pool(pool), count(count), prepared(prepared), issued(0),
+    completed(0), errors(0) {}
+
+
+  void issue() {
+    unsigned i = issued++;
+    auto cb = [this] (MariaDB::EventDB::state_t state) {done(state);};
+
+    if (prepared) {
+      SmartPointer<JSON::Value> params = new JSON::List;
+      params->append(i);
+      pool.execute(cb, "SELECT ? + 1", params);
+
+    } else {
+      SmartPointer<JSON::Value> dict = new JSON::Dict;
+      dict->insert("i", i);
+      pool.query(cb, "SELECT %(i)u + 1", dict);
+    }
+  }
+
+
+  void done(MariaDB::EventDB::state_t state) {
+    if (state == MariaDB::EventDB::EVENTDB_ERROR) errors++;
+    else if (state != MariaDB::EventDB::EVENTDB_DONE) return;
+
+    if (++completed == count) base.loopExit();
+    else if (issued < count) issue();
+  }
+
+
+  void run(unsigned depth) {
+    double start = Timer::now();
+
+    for (unsigned i = 0; i < depth && issued < count; i++) issue();
+    base.dispatch();
+
+    if (errors) THROW(errors << " queries failed");
+
+    cout << setw(10) << (prepared ? "prepared" : "text") << setw(8)
+         << pool.getSize() << setw(8) << depth << setw(14) << fixed
+         << setprecision(0) << count / (Timer::now() - start) << endl;
+  }
+};
+
+
+void bench(const string &host, const string &user, const string &password,
+           const string &db, unsigned count, unsigned connections,
+           unsigned depth) {
+  Event::Base base;
+  MariaDB::EventDBPool pool(base, connections);
+
+  pool.setPingInterval(0);
+  pool.connect(host, user, password, db);
+
+  for (unsigned i = 0; i < 2; i++) Bench(base, pool, count, i).run(depth);
+
+  pool.close();
+}
+#endif // HAVE_MARIADB
+
+
+int main(int argc, char *argv[]) {
+  try {
+#ifdef HAVE_MARIADB
+    if (argc < 5) {
+      cerr << "Usage: " << argv[0]
+           << " <host> <user> <password> <db> [count]" << endl;
+      return 1;
+    }
+
+    unsigned count = 100000;
+    if (5 < argc) count = String::parseU32(argv[5]);
+
+    cout << setw(10) << "mode" << setw(8) << "conns" << setw(8) << "depth"
+         << setw(14) << "queries/sec" << endl;
+
+    // One connection one query at a time vs. a pipelined pool
+    bench(argv[1], argv[2], argv[3], argv[4], count, 1, 1);
+    bench(argv[1], argv[2], argv[3], argv[4], count, 1, 16);
+    bench(argv[1], argv[2], argv[3], argv[4], count, 4, 64);
+
+    return 0;
+#else
+    THROW("Built without MariaDB");
+#endif
+
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,123 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/String.h>
+#include <cbang/util/OrderedDict.h>
+#include <cbang/util/HashOrderedDict.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+#include <new>
+
+#include <stdlib.h>
+
+using namespace cb;
+using namespace std;
+
+
+// Track live heap usage, the size is stored before each block
+static size_t allocated = 0;
+
+
+void *operator new(size_t size) {
+  size_t *ptr = (size_t *)malloc(size + 16);
+  if (!ptr) throw bad_alloc();
+  allocated += *ptr = size;
+  return (char *)ptr + 16;
+}
+
+
+void operator delete(void *ptr) noexcept {
+  if (!ptr) return;
+  size_t *real = (size_t *)((char *)ptr - 16);
+  allocated -= *real;
+  free(real);
+}
+
+
+template <typename Dict_T>
+void bench(const char *name, const vector<string> &keys, unsigned dicts,
+           unsigned lookups) {
+  // Build
+  size_t start = allocated;
+  double startTime = Timer::now();
+
+  vector<Dict_T> *all = new vector<Dict_T>(dicts);
+  for (unsigned i = 0; i < dicts; i++)
+    for (unsigned j = 0; j < keys.size(); j++)
+      (*all)[i].insert(keys[j], i + j);
+
+  double buildTime = Timer::now() - startTime;
+  double bytes = (double)(allocated - start) / dicts;
+
+  // Lookup
+  uint64_t sum = 0;
+  startTime = Timer::now();
+  for (unsigned n = 0; n < lookups; n++) {
+    const Dict_T &dict = (*all)[n % dicts];
+    sum += dict.get(keys[(n * 7) % keys.size()]);
+  }
+  double lookupRate = lookups / (Timer::now() - startTime);
+
+  delete all;
+
+  cout << setw(6) << keys.size() << setw(8) << name
+       << setw(14) << fixed << setprecision(0) << bytes
+       << setw(14) << dicts / buildTime << setw(14) << lookupRate
+       << (sum ? "" : " ") << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  unsigned dicts = 100000;
+  unsigned lookups = 2000000;
+
+  if (1 < argc) dicts = String::parseU32(argv[1]);
+  if (2 < argc) lookups = String::parseU32(argv[2]);
+
+  cout << setw(6) << "keys" << setw(8) << "dict" << setw(14) << "bytes/dict"
+       << setw(14) << "builds/sec" << setw(14) << "lookups/sec" << endl;
+
+  unsigned sizes[] = {4, 8, 16, 64, 256};
+  for (unsigned i = 0; i < sizeof(sizes) / sizeof(unsigned); i++) {
+    vector<string> keys;
+    for (unsigned j = 0; j < sizes[i]; j++)
+      keys.push_back(String::printf("property_name_%u", j));
+
+    unsigned n = dicts * 4 / sizes[i];
+    bench<OrderedDict<unsigned> >("map", keys, n, lookups);
+    bench<HashOrderedDict<unsigned> >("hash", keys, n, lookups);
+  }
+
+  return 0;
+}
@@ -0,0 +1,108 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/SmartPointer.h>
+#include <cbang/String.h>
+#include <cbang/os/ThreadPool.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+
+using namespace cb;
+using namespace std;
+
+
+struct Data {int x = 0;};
+
+
+template <typename Ptr>
+class CopyPool : public ThreadPool {
+  const Ptr &ptr;
+  unsigned count;
+
+public:
+  CopyPool(const Ptr &ptr, unsigned threads, unsigned count) :
+    ThreadPool(threads), ptr(ptr), count(count) {}
+
+  // From ThreadPool
+  void run() {
+    for (unsigned i = 0; i < count; i++) {
+      Ptr copy = ptr;
+      copy.release();
+    }
+  }
+};
+
+
+template <typename Ptr>
+double bench(unsigned threads, unsigned count) {
+  Ptr ptr = new Data;
+  CopyPool<Ptr> pool(ptr, threads, count);
+
+  double start = Timer::now();
+  pool.start();
+  pool.wait();
+
+  return (double)threads * count / (Timer::now() - start);
+}
+
+
+int main(int argc, char *argv[]) {
+  unsigned count = 1000000;
+  unsigned maxThreads = 64;
+
+  if (1 < argc) count = String::parseU32(argv[1]);
+  if (2 < argc) maxThreads = String::parseU32(argv[2]);
+
+  typedef SmartPointer<Data, DeallocNew<Data>,
+                       MutexRefCounterImpl<Data> > MutexPtr;
+  typedef SmartPointer<Data, DeallocNew<Data>,
+                       AtomicRefCounterImpl<Data> > AtomicPtr;
+
+  cout << "Copy/destroy operations per second" << endl
+       << setw(8) << "threads" << setw(16) << "mutex"
+       << setw(16) << "atomic" << setw(10) << "speedup" << endl;
+
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+    double mutexRate = bench<MutexPtr>(threads, count);
+    double atomicRate = bench<AtomicPtr>(threads, count);
+
+    cout << setw(8) << threads
+         << setw(16) << fixed << setprecision(0) << mutexRate
+         << setw(16) << atomicRate
+         << setw(9) << setprecision(2) << atomicRate / mutexRate << 'x'
+         << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,198 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/net/SessionManager.h>
+#include <cbang/os/ThreadPool.h>
+#include <cbang/os/Mutex.h>
+#include <cbang/util/SmartLock.h>
+#include <cbang/json/JSON.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+#include <map>
+
+#include <unistd.h>
+
+using namespace cb;
+using namespace std;
+
+
+// The original single map with string valued expiry fields, for comparison
+class MapSessions : public Mutex {
+  typedef map<string, SmartPointer<JSON::Dict> > sessions_t;
+  sessions_t sessions;
+  uint64_t timeout = Time::SEC_PER_HOUR;
+  uint64_t lifetime = Time::SEC_PER_DAY;
+
+public:
+  void add(const string &sid, uint64_t lastUsed) {
+    SmartPointer<JSON::Dict> session = new JSON::Dict;
+    session->insert("id", sid);
+    session->insert("created", Time(lastUsed).toString());
+    session->insert("last_used", Time(lastUsed).toString());
+    sessions[sid] = session;
+  }
+
+
+  bool isExpired(const JSON::Dict &session) const {
+    uint64_t now = Time::now();
+    uint64_t timeout = session.getU64("timeout", this->timeout);
+    uint64_t lifetime = session.getU64("lifetime", this->lifetime);
+
+    return
+      (timeout && Time::parse(session.getString("last_used")) + timeout < now)
+      || (lifetime &&
+          Time::parse(session.getString("created")) + lifetime < now);
+  }
+
+
+  bool lookup(const string &sid) {
+    SmartLock lock(this);
+
+    auto it = sessions.find(sid);
+    if (it == sessions.end() || isExpired(*it->second)) return false;
+    it->second->insert("last_used", Time(Time::now()).toString());
+
+    return true;
+  }
+
+
+  void cleanup() {
+    SmartLock lock(this);
+
+    for (auto it = sessions.begin(); it != sessions.end();)
+      if (isExpired(*it->second)) sessions.erase(it++);
+      else it++;
+  }
+};
+
+
+class Sharded : public SessionManager {
+public:
+  void add(const string &sid, uint64_t lastUsed) {
+    SessionPtr session = new Session(sid, IPAddress());
+    session->setCreationTime(lastUsed);
+    session->setLastUsed(lastUsed);
+    addSession(session);
+  }
+
+  bool lookup(const string &sid) {return findSession(sid).isSet();}
+};
+
+
+template <typename T>
+class Clients : public ThreadPool {
+  T &sessions;
+  const vector<string> &ids;
+  unsigned count;
+
+public:
+  Clients(T &sessions, const vector<string> &ids, unsigned threads,
+          unsigned count) :
+    ThreadPool(threads), sessions(sessions), ids(ids), count(count) {}
+
+  // From ThreadPool
+  void run() {
+    uint64_t x = (uint64_t)this ^ (uint64_t)&x;
+
+    for (unsigned i = 0; i < count; i++) {
+      x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+      if (!sessions.lookup(ids[(x >> 33) % ids.size()]))
+        THROW("Session lookup failed");
+    }
+  }
+};
+
+
+template <typename T>
+void bench(const char *name, const vector<string> &ids, unsigned count) {
+  T sessions;
+
+  // One percent of sessions are past their timeout
+  uint64_t now = Time::now();
+  for (unsigned i = 0; i < ids.size(); i++)
+    sessions.add(ids[i], i % 100 ? now : now - 2 * Time::SEC_PER_HOUR);
+
+  vector<string> live;
+  for (unsigned i = 0; i < ids.size(); i++)
+    if (i % 100) live.push_back(ids[i]);
+
+  cout << setw(10) << name;
+
+  for (unsigned threads = 1; threads <= 4; threads *= 4) {
+    Clients<T> clients(sessions, live, threads, count);
+
+    double start = Timer::now();
+    clients.start();
+    clients.wait();
+    double elapsed = Timer::now() - start;
+
+    cout << setw(14) << fixed << setprecision(0) << threads * count / elapsed;
+  }
+
+  // Sessions added already expired are due on the next tick
+  sleep(2);
+
+  double start = Timer::now();
+  sessions.cleanup();
+  cout << setw(14) << setprecision(2) << (Timer::now() - start) * 1e3 << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned sessions = 100000;
+    unsigned count = 10000;
+
+    if (1 < argc) sessions = String::parseU32(argv[1]);
+    if (2 < argc) count = String::parseU32(argv[2]);
+
+    vector<string> ids;
+    for (unsigned i = 0; i < sessions; i++)
+      ids.push_back(String::printf("%016llx", (unsigned long long)i *
+                                   0x9e3779b97f4a7c15ULL));
+
+    cout << sessions << " sessions, 1% expired" << endl
+         << setw(10) << "store" << setw(14) << "1 thread/sec"
+         << setw(14) << "4 threads/sec" << setw(14) << "cleanup ms" << endl;
+
+    // The map store is about 100 times slower
+    bench<MapSessions>("map", ids, count);
+    bench<Sharded>("sharded", ids, 100 * count);
+
+    return 0;
+  } CATCH_ERROR;
+
+  return 1;
+}
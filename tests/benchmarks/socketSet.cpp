@@ -0,0 +1,174 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/socket/Socket.h>
+#include <cbang/socket/SocketSet.h>
+#include <cbang/os/SysError.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <unistd.h>
+#endif
+
+using namespace cb;
+using namespace std;
+
+
+#ifndef _WIN32
+struct Pair {
+  Socket a;
+  Socket b;
+
+  Pair() {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+      THROW("socketpair() " << SysError());
+    a.set(fds[0]);
+    b.set(fds[1]);
+  }
+};
+
+
+// Wake the set once through the active socket
+void wakeup(SocketSet &set, Pair &active) {
+  char c = 0;
+  if (::write(active.b.get(), &c, 1) != 1) THROW("write() " << SysError());
+
+  if (!set.select(1) || !set.isSet(active.a, SocketSet::READ))
+    THROW("Active socket not ready");
+
+  if (::read(active.a.get(), &c, 1) != 1) THROW("read() " << SysError());
+}
+
+
+void report(const char *mode, SocketSet::backend_t backend, unsigned count,
+            unsigned wakeups, double delta) {
+  cout << setw(10) << mode << setw(8) << SocketSet::getBackendName(backend)
+       << setw(8) << count << setw(14) << fixed << setprecision(2)
+       << delta / wakeups * 1e6 << endl;
+}
+
+
+// How SocketServer worked before, the set is rebuilt for every wakeup
+void rebuild(vector<Pair> &pairs, SocketSet::backend_t backend,
+             unsigned wakeups) {
+  double start = Timer::now();
+
+  for (unsigned i = 0; i < wakeups; i++) {
+    SocketSet set(backend);
+    for (auto &pair: pairs) set.add(pair.a, SocketSet::READ);
+    wakeup(set, pairs[0]);
+  }
+
+  report("rebuild", backend, pairs.size(), wakeups, Timer::now() - start);
+}
+
+
+void persistent(vector<Pair> &pairs, SocketSet::backend_t backend,
+                unsigned wakeups) {
+  SocketSet set(backend);
+  for (auto &pair: pairs) set.add(pair.a, SocketSet::READ);
+
+  double start = Timer::now();
+  for (unsigned i = 0; i < wakeups; i++) wakeup(set, pairs[0]);
+
+  report("persist", backend, pairs.size(), wakeups, Timer::now() - start);
+}
+#endif // !_WIN32
+
+
+int main(int argc, char *argv[]) {
+  try {
+#ifndef _WIN32
+    unsigned count = 10000;
+    unsigned wakeups = 2000;
+
+    if (1 < argc) count = String::parseU32(argv[1]);
+    if (2 < argc) wakeups = String::parseU32(argv[2]);
+
+    // Two descriptors per connection
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    if (limit.rlim_cur < 2 * count + 64) {
+      count = (limit.rlim_cur - 64) / 2;
+      cerr << "Descriptor limit allows only " << count << " connections"
+           << endl;
+    }
+
+    cout << setw(10) << "mode" << setw(8) << "backend" << setw(8) << "conns"
+         << setw(14) << "usec/wakeup" << endl;
+
+    const unsigned sizes[] = {100, 400, 1000, count};
+
+    for (unsigned i = 0; i < 4; i++) {
+      unsigned n = sizes[i];
+      if (count < n || (i && n <= sizes[i - 1])) continue;
+
+      vector<Pair> pairs(n);
+
+      // Rebuilding large sets is slow, do fewer rounds
+      unsigned rebuilds = wakeups * 100 / n;
+      if (rebuilds < 10) rebuilds = 10;
+      if (wakeups < rebuilds) rebuilds = wakeups;
+
+      // select() cannot handle descriptors past FD_SETSIZE
+      if (pairs.back().b.get() < FD_SETSIZE) {
+        rebuild(pairs, SocketSet::BACKEND_SELECT, rebuilds);
+        persistent(pairs, SocketSet::BACKEND_SELECT, wakeups);
+      }
+
+      rebuild(pairs, SocketSet::BACKEND_EPOLL, rebuilds);
+      persistent(pairs, SocketSet::BACKEND_POLL, wakeups);
+      persistent(pairs, SocketSet::BACKEND_EPOLL, wakeups);
+    }
+
+    return 0;
+#else
+    THROW("Not supported on Windows");
+#endif
+
+  } CATCH_ERROR;
+
+  return 1;
+}
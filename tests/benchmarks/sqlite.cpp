@@ -0,0 +1,159 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/db/Database.h>
+#include <cbang/db/NameValueTable.h>
+#include <cbang/db/WriteBatch.h>
+#include <cbang/http/Session.h>
+#include <cbang/http/SessionsTable.h>
+#include <cbang/os/TemporaryDirectory.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+
+using namespace cb;
+using namespace std;
+
+
+typedef enum {
+  MODE_BASELINE, // No statement cache, rollback journal, one write per commit
+  MODE_CACHED,
+  MODE_WAL,
+  MODE_BATCHED,
+} bench_mode_t;
+
+const char *modeNames[] = {"baseline", "cached", "wal", "batched"};
+
+
+void configure(DB::Database &db, bench_mode_t mode) {
+  if (mode == MODE_BASELINE) db.setStatementCacheSize(0);
+
+  if (MODE_WAL <= mode) {
+    db.setJournalMode(DB::Database::JOURNAL_WAL);
+    db.setSynchronous(DB::Database::SYNC_NORMAL);
+  }
+}
+
+
+void report(const char *table, bench_mode_t mode, unsigned count, double delta) {
+  cout << setw(12) << table << setw(10) << modeNames[mode] << setw(14)
+       << fixed << setprecision(0) << count / delta << endl;
+}
+
+
+void benchNameValue(const string &path, bench_mode_t mode, unsigned count) {
+  DB::Database db;
+  db.open(path);
+  configure(db, mode);
+
+  DB::NameValueTable table(db, "config");
+  table.create();
+  table.init();
+
+  DB::WriteBatch batch(db);
+  double start = Timer::now();
+
+  for (unsigned i = 0; i < count; i++) {
+    string name = String::printf("name%u", i % 1000);
+
+    if (mode == MODE_BATCHED) batch.write([&] () {table.set(name, i);});
+    else table.set(name, i);
+  }
+
+  batch.flush();
+  report("NameValue", mode, count, Timer::now() - start);
+}
+
+
+void benchSessions(const string &path, bench_mode_t mode, unsigned count) {
+  DB::Database db;
+  db.open(path);
+  configure(db, mode);
+
+  HTTP::SessionsTable table;
+  table.create(db);
+
+  DB::WriteBatch batch(db);
+  HTTP::Session session("");
+  session.setUser("user");
+  session.setIP(IPAddress("127.0.0.1"));
+
+  double start = Timer::now();
+
+  for (unsigned i = 0; i < count; i++) {
+    session.setID(String::printf("session%u", i % 1000));
+    session.touch();
+
+    auto write = [&] () {
+      SmartPointer<DB::Statement> writeStmt = table.makeWriteStmt(db);
+      table.bindWriteStmt(writeStmt, session);
+      writeStmt->execute();
+    };
+
+    if (mode == MODE_BATCHED) batch.write(write);
+    else write();
+  }
+
+  batch.flush();
+  report("Sessions", mode, count, Timer::now() - start);
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned count = 2000;
+    unsigned batchedCount = 200000;
+
+    if (1 < argc) count = String::parseU32(argv[1]);
+    if (2 < argc) batchedCount = String::parseU32(argv[2]);
+
+    TemporaryDirectory tmp(".");
+
+    cout << setw(12) << "table" << setw(10) << "mode" << setw(14)
+         << "inserts/sec" << endl;
+
+    for (int mode = MODE_BASELINE; mode <= MODE_BATCHED; mode++) {
+      unsigned n = mode == MODE_BATCHED ? batchedCount : count;
+      string path = tmp.getPath() + "/" + modeNames[mode];
+
+      benchNameValue(path + "-config.db", (bench_mode_t)mode, n);
+      benchSessions(path + "-sessions.db", (bench_mode_t)mode, n);
+    }
+
+    return 0;
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,164 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/DNSBase.h>
+#include <cbang/event/Client.h>
+#include <cbang/event/OutgoingRequest.h>
+#include <cbang/event/HTTPServerPool.h>
+#include <cbang/event/HTTPHandler.h>
+#include <cbang/event/Request.h>
+#include <cbang/log/Logger.h>
+#include <cbang/openssl/SSLContext.h>
+#include <cbang/openssl/KeyPair.h>
+#include <cbang/openssl/Certificate.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+#include <iomanip>
+
+using namespace cb;
+using namespace cb::Event;
+using namespace std;
+
+
+struct HelloHandler : public HTTPHandler {
+  // From HTTPHandler
+  SmartPointer<Request> createRequest
+  (Connection &con, RequestMethod method, const URI &uri,
+   const Version &version) {return new Request(method, uri, version);}
+
+  bool handleRequest(Request &req) {
+    req.reply("Hello World!", 12);
+    return true;
+  }
+
+  void endRequest(Request &req) {}
+};
+
+
+SmartPointer<SSLContext> serverContext(bool cache, bool tickets) {
+  KeyPair key;
+  key.generateRSA(2048);
+
+  Certificate cert;
+  cert.setVersion(2);
+  cert.setSerial(1);
+  cert.setPublicKey(key);
+  cert.setNotBefore();
+  cert.setNotAfter(3600);
+  cert.addNameEntry("CN", "localhost");
+  cert.setIssuer(cert);
+  cert.sign(key);
+
+  SmartPointer<SSLContext> ctx = new SSLContext;
+  ctx->useCertificate(cert);
+  ctx->usePrivateKey(key);
+  ctx->setSessionCacheSize(cache ? 20480 : 0);
+  ctx->setSessionTickets(tickets);
+  if (tickets) ctx->setTicketKeyLifetime(3600);
+
+  return ctx;
+}
+
+
+void bench(const IPAddress &addr, const string &name, bool resume, bool cache,
+           bool tickets, unsigned count) {
+  SmartPointer<SSLContext> serverCtx = serverContext(cache, tickets);
+
+  HTTPServerPool pool(1, new HelloHandler, serverCtx);
+  pool.bind(addr);
+  pool.start();
+
+  cb::Event::Base base;
+  DNSBase dns(base);
+  SmartPointer<SSLContext> clientCtx = new SSLContext;
+  Client client(base, dns, clientCtx);
+  clientCtx->setClientSessionCache(resume);
+
+  URI uri("https://" + addr.toString() + "/");
+  unsigned done = 0;
+  unsigned failed = 0;
+
+  // Each request is a new connection and a new handshake
+  function<void ()> next =
+    [&] () {
+      client.call(uri, RequestMethod::HTTP_GET, [&] (Request &req) {
+        if (!req.isOk()) failed++;
+        if (++done == count) base.loopExit();
+        else next();
+      })->send();
+    };
+
+  double start = Timer::now();
+  next();
+  base.dispatch();
+  double delta = Timer::now() - start;
+
+  if (failed) THROW(failed << " requests failed");
+
+  cout << setw(16) << name << setw(14) << fixed << setprecision(0)
+       << count / delta << setw(12) << setprecision(1)
+       << serverCtx->getResumptionRate() * 100 << '%' << endl;
+
+  pool.join();
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned count = 2000;
+    IPAddress addr("127.0.0.1:18443");
+
+    if (1 < argc) count = String::parseU32(argv[1]);
+    if (2 < argc) addr = IPAddress(argv[2]);
+
+    Logger::instance().setVerbosity(0);
+
+    cout << "TLS handshakes over loopback, " << count << " connections"
+         << endl << setw(16) << "mode" << setw(14) << "handshakes/s"
+         << setw(13) << "resumed" << endl;
+
+    // A fresh port for each run, the previous server may linger
+    bench(addr, "full", false, true, true, count);
+    addr.setPort(addr.getPort() + 1);
+    bench(addr, "session cache", true, true, false, count);
+    addr.setPort(addr.getPort() + 1);
+    bench(addr, "session tickets", true, false, true, count);
+
+    return 0;
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,263 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/String.h>
+#include <cbang/Catch.h>
+#include <cbang/event/HTTPServerPool.h>
+#include <cbang/event/HTTPHandler.h>
+#include <cbang/event/Websocket.h>
+#include <cbang/log/Logger.h>
+#include <cbang/openssl/SSLContext.h>
+#include <cbang/socket/Socket.h>
+#include <cbang/time/Timer.h>
+#include <cbang/util/Random.h>
+
+#include <iostream>
+#include <iomanip>
+
+#include <string.h>
+
+using namespace cb;
+using namespace cb::Event;
+using namespace std;
+
+
+struct EchoWebsocket : public Websocket {
+  using Websocket::Websocket;
+
+  // From Websocket
+  void onMessage(const char *data, uint64_t length) {send(data, length);}
+};
+
+
+struct EchoHandler : public HTTPHandler {
+  // From HTTPHandler
+  SmartPointer<Request> createRequest
+  (Connection &con, RequestMethod method, const URI &uri,
+   const Version &version) {return new EchoWebsocket(method, uri, version);}
+
+  bool handleRequest(Request &req) {return false;}
+  void endRequest(Request &req) {}
+};
+
+
+class Client {
+  Socket socket;
+  string input;
+  string output;
+  uint64_t wireBytes = 0;
+
+public:
+  Client(const IPAddress &addr, bool deflate) {
+    socket.connect(addr);
+
+    string request =
+      "GET /echo HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Upgrade: websocket\r\n"
+      "Connection: Upgrade\r\n"
+      "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+      "Sec-WebSocket-Version: 13\r\n";
+    if (deflate) request += "Sec-WebSocket-Extensions: permessage-deflate; "
+                   "client_max_window_bits\r\n";
+    request += "\r\n";
+    socket.write(request.data(), request.length());
+
+    // Read handshake response
+    size_t end;
+    while ((end = input.find("\r\n\r\n")) == string::npos) fill();
+
+    string response = input.substr(0, end);
+    input = input.substr(end + 4);
+    wireBytes = input.length();
+
+    if (response.find(" 101 ") == string::npos)
+      THROW("Upgrade failed: " << response);
+    if (deflate && response.find("permessage-deflate") == string::npos)
+      THROW("Server did not accept permessage-deflate");
+  }
+
+
+  uint64_t getWireBytes() const {return wireBytes;}
+
+
+  void fill() {
+    char buf[64 * 1024];
+    int64_t bytes = socket.read(buf, sizeof(buf));
+    input.append(buf, bytes);
+    wireBytes += bytes;
+  }
+
+
+  void flush() {
+    socket.write(output.data(), output.length());
+    output.clear();
+  }
+
+
+  void send(const string &msg, uint8_t opcode = 1) {
+    // Clients must mask their frames
+    uint8_t header[14] = {(uint8_t)(0x80 | opcode)};
+    unsigned bytes = 2;
+
+    if (msg.length() < 126) header[1] = 0x80 | msg.length();
+    else {
+      header[1] = 0x80 | 126;
+      header[2] = msg.length() >> 8;
+      header[3] = msg.length();
+      bytes = 4;
+    }
+
+    Random::instance().bytes(header + bytes, 4);
+
+    output.append((char *)header, bytes + 4);
+    size_t offset = output.length();
+    output.resize(offset + msg.length());
+    Websocket::mask(header + bytes, msg.data(), &output[offset],
+                    msg.length());
+  }
+
+
+  void close() {
+    send(string("\x03\xe8", 2), 8); // Normal close
+    flush();
+    while (receive() != 8) continue;
+    socket.close();
+  }
+
+
+  uint8_t receive() {
+    while (true) {
+      // Parse frame header, server frames are not masked
+      while (input.length() < 2) fill();
+      const uint8_t *header = (const uint8_t *)input.data();
+      bool finish = header[0] & 0x80;
+      uint8_t opcode = header[0] & 0xf;
+      uint64_t length = header[1] & 0x7f;
+      unsigned bytes = 2;
+
+      if (length == 126) {
+        while (input.length() < 4) fill();
+        header = (const uint8_t *)input.data();
+        length = (uint64_t)header[2] << 8 | header[3];
+        bytes = 4;
+
+      } else if (length == 127) THROW("Unexpected large frame");
+
+      while (input.length() < bytes + length) fill();
+      input.erase(0, bytes + length);
+
+      if ((finish && opcode < 8) || opcode == 8) return opcode;
+    }
+  }
+};
+
+
+string makeMessage(unsigned size) {
+  string msg = "[";
+
+  for (unsigned i = 0; msg.length() < size; i++)
+    msg += String::printf("%s{\"id\":%u,\"name\":\"sensor-%u\",\"state\":"
+                          "\"online\",\"value\":%u.%02u}", i ? "," : "", i,
+                          i % 16, i * 37 % 1000, i % 100);
+
+  return msg + "]";
+}
+
+
+void bench(const IPAddress &addr, const string &name, bool deflate,
+           bool noContextTakeover, const string &msg, unsigned count,
+           unsigned window) {
+  HTTPServerPool pool(1, new EchoHandler);
+  pool.setWebsockDeflate(deflate);
+  pool.setWebsockNoContextTakeover(noContextTakeover);
+  pool.bind(addr);
+  pool.start();
+
+  Client client(addr, deflate);
+
+  double start = Timer::now();
+
+  for (unsigned i = 0; i < count; i += window) {
+    unsigned n = min(window, count - i);
+    for (unsigned j = 0; j < n; j++) client.send(msg);
+    client.flush();
+    for (unsigned j = 0; j < n; j++) client.receive();
+  }
+
+  double delta = Timer::now() - start;
+  double wire = (double)client.getWireBytes() / count;
+
+  client.close();
+
+  cout << setw(22) << name << setw(12) << fixed << setprecision(0)
+       << count / delta << setw(14) << setprecision(1) << wire
+       << setw(10) << setprecision(2) << msg.length() / wire << endl;
+
+  pool.join();
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    unsigned count = 20000;
+    unsigned size = 1024;
+    unsigned window = 32;
+    IPAddress addr("127.0.0.1:18081");
+
+    if (1 < argc) count = String::parseU32(argv[1]);
+    if (2 < argc) size = String::parseU32(argv[2]);
+    if (3 < argc) window = String::parseU32(argv[3]);
+    if (4 < argc) addr = IPAddress(argv[4]);
+
+    Logger::instance().setVerbosity(0);
+
+    string msg = makeMessage(size);
+    if (0xffff < msg.length()) THROW("Message too large");
+
+    cout << "Websocket echo of " << count << " JSON messages of "
+         << msg.length() << " bytes" << endl
+         << setw(22) << "mode" << setw(12) << "msgs/sec" << setw(14)
+         << "wire B/msg" << setw(10) << "ratio" << endl;
+
+    // A fresh port for each run, the previous server may linger
+    bench(addr, "uncompressed", false, false, msg, count, window);
+    addr.setPort(addr.getPort() + 1);
+    bench(addr, "deflate", true, false, msg, count, window);
+    addr.setPort(addr.getPort() + 1);
+    bench(addr, "deflate no takeover", true, true, msg, count, window);
+
+    return 0;
+  } CATCH_ERROR;
+
+  return 1;
+}
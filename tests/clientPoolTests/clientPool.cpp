@@ -0,0 +1,214 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/Client.h>
+#include <cbang/event/DNSBase.h>
+#include <cbang/event/Event.h>
+#include <cbang/event/HTTP.h>
+#include <cbang/event/HTTPHandler.h>
+#include <cbang/event/OutgoingRequest.h>
+#include <cbang/event/Request.h>
+#include <cbang/log/Logger.h>
+#include <cbang/net/URI.h>
+#include <cbang/openssl/SSLContext.h>
+
+#include <iostream>
+#include <list>
+#include <set>
+
+using namespace cb;
+using namespace cb::Event;
+using namespace std;
+
+
+// Each server gets its own port, open connections may outlive it
+unsigned nextPort = 28191;
+
+
+struct Server : public HTTPHandler {
+  cb::Event::Base &base;
+  SmartPointer<Event::HTTP> http;
+  SmartPointer<cb::Event::Event> replyEvent;
+
+  double delay = 0;
+  set<uint16_t> ports;
+  list<SmartPointer<Request> > waiting;
+  unsigned active = 0;
+  unsigned maxActive = 0;
+
+  Server(cb::Event::Base &base, const IPAddress &addr) : base(base) {
+    http = new Event::HTTP(base, SmartPointer<HTTPHandler>::Phony(this));
+    http->bind(addr);
+    replyEvent = base.newEvent(this, &Server::replyAll, 0);
+  }
+
+
+  void reply(Request &req) {
+    active--;
+    req.reply("ok", 2);
+  }
+
+
+  void replyAll() {
+    while (!waiting.empty()) {
+      reply(*waiting.front());
+      waiting.pop_front();
+    }
+  }
+
+
+  // From HTTPHandler
+  SmartPointer<Request> createRequest
+  (Connection &con, RequestMethod method, const URI &uri,
+   const Version &version) {return new Request(method, uri, version);}
+
+
+  bool handleRequest(Request &req) {
+    ports.insert(req.getClientIP().getPort());
+    if (maxActive < ++active) maxActive = active;
+
+    if (!delay) reply(req);
+    else {
+      waiting.push_back(&req);
+      if (!replyEvent->isPending()) replyEvent->add(delay);
+    }
+
+    return true;
+  }
+
+
+  void endRequest(Request &req) {}
+};
+
+
+struct Test {
+  cb::Event::Base base;
+  DNSBase dns;
+  Server server;
+  Client client;
+  URI uri;
+  unsigned ok = 0;
+  unsigned failed = 0;
+
+  Test() : dns(base), server(base, IPAddress("127.0.0.1", nextPort)),
+           client(base, dns),
+           uri(SSTR("http://127.0.0.1:" << nextPort++ << "/")) {}
+
+
+  void request(unsigned count, function<void ()> done) {
+    client.call(uri, RequestMethod::HTTP_GET, [=] (Request &req) {
+      if (req.isOk()) ok++; else failed++;
+      if (1 < count) request(count - 1, done);
+      else done();
+    })->send();
+  }
+
+
+  void print(const string &name) {
+    cout << name << ": ok " << ok << " failed " << failed << " connections "
+         << server.ports.size() << " max active " << server.maxActive << endl;
+  }
+};
+
+
+void testReuse() {
+  for (bool pooling: {false, true}) {
+    Test test;
+    test.client.setPooling(pooling);
+    test.request(8, [&] () {test.base.loopExit();});
+    test.base.dispatch();
+    test.print(pooling ? "pooled" : "unpooled");
+  }
+}
+
+
+void testIdle() {
+  Test test;
+  test.client.setPooling(true);
+  test.client.setIdleTimeout(0.2);
+
+  auto exit = [&] () {test.base.loopExit();};
+  auto later = [&] (double delay) {
+    auto e = test.base.newEvent([&] () {test.request(1, exit);}, 0);
+    e->add(delay);
+    test.base.dispatch();
+  };
+
+  test.request(1, exit);
+  test.base.dispatch();
+  later(0.05);
+  test.print("before timeout");
+
+  // A new connection replaces the expired one
+  later(0.5);
+  test.print("after timeout");
+}
+
+
+void testInFlight() {
+  for (unsigned max: {0, 1, 3}) {
+    Test test;
+    test.client.setPooling(true);
+    test.client.setMaxInFlight(max);
+    test.server.delay = 0.02;
+
+    const unsigned count = 6;
+    unsigned done = 0;
+    for (unsigned i = 0; i < count; i++)
+      test.request(1, [&] () {if (++done == count) test.base.loopExit();});
+
+    test.base.dispatch();
+    test.print(SSTR("max in flight " << max));
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+    string test = argv[1];
+
+    Logger::instance().setVerbosity(0);
+
+    if (test == "reuse") testReuse();
+    else if (test == "idle") testIdle();
+    else if (test == "inflight") testInFlight();
+    else THROW("Unknown test " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
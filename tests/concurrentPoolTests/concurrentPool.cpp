@@ -0,0 +1,205 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/ConcurrentPool.h>
+#include <cbang/time/Timer.h>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace cb;
+using namespace std;
+
+
+void dispatch(Event::Base &base) {
+  // Keeps the loop alive until the tasks complete
+  auto timeout = base.newEvent([&] (Event::Event &, int, unsigned) {
+      cout << "timeout" << endl;
+      base.loopExit();
+    }, 0);
+  timeout->add(10);
+
+  base.dispatch();
+}
+
+
+void testSteal() {
+  Event::Base base;
+  Event::ConcurrentPool pool(base, 2);
+
+  // Queued before start() so both workers have tasks waiting.  The first
+  // task blocks its thread until the rest are done, so some of them must be
+  // stolen from the blocked worker's queue.
+  const unsigned count = 10;
+  atomic<unsigned> done(0);
+  unsigned succeeded = 0;
+  bool stolen = false;
+
+  auto success = [&] (bool &) {
+    if (++succeeded == count) base.loopExit();
+  };
+
+  pool.submit<bool>(0, [&] () {
+    for (unsigned i = 0; i < 500 && done < count - 1; i++)
+      Timer::sleep(0.01);
+    return stolen = done == count - 1;
+  }, success);
+
+  for (unsigned i = 1; i < count; i++)
+    pool.submit<bool>(0, [&] () {done++; return true;}, success);
+
+  pool.start();
+  dispatch(base);
+  pool.join();
+
+  cout << "done " << succeeded << "/" << count << endl;
+  cout << "stolen " << stolen << endl;
+  cout << "ready " << pool.getNumReady() << endl;
+}
+
+
+void testStress() {
+  Event::Base base;
+  Event::ConcurrentPool pool(base, 4);
+  pool.start();
+
+  // Submitters race with thieves on the ready count
+  const unsigned count = 20000;
+  atomic<unsigned> ran(0);
+  unsigned succeeded = 0;
+
+  auto run = [&] () {return ++ran;};
+  auto success = [&] (unsigned &) {
+    if (++succeeded == count) base.loopExit();
+  };
+
+  vector<thread> submitters;
+  for (unsigned i = 0; i < 4; i++)
+    submitters.push_back(thread([&] () {
+      for (unsigned j = 0; j < count / 4; j++)
+        pool.submit<unsigned>(0, run, success);
+    }));
+
+  dispatch(base);
+  for (unsigned i = 0; i < submitters.size(); i++) submitters[i].join();
+  pool.join();
+
+  cout << "done " << succeeded << "/" << count << endl;
+  cout << "ready " << pool.getNumReady() << endl;
+}
+
+
+void testOrder() {
+  Event::Base base;
+  Event::ConcurrentPool pool(base, 1);
+
+  // Higher priorities run first
+  vector<int> order;
+  unsigned succeeded = 0;
+
+  for (int priority: {1, 3, 2, 5, 4})
+    pool.submit<bool>(priority, [&, priority] () {
+      order.push_back(priority);
+      return true;
+    }, [&] (bool &) {if (++succeeded == 5) base.loopExit();});
+
+  pool.start();
+  dispatch(base);
+  pool.join();
+
+  cout << "order";
+  for (unsigned i = 0; i < order.size(); i++) cout << ' ' << order[i];
+  cout << endl;
+}
+
+
+struct SpinTask : public Event::ConcurrentPool::Task {
+  atomic<unsigned> &started;
+
+  SpinTask(atomic<unsigned> &started) : Task(0), started(started) {}
+
+  // From Task
+  void run() {
+    started++;
+    while (!shouldShutdown()) Timer::sleep(0.01);
+  }
+};
+
+
+void testShutdown() {
+  Event::Base base;
+  Event::ConcurrentPool pool(base, 2);
+  pool.start();
+
+  // Both threads are busy until join() asks them to shutdown
+  atomic<unsigned> started(0);
+  pool.submit(new SpinTask(started));
+  pool.submit(new SpinTask(started));
+  while (started < 2) Timer::sleep(0.01);
+
+  atomic<unsigned> ran(0);
+  for (unsigned i = 0; i < 3; i++)
+    pool.submit<bool>(0, [&] () {ran++; return true;});
+
+  pool.join();
+
+  // Queued tasks are not run after shutdown
+  cout << "joined" << endl;
+  cout << "ran " << ran << endl;
+  cout << "ready " << pool.getNumReady() << endl;
+  cout << "active " << pool.getNumActive() << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+    string test = argv[1];
+
+    Event::Base::enableThreads();
+
+    if (test == "steal") testSteal();
+    else if (test == "stress") testStress();
+    else if (test == "order") testOrder();
+    else if (test == "shutdown") testShutdown();
+    else THROW("Unknown test " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
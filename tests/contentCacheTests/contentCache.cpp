@@ -0,0 +1,360 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/String.h>
+#include <cbang/config/Options.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/ContentCache.h>
+#include <cbang/event/FileHandler.h>
+#include <cbang/event/WebServer.h>
+#include <cbang/log/Logger.h>
+#include <cbang/net/IPAddress.h>
+#include <cbang/openssl/SSLContext.h>
+#include <cbang/os/SystemUtilities.h>
+#include <cbang/os/TemporaryDirectory.h>
+#include <cbang/socket/Socket.h>
+
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace cb;
+using namespace cb::Event;
+using namespace std;
+
+
+namespace {
+  const char *address = "127.0.0.1:28191";
+
+
+  struct Response {
+    string status;
+    string headers;
+    string body;
+
+    string get(const string &name) const {
+      size_t start = headers.find("\r\n" + name + ": ");
+      if (start == string::npos) return "-";
+      start += name.length() + 4;
+
+      return headers.substr(start, headers.find("\r\n", start) - start);
+    }
+
+
+    string encoding() const {
+      string etag = get("ETag");
+      size_t dash = etag.find_last_of('-');
+      string suffix = etag.substr(dash + 1, etag.length() - dash - 2);
+      return get("Content-Encoding") + " etag=" +
+        (suffix == "gzip" || suffix == "br" || suffix == "zstd" ? suffix :
+         "identity");
+    }
+  };
+
+
+  Response fetch(const string &path, const string &headers = "",
+                 const string &method = "GET") {
+    Socket socket;
+    socket.connect(IPAddress(address));
+
+    string req = method + " " + path + " HTTP/1.1\r\nHost: localhost\r\n" +
+      headers + "Connection: close\r\n\r\n";
+    socket.write(req.data(), req.size());
+
+    string response;
+    char buf[4096];
+    try {
+      while (true) response.append(buf, socket.read(buf, sizeof(buf)));
+    } catch (const Socket::EndOfStream &e) {}
+
+    Response r;
+    size_t eol = response.find("\r\n");
+    size_t end = response.find("\r\n\r\n");
+    r.status = response.substr(9, eol - 9);
+    r.headers = response.substr(eol, end + 2 - eol);
+    r.body = response.substr(end + 4);
+
+    return r;
+  }
+
+
+  string text(unsigned lines, const string &word) {
+    string s;
+    for (unsigned i = 0; i < lines; i++)
+      s += SSTR(word << ' ' << i << " the quick brown fox\n");
+    return s;
+  }
+
+
+  // Bytes cached for data with every supported encoding
+  uint64_t cachedBytes(const string &data) {
+    uint64_t bytes = ContentCache::ENTRY_OVERHEAD;
+
+    for (int i = 0; i < ContentCache::ENCODINGS; i++) {
+      auto encoding = (ContentCache::encoding_t)i;
+      if (!ContentCache::isSupported(encoding)) continue;
+
+      string out = ContentCache::compress(encoding, data.data(), data.size());
+      if (out.size() < data.size()) bytes += out.size();
+    }
+
+    return bytes;
+  }
+
+
+  void serve(const string &root, const SmartPointer<ContentCache> &cache,
+             unsigned loops, function<void ()> client) {
+    Logger::instance().setVerbosity(0);
+
+    Options options;
+    Event::Base base(true);
+    WebServer server(options, base);
+
+    SmartPointer<FileHandler> handler = new FileHandler(root);
+    if (cache.isSet()) handler->setCache(cache);
+    server.addHandler(handler);
+
+    options["http-addresses"].set(address);
+    options["http-event-loops"].set(loops);
+    server.init();
+    server.start();
+
+    thread t([&] () {
+      TRY_CATCH_ERROR(client());
+      base.loopExit();
+    });
+
+    base.dispatch();
+    t.join();
+
+    server.shutdown();
+  }
+}
+
+
+void testAccept() {
+  TemporaryDirectory tmp("/tmp");
+  ofstream((tmp.getPath() + "/a.txt").c_str()) << text(200, "a");
+  ofstream((tmp.getPath() + "/small.txt").c_str()) << "small";
+  ofstream((tmp.getPath() + "/a.png").c_str()) << text(200, "a");
+
+  const char *accepts[] = {
+    "", "gzip", "GZIP", "x-gzip", "gzip;q=0", "gzip;q=0.5", "deflate",
+    "br;q=0, zstd;q=0, gzip;q=0.5, identity",
+    "br;q=0, zstd;q=0, gzip;q=0.8, identity;q=0.9",
+    "identity;q=0, br;q=0, zstd;q=0, gzip;q=0.1",
+    "*;q=0.3, br;q=0, zstd;q=0", "*;q=0", "br;q=0,zstd;q=0,gzip ; q=1.0", 0};
+
+  serve(tmp.getPath(), new ContentCache, 1, [&] () {
+    for (unsigned i = 0; accepts[i]; i++) {
+      string headers = *accepts[i] ?
+        SSTR("Accept-Encoding: " << accepts[i] << "\r\n") : string();
+      Response r = fetch("/a.txt", headers);
+
+      cout << "'" << accepts[i] << "': " << r.status << ' ' << r.encoding()
+           << " vary=" << r.get("Vary") << " length=" << r.body.size()
+           << " gzip=" << !r.body.compare(0, 2, "\x1f\x8b") << endl;
+    }
+
+    // Ranges are served from the identity encoding
+    Response r =
+      fetch("/a.txt", "Accept-Encoding: gzip\r\nRange: bytes=0-3\r\n");
+    cout << "range: " << r.status << ' ' << r.encoding() << " body="
+         << r.body << endl;
+
+    r = fetch("/a.txt", "Accept-Encoding: br;q=0, zstd;q=0, gzip\r\n", "HEAD");
+    cout << "head: " << r.status << ' ' << r.encoding() << " length="
+         << (r.get("Content-Length") != "-") << " body=" << r.body.size()
+         << endl;
+
+    // Too small or not compressible, no Vary
+    for (const char *path: {"/small.txt", "/a.png"}) {
+      r = fetch(path, "Accept-Encoding: gzip\r\n");
+      cout << path << ": " << r.status << ' ' << r.encoding() << " vary="
+           << r.get("Vary") << endl;
+    }
+  });
+}
+
+
+void testNotModified() {
+  TemporaryDirectory tmp("/tmp");
+  string path = tmp.getPath() + "/a.txt";
+  ofstream(path.c_str()) << text(200, "a");
+
+  serve(tmp.getPath(), new ContentCache, 1, [&] () {
+    const string gzip = "Accept-Encoding: br;q=0, zstd;q=0, gzip\r\n";
+    string gzipTag = fetch("/a.txt", gzip).get("ETag");
+    string identityTag = fetch("/a.txt").get("ETag");
+
+    cout << "tags differ " << (gzipTag != identityTag) << endl;
+
+    vector<pair<string, string> > cases = {
+      {"gzip tag, gzip", gzip + "If-None-Match: " + gzipTag + "\r\n"},
+      {"gzip tag, identity", "If-None-Match: " + gzipTag + "\r\n"},
+      {"identity tag, identity", "If-None-Match: " + identityTag + "\r\n"},
+      {"weak", gzip + "If-None-Match: W/" + gzipTag + "\r\n"},
+      {"list", gzip + "If-None-Match: \"x\", " + gzipTag + "\r\n"},
+      {"star", "If-None-Match: *\r\n"},
+      {"other", "If-None-Match: \"x\"\r\n"},
+    };
+
+    for (auto &c: cases) {
+      Response r = fetch("/a.txt", c.second);
+      cout << c.first << ": " << r.status << ' ' << r.encoding()
+           << " body=" << r.body.size() << " vary=" << r.get("Vary") << endl;
+    }
+
+    // A changed file gets a new ETag
+    SystemUtilities::oopen(path)->write("changed\n", 8);
+    ofstream(path.c_str(), ios::app) << text(300, "b");
+    Response r = fetch("/a.txt", "If-None-Match: " + identityTag + "\r\n");
+    cout << "changed: " << r.status << " new tag "
+         << (r.get("ETag") != identityTag) << endl;
+  });
+}
+
+
+void testBudget() {
+  TemporaryDirectory tmp("/tmp");
+  string a = text(200, "a");
+  string b = text(300, "b");
+  string big = text(2000, "c");
+  ofstream((tmp.getPath() + "/a.txt").c_str()) << a;
+  ofstream((tmp.getPath() + "/b.txt").c_str()) << b;
+  ofstream((tmp.getPath() + "/big.txt").c_str()) << big;
+
+  uint64_t aBytes = cachedBytes(a);
+  uint64_t bBytes = cachedBytes(b);
+
+  // Room for either a or b but not both
+  SmartPointer<ContentCache> cache = new ContentCache(aBytes + bBytes - 1);
+
+  serve(tmp.getPath(), cache, 1, [&] () {
+    const string gzip = "Accept-Encoding: gzip\r\n";
+
+    for (const char *path: {"/a.txt", "/a.txt", "/b.txt", "/a.txt"}) {
+      Response r = fetch(path, gzip);
+      uint64_t bytes = cache->getBytes();
+
+      cout << path << ": " << r.status << ' ' << r.get("Content-Encoding")
+           << " cached=" << (bytes == aBytes ? "a" : bytes == bBytes ? "b" :
+                             String(bytes)) << endl;
+    }
+
+    // Larger than the whole budget, served uncompressed
+    Response r = fetch("/big.txt", gzip);
+    uint64_t bytes = cache->getBytes() - ContentCache::ENTRY_OVERHEAD;
+    cout << "/big.txt: " << r.status << ' ' << r.get("Content-Encoding")
+         << " length=" << (r.body.size() == big.size()) << " cached="
+         << (bytes == aBytes ? "a+etag" : String(bytes)) << endl;
+  });
+}
+
+
+void testEntries() {
+  TemporaryDirectory tmp("/tmp");
+  for (unsigned i = 0; i < 10; i++)
+    ofstream(SSTR(tmp.getPath() << '/' << i << ".txt").c_str()) << "small";
+
+  // Entries without encodings still count against the budget
+  SmartPointer<ContentCache> cache =
+    new ContentCache(4 * ContentCache::ENTRY_OVERHEAD);
+
+  serve(tmp.getPath(), cache, 1, [&] () {
+    unsigned ok = 0;
+    for (unsigned i = 0; i < 10; i++)
+      if (fetch(SSTR('/' << i << ".txt")).body == "small") ok++;
+
+    cout << "ok " << ok << "/10" << endl;
+    cout << "entries " << cache->getBytes() / ContentCache::ENTRY_OVERHEAD
+         << endl;
+  });
+
+  // Caching is off unless a cache is set
+  serve(tmp.getPath(), 0, 1, [&] () {
+    Response r = fetch("/0.txt", "Accept-Encoding: gzip\r\n");
+    cout << "no cache: " << r.status << " etag=" << r.get("ETag") << endl;
+  });
+}
+
+
+void testConcurrent() {
+  TemporaryDirectory tmp("/tmp");
+  string a = text(5000, "a");
+  ofstream((tmp.getPath() + "/a.txt").c_str()) << a;
+
+  SmartPointer<ContentCache> cache = new ContentCache;
+
+  serve(tmp.getPath(), cache, 4, [&] () {
+    const unsigned count = 8;
+    vector<thread> threads;
+    atomic<unsigned> ok(0);
+
+    // Requests arriving while the entry is built wait for that build
+    for (unsigned i = 0; i < count; i++)
+      threads.push_back(thread([&] () {
+        Response r = fetch("/a.txt", "Accept-Encoding: gzip\r\n");
+        if (r.status.compare(0, 4, "200 ") == 0 &&
+            r.get("Content-Encoding") == "gzip") ok++;
+      }));
+
+    for (auto &t: threads) t.join();
+
+    cout << "ok " << ok << '/' << count << endl;
+    cout << "cached " << (cache->getBytes() == cachedBytes(a)) << endl;
+  });
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+    string test = argv[1];
+
+    if (test == "accept") testAccept();
+    else if (test == "notmodified") testNotModified();
+    else if (test == "budget") testBudget();
+    else if (test == "concurrent") testConcurrent();
+    else if (test == "entries") testEntries();
+    else THROW("Unknown test " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
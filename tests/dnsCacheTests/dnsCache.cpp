@@ -0,0 +1,277 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/String.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/DNSBase.h>
+#include <cbang/event/Event.h>
+#include <cbang/os/SystemUtilities.h>
+#include <cbang/os/TemporaryDirectory.h>
+#include <cbang/time/Timer.h>
+
+#include <iostream>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+using namespace cb;
+using namespace std;
+
+
+// Answers A queries with 10.0.0.<query count> or NXDOMAIN for names
+// starting with "nx"
+class StubServer {
+  int fd;
+  unsigned port = 0;
+  SmartPointer<cb::Event::Event> event;
+
+public:
+  unsigned queries = 0;
+  uint32_t ttl = 60;
+
+  StubServer(cb::Event::Base &base) {
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) THROW("socket() failed");
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr))) THROW("bind() failed");
+
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr *)&addr, &len);
+    port = ntohs(addr.sin_port);
+
+    event = base.newEvent(fd, this, &StubServer::readCB,
+                          cb::Event::EventFlag::EVENT_READ |
+                          cb::Event::EventFlag::EVENT_PERSIST);
+    event->add();
+  }
+
+  ~StubServer() {close(fd);}
+
+  unsigned getPort() const {return port;}
+
+  void readCB() {
+    uint8_t buf[512];
+    sockaddr_in from;
+    socklen_t len = sizeof(from);
+    int n = recvfrom(fd, buf, sizeof(buf), 0, (sockaddr *)&from, &len);
+    if (n < 17) return;
+
+    // Read question name
+    string name;
+    int i = 12;
+    while (i < n && buf[i]) {
+      if (!name.empty()) name += '.';
+      name += string((char *)buf + i + 1, buf[i]);
+      i += buf[i] + 1;
+    }
+    int end = i + 5; // Zero label, type and class
+    if (n < end) return;
+
+    queries++;
+    bool nx = String::startsWith(String::toLower(name), "nx");
+
+    string reply((char *)buf, end);
+    reply[2] = 0x84 | (buf[2] & 1); // Response, authoritative, RD
+    reply[3] = nx ? 3 : 0;
+    reply[6] = 0; reply[7] = nx ? 0 : 1; // Answer count
+    reply[8] = reply[9] = reply[10] = reply[11] = 0;
+
+    if (!nx) {
+      uint8_t answer[] = {
+        0xc0, 12, 0, 1, 0, 1,
+        (uint8_t)(ttl >> 24), (uint8_t)(ttl >> 16), (uint8_t)(ttl >> 8),
+        (uint8_t)ttl, 0, 4, 10, 0, 0, (uint8_t)queries,
+      };
+      reply.append((char *)answer, sizeof(answer));
+    }
+
+    sendto(fd, reply.data(), reply.size(), 0, (sockaddr *)&from, len);
+  }
+};
+
+
+class Test {
+  cb::Event::Base base;
+  StubServer server;
+  cb::Event::DNSBase dns;
+  unsigned pending = 0;
+
+public:
+  Test() : server(base), dns(base, false) {
+    dns.addNameserver(IPAddress("127.0.0.1", server.getPort()));
+  }
+
+
+  void lookup(const vector<string> &names) {
+    for (unsigned i = 0; i < names.size(); i++) {
+      string name = names[i];
+      pending++;
+
+      auto cb =
+        [this, name] (int error, vector<IPAddress> &addrs, int ttl) {
+          cout << name << ":";
+          if (error) cout << " " << cb::Event::DNSRequest::getErrorStr(error);
+          for (unsigned j = 0; j < addrs.size(); j++)
+            cout << " " << addrs[j].getIPString();
+          cout << endl;
+
+          if (!--pending) base.loopExit();
+        };
+
+      dns.resolve(name, cb, false);
+    }
+
+    base.dispatch();
+  }
+
+
+  void lookup(const string &name) {lookup(vector<string>(1, name));}
+
+
+  void run(double seconds) {
+    auto e = base.newEvent([this] (cb::Event::Event &, int, unsigned) {
+        base.loopExit();
+      }, 0);
+    e->add(seconds);
+    base.dispatch();
+  }
+
+
+  void report() {
+    cout << "queries=" << server.queries
+         << " hits=" << dns.getHits()
+         << " stale=" << dns.getStaleHits()
+         << " misses=" << dns.getMisses()
+         << " coalesced=" << dns.getCoalesced() << endl;
+  }
+
+
+  void run(const string &name) {
+    if (name == "coalesce") {
+      vector<string> names = {"a.test", "A.test", "a.test", "b.test"};
+      lookup(names);
+
+    } else if (name == "hit") {
+      lookup("a.test");
+      lookup("a.test");
+      lookup("a.test");
+
+    } else if (name == "expire") {
+      server.ttl = 1;
+      lookup("a.test");
+      Timer::sleep(1.2);
+      lookup("a.test");
+      lookup("a.test");
+
+    } else if (name == "negative") {
+      dns.setNegativeTTL(1);
+      lookup("nx.test");
+      lookup("nx.test");
+      Timer::sleep(1.2);
+      lookup("nx.test");
+
+    } else if (name == "stale") {
+      server.ttl = 1;
+      dns.setStaleWhileRevalidate(60);
+      lookup("a.test");
+      Timer::sleep(1.2);
+      lookup("a.test"); // Stale answer, refreshed in the background
+      run(0.2);
+      lookup("a.test");
+
+    } else if (name == "limits") {
+      dns.setMaxTTL(1);
+      lookup("a.test");
+      lookup("a.test");
+      Timer::sleep(1.2);
+      lookup("a.test"); // Server TTL is longer than the max
+      dns.clearCache();
+      lookup("a.test");
+
+    } else if (name == "evict") {
+      dns.setMaxEntries(2);
+      server.ttl = 60;
+      lookup("a.test");
+      server.ttl = 30;
+      lookup("b.test");
+      server.ttl = 90;
+      lookup("c.test"); // Evicts b.test which expires first
+      cout << "entries=" << dns.getCacheSize() << endl;
+      lookup("a.test");
+      lookup("c.test");
+      lookup("b.test"); // Evicts a.test
+      lookup("c.test");
+      cout << "entries=" << dns.getCacheSize() << endl;
+
+    } else if (name == "nocache") {
+      dns.setCaching(false);
+      lookup("a.test");
+      lookup("a.test");
+      lookup("nx.test");
+      lookup("nx.test");
+
+    } else if (name == "hosts") {
+      TemporaryDirectory tmp(".");
+      string path = tmp.getPath() + "/hosts";
+      *SystemUtilities::oopen(path) <<
+        "# Test hosts\n"
+        "127.0.0.5 Local.Test alias.test # Comment\n"
+        "::1 v6.test\n"
+        "127.0.0.6 local.test\n";
+
+      dns.loadHosts(path);
+      vector<string> names = {"local.test", "ALIAS.TEST", "v6.test"};
+      lookup(names);
+
+    } else THROW("Unknown test " << name);
+
+    report();
+  }
+};
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc != 2) THROW("Usage: " << argv[0] << " <test>");
+
+    Test().run(argv[1]);
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
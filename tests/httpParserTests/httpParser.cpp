@@ -0,0 +1,177 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/String.h>
+#include <cbang/event/Buffer.h>
+#include <cbang/event/Headers.h>
+
+#include <iostream>
+#include <cstring>
+
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  string peekLine(Event::Buffer &buf, unsigned maxLength, bool block) {
+    unsigned length = 0;
+    const char *data = block ? buf.peekLines(maxLength, length) :
+      buf.peekLine(maxLength, length);
+    if (!data) return "<none>";
+    return String::escapeC(string(data, length));
+  }
+
+
+  void parse(const string &block, unsigned maxSize = 0) {
+    try {
+      Event::Buffer buf(block);
+      Event::Headers headers;
+      bool complete = headers.parse(buf, maxSize);
+      cout << "parsed " << complete << ' ' << headers.size() << endl;
+
+    } catch (const Exception &e) {
+      cout << "error: " << e.getMessage() << endl;
+    }
+  }
+}
+
+
+void testFindLF() {
+  char s[64];
+  unsigned cases = 0;
+  unsigned failures = 0;
+
+  // Every length and LF position around the 16 byte blocks
+  for (unsigned len = 0; len <= 48; len++)
+    for (int pos = -1; pos < (int)len; pos++) {
+      memset(s, 'x', len);
+      if (0 <= pos) s[pos] = '\n';
+      if (pos + 1 < (int)len) s[len - 1] = '\n';
+
+      cases++;
+      const void *expected = memchr(s, '\n', len);
+      if (Event::Buffer::findLF(s, s + len) != expected) failures++;
+    }
+
+  cout << cases << " cases " << failures << " failures" << endl;
+}
+
+
+void testPeek() {
+  // Lines split across chunks
+  const char *chunks[] = {
+    "GET / HT", "TP/1.1\r", "\nHost: x\r\n", "\r", "\nBODY", 0};
+
+  Event::Buffer buf;
+  for (unsigned i = 0; chunks[i]; i++)
+    buf.addRef(chunks[i], strlen(chunks[i]));
+
+  cout << "line " << peekLine(buf, 0, false) << endl;
+  cout << "block " << peekLine(buf, 0, true) << endl;
+  cout << "short line " << peekLine(buf, 10, false) << endl;
+  cout << "short block " << peekLine(buf, 20, true) << endl;
+  cout << "length " << buf.getLength() << endl;
+
+  Event::Buffer partial("GET / HTTP/1.1\r\nHost: x\r\n");
+  cout << "partial line " << peekLine(partial, 0, false) << endl;
+  cout << "partial block " << peekLine(partial, 0, true) << endl;
+
+  Event::Buffer lf("A: 1\n\nrest");
+  cout << "lf block " << peekLine(lf, 0, true) << endl;
+}
+
+
+void testHeaders() {
+  Event::Buffer buf(
+    "Host: example.com\r\n"
+    "CONTENT-length:  42 \r\n"
+    "X-Custom: a\r\n"
+    "  b \r\n"
+    "connection: Keep-Alive, Upgrade\r\n"
+    "Upgrade: WebSocket\r\n"
+    "\r\n"
+    "BODY");
+
+  Event::Headers headers;
+  cout << "parsed " << headers.parse(buf) << endl;
+  cout << headers;
+  cout << "remaining " << buf.toString() << endl;
+
+  const string *length = headers.find(Event::Headers::HEADER_CONTENT_LENGTH);
+  cout << "length " << (length ? *length : "<none>") << endl;
+  cout << "custom " << headers.find("X-Custom") << endl;
+  cout << "upgrade "
+       << headers.keyEquals(Event::Headers::HEADER_UPGRADE, "websocket")
+       << endl;
+  cout << "connection upgrade "
+       << headers.keyContains(Event::Headers::HEADER_CONNECTION, "upgrade")
+       << endl;
+  cout << "connection close "
+       << headers.keyContains(Event::Headers::HEADER_CONNECTION, "close")
+       << endl;
+  cout << "has expect " << headers.has(Event::Headers::HEADER_EXPECT) << endl;
+
+  // Incomplete blocks are left in the buffer
+  Event::Buffer partial("Host: a\r\n");
+  Event::Headers headers2;
+  cout << "partial " << headers2.parse(partial) << ' '
+       << partial.getLength() << endl;
+  partial.add("\r\n");
+  cout << "complete " << headers2.parse(partial) << ' '
+       << partial.getLength() << endl;
+  cout << headers2;
+
+  parse("\r\n");
+  parse("Host: abcdefgh", 8);
+  parse("NoColon\r\n\r\n");
+  parse(" leading\r\n\r\n");
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+
+    string test = argv[1];
+
+    if (test == "findlf") testFindLF();
+    else if (test == "peek") testPeek();
+    else if (test == "headers") testHeaders();
+    else THROW("Unknown test: " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,210 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/event/HTTPHandlerGroup.h>
+#include <cbang/event/HTTPRouteIndex.h>
+#include <cbang/event/Request.h>
+
+#include <iostream>
+
+using namespace cb;
+using namespace cb::Event;
+using namespace std;
+
+
+// Routes every handler to all paths, like a factory with custom matchers
+struct UnroutedFactory : public HTTPHandlerFactory {
+  bool getRoute(unsigned methods, const string &search,
+                unsigned &routeMethods, string &pattern) {return false;}
+};
+
+
+class Test {
+  SmartPointer<HTTPHandlerGroup> group;
+
+public:
+  Test(const SmartPointer<HTTPHandlerFactory> &factory =
+       new HTTPHandlerFactory) : group(new HTTPHandlerGroup(factory)) {}
+
+
+  void add(unsigned methods, const string &pattern, const string &name,
+           bool accept = true) {
+    auto cb = [name, accept] (Request &req) {
+      cout << "  " << name << (accept ? " handled" : " declined") << endl;
+      return accept;
+    };
+
+    group->addHandler(methods, pattern, new HTTPRequestFunctionHandler(cb));
+  }
+
+
+  void add(const string &name) {
+    auto cb = [name] (Request &req) {
+      cout << "  " << name << " handled" << endl;
+      return true;
+    };
+
+    group->addHandler(new HTTPRequestFunctionHandler(cb));
+  }
+
+
+  void request(RequestMethod method, const string &path) {
+    cout << method << ' ' << path << endl;
+    Request req(method, URI(path), Version(1, 1));
+    if (!(*group)(req)) cout << "  not handled" << endl;
+  }
+};
+
+
+void testLiteral() {
+  const char *patterns[] = {
+    "/a/b", "/a\\.b", "/a/b/", "/a.*", "/a/[0-9]+", "/a\\d", "/a|/b", 0};
+
+  for (unsigned i = 0; patterns[i]; i++) {
+    string literal;
+    bool isLiteral = HTTPRouteIndex::isLiteral(patterns[i], literal);
+    cout << patterns[i] << ' ' << (isLiteral ? "literal " + literal : "pattern")
+         << endl;
+  }
+}
+
+
+void testIndex() {
+  HTTPRouteIndex index;
+  index.add(RequestMethod::HTTP_ANY, "/api/.*");
+  index.add(RequestMethod::HTTP_GET, "/api/status");
+  index.add(RequestMethod::HTTP_ANY, "");
+  index.add(RequestMethod::HTTP_POST, "/api/[a-z]+");
+  index.compile();
+
+  const char *paths[] = {"/api/status", "/api/x1", "/other", 0};
+  RequestMethod methods[] = {RequestMethod::HTTP_GET, RequestMethod::HTTP_POST};
+
+  for (unsigned i = 0; paths[i]; i++)
+    for (unsigned j = 0; j < 2; j++) {
+      vector<unsigned> routes;
+      index.match(methods[j], paths[i], routes);
+
+      cout << methods[j] << ' ' << paths[i] << ':';
+      for (unsigned k = 0; k < routes.size(); k++) cout << ' ' << routes[k];
+      cout << endl;
+    }
+}
+
+
+void testPrecedence() {
+  Test patternFirst;
+  patternFirst.add(RequestMethod::HTTP_GET, "/api/.*", "pattern");
+  patternFirst.add(RequestMethod::HTTP_GET, "/api/status", "literal");
+  patternFirst.request(RequestMethod::HTTP_GET, "/api/status");
+  patternFirst.request(RequestMethod::HTTP_GET, "/api/other");
+
+  Test literalFirst;
+  literalFirst.add(RequestMethod::HTTP_GET, "/api/status", "literal");
+  literalFirst.add(RequestMethod::HTTP_GET, "/api/.*", "pattern");
+  literalFirst.request(RequestMethod::HTTP_GET, "/api/status");
+  literalFirst.request(RequestMethod::HTTP_GET, "/api/other");
+}
+
+
+void testMethods() {
+  Test test;
+  test.add(RequestMethod::HTTP_GET, "/item", "get");
+  test.add(RequestMethod::HTTP_POST, "/item", "post");
+  test.add(RequestMethod::HTTP_GET | RequestMethod::HTTP_HEAD,
+           "/item/[0-9]+", "get-head");
+  test.add(RequestMethod::HTTP_ANY, "/any", "any");
+
+  test.request(RequestMethod::HTTP_GET, "/item");
+  test.request(RequestMethod::HTTP_POST, "/item");
+  test.request(RequestMethod::HTTP_PUT, "/item");
+  test.request(RequestMethod::HTTP_HEAD, "/item/7");
+  test.request(RequestMethod::HTTP_DELETE, "/item/7");
+  test.request(RequestMethod::HTTP_DELETE, "/any");
+}
+
+
+void testSlash() {
+  Test test;
+  test.add(RequestMethod::HTTP_ANY, "/dir", "dir");
+  test.add(RequestMethod::HTTP_ANY, "/dir/", "dir-slash");
+  test.add(RequestMethod::HTTP_ANY, "/files/?", "files");
+
+  test.request(RequestMethod::HTTP_GET, "/dir");
+  test.request(RequestMethod::HTTP_GET, "/dir/");
+  test.request(RequestMethod::HTTP_GET, "/dir//");
+  test.request(RequestMethod::HTTP_GET, "/files");
+  test.request(RequestMethod::HTTP_GET, "/files/");
+}
+
+
+void testFallthrough() {
+  Test test;
+  test.add(RequestMethod::HTTP_ANY, "/x/.*", "pattern", false);
+  test.add(RequestMethod::HTTP_ANY, "/x/y", "literal");
+  test.add(RequestMethod::HTTP_ANY, "/x/(?P<name>[a-z]+)", "regex");
+  test.add("catch-all");
+
+  test.request(RequestMethod::HTTP_GET, "/x/y");
+  test.request(RequestMethod::HTTP_GET, "/x/z");
+  test.request(RequestMethod::HTTP_GET, "/x/9");
+  test.request(RequestMethod::HTTP_GET, "/y");
+
+  // Handlers without a route are tried for every request
+  Test unrouted(new UnroutedFactory);
+  unrouted.add(RequestMethod::HTTP_ANY, "/u/.*", "unrouted", false);
+  unrouted.add(RequestMethod::HTTP_GET, "/u/v", "literal");
+  unrouted.request(RequestMethod::HTTP_GET, "/u/v");
+  unrouted.request(RequestMethod::HTTP_GET, "/w");
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc != 2) THROW("Usage: " << argv[0] << " <test>");
+    string name = argv[1];
+
+    if (name == "literal") testLiteral();
+    else if (name == "index") testIndex();
+    else if (name == "precedence") testPrecedence();
+    else if (name == "methods") testMethods();
+    else if (name == "slash") testSlash();
+    else if (name == "fallthrough") testFallthrough();
+    else THROW("Unknown test " << name);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,188 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/String.h>
+#include <cbang/config/Options.h>
+#include <cbang/http/Connection.h>
+#include <cbang/http/Context.h>
+#include <cbang/http/Handler.h>
+#include <cbang/http/Server.h>
+#include <cbang/log/Logger.h>
+#include <cbang/socket/Socket.h>
+#include <cbang/time/Timer.h>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace cb;
+using namespace std;
+
+
+// Holds "/hold" responses until released
+class TestHandler : public HTTP::Handler {
+  struct HoldContext : public HTTP::Context {
+    const atomic<bool> &released;
+
+    HoldContext(HTTP::Connection &con, const atomic<bool> &released) :
+      Context(con), released(released) {}
+
+    // From HTTP::Context
+    bool isReady() const {return released;}
+  };
+
+public:
+  atomic<bool> released;
+
+  TestHandler() : released(false) {}
+
+  // From HTTP::Handler
+  HTTP::Context *createContext(HTTP::Connection *con) {
+    if (con->getRequest().getURI().getPath() == "/hold")
+      return new HoldContext(*con, released);
+    return Handler::createContext(con);
+  }
+
+
+  void buildResponse(HTTP::Context *ctx) {
+    ctx->getConnection() << "path " << ctx->getURI().getPath() << flush;
+  }
+};
+
+
+void request(Socket &socket, const string &path, bool close = false) {
+  string req = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n" +
+    (close ? "Connection: close\r\n" : "") + "\r\n";
+  socket.write(req.data(), req.length());
+}
+
+
+string response(Socket &socket) {
+  string data;
+  char buf[4096];
+
+  while (true) {
+    size_t end = data.find("\r\n\r\n");
+
+    if (end != string::npos) {
+      string header = String::toLower(data.substr(0, end));
+      size_t pos = header.find("content-length:");
+      unsigned length = 0;
+
+      if (pos != string::npos) {
+        pos += 15;
+        length = String::parseU32(String::trim(header.substr(
+          pos, header.find('\r', pos) - pos)));
+      }
+
+      if (end + 4 + length <= data.length())
+        return data.substr(0, data.find('\r')) + ": " +
+          data.substr(end + 4, length);
+    }
+
+    streamsize n = socket.read(buf, sizeof(buf));
+    if (n <= 0) THROW("Connection closed");
+    data.append(buf, n);
+  }
+}
+
+
+void testServer(bool threads, unsigned port) {
+  Logger::instance().setVerbosity(0);
+  IPAddress addr("127.0.0.1", port);
+
+  Options options;
+  HTTP::Server server(options);
+  TestHandler handler;
+  server.addHandler(&handler);
+  options["http-addresses"].set(addr.toString());
+  server.init();
+
+  // The pool changes connection states outside the server thread
+  if (threads) server.createThreadPool(2);
+  server.start();
+
+  // Several requests on a persistent connection
+  Socket client;
+  client.setTimeout(5);
+  client.connect(addr);
+  for (const char *path: {"/a", "/b", "/c"}) {
+    request(client, path);
+    cout << response(client) << endl;
+  }
+
+  // Many connections at once
+  const unsigned count = 16;
+  vector<SmartPointer<Socket> > clients;
+  for (unsigned i = 0; i < count; i++) {
+    clients.push_back(new Socket);
+    clients.back()->setTimeout(5);
+    clients.back()->connect(addr);
+    request(*clients.back(), SSTR("/" << i), true);
+  }
+
+  unsigned ok = 0;
+  for (unsigned i = 0; i < count; i++) {
+    string expected = SSTR("HTTP/1.1 200 HTTP_OK: path /" << i);
+    if (response(*clients[i]) == expected) ok++;
+  }
+  cout << "ok " << ok << "/" << count << endl;
+
+  // The response waits for the Context to be ready
+  request(client, "/hold");
+  cout << "held " << !client.canRead(0.3) << endl;
+  handler.released = true;
+  cout << response(client) << endl;
+
+  server.stop();
+  server.join();
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+
+    string test = argv[1];
+
+    if (test == "direct") testServer(false, 19881);
+    else if (test == "threads") testServer(true, 19882);
+    else THROW("Unknown test: " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
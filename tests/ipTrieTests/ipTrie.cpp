@@ -0,0 +1,167 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/String.h>
+#include <cbang/net/IPAddressFilter.h>
+#include <cbang/net/IPTrie.h>
+#include <cbang/os/SystemUtilities.h>
+#include <cbang/os/TemporaryDirectory.h>
+
+#include <iostream>
+
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  void check(const IPTrie &trie, const char *addrs[]) {
+    for (unsigned i = 0; addrs[i]; i++)
+      cout << addrs[i] << ' '
+           << (trie.contains(IPTrie::Address::parse(addrs[i])) ? "in" : "out")
+           << endl;
+  }
+
+
+  void write(const string &path, const string &specs) {
+    *SystemUtilities::oopen(path) << specs;
+  }
+}
+
+
+void testIPv4() {
+  IPTrie::Builder builder;
+  builder.insert("10.0.0.0/8");
+  builder.insert("192.168.1.10-192.168.1.20");
+  builder.insert("192.168.1.15-192.168.1.30"); // Overlaps, merged
+  builder.insert("172.16.0.1");
+
+  SmartPointer<IPTrie>::Protected trie = builder.build();
+  cout << "ranges " << trie->getRangeCount() << endl;
+
+  const char *addrs[] = {
+    "9.255.255.255", "10.0.0.0", "10.255.255.255", "11.0.0.0",
+    "192.168.1.9", "192.168.1.10", "192.168.1.25", "192.168.1.30",
+    "192.168.1.31", "172.16.0.0", "172.16.0.1", "172.16.0.2", 0};
+  check(*trie, addrs);
+
+  cout << "ipv4 " << trie->contains(IPAddress("10.1.2.3")) << endl;
+}
+
+
+void testIPv6() {
+  IPTrie::Builder builder;
+  builder.insert("2001:db8::/32");
+  builder.insert("::1");
+  builder.insert("fe80::10-fe80::1f");
+  builder.insert("127.0.0.0/8"); // Stored as ::ffff:127.0.0.0/104
+
+  SmartPointer<IPTrie>::Protected trie = builder.build();
+  cout << "ranges " << trie->getRangeCount() << endl;
+
+  const char *addrs[] = {
+    "2001:db7:ffff:ffff:ffff:ffff:ffff:ffff", "2001:db8::",
+    "2001:db8:ffff:ffff:ffff:ffff:ffff:ffff", "2001:db9::", "::", "::1",
+    "::2", "fe80::f", "fe80::10", "fe80::1f", "fe80::20", "127.0.0.1",
+    "::ffff:127.0.0.1", "128.0.0.1", 0};
+  check(*trie, addrs);
+}
+
+
+void testEmpty() {
+  SmartPointer<IPTrie>::Protected trie = IPTrie::Builder().build();
+  cout << "empty " << trie->empty() << endl;
+
+  const char *addrs[] = {"0.0.0.0", "255.255.255.255", "::", 0};
+  check(*trie, addrs);
+
+  IPTrie::Builder builder;
+  builder.insert("0.0.0.0/0");
+  trie = builder.build();
+
+  const char *all[] = {"0.0.0.0", "255.255.255.255", "::", 0};
+  check(*trie, all);
+}
+
+
+void testFilter() {
+  IPAddressFilter filter;
+  filter.deny("10.0.0.0/8");
+  filter.allow("10.1.0.0/16");
+
+  cout << "10.2.0.1 " << filter.isAllowed(IPAddress("10.2.0.1")) << endl;
+  cout << "10.1.0.1 " << filter.isAllowed(IPAddress("10.1.0.1")) << endl;
+  cout << "11.0.0.1 " << filter.isAllowed(IPAddress("11.0.0.1")) << endl;
+
+  TemporaryDirectory tmp(".");
+  string path = tmp.getPath() + "/deny";
+
+  // Reload replaces the deny list
+  write(path, "11.0.0.0/8 # comment\n\n12.0.0.1\n");
+  filter.reloadDeny(path);
+
+  cout << "reloaded" << endl;
+  cout << "10.2.0.1 " << filter.isAllowed(IPAddress("10.2.0.1")) << endl;
+  cout << "11.0.0.1 " << filter.isAllowed(IPAddress("11.0.0.1")) << endl;
+  cout << "12.0.0.1 " << filter.isAllowed(IPAddress("12.0.0.1")) << endl;
+
+  // Later changes add to the reloaded list
+  filter.deny("13.0.0.0/8");
+  cout << "11.0.0.1 " << filter.isAllowed(IPAddress("11.0.0.1")) << endl;
+  cout << "13.0.0.1 " << filter.isAllowed(IPAddress("13.0.0.1")) << endl;
+
+  // Many single adds are compiled once by the next lookup
+  for (unsigned i = 0; i < 1000; i++)
+    filter.deny("14.0." + String(i / 256) + "." + String(i % 256));
+  cout << "14.0.3.231 " << filter.isAllowed(IPAddress("14.0.3.231")) << endl;
+  cout << "14.0.3.232 " << filter.isAllowed(IPAddress("14.0.3.232")) << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+
+    string test = argv[1];
+
+    if (test == "ipv4") testIPv4();
+    else if (test == "ipv6") testIPv6();
+    else if (test == "empty") testEmpty();
+    else if (test == "filter") testFilter();
+    else THROW("Unknown test: " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
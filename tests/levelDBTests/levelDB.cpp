@@ -0,0 +1,264 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/String.h>
+#include <cbang/db/AsyncLevelDB.h>
+#include <cbang/event/Base.h>
+#include <cbang/os/TemporaryDirectory.h>
+
+#include <iostream>
+
+using namespace cb;
+using namespace std;
+
+
+void testAsync(const string &path) {
+  Event::Base base;
+  SmartPointer<AsyncScheduler> sched = new AsyncScheduler(base, 2);
+  AsyncLevelDB db(sched);
+
+  AsyncLevelDB::pairs_t pairs;
+  for (unsigned i = 0; i < 20; i++)
+    pairs.push_back({String::printf("k%02u", i), String(i)});
+
+  sched->setErrorHandler([&] (const Exception &e) {
+    cout << "get missing failed" << endl;
+    base.loopExit();
+  });
+
+  // Each step runs in the previous step's callback
+  vector<function<void ()> > steps;
+  unsigned step = 0;
+  auto next = [&] () {
+    if (step < steps.size()) steps[step++]();
+    else base.loopExit();
+  };
+
+  unsigned count = 0;
+  string keys;
+  auto collect = [&] (const string &key, const string &value) {
+    keys += (keys.empty() ? "" : " ") + key + "=" + value;
+    return ++count < 5;
+  };
+  auto printKeys = [&] (const SmartPointer<Exception> &error) {
+    cout << count << ':';
+    if (!keys.empty()) cout << ' ' << keys;
+    if (error.isSet()) cout << " error: " << error->getMessage();
+    cout << endl;
+    count = 0;
+    keys.clear();
+    next();
+  };
+
+  steps.push_back([&] () {
+      db.open(path, [&] () {cout << "open" << endl; next();},
+              LevelDB::CREATE_IF_MISSING);
+    });
+  steps.push_back([&] () {db.set(pairs, next);});
+  steps.push_back([&] () {
+      AsyncLevelDB::keys_t keys = {"k01", "missing", "k19"};
+      db.get(keys, "default", [&] (const AsyncLevelDB::values_t &values) {
+        cout << "get:";
+        for (auto &v: values) cout << ' ' << v;
+        cout << endl;
+        next();
+      });
+    });
+  steps.push_back([&] () {db.foreach(collect, "", false, 0, 2, printKeys);});
+  steps.push_back([&] () {db.foreach(collect, "k10", true, 0, 3, printKeys);});
+  steps.push_back([&] () {db.erase("k02", next);});
+  steps.push_back([&] () {
+      db.has("k02", [&] (bool has) {cout << "has k02 " << has << endl; next();});
+    });
+  steps.push_back([&] () {
+      db.set("k02", "two", [&] () {
+        db.get("k02", [&] (const string &v) {
+          cout << "k02=" << v << endl;
+          next();
+        });
+      });
+    });
+
+  // done is called with the error when a callback or a read fails
+  auto fail = [&] (const string &key, const string &value) {
+    if (collect(key, value) && count == 3) THROW("Callback failed");
+    return true;
+  };
+  steps.push_back([&] () {db.foreach(fail, "", false, 0, 2, printKeys);});
+
+  AsyncLevelDB closed(sched);
+  steps.push_back([&] () {
+      closed.foreach(collect, "", false, 0, 2, printKeys);
+    });
+
+  steps.push_back([&] () {
+      db.get("missing", [&] (const string &v) {cout << "unexpected" << endl;});
+    });
+
+  next();
+  base.dispatch();
+  sched->join();
+}
+
+
+void print(LevelDB::Iterator it, bool reverse = false) {
+  if (reverse) it.last();
+  else it.first();
+
+  for (; it.valid(); reverse ? it-- : it++) {
+    LevelDB::Slice key = it.keySlice();
+    LevelDB::Slice value = it.valueSlice();
+    cout << ' ' << key.toString() << '=' << value.toString();
+  }
+
+  cout << endl;
+}
+
+
+void testNamespace(const string &path) {
+  LevelDB db;
+  db.open(path, LevelDB::CREATE_IF_MISSING);
+
+  LevelDB a = db.ns("a:");
+  LevelDB b = db.ns("b:");
+  a.set("x", "1");
+  a.set("y", "2");
+  b.set("z", "3");
+  db.set("a", "4");
+  db.set("c", "5");
+
+  cout << "all:";
+  print(db.iterator());
+  cout << "a:";
+  print(a.iterator());
+  cout << "a reverse:";
+  print(a.iterator(), true);
+  cout << "b:";
+  print(b.iterator());
+
+  LevelDB::Iterator it = a.iterator();
+  it.seek("y");
+  cout << "seek y: " << it.key() << '=' << it.value() << endl;
+
+  LevelDB::Slice slice("prefix:key");
+  cout << "startsWith " << slice.startsWith("prefix:") << ' '
+       << slice.startsWith("key") << endl;
+  cout << "substr " << slice.substr(7).toString() << endl;
+  cout << "compare " << (LevelDB::Slice("ab") < LevelDB::Slice("abc")) << ' '
+       << (LevelDB::Slice("b") < LevelDB::Slice("abc")) << ' '
+       << (LevelDB::Slice("ab") == string("ab")) << endl;
+}
+
+
+void testLookup(const string &path) {
+  LevelDB db;
+  db.open(path, LevelDB::CREATE_IF_MISSING);
+  db.set("key", "value");
+
+  string value;
+  value.reserve(1024);
+  size_t capacity = value.capacity();
+
+  cout << "found " << db.lookup("key", value) << ' ' << value << endl;
+  cout << "storage reused " << (value.capacity() == capacity) << endl;
+  cout << "missing " << db.lookup("missing", value) << endl;
+  cout << "get " << db.get("key") << ' ' << db.get("missing", "default")
+       << endl;
+
+  db.compact("a", "z");
+  db.compact();
+  cout << "after compact " << db.get("key") << endl;
+}
+
+
+// Orders keys in reverse without allocating strings
+struct ReverseComparator : public LevelDB::Comparator {
+  ReverseComparator() : LevelDB::Comparator("reverse") {}
+
+  int compare(const LevelDB::Slice &a, const LevelDB::Slice &b) const {
+    return b.compare(a);
+  }
+};
+
+
+// Only implements the string compare used before Slices
+struct NumericComparator : public LevelDB::Comparator {
+  NumericComparator() : LevelDB::Comparator("numeric") {}
+
+  int operator()(const string &a, const string &b) const {
+    uint64_t x = String::parseU64(a);
+    uint64_t y = String::parseU64(b);
+    return x < y ? -1 : (y < x ? 1 : 0);
+  }
+};
+
+
+void testComparator(const string &path) {
+  SmartPointer<LevelDB::Comparator> comparators[] = {
+    new ReverseComparator, new NumericComparator};
+
+  for (unsigned i = 0; i < 2; i++) {
+    LevelDB db(comparators[i]);
+    db.open(path + String(i), LevelDB::CREATE_IF_MISSING);
+
+    const char *keys[] = {"2", "10", "1", "33", 0};
+    for (unsigned j = 0; keys[j]; j++) db.set(keys[j], "");
+
+    cout << comparators[i]->getName() << ':';
+    for (auto it = db.first(); it.valid(); it++) cout << ' ' << it.key();
+    cout << endl;
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+    string test = argv[1];
+
+    Event::Base::enableThreads();
+    TemporaryDirectory tmp(".");
+    string path = tmp.getPath() + "/db";
+
+    if (test == "async") testAsync(path);
+    else if (test == "namespace") testNamespace(path);
+    else if (test == "lookup") testLookup(path);
+    else if (test == "comparator") testComparator(path);
+    else THROW("Unknown test " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
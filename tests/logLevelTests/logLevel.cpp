@@ -0,0 +1,129 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#define CBANG_LOG_DOMAIN "logLevelTest"
+
+#include <cbang/Catch.h>
+#include <cbang/log/Logger.h>
+
+#include <iostream>
+#include <sstream>
+
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  SmartPointer<stringstream> screen = new stringstream;
+
+
+  // One callsite for each check, called repeatedly
+  bool info3() {return LOG_INFO_ENABLED(3);}
+  bool info5() {return LOG_INFO_ENABLED(5);}
+  void logInfo3(int i) {LOG_INFO(3, "info3 " << i);}
+
+
+  void show(const char *label) {
+    cout << label << ": info3=" << info3() << " info5=" << info5() << endl;
+  }
+}
+
+
+void testVerbosity() {
+  Logger &log = Logger::instance();
+
+  log.setVerbosity(1);
+  show("verbosity 1");
+  show("again");
+
+  // Changing the verbosity invalidates the cached results
+  log.setVerbosity(3);
+  show("verbosity 3");
+
+  log.setVerbosity(5);
+  show("verbosity 5");
+
+  log.setVerbosity(0);
+  show("verbosity 0");
+}
+
+
+void testDomain() {
+  Logger &log = Logger::instance();
+  log.setVerbosity(1);
+  show("default");
+
+  log.setLogDomainLevels("logLevelTest:i:5");
+  show("domain 5");
+
+  log.setLogDomainLevels("logLevelTest:i:3");
+  show("domain 3");
+
+  // Levels for other domains do not affect this one
+  log.setLogDomainLevels("otherDomain:i:5");
+  show("other domain");
+}
+
+
+void testOutput() {
+  Logger &log = Logger::instance();
+  log.setScreenStream(screen);
+  log.setLogHeader(false);
+  log.setLogColor(false);
+
+  // Only the lines logged while enabled reach the screen
+  for (int i = 0; i < 6; i++) {
+    log.setVerbosity(i % 2 ? 3 : 2);
+    logInfo3(i);
+  }
+
+  cout << screen->str();
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+
+    string test = argv[1];
+
+    if (test == "verbosity") testVerbosity();
+    else if (test == "domain") testDomain();
+    else if (test == "output") testOutput();
+    else THROW("Unknown test: " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
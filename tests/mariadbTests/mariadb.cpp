@@ -0,0 +1,125 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/db/maria/EventDB.h>
+#include <cbang/db/maria/EventDBPool.h>
+#include <cbang/event/Base.h>
+#include <cbang/json/NullSink.h>
+#include <cbang/json/Value.h>
+#include <cbang/log/Logger.h>
+
+#include <iostream>
+
+using namespace cb;
+using namespace cb::MariaDB;
+using namespace std;
+
+
+namespace {
+  class TestSink : public JSON::NullSink {
+  public:
+    ~TestSink() {cout << "sink released" << endl;}
+  };
+
+
+  const char *stateName(EventDB::state_t state) {
+    switch (state) {
+    case EventDB::EVENTDB_DONE: return "done";
+    case EventDB::EVENTDB_ERROR: return "error";
+    default: return "other";
+    }
+  }
+
+
+  EventDB::callback_t printer(const string &name) {
+    return [name] (EventDB::state_t state) {
+      cout << name << ' ' << stateName(state) << endl;
+    };
+  }
+}
+
+
+void testQueue() {
+  Event::Base base;
+  EventDB db(base);
+
+  // Not connected so each operation fails, in order, as it is dequeued.
+  // Query 2 is queued while query 1 is busy and must keep its sink alive.
+  db.query([&] (EventDB::state_t state) {
+      cout << "query 1 " << stateName(state) << endl;
+
+      SmartPointer<JSON::Sink> sink = new TestSink;
+      db.query(sink, printer("query 2"), "SELECT 2");
+      cout << "caller dropped sink" << endl;
+    }, "SELECT 1");
+
+  db.query(printer("query 3"), "SELECT 3");
+}
+
+
+void testPool() {
+  Event::Base base;
+  EventDBPool pool(base, 2);
+
+  cout << "size " << pool.getSize() << endl;
+  cout << "connected " << pool.getConnectedCount() << endl;
+
+  // Closing an unconnected pool is harmless
+  pool.close();
+
+  SmartPointer<JSON::Sink> sink = new TestSink;
+  pool.query(sink, printer("pool query"), "SELECT 1");
+  sink.release();
+
+  cout << "end" << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+
+    Logger::instance().setVerbosity(0);
+
+    string test = argv[1];
+
+    if (test == "queue") testQueue();
+    else if (test == "pool") testPool();
+    else THROW("Unknown test: " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,187 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/net/SessionManager.h>
+#include <cbang/db/Database.h>
+
+#include <iostream>
+
+#include <unistd.h>
+
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  SessionManager::SessionPtr make(const string &sid, uint64_t lastUsed) {
+    SessionManager::SessionPtr session = new Session(sid, IPAddress());
+    session->setLastUsed(lastUsed);
+    return session;
+  }
+
+
+  void add(SessionManager &manager, const string &sid, uint64_t lastUsed) {
+    manager.addSession(make(sid, lastUsed));
+  }
+
+
+  void print(const SessionManager &manager) {
+    SessionManager::snapshot_t sessions = manager.getSessions();
+
+    cout << "sessions " << manager.getSessionCount() << ':';
+    for (auto it = sessions.begin(); it != sessions.end(); it++)
+      cout << ' ' << it->first;
+    cout << endl;
+  }
+}
+
+
+void testExpire() {
+  SessionManager manager;
+  manager.setTimeout(60);
+  uint64_t now = Time::now();
+
+  add(manager, "live", now);
+  add(manager, "idle", now - 120);
+
+  SessionManager::SessionPtr old = make("old", now);
+  old->setCreationTime(now - 100);
+  old->setLifetime(50);
+  manager.addSession(old);
+
+  SessionManager::SessionPtr forever = make("forever", now - 120);
+  forever->setTimeout(0);
+  manager.addSession(forever);
+
+  // The "touched" timer fires but the session was used since
+  SessionManager::SessionPtr touched = make("touched", now - 60);
+  manager.addSession(touched);
+  touched->setLastUsed(now + 100);
+
+  // Timers are not due before the next tick
+  manager.cleanup();
+  print(manager);
+
+  sleep(2);
+  manager.cleanup();
+  print(manager);
+
+  // A lookup removes an expired session without waiting for cleanup()
+  manager.findSession("live")->setLastUsed(now - 120);
+  cout << "find live " << manager.findSession("live").isSet() << endl;
+  print(manager);
+
+  // Sessions must be protected because they are shared between threads
+  try {
+    SmartPointer<Session> session = new Session("unprotected", IPAddress());
+    manager.addSession(session);
+  } catch (const Exception &e) {cout << e.getMessage() << endl;}
+
+  // Sessions can be visited in place without copying the map
+  unsigned count = 0;
+  manager.forEach([&] (const SessionManager::SessionPtr &session) {
+    if (session->getID().size()) count++;
+  });
+  cout << "forEach " << count << endl;
+}
+
+
+void testWriteBehind() {
+  DB::Database db;
+  db.open(":memory:");
+
+  SessionManager manager;
+  manager.setWriteBehind(true);
+  manager.create(db);
+
+  uint64_t now = Time::now();
+  SessionManager::SessionPtr a = make("a", now);
+  a->setCreationTime(now - 1000);
+  manager.addSession(a);
+  add(manager, "b", now);
+  add(manager, "c", now);
+  manager.save(db);
+
+  int64_t rows = 0;
+  db.execute("SELECT COUNT(*) FROM sessions", rows);
+  cout << "rows " << rows << endl;
+
+  // Changes are written by the next save()
+  manager.findSession("a")->setUser("alice");
+  manager.findSession("c")->addGroup("admin");
+  manager.closeSession("b");
+
+  SessionManager loaded;
+  loaded.load(db);
+  print(loaded);
+  cout << "a user " << loaded.findSession("a")->hasUser() << endl;
+
+  manager.save(db);
+
+  SessionManager reloaded;
+  reloaded.load(db);
+  print(reloaded);
+
+  a = reloaded.findSession("a");
+  cout << "a user " << a->getUser() << endl;
+  cout << "a age " << now - a->getCreationTime() << endl;
+  cout << "c admin " << reloaded.findSession("c")->hasGroup("admin") << endl;
+
+  // Nothing is queued without write-behind
+  reloaded.findSession("c")->setUser("carol");
+  reloaded.closeSession("a");
+  reloaded.save(db);
+
+  SessionManager unchanged;
+  unchanged.load(db);
+  print(unchanged);
+  cout << "c user " << unchanged.findSession("c")->hasUser() << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+
+    string test = argv[1];
+
+    if (test == "expire") testExpire();
+    else if (test == "writebehind") testWriteBehind();
+    else THROW("Unknown test: " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
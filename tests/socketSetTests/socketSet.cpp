@@ -0,0 +1,123 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/net/IPAddress.h>
+#include <cbang/socket/Socket.h>
+#include <cbang/socket/SocketSet.h>
+
+#include <iostream>
+
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  const char *ready(const SocketSet &set, const Socket &s) {
+    bool r = set.isSet(s, SocketSet::READ);
+    bool w = set.isSet(s, SocketSet::WRITE);
+    return r ? (w ? "rw" : "r") : (w ? "w" : "-");
+  }
+}
+
+
+void testBackend(SocketSet::backend_t backend, unsigned port) {
+  // Use the same output for every backend, including select() fallback
+  if (!SocketSet::isAvailable(backend)) backend = SocketSet::BACKEND_SELECT;
+
+  IPAddress addr("127.0.0.1", port);
+
+  Socket server;
+  server.setReuseAddr(true);
+  server.bind(addr);
+  server.listen();
+
+  Socket client;
+  client.connect(addr);
+  SmartPointer<Socket> peer = server.accept();
+
+  SocketSet set(backend);
+  set.add(client, SocketSet::READ);
+  set.add(*peer, SocketSet::READ);
+  cout << "size " << set.size() << endl;
+
+  // Nothing to read yet
+  cout << "idle " << set.select(0) << endl;
+
+  // Readiness is reported and the sockets stay in the set
+  peer->write("x", 1);
+  cout << "select " << set.select(1) << " client " << ready(set, client)
+       << " peer " << ready(set, *peer) << endl;
+
+  char c;
+  client.read(&c, 1);
+  cout << "drained " << set.select(0) << endl;
+
+  // set() replaces interest, a connected socket is writable
+  set.set(client, SocketSet::WRITE);
+  cout << "select " << set.select(1) << " client " << ready(set, client)
+       << endl;
+
+  set.set(client, SocketSet::READ);
+  cout << "read only " << set.select(0) << endl;
+
+  // Data in the other direction
+  client.write("y", 1);
+  cout << "select " << set.select(1) << " client " << ready(set, client)
+       << " peer " << ready(set, *peer) << endl;
+
+  // Removed sockets are not reported even with data pending
+  set.remove(*peer);
+  cout << "size " << set.size() << " removed " << set.select(0) << endl;
+
+  set.clear();
+  cout << "size " << set.size() << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+
+    string test = argv[1];
+
+    if (test == "select") testBackend(SocketSet::BACKEND_SELECT, 19871);
+    else if (test == "poll") testBackend(SocketSet::BACKEND_POLL, 19872);
+    else if (test == "epoll") testBackend(SocketSet::BACKEND_EPOLL, 19873);
+    else THROW("Unknown test: " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
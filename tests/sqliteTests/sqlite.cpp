@@ -0,0 +1,186 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/db/Database.h>
+#include <cbang/db/Statement.h>
+#include <cbang/db/TableDef.h>
+#include <cbang/db/Transaction.h>
+#include <cbang/db/WriteBatch.h>
+
+#include <iostream>
+
+using namespace cb;
+using namespace std;
+
+
+namespace {
+  int64_t count(DB::Database &db) {
+    int64_t result = 0;
+    db.execute("SELECT COUNT(*) FROM t", result);
+    return result;
+  }
+
+
+  void insert(DB::Database &db, int64_t x) {
+    SmartPointer<DB::Statement> stmt = db.prepare("INSERT INTO t VALUES (@X)");
+    stmt->parameter("@X").bind(x);
+    stmt->execute();
+  }
+}
+
+
+void testCache() {
+  DB::Database db;
+  db.open(":memory:");
+  db.setStatementCacheSize(2);
+
+  const char *a = "SELECT 1";
+  const char *b = "SELECT 2";
+  const char *c = "SELECT 3";
+
+  SmartPointer<DB::Statement> stmtA = db.prepare(a);
+  cout << "hit " << (db.prepare(a) == stmtA) << endl;
+
+  // A is most recently used so B is evicted by C
+  SmartPointer<DB::Statement> stmtB = db.prepare(b);
+  db.prepare(a);
+  db.prepare(c);
+  cout << "a kept " << (db.prepare(a) == stmtA) << endl;
+  cout << "b evicted " << (db.prepare(b) != stmtB) << endl;
+
+  // A cached statement is returned reset with its bindings cleared
+  SmartPointer<DB::Statement> stmt = db.prepare("SELECT @X");
+  stmt->parameter("@X").bind((int64_t)7);
+  stmt->next();
+  stmt = db.prepare("SELECT @X");
+  stmt->next();
+  cout << "cleared " << (stmt->column(0).getType() == DB::Column::DB_NULL)
+       << endl;
+
+  db.setStatementCacheSize(0);
+  stmtA = db.prepare(a);
+  cout << "disabled " << (db.prepare(a) != stmtA) << endl;
+}
+
+
+void testTableDef() {
+  DB::Database db;
+  db.open(":memory:");
+
+  DB::TableDef table("t");
+  table.add(DB::ColumnDef("x", "INTEGER", "PRIMARY KEY"));
+  table.add(DB::ColumnDef("y", "TEXT"));
+  table.create(db);
+
+  // Each call returns its own statement so both can be held at once
+  SmartPointer<DB::Statement> write1 = table.makeWriteStmt(db);
+  SmartPointer<DB::Statement> write2 = table.makeWriteStmt(db);
+  cout << "distinct " << (write1.get() != write2.get()) << endl;
+
+  write1->parameter("@X").bind((int64_t)1);
+  write2->parameter("@X").bind((int64_t)2);
+  write1->parameter("@Y").bind(string("one"));
+  write2->parameter("@Y").bind(string("two"));
+  write1->execute();
+  write2->execute();
+
+  SmartPointer<DB::Statement> read1 = table.makeReadStmt(db, "ORDER BY x");
+  SmartPointer<DB::Statement> read2 = table.makeReadStmt(db, "ORDER BY x");
+
+  read1->next();
+  read2->next();
+  read2->next();
+
+  cout << read1->column(1).toString() << ' ' << read2->column(1).toString()
+       << endl;
+}
+
+
+void testBatch() {
+  DB::Database db;
+  db.open(":memory:");
+  db.execute("CREATE TABLE t (x INTEGER)");
+
+  {
+    DB::WriteBatch batch(db, 3, 3600);
+
+    for (int i = 0; i < 4; i++) batch.write([&db, i] () {insert(db, i);});
+
+    // The first three were committed, the fourth is pending
+    cout << "pending " << batch.getPendingWrites() << endl;
+
+    try {
+      db.begin();
+      cout << "nested begin allowed" << endl;
+    } catch (const Exception &e) {
+      cout << "nested begin: " << e.getMessage() << endl;
+    }
+
+    batch.rollback();
+    cout << "after rollback " << count(db) << endl;
+
+    batch.write([&db] () {insert(db, 10);});
+    batch.flush();
+    cout << "after flush " << count(db) << endl;
+
+    // Outside a pending batch transactions work as usual
+    SmartPointer<DB::Transaction> t = db.begin();
+    insert(db, 11);
+    t->commit();
+    cout << "after transaction " << count(db) << endl;
+
+    batch.execute("INSERT INTO t VALUES (12)");
+  }
+
+  // The destructor commits pending writes
+  cout << "after destruct " << count(db) << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+
+    string test = argv[1];
+
+    if (test == "cache") testCache();
+    else if (test == "tabledef") testTableDef();
+    else if (test == "batch") testBatch();
+    else THROW("Unknown test: " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
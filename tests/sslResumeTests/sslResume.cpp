@@ -0,0 +1,242 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/Client.h>
+#include <cbang/event/DNSBase.h>
+#include <cbang/event/HTTP.h>
+#include <cbang/event/HTTPHandler.h>
+#include <cbang/event/OutgoingRequest.h>
+#include <cbang/event/Request.h>
+#include <cbang/log/Logger.h>
+#include <cbang/net/URI.h>
+#include <cbang/openssl/Certificate.h>
+#include <cbang/openssl/KeyPair.h>
+#include <cbang/openssl/SSLContext.h>
+
+#include <iostream>
+
+using namespace cb;
+using namespace cb::Event;
+using namespace std;
+
+
+unsigned nextPort = 28201;
+
+
+struct HelloHandler : public HTTPHandler {
+  // From HTTPHandler
+  SmartPointer<Request> createRequest
+  (Connection &con, RequestMethod method, const URI &uri,
+   const Version &version) {return new Request(method, uri, version);}
+
+  bool handleRequest(Request &req) {req.reply("ok", 2); return true;}
+  void endRequest(Request &req) {}
+};
+
+
+SmartPointer<SSLContext> serverContext(bool cache, bool tickets) {
+  static KeyPair key;
+  static Certificate cert;
+  static bool generated = false;
+
+  if (!generated) {
+    generated = true;
+    key.generateRSA(2048);
+    cert.setVersion(2);
+    cert.setSerial(1);
+    cert.setPublicKey(key);
+    cert.setNotBefore();
+    cert.setNotAfter(3600);
+    cert.addNameEntry("CN", "localhost");
+    cert.setIssuer(cert);
+    cert.sign(key);
+  }
+
+  SmartPointer<SSLContext> ctx = new SSLContext;
+  ctx->useCertificate(cert);
+  ctx->usePrivateKey(key);
+  ctx->setSessionCacheSize(cache ? 1024 : 0);
+  ctx->setSessionTickets(tickets);
+
+  return ctx;
+}
+
+
+struct Test {
+  cb::Event::Base base;
+  DNSBase dns;
+  SmartPointer<SSLContext> clientCtx;
+  Client client;
+
+  Test(const SmartPointer<SSLContext> &clientCtx = new SSLContext) :
+    dns(base), clientCtx(clientCtx), client(base, dns, clientCtx) {}
+
+
+  // Makes @param count connections and returns how many were resumed
+  unsigned connect(const SmartPointer<SSLContext> &serverCtx, unsigned port,
+                   unsigned count) {
+    SmartPointer<Event::HTTP> http =
+      new Event::HTTP(base, new HelloHandler, serverCtx);
+    http->bind(IPAddress("127.0.0.1", port));
+
+    URI uri(SSTR("https://127.0.0.1:" << port << "/"));
+    uint64_t resumed = serverCtx->getResumedHandshakes();
+    unsigned failed = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+      client.call(uri, RequestMethod::HTTP_GET, [&] (Request &req) {
+        if (!req.isOk()) failed++;
+        base.loopExit();
+      })->send();
+
+      base.dispatch();
+    }
+
+    if (failed) THROW(failed << " requests failed");
+
+    return serverCtx->getResumedHandshakes() - resumed;
+  }
+};
+
+
+void testModes() {
+  const struct {
+    const char *name;
+    bool cache;
+    bool tickets;
+    bool client;
+  } modes[] = {
+    {"full", false, false, true},
+    {"cache", true, false, true},
+    {"tickets", false, true, true},
+    {"no client cache", true, true, false},
+    {0},
+  };
+
+  for (unsigned i = 0; modes[i].name; i++) {
+    Test test;
+    test.clientCtx->setClientSessionCache(modes[i].client);
+
+    auto serverCtx = serverContext(modes[i].cache, modes[i].tickets);
+    if (modes[i].tickets) serverCtx->setTicketKeyLifetime(3600);
+
+    cout << modes[i].name << ": resumed "
+         << test.connect(serverCtx, nextPort++, 4) << "/4" << endl;
+  }
+}
+
+
+void testRotate() {
+  Test test;
+  auto serverCtx = serverContext(false, true);
+  serverCtx->setTicketKeyLifetime(3600);
+  serverCtx->setMaxTicketKeys(2);
+  unsigned port = nextPort++;
+
+  cout << "first key: resumed " << test.connect(serverCtx, port, 2) << "/2"
+       << endl;
+
+  // Tickets from the previous key are still accepted and renewed
+  serverCtx->rotateTicketKeys();
+  cout << "after rotate: resumed " << test.connect(serverCtx, port, 2) << "/2"
+       << endl;
+
+  // Once the issuing key is dropped the ticket is rejected
+  serverCtx->setMaxTicketKeys(1);
+  serverCtx->rotateTicketKeys();
+  cout << "after drop: resumed " << test.connect(serverCtx, port, 2) << "/2"
+       << endl;
+}
+
+
+void testShared() {
+  string key(80, 0);
+  for (unsigned i = 0; i < key.size(); i++) key[i] = (char)(i * 7 + 3);
+
+  auto serverA = serverContext(false, true);
+  auto serverB = serverContext(false, true);
+  serverA->addTicketKey(key);
+  serverB->addTicketKey(key);
+
+  // Both servers listen on the same address one after the other
+  Test test;
+  unsigned port = nextPort++;
+  cout << "server A: resumed " << test.connect(serverA, port, 1) << "/1"
+       << endl;
+  cout << "server B: resumed " << test.connect(serverB, port, 1) << "/1"
+       << endl;
+
+  // Another key does not decrypt the ticket
+  auto serverC = serverContext(false, true);
+  serverC->setTicketKeyLifetime(3600);
+  cout << "server C: resumed " << test.connect(serverC, port, 1) << "/1"
+       << endl;
+}
+
+
+void testCounters() {
+  // One context is both the client and the server
+  auto ctx = serverContext(true, false);
+  ctx->setClientSessionCache(true);
+
+  Test test(ctx);
+  test.connect(ctx, nextPort++, 4);
+
+  cout << "server: " << ctx->getResumedHandshakes(true) << '/'
+       << ctx->getHandshakes(true) << " resumed" << endl;
+  cout << "client: " << ctx->getResumedHandshakes(false) << '/'
+       << ctx->getHandshakes(false) << " resumed" << endl;
+  cout << "rate: " << ctx->getResumptionRate() << endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+    string test = argv[1];
+
+    Logger::instance().setVerbosity(0);
+
+    if (test == "modes") testModes();
+    else if (test == "rotate") testRotate();
+    else if (test == "shared") testShared();
+    else if (test == "counters") testCounters();
+    else THROW("Unknown test " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}
@@ -0,0 +1,268 @@
+/******************************************************************************\
+
+          This file is part of the C! library.  A.K.A the cbang library.
+
+                Copyright (c) 2003-2019, Cauldron Development LLC
+                   Copyright (c) 2003-2017, Stanford University
+                               All rights reserved.
+
+         The C! library is free software: you can redistribute it and/or
+        modify it under the terms of the GNU Lesser General Public License
+       as published by the Free Software Foundation, either version 2.1 of
+               the License, or (at your option) any later version.
+
+        The C! library is distributed in the hope that it will be useful,
+          but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+                 Lesser General Public License for more details.
+
+         You should have received a copy of the GNU Lesser General Public
+                 License along with the C! library.  If not, see
+                         <http://www.gnu.org/licenses/>.
+
+        In addition, BSD licensing may be granted on a case by case basis
+        by written permission from at least one of the copyright holders.
+           You may request written permission by emailing the authors.
+
+                  For information regarding this software email:
+                                 Joseph Coffland
+                          joseph@cauldrondevelopment.com
+
+\******************************************************************************/
+
+#include <cbang/Catch.h>
+#include <cbang/config/Options.h>
+#include <cbang/event/Base.h>
+#include <cbang/event/HTTPRequestHandler.h>
+#include <cbang/event/Request.h>
+#include <cbang/event/WebServer.h>
+#include <cbang/log/Logger.h>
+#include <cbang/net/IPAddress.h>
+#include <cbang/openssl/SSLContext.h>
+#include <cbang/os/Mutex.h>
+#include <cbang/socket/Socket.h>
+#include <cbang/util/SmartLock.h>
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <set>
+
+#include <unistd.h>
+
+using namespace cb;
+using namespace cb::Event;
+using namespace std;
+
+
+const char *address = "127.0.0.1:28181";
+
+
+string fetch(const string &method = "GET", const string &headers = "") {
+  Socket socket;
+  socket.connect(IPAddress(address));
+
+  string req = method + " / HTTP/1.1\r\nHost: localhost\r\n" + headers +
+    "Connection: close\r\n\r\n";
+  socket.write(req.data(), req.size());
+
+  string response;
+  char buf[4096];
+  try {
+    while (true) response.append(buf, socket.read(buf, sizeof(buf)));
+  } catch (const Socket::EndOfStream &e) {}
+
+  return response;
+}
+
+
+string getHeader(const string &response, const string &name) {
+  size_t start = response.find("\r\n" + name + ": ");
+  if (start == string::npos) return "-";
+  start += name.length() + 4;
+
+  return response.substr(start, response.find("\r\n", start) - start);
+}
+
+
+void testLoops() {
+  Logger::instance().setVerbosity(0);
+
+  Options options;
+  Event::Base base(true);
+  WebServer server(options, base);
+
+  atomic<unsigned> handled(0);
+  auto cb = [&handled] (Request &req) {
+    handled++;
+    req.reply("ok", 2);
+    return true;
+  };
+  server.addHandler(new HTTPRequestFunctionHandler(cb));
+
+  options["http-addresses"].set(address);
+  options["http-event-loops"].set(3);
+  server.init();
+  server.start();
+  server.start(); // Only the first call starts the loops
+
+  cout << "loops " << server.getEventLoops() << endl;
+  cout << "ports " << server.getNumListenPorts() << endl;
+
+  try {
+    server.addListenPort(IPAddress("127.0.0.1:28182"));
+    cout << "added port after start" << endl;
+  } catch (const Exception &e) {cout << "add after start failed" << endl;}
+
+  const unsigned count = 32;
+  unsigned ok = 0;
+
+  thread client([&] () {
+    for (unsigned i = 0; i < count; i++)
+      if (fetch().compare(0, 13, "HTTP/1.1 200 ") == 0) ok++;
+
+    base.loopExit();
+  });
+
+  base.dispatch();
+  client.join();
+
+  cout << "ok " << ok << '/' << count << endl;
+  cout << "handled " << handled << endl;
+
+  server.shutdown();
+}
+
+
+void testConnections(bool start) {
+  Logger::instance().setVerbosity(0);
+
+  Options options;
+  Event::Base base(true);
+  WebServer server(options, base);
+
+  Mutex lock;
+  set<thread::id> threads;
+  auto cb = [&] (Request &req) {
+    SmartLock smartLock(&lock);
+    threads.insert(this_thread::get_id());
+    req.reply("ok", 2);
+    return true;
+  };
+  server.addHandler(new HTTPRequestFunctionHandler(cb));
+
+  options["http-addresses"].set(address);
+  options["http-event-loops"].set(3);
+  server.init();
+  if (start) server.start();
+
+  const unsigned count = 24;
+  unsigned ok = 0;
+
+  thread client([&] () {
+    // All connections are open at once so each loop's socket gets some
+    vector<SmartPointer<Socket> > sockets;
+    for (unsigned i = 0; i < count; i++) {
+      sockets.push_back(new Socket);
+      sockets.back()->connect(IPAddress(address));
+    }
+
+    string req = "GET / HTTP/1.1\r\nHost: localhost\r\n"
+      "Connection: close\r\n\r\n";
+
+    for (unsigned i = 0; i < count; i++) {
+      Socket &socket = *sockets[i];
+      socket.write(req.data(), req.size());
+
+      string response;
+      char buf[4096];
+      try {
+        while (true) response.append(buf, socket.read(buf, sizeof(buf)));
+      } catch (const Socket::EndOfStream &e) {}
+
+      if (response.compare(0, 13, "HTTP/1.1 200 ") == 0) ok++;
+    }
+
+    base.loopExit();
+  });
+
+  base.dispatch();
+  client.join();
+
+  cout << "ok " << ok << '/' << count << endl;
+  cout << "several loops " << (1 < threads.size()) << endl;
+
+  server.shutdown();
+}
+
+
+void testRange() {
+  Logger::instance().setVerbosity(0);
+
+  string path = SSTR("/tmp/webServerRange-" << getpid() << ".txt");
+  ofstream(path.c_str()) << "0123456789abcdefghij";
+
+  Options options;
+  Event::Base base(true);
+  WebServer server(options, base);
+
+  auto cb = [&path] (Request &req) {req.replyFile(path); return true;};
+  server.addHandler(new HTTPRequestFunctionHandler(cb));
+
+  options["http-addresses"].set(address);
+  server.init();
+  server.start();
+
+  const char *ranges[] = {
+    "", "bytes=2-5", "bytes=-3", "bytes=15-", "bytes=18-30", "bytes=25-",
+    "bytes=25-30", "bytes=5-2", "bytes=0-1,4-5", "items=1-2", 0};
+
+  thread client([&] () {
+    for (unsigned i = 0; ranges[i]; i++)
+      for (const char *method: {"GET", "HEAD"}) {
+        string headers = *ranges[i] ? SSTR("Range: " << ranges[i] << "\r\n") :
+          string();
+        string response = fetch(method, headers);
+
+        size_t eol = response.find("\r\n");
+        size_t body = response.find("\r\n\r\n");
+
+        cout << method << " '" << ranges[i] << "': "
+             << response.substr(9, eol - 9)
+             << " range=" << getHeader(response, "Content-Range")
+             << " length=" << getHeader(response, "Content-Length")
+             << " accept=" << getHeader(response, "Accept-Ranges")
+             << " body='"
+             << (body == string::npos ? string() : response.substr(body + 4))
+             << "'" << endl;
+      }
+
+    base.loopExit();
+  });
+
+  base.dispatch();
+  client.join();
+
+  server.shutdown();
+  unlink(path.c_str());
+}
+
+
+int main(int argc, char *argv[]) {
+  try {
+    if (argc < 2) THROW("Usage: " << argv[0] << " <test>");
+    string test = argv[1];
+
+    if (test == "loops") testLoops();
+    else if (test == "range") testRange();
+    else if (test == "started") testConnections(true);
+    else if (test == "unstarted") testConnections(false);
+    else THROW("Unknown test " << test);
+
+    return 0;
+
+  } CATCH_ERROR;
+
+  return 1;
+}